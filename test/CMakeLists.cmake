@@ -51,7 +51,11 @@ auto_compile_frag_shaders(compile_all_vulkan_frag
     ${TEST_EXECUTABLE_OUTPUT_PATH}/vulkan/shaders)
 
 # auto_add_ray_tracing("ray_tracing/one" "glm_modules")
-auto_add_ray_tracing("ray_tracing/next" "stb")
+# NOTE: tinyobjloader / tinygltf 给 triangle_mesh 的 OBJ / glTF 加载用（mesh_loader.hpp）
+auto_add_ray_tracing("ray_tracing/next" "stb;tinyobjloader;tinygltf")
 file(COPY ${CMAKE_SOURCE_DIR}/test/ray_tracing/images
     DESTINATION ${TEST_EXECUTABLE_OUTPUT_PATH}/ray_tracing
-    FILES_MATCHING PATTERN "*")
\ No newline at end of file
+    FILES_MATCHING PATTERN "*")
+file(COPY ${CMAKE_SOURCE_DIR}/test/ray_tracing/scenes
+    DESTINATION ${TEST_EXECUTABLE_OUTPUT_PATH}/ray_tracing
+    FILES_MATCHING PATTERN "*.scene")
\ No newline at end of file
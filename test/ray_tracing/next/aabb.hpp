@@ -4,6 +4,7 @@
 
 #include "interval.hpp"
 #include "ray.hpp"
+#include "render_stats.hpp"
 #include "vec3.hpp"
 
 // NOLINTBEGIN
@@ -98,6 +99,14 @@ class aabb
     */
     [[nodiscard]] bool hit(const ray &r, interval ray_t) const
     {
+        return clip(r, ray_t);
+    }
+
+    // NOTE: 与 hit 相同的 slab 测试，但把光线在盒子内的 [进入, 离开] 区间写回 ray_t。
+    // 体积渲染需要进出距离，一次 slab 测试就能得到，不必再对边界做两次完整求交
+    [[nodiscard]] bool clip(const ray &r, interval &ray_t) const
+    {
+        count_stat(render_stat::ray_box_tests);
         const point3 &ray_orig = r.origin();
         const vec3 &ray_dir = r.direction();
 
@@ -188,4 +197,16 @@ aabb operator+(const vec3 &offset, const aabb &bbox)
     return bbox + offset;
 }
 
+// NOTE: 运动包围盒：把 t=0 和 t=1 两个时刻的包围盒按时间线性插值。
+// 只要图元做线性运动，插值结果就包含该时刻的图元；父节点取两端各自的并集，插值后仍然保守
+inline interval lerp(const interval &a, const interval &b, double t)
+{
+    return {a.min + ((b.min - a.min) * t), a.max + ((b.max - a.max) * t)};
+}
+
+inline aabb lerp(const aabb &box0, const aabb &box1, double t)
+{
+    return {lerp(box0.x, box1.x, t), lerp(box0.y, box1.y, t), lerp(box0.z, box1.z, t)};
+}
+
 // NOLINTEND
\ No newline at end of file
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "color.hpp"
+
+/*
+NOTE: 渲染区域与累加缓冲区
+render_region 描述一次（部分）渲染的工作量：像素矩形 [x0, x1) x [y0, y1)，
+以及每个像素的样本序号区间 [sample_begin, sample_end)。
+整幅图、一块 tile、或者"全部像素的第 100~199 个样本"都是一个 render_region。
+
+accumulation_buffer 保存区域内每个像素的样本颜色之和（double）和样本数，而不是平均值：
+合并几个部分结果只要把和与样本数分别相加，平均值 = 总和 / 总样本数，按样本数加权是自动的。
+    按 tile 切分：各部分像素不重叠，合并结果与单进程渲染逐位相同
+    按样本切分：同一像素的和按不同顺序相加，差别在 double 舍入误差的量级
+哈希采样器（stratified / halton / sobol）按"像素 + 样本序号"取数，切分样本区间不影响取到的样本；
+independent 采样器用线程随机引擎，各部分需要不同的种子。
+
+文件格式（.accum）：定长文件头 + 区域内每个像素的 color 和（3 个 double）+ 每个像素的样本数（uint32）。
+*/
+struct render_region // NOLINT
+{
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+    int sample_begin = 0;
+    int sample_end = 0;
+
+    [[nodiscard]] int width() const
+    {
+        return x1 - x0;
+    }
+
+    [[nodiscard]] int height() const
+    {
+        return y1 - y0;
+    }
+
+    [[nodiscard]] int samples() const
+    {
+        return sample_end - sample_begin;
+    }
+
+    [[nodiscard]] bool valid(int image_width, int image_height) const
+    {
+        return 0 <= x0 && x0 < x1 && x1 <= image_width && 0 <= y0 && y0 < y1 &&
+               y1 <= image_height && 0 <= sample_begin && sample_begin < sample_end;
+    }
+
+    // 整幅图、所有样本
+    static render_region full(int image_width, int image_height, int samples_per_pixel)
+    {
+        return {0, 0, image_width, image_height, 0, samples_per_pixel};
+    }
+};
+
+class accumulation_buffer // NOLINT
+{
+  public:
+    static constexpr uint32_t k_version = 1;
+
+    accumulation_buffer() = default;
+
+    accumulation_buffer(int image_width, int image_height, const render_region &region)
+        : image_width_(image_width), image_height_(image_height), region_(region),
+          sums_(static_cast<size_t>(region.width()) * region.height(), color(0, 0, 0)),
+          counts_(sums_.size(), 0)
+    {
+    }
+
+    [[nodiscard]] int image_width() const
+    {
+        return image_width_;
+    }
+
+    [[nodiscard]] int image_height() const
+    {
+        return image_height_;
+    }
+
+    [[nodiscard]] const render_region &region() const
+    {
+        return region_;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return sums_.empty();
+    }
+
+    // (x, y) 是整幅图中的坐标，必须在 region 内
+    void add(int x, int y, const color &sum, uint32_t samples)
+    {
+        auto i = index(x, y);
+        sums_[i] += sum;
+        counts_[i] += samples;
+    }
+
+    [[nodiscard]] const color &sum(int x, int y) const
+    {
+        return sums_[index(x, y)];
+    }
+
+    [[nodiscard]] uint32_t samples(int x, int y) const
+    {
+        return counts_[index(x, y)];
+    }
+
+    // 像素的平均颜色；没有样本的像素是黑色。与 camera::render 一样乘以 1/样本数，结果逐位相同
+    [[nodiscard]] color average(int x, int y) const
+    {
+        auto i = index(x, y);
+        if (counts_[i] == 0)
+            return {0, 0, 0};
+        return (1.0 / counts_[i]) * sums_[i];
+    }
+
+    // 把 other 的区域累加进来；图像尺寸不同或 other 超出本缓冲区的区域时失败
+    bool merge(const accumulation_buffer &other)
+    {
+        const auto &r = other.region_;
+        if (other.image_width_ != image_width_ || other.image_height_ != image_height_ ||
+            r.x0 < region_.x0 || r.y0 < region_.y0 || r.x1 > region_.x1 ||
+            r.y1 > region_.y1)
+        {
+            std::cerr << "ERROR: Accumulation buffer does not fit the merge target.\n";
+            return false;
+        }
+        for (int y = r.y0; y < r.y1; y++)
+            for (int x = r.x0; x < r.x1; x++)
+                add(x, y, other.sum(x, y), other.samples(x, y));
+        region_.sample_begin = std::min(region_.sample_begin, r.sample_begin);
+        region_.sample_end = std::max(region_.sample_end, r.sample_end);
+        return true;
+    }
+
+    // 与 camera::render 相同的 PPM 输出（gamma 2，截断到 [0, 255]）
+    void write_ppm(std::ostream &out) const
+    {
+        out << "P3\n" << region_.width() << ' ' << region_.height() << "\n255\n";
+        for (int y = region_.y0; y < region_.y1; y++)
+            for (int x = region_.x0; x < region_.x1; x++)
+                write_color(out, average(x, y));
+    }
+
+    // 先写临时文件再改名，中途失败不会留下半个文件
+    [[nodiscard]] bool save(const std::string &path) const
+    {
+        auto tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!out || !write(out))
+            {
+                std::cerr << "ERROR: Could not write '" << tmp_path << "'.\n";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, path, ec);
+        return !ec;
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            std::cerr << "ERROR: Could not open accumulation file '" << path << "'.\n";
+            return false;
+        }
+        if (!read(in))
+        {
+            std::cerr << "ERROR: '" << path << "' is not a valid accumulation file.\n";
+            return false;
+        }
+        return true;
+    }
+
+    // 写到已打开的二进制流，其他文件（例如 checkpoint）可以把累加缓冲区嵌在自己的格式里
+    bool write(std::ostream &out) const
+    {
+        auto h = make_header();
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h)); // NOLINT
+        out.write(reinterpret_cast<const char *>(sums_.data()),  // NOLINT
+                  static_cast<std::streamsize>(sums_.size() * sizeof(color)));
+        out.write(reinterpret_cast<const char *>(counts_.data()), // NOLINT
+                  static_cast<std::streamsize>(counts_.size() * sizeof(uint32_t)));
+        return static_cast<bool>(out);
+    }
+
+    // 文件头不对或数据不完整时返回 false，*this 不变
+    bool read(std::istream &in)
+    {
+        header h{};
+        in.read(reinterpret_cast<char *>(&h), sizeof(h)); // NOLINT
+        if (!in || std::memcmp(h.magic, k_magic, sizeof(h.magic)) != 0 ||
+            h.version != k_version || h.endian != k_endian ||
+            !h.region.valid(h.image_width, h.image_height))
+            return false;
+
+        accumulation_buffer buffer(h.image_width, h.image_height, h.region);
+        in.read(reinterpret_cast<char *>(buffer.sums_.data()), // NOLINT
+                static_cast<std::streamsize>(buffer.sums_.size() * sizeof(color)));
+        in.read(reinterpret_cast<char *>(buffer.counts_.data()), // NOLINT
+                static_cast<std::streamsize>(buffer.counts_.size() * sizeof(uint32_t)));
+        if (!in)
+            return false;
+        *this = std::move(buffer);
+        return true;
+    }
+
+  private:
+    static constexpr char k_magic[8] = {'R', 'T', 'A', 'C', 'C', 'U', 'M', '\0'};
+    static constexpr uint32_t k_endian = 0x01020304;
+
+    struct header
+    {
+        char magic[8]; // NOLINT
+        uint32_t version;
+        uint32_t endian;
+        int32_t image_width;
+        int32_t image_height;
+        render_region region;
+    };
+
+    int image_width_ = 0;
+    int image_height_ = 0;
+    render_region region_;
+    std::vector<color> sums_;
+    std::vector<uint32_t> counts_;
+
+    [[nodiscard]] size_t index(int x, int y) const
+    {
+        auto row = static_cast<size_t>(y - region_.y0);
+        return (row * region_.width()) + (x - region_.x0);
+    }
+
+    [[nodiscard]] header make_header() const
+    {
+        header h{};
+        std::memcpy(h.magic, k_magic, sizeof(h.magic));
+        h.version = k_version;
+        h.endian = k_endian;
+        h.image_width = image_width_;
+        h.image_height = image_height_;
+        h.region = region_;
+        return h;
+    }
+};
@@ -0,0 +1,255 @@
+#include "denoiser.hpp"
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "sampler.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 降噪 benchmark：达到目标质量需要多少 spp
+    bench_denoiser [--scene cornell_box|bvh] [--width N] [--ref-spp N] [--max-spp N]
+                   [--psnr dB] [--ssim 值] [--sampler 名字] [--threads N] [--seed N]
+                   [--out 文件]
+
+1. 用 ref-spp 个样本（默认 8192）渲染参考图
+2. spp = 1, 2, 4, ... max-spp，渲染同一场景（同时得到特征缓冲区），再降噪，
+   分别计算原图和降噪图与参考图的 PSNR、SSIM
+3. 最后输出原图和降噪图各自第一次达到 --psnr（默认 28 dB）和 --ssim（默认 0.8）的 spp
+
+PSNR / SSIM 在显示空间算：gamma 2、截断到 [0, 1]，与 PPM 输出一致；SSIM 用亮度、7x7 窗口。
+每个 spp 输出一行 JSON：render_s（包含特征缓冲区）、denoise_ms、两组指标。
+参考图自身也有噪声，很高的 spp 时指标会趋于饱和。
+*/
+
+struct bench_options
+{
+    std::string scene = "cornell_box";
+    std::string out;
+    int width = 64;
+    int ref_spp = 8192;
+    int max_spp = 2048;
+    double target_psnr = 28;
+    double target_ssim = 0.8;
+    sampler_type sampling = sampler_type::sobol;
+    int threads = 0;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+// 与 write_color 相同的显示变换，不量化
+double display_value(double linear)
+{
+    auto v = linear > 0 ? std::sqrt(linear) : 0.0;
+    return std::fmin(v, 1.0);
+}
+
+double psnr(const std::vector<color> &image, const std::vector<color> &reference)
+{
+    double sum = 0;
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            auto d = display_value(image[i][c]) - display_value(reference[i][c]);
+            sum += d * d;
+        }
+    }
+    auto mse = sum / (3.0 * static_cast<double>(image.size()));
+    return mse > 0 ? 10.0 * std::log10(1.0 / mse) : 99.0;
+}
+
+std::vector<double> display_luminance(const std::vector<color> &image)
+{
+    std::vector<double> y(image.size());
+    for (size_t i = 0; i < image.size(); i++)
+        y[i] = (0.2126 * display_value(image[i][0])) +
+               (0.7152 * display_value(image[i][1])) +
+               (0.0722 * display_value(image[i][2]));
+    return y;
+}
+
+// 7x7 窗口的平均 SSIM（窗口完全在图像内的位置）
+double ssim(const std::vector<color> &image, const std::vector<color> &reference,
+            int width, int height)
+{
+    constexpr int k_radius = 3;
+    constexpr double c1 = 0.01 * 0.01;
+    constexpr double c2 = 0.03 * 0.03;
+    auto a = display_luminance(image);
+    auto b = display_luminance(reference);
+
+    double total = 0;
+    int windows = 0;
+    for (int y = k_radius; y < height - k_radius; y++)
+    {
+        for (int x = k_radius; x < width - k_radius; x++)
+        {
+            double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (int dy = -k_radius; dy <= k_radius; dy++)
+            {
+                for (int dx = -k_radius; dx <= k_radius; dx++)
+                {
+                    auto i = (static_cast<size_t>(y + dy) * width) + (x + dx);
+                    sa += a[i];
+                    sb += b[i];
+                    saa += a[i] * a[i];
+                    sbb += b[i] * b[i];
+                    sab += a[i] * b[i];
+                }
+            }
+            constexpr double n = (2 * k_radius + 1) * (2 * k_radius + 1);
+            auto mean_a = sa / n;
+            auto mean_b = sb / n;
+            auto var_a = (saa / n) - (mean_a * mean_a);
+            auto var_b = (sbb / n) - (mean_b * mean_b);
+            auto cov = (sab / n) - (mean_a * mean_b);
+            total += ((2 * mean_a * mean_b + c1) * (2 * cov + c2)) /
+                     ((mean_a * mean_a + mean_b * mean_b + c1) * (var_a + var_b + c2));
+            windows++;
+        }
+    }
+    return windows > 0 ? total / windows : 1.0;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--scene")
+            options.scene = value;
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--width")
+            options.width = std::stoi(value);
+        else if (key == "--ref-spp")
+            options.ref_spp = std::stoi(value);
+        else if (key == "--max-spp")
+            options.max_spp = std::stoi(value);
+        else if (key == "--psnr")
+            options.target_psnr = std::stod(value);
+        else if (key == "--ssim")
+            options.target_ssim = std::stod(value);
+        else if (key == "--threads")
+            options.threads = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else if (key == "--sampler")
+        {
+            if (!parse_sampler_type(value, options.sampling))
+            {
+                std::cerr << "ERROR: unknown sampler '" << value << "'.\n";
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(options.seed);
+    reference_scene scene;
+    if (options.scene == "cornell_box")
+        scene = cornell_box_scene();
+    else if (options.scene == "bvh")
+        scene = bvh_scene();
+    else
+    {
+        std::cerr << "ERROR: unknown scene '" << options.scene << "'.\n";
+        return 1;
+    }
+    auto world = flat_bvh_accel(scene.world);
+    auto cam = scene.cam;
+    cam.image_width = options.width;
+    cam.sampling = options.sampling;
+    auto height = cam.image_height();
+
+    // 参考图用不同的种子，避免与被测图像相关
+    auto ref_begin = std::chrono::steady_clock::now();
+    cam.samples_per_pixel = options.ref_spp;
+    cam.sampler_seed = options.seed + 1;
+    seed_random(options.seed + 1);
+    auto reference = cam.render_linear(world, !scene.sky);
+    std::clog << std::format("reference: {} spp in {:.2f} s\n", options.ref_spp,
+                             ms_since(ref_begin) / 1000.0);
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+    auto emit = [&](const std::string &line) {
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    };
+
+    denoise_options denoise_settings;
+    denoise_settings.threads = options.threads;
+    int raw_psnr_spp = 0, raw_ssim_spp = 0, denoised_psnr_spp = 0, denoised_ssim_spp = 0;
+    auto reached = [](int &slot, int spp, bool ok) {
+        if (ok && slot == 0)
+            slot = spp;
+    };
+
+    for (int spp = 1; spp <= options.max_spp; spp *= 2)
+    {
+        cam.samples_per_pixel = spp;
+        cam.sampler_seed = options.seed;
+        seed_random(options.seed);
+
+        // 特征缓冲区的开销：同样的渲染不带特征再跑一次
+        auto plain_begin = std::chrono::steady_clock::now();
+        auto plain = cam.render_linear(world, !scene.sky);
+        auto plain_s = ms_since(plain_begin) / 1000.0;
+
+        seed_random(options.seed);
+        feature_buffers features;
+        auto begin = std::chrono::steady_clock::now();
+        auto image = cam.render_linear(world, !scene.sky, &features);
+        auto render_s = ms_since(begin) / 1000.0;
+
+        auto denoise_begin = std::chrono::steady_clock::now();
+        auto denoised = denoise(image, features, denoise_settings);
+        auto denoise_ms = ms_since(denoise_begin);
+
+        auto raw_psnr = psnr(image, reference);
+        auto raw_ssim = ssim(image, reference, options.width, height);
+        auto den_psnr = psnr(denoised, reference);
+        auto den_ssim = ssim(denoised, reference, options.width, height);
+        reached(raw_psnr_spp, spp, raw_psnr >= options.target_psnr);
+        reached(raw_ssim_spp, spp, raw_ssim >= options.target_ssim);
+        reached(denoised_psnr_spp, spp, den_psnr >= options.target_psnr);
+        reached(denoised_ssim_spp, spp, den_ssim >= options.target_ssim);
+
+        emit(std::format(
+            "{{\"scene\":\"{}\",\"width\":{},\"spp\":{},\"render_s\":{:.4f},"
+            "\"render_no_features_s\":{:.4f},\"denoise_ms\":{:.2f},\"psnr\":{:.2f},"
+            "\"ssim\":{:.4f},\"denoised_psnr\":{:.2f},\"denoised_ssim\":{:.4f}}}",
+            options.scene, options.width, spp, render_s, plain_s, denoise_ms, raw_psnr,
+            raw_ssim, den_psnr, den_ssim));
+    }
+
+    // 0 表示在 max-spp 以内没有达到
+    emit(std::format("{{\"summary\":true,\"target_psnr\":{:.1f},\"target_ssim\":{:.3f},"
+                     "\"spp_psnr\":{},\"spp_psnr_denoised\":{},\"spp_ssim\":{},"
+                     "\"spp_ssim_denoised\":{}}}",
+                     options.target_psnr, options.target_ssim, raw_psnr_spp,
+                     denoised_psnr_spp, raw_ssim_spp, denoised_ssim_spp));
+    return 0;
+}
+
+// NOLINTEND
@@ -0,0 +1,184 @@
+#include "camera.hpp"
+#include "environment_map.hpp"
+#include "flat_bvh.hpp"
+#include "material.hpp"
+#include "quad.hpp"
+#include "sphere.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: HDR 环境光 benchmark（environment_map.hpp）
+    bench_environment_map [--hdr 文件] [--intensity X] [--width N] [--ref-spp N]
+                          [--max-spp N] [--seed N] [--out 文件]
+
+室外场景：灰色地面上三个漫反射球，只由环境光照明。
+环境采样只在漫反射点上做；金属、玻璃反射 / 折射太阳形成的高光和焦散只有散射方向能找到，
+两种方式一样吵，会盖住差别，所以这里不放。
+环境贴图默认是程序生成的 1024×512 天空：渐变天空加一个角半径 1° 的太阳，
+太阳的亮度是天空的两万倍，地面上的光照大部分来自它。--hdr 换成任意经纬度展开的 HDR 图片。
+1. 用环境采样 + MIS、ref-spp 个样本（默认 1024）渲染参考图
+2. spp = 1, 2, 4, ... max-spp，两种方式各渲染一次，输出与参考图的 RMSE：
+       bsdf   只靠散射方向碰到环境（environment_sampling = false）
+       mis    漫反射点上按贴图亮度取方向，与散射方向 MIS 合并
+bsdf 碰到太阳的概率与太阳的立体角成正比，阴影和亮面都是噪点；
+mis 达到同样的 RMSE 只需要它的一小部分样本。
+*/
+
+struct bench_options
+{
+    std::string hdr;
+    std::string out;
+    double intensity = 1.0;
+    int width = 96;
+    int ref_spp = 1024;
+    int max_spp = 64;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+double rmse(const std::vector<color> &image, const std::vector<color> &reference)
+{
+    double sum = 0;
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        auto d = image[i] - reference[i];
+        sum += d.length_squared();
+    }
+    return std::sqrt(sum / (3.0 * static_cast<double>(image.size())));
+}
+
+// 渐变天空 + 太阳，地平线以下是暗的地面色
+std::shared_ptr<environment_map> sun_sky(int width, int height, double intensity)
+{
+    auto sun = unit_vector(vec3(-0.6, std::tan(degrees_to_radians(35)), -0.4));
+    auto cos_sun = std::cos(degrees_to_radians(1));
+    std::vector<color> pixels;
+    pixels.reserve(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            auto d = environment_map::direction_of((x + 0.5) / width, (y + 0.5) / height);
+            auto a = std::max(0.0, d.y());
+            color c = d.y() < 0 ? color(0.1, 0.1, 0.1)
+                                : ((1.0 - a) * color(1.0, 1.0, 1.0)) +
+                                      (a * color(0.5, 0.7, 1.0));
+            if (dot(d, sun) >= cos_sun)
+                c = 20000 * color(1.0, 0.95, 0.85);
+            pixels.push_back(c);
+        }
+    }
+    return std::make_shared<environment_map>(width, height, std::move(pixels), intensity);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--hdr")
+            options.hdr = value;
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--intensity")
+            options.intensity = std::stod(value);
+        else if (key == "--width")
+            options.width = std::stoi(value);
+        else if (key == "--ref-spp")
+            options.ref_spp = std::stoi(value);
+        else if (key == "--max-spp")
+            options.max_spp = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    auto environment = options.hdr.empty()
+                           ? sun_sky(1024, 512, options.intensity)
+                           : environment_map::load(options.hdr, options.intensity);
+    if (!environment)
+        return 1;
+
+    hittable_list scene;
+    auto ground = std::make_shared<lambertian>(color(0.5, 0.5, 0.5));
+    auto red = std::make_shared<lambertian>(color(0.7, 0.3, 0.2));
+    auto white = std::make_shared<lambertian>(color(0.8, 0.8, 0.8));
+    auto blue = std::make_shared<lambertian>(color(0.2, 0.4, 0.7));
+    scene.add(std::make_shared<quad>(point3(-50, 0, -50), vec3(100, 0, 0),
+                                     vec3(0, 0, 100), ground));
+    scene.add(std::make_shared<sphere>(point3(-2.2, 1, 0), 1.0, red));
+    scene.add(std::make_shared<sphere>(point3(0, 1, 0), 1.0, white));
+    scene.add(std::make_shared<sphere>(point3(2.2, 1, 0), 1.0, blue));
+    auto world = flat_bvh_accel(scene);
+
+    camera cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = options.width;
+    cam.max_depth = 8;
+    cam.vfov = 40;
+    cam.lookfrom = point3(0, 3, 9);
+    cam.lookat = point3(0, 0.8, 0);
+    cam.environment = environment;
+    cam.sampling = sampler_type::sobol;
+    cam.show_progress = false;
+
+    auto render = [&](bool environment_sampling, int spp, uint32_t seed) {
+        auto c = cam;
+        c.environment_sampling = environment_sampling;
+        c.samples_per_pixel = spp;
+        c.sampler_seed = seed;
+        seed_random(seed);
+        return c.render_linear(world, true);
+    };
+
+    // 参考图用不同的种子，避免与被测图像相关
+    auto ref_begin = std::chrono::steady_clock::now();
+    auto reference = render(true, options.ref_spp, options.seed + 1);
+    std::clog << std::format("reference: {} spp in {:.2f} s\n", options.ref_spp,
+                             ms_since(ref_begin) / 1000.0);
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    for (auto environment_sampling : {false, true})
+    {
+        for (int spp = 1; spp <= options.max_spp; spp *= 2)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            auto image = render(environment_sampling, spp, options.seed);
+            auto render_s = ms_since(begin) / 1000.0;
+
+            auto line = std::format(
+                "{{\"environment\":\"{}\",\"mode\":\"{}\",\"width\":{},\"spp\":{},"
+                "\"ref_spp\":{},\"render_s\":{:.4f},\"rmse\":{:.6f}}}",
+                options.hdr.empty() ? "sun_sky" : options.hdr,
+                environment_sampling ? "mis" : "bsdf", options.width, spp,
+                options.ref_spp, render_s, rmse(image, reference));
+            std::cout << line << '\n' << std::flush;
+            if (out.is_open())
+                out << line << '\n';
+        }
+    }
+    return 0;
+}
+
+// NOLINTEND
@@ -0,0 +1,219 @@
+#include "bvh_node.hpp"
+#include "flat_bvh.hpp"
+#include "lbvh.hpp"
+#include "material.hpp"
+#include "sphere.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: LBVH 构建 benchmark
+    bench_lbvh [--count N] [--rays N] [--repeat N] [--threads N] [--seed N] [--out 文件]
+
+N 个随机球（默认 10^6，与 bench_quantized_bvh 相同的分布），比较构建速度和树的质量：
+    bvh_node      shared_ptr 树，随机轴中位数分割（原实现）
+    flat_bvh      分桶 SAH
+    lbvh63        63 位 Morton 码 LBVH，--threads 个线程（默认全部核）
+    lbvh30        30 位 Morton 码
+    lbvh63_1t     63 位，单线程，看并行的收益
+每种输出一行 JSON：
+    build_ms      只算从包围盒数组到 BVH 的时间（bvh_node 是整棵树的构建），repeat 次中的最小值
+    accel_ms      在已经建好的 BVH 上创建 flat_bvh_accel（叶子里的球打包），每帧重建时也要付
+    sah_cost      SAH 代价（访问一个节点 = 1，求交一个图元 = 1，按面积加权），越小树越好；bvh_node 为 null
+    mrays_per_s   单线程最近交点吞吐；mismatches 是与 flat_bvh 结果不同的光线数，应该为 0
+*/
+
+struct bench_options
+{
+    size_t count = 1000000;
+    size_t rays = 1000000;
+    int repeat = 5;
+    int threads = 0;
+    uint32_t seed = 20240601;
+    std::string out;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+double half_area(const flat_bvh_node &node)
+{
+    double d[3];
+    for (int axis = 0; axis < 3; axis++)
+        d[axis] = static_cast<double>(node.max[axis]) - node.min[axis];
+    return (d[0] * d[1]) + (d[1] * d[2]) + (d[2] * d[0]);
+}
+
+double sah_cost(const flat_bvh &bvh)
+{
+    const auto nodes = bvh.nodes();
+    auto root_area = half_area(nodes[0]);
+    double cost = 0;
+    for (const auto &node : nodes)
+        cost += half_area(node) / root_area * (node.count > 0 ? node.count : 1.0);
+    return cost;
+}
+
+struct accel_result
+{
+    std::shared_ptr<hittable> accel;
+    double build_ms = 0;
+    double accel_ms = 0;
+    size_t nodes = 0;
+    double sah = -1;
+};
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--count")
+            options.count = std::stoull(value);
+        else if (key == "--rays")
+            options.rays = std::stoull(value);
+        else if (key == "--repeat")
+            options.repeat = std::max(1, std::stoi(value));
+        else if (key == "--threads")
+            options.threads = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else if (key == "--out")
+            options.out = value;
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(options.seed);
+    auto side = std::cbrt(static_cast<double>(options.count));
+    auto mat = std::make_shared<lambertian>(color(0.5, 0.5, 0.5));
+    hittable_list world;
+    world.objects.reserve(options.count);
+    for (size_t i = 0; i < options.count; i++)
+    {
+        point3 center(random_double(0, side), random_double(0, side),
+                      random_double(0, side));
+        world.add(std::make_shared<sphere>(center, random_double(0.1, 0.3), mat));
+    }
+    std::vector<aabb> boxes;
+    boxes.reserve(world.objects.size());
+    for (const auto &object : world.objects)
+        boxes.push_back(object->bounding_box());
+
+    std::vector<ray> rays;
+    rays.reserve(options.rays);
+    for (size_t i = 0; i < options.rays; i++)
+    {
+        point3 origin(random_double(0, side), random_double(0, side),
+                      random_double(0, side));
+        rays.emplace_back(origin, random_unit_vector());
+    }
+
+    // 反复构建取最小值，最后一次的结果包装成 flat_bvh_accel
+    auto flat = [&](const std::function<flat_bvh()> &build) {
+        accel_result result;
+        result.build_ms = infinity;
+        flat_bvh bvh;
+        for (int round = 0; round < options.repeat; round++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            bvh = build();
+            result.build_ms = std::min(result.build_ms, ms_since(begin));
+        }
+        result.nodes = bvh.nodes().size();
+        result.sah = sah_cost(bvh);
+        auto begin = std::chrono::steady_clock::now();
+        result.accel = std::make_shared<flat_bvh_accel>(world.objects, std::move(bvh));
+        result.accel_ms = ms_since(begin);
+        return result;
+    };
+
+    const std::vector<std::pair<std::string, std::function<accel_result()>>> accels = {
+        {"bvh_node",
+         [&] {
+             accel_result result;
+             auto begin = std::chrono::steady_clock::now();
+             result.accel = std::make_shared<bvh_node>(world);
+             result.build_ms = ms_since(begin);
+             return result;
+         }},
+        {"flat_bvh", [&] { return flat([&] { return flat_bvh::build(boxes); }); }},
+        {"lbvh63",
+         [&] {
+             return flat([&] {
+                 return build_lbvh(boxes, lbvh_builder::k_default_max_leaf_size, 63,
+                                   options.threads);
+             });
+         }},
+        {"lbvh30",
+         [&] {
+             return flat([&] {
+                 return build_lbvh(boxes, lbvh_builder::k_default_max_leaf_size, 30,
+                                   options.threads);
+             });
+         }},
+        {"lbvh63_1t",
+         [&] {
+             return flat([&] {
+                 return build_lbvh(boxes, lbvh_builder::k_default_max_leaf_size, 63,
+                                   1);
+             });
+         }},
+    };
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    std::vector<double> reference; // flat_bvh 的最近交点，miss 为 infinity
+    for (const auto &[name, make] : accels)
+    {
+        auto result = make();
+
+        std::vector<double> hits(rays.size(), infinity);
+        auto trace_begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            hit_record rec;
+            if (result.accel->hit(rays[i], interval(0.001, infinity), rec))
+                hits[i] = rec.t;
+        }
+        auto trace_s = ms_since(trace_begin) / 1000.0;
+
+        if (name == "flat_bvh")
+            reference = hits;
+        size_t mismatches = 0;
+        if (!reference.empty())
+            for (size_t i = 0; i < hits.size(); i++)
+                mismatches += hits[i] != reference[i] ? 1 : 0;
+
+        auto line = std::format(
+            "{{\"accel\":\"{}\",\"primitives\":{},\"build_ms\":{:.3f},"
+            "\"accel_ms\":{:.3f},\"nodes\":{},\"sah_cost\":{},\"rays\":{},\"mrays_per_s\":{:.3f},"
+            "\"mismatches\":{}}}",
+            name, options.count, result.build_ms, result.accel_ms, result.nodes,
+            result.sah < 0 ? std::string("null") : std::format("{:.2f}", result.sah),
+            rays.size(), rays.size() / trace_s / 1e6,
+            reference.empty() ? std::string("null") : std::to_string(mismatches));
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    }
+    return 0;
+}
+
+// NOLINTEND
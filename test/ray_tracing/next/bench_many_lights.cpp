@@ -0,0 +1,257 @@
+#include "camera.hpp"
+#include "flat_bvh.hpp"
+#include "light_sampler.hpp"
+#include "material.hpp"
+#include "quad.hpp"
+#include "sphere.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 多光源 benchmark（light_sampler.hpp）
+    bench_many_lights [--counts 1000,10000,100000] [--width N] [--spp N] [--ref-spp N]
+                      [--depth N] [--seed N] [--out 文件]
+
+漫反射地面上方散布 N 个小的发光球（亮度相差 40 倍），地上有 N/10 个漫反射球，背景是黑的。
+相机在发光球下面往下看，看不到光源本身：直接看到的光源边缘的噪声各种方式都一样，会掩盖差别。
+对每个 N：
+1. 用光源 BVH、ref-spp 个样本（默认 256）渲染参考图
+2. 相同 spp（默认 4）下比较挑光源的方式：
+       none      不做光源采样，只靠漫反射弹到光源（原来的 render_with_background）
+       uniform   等概率挑光源
+       power     按功率挑（别名表）
+       bvh       光源 BVH，考虑距离和着色点的法线
+每种输出一行 JSON：build_ms（构建 light_sampler）、render_s、与参考图的 rmse。
+另外不做光源采样也渲染 ref-spp 个样本，检查两张图的平均亮度一致（"check":"mean"）：
+光源采样只改变方差，不改变期望；逐像素之差的平均值超过 3 倍标准误差时在 stderr 报错，退出码为 1。
+场景里间接光很少，--depth 1 时最容易看出最后一次反弹多算了光源采样这类错误。
+光源越多，none 和 uniform 的误差越大：绝大多数光源离着色点很远，几乎没有贡献；
+光源 BVH 的每个样本多花 O(log N) 次重要性计算，换来的是同样时间下低得多的误差。
+*/
+
+struct bench_options
+{
+    std::vector<size_t> counts = {1000, 10000, 100000};
+    std::string out;
+    int width = 64;
+    int spp = 4;
+    int ref_spp = 256;
+    int depth = 5;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+double rmse(const std::vector<color> &image, const std::vector<color> &reference)
+{
+    double sum = 0;
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        auto d = image[i] - reference[i];
+        sum += d.length_squared();
+    }
+    return std::sqrt(sum / (3.0 * static_cast<double>(image.size())));
+}
+
+// 两张图平均亮度之差，以标准误差为单位：逐像素取差（图像内容相消，只剩噪声），
+// 差的平均值除以它的标准误差
+double mean_difference_sigmas(const std::vector<color> &a, const std::vector<color> &b)
+{
+    double sum = 0;
+    double sum2 = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        auto d = ((a[i].x() + a[i].y() + a[i].z()) - (b[i].x() + b[i].y() + b[i].z())) / 3;
+        sum += d;
+        sum2 += d * d;
+    }
+    auto n = static_cast<double>(a.size());
+    auto mean = sum / n;
+    auto error = std::sqrt(std::max(0.0, (sum2 / n) - (mean * mean)) / n);
+    return error > 0 ? std::fabs(mean) / error : 0.0;
+}
+
+double mean(const std::vector<color> &image)
+{
+    double sum = 0;
+    for (const auto &p : image)
+        sum += (p.x() + p.y() + p.z()) / 3;
+    return sum / static_cast<double>(image.size());
+}
+
+hittable_list many_lights_scene(size_t count, double side)
+{
+    hittable_list world;
+    auto ground = std::make_shared<lambertian>(color(0.6, 0.6, 0.6));
+    world.add(std::make_shared<quad>(point3(-side / 2, 0, -side / 2), vec3(side, 0, 0),
+                                     vec3(0, 0, side), ground));
+
+    std::vector<std::shared_ptr<material>> emitters;
+    for (int i = 0; i < 8; i++)
+    {
+        auto strength = 0.5 * std::pow(40.0, i / 7.0);
+        emitters.push_back(std::make_shared<diffuse_light>(
+            strength * color(random_double(0.5, 1), random_double(0.5, 1),
+                             random_double(0.5, 1))));
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        point3 center(random_double(-side / 2, side / 2), random_double(2.5, 4),
+                      random_double(-side / 2, side / 2));
+        world.add(std::make_shared<sphere>(center, random_double(0.05, 0.15),
+                                           emitters[random_int(0, 7)]));
+    }
+
+    auto diffuse = std::make_shared<lambertian>(color(0.7, 0.5, 0.3));
+    for (size_t i = 0; i < count / 10; i++)
+    {
+        auto radius = random_double(0.2, 0.6);
+        point3 center(random_double(-side / 2, side / 2), radius,
+                      random_double(-side / 2, side / 2));
+        world.add(std::make_shared<sphere>(center, radius, diffuse));
+    }
+    return world;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--counts")
+        {
+            options.counts.clear();
+            std::stringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ','))
+                options.counts.push_back(std::stoull(item));
+        }
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--width")
+            options.width = std::stoi(value);
+        else if (key == "--spp")
+            options.spp = std::stoi(value);
+        else if (key == "--ref-spp")
+            options.ref_spp = std::stoi(value);
+        else if (key == "--depth")
+            options.depth = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+    auto emit = [&](const std::string &line) {
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    };
+    int status = 0;
+
+    for (auto count : options.counts)
+    {
+        seed_random(options.seed);
+        auto side = 2 * std::sqrt(static_cast<double>(count));
+        auto scene = many_lights_scene(count, side);
+        auto world = flat_bvh_accel(scene);
+
+        camera cam;
+        cam.aspect_ratio = 1.0;
+        cam.image_width = options.width;
+        cam.max_depth = options.depth;
+        cam.background = color(0, 0, 0);
+        cam.vfov = 50;
+        // 往下 30°，视野上沿仍在水平线以下
+        cam.lookfrom = point3(0, 2, side / 4);
+        cam.lookat = cam.lookfrom + vec3(0, -0.5, -std::sqrt(0.75));
+        cam.sampling = sampler_type::sobol;
+        cam.show_progress = false;
+
+        auto render = [&](std::shared_ptr<const light_sampler> lights, int spp,
+                          uint32_t seed) {
+            auto c = cam;
+            c.lights = std::move(lights);
+            c.samples_per_pixel = spp;
+            c.sampler_seed = seed;
+            seed_random(seed);
+            return c.render_linear(world, true);
+        };
+
+        // 参考图用不同的种子，避免与被测图像相关
+        auto ref_begin = std::chrono::steady_clock::now();
+        auto reference =
+            render(std::make_shared<light_sampler>(scene, light_selection::bvh),
+                   options.ref_spp, options.seed + 1);
+        std::clog << std::format("{} lights: reference {} spp in {:.2f} s\n", count,
+                                 options.ref_spp, ms_since(ref_begin) / 1000.0);
+
+        // 期望检查：不做光源采样的同样本数图像，平均亮度应与参考图一致
+        auto baseline = render(nullptr, options.ref_spp, options.seed + 2);
+        auto ref_mean = mean(reference);
+        auto base_mean = mean(baseline);
+        auto sigmas = mean_difference_sigmas(reference, baseline);
+        emit(std::format("{{\"lights\":{},\"check\":\"mean\",\"depth\":{},"
+                         "\"ref_spp\":{},\"lights_mean\":{:.6f},\"none_mean\":{:.6f},"
+                         "\"sigmas\":{:.2f}}}",
+                         count, options.depth, options.ref_spp, ref_mean, base_mean,
+                         sigmas));
+        if (sigmas > 3)
+        {
+            std::cerr << std::format("ERROR: {} lights: mean with light sampling {:.6f} "
+                                     "differs from {:.6f} without it.\n",
+                                     count, ref_mean, base_mean);
+            status = 1;
+        }
+
+        const std::vector<std::pair<std::string, int>> modes = {
+            {"none", -1},
+            {"uniform", static_cast<int>(light_selection::uniform)},
+            {"power", static_cast<int>(light_selection::power)},
+            {"bvh", static_cast<int>(light_selection::bvh)},
+        };
+        for (const auto &[name, mode] : modes)
+        {
+            std::shared_ptr<const light_sampler> lights;
+            auto build_begin = std::chrono::steady_clock::now();
+            if (mode >= 0)
+                lights = std::make_shared<light_sampler>(
+                    scene, static_cast<light_selection>(mode));
+            auto build_ms = ms_since(build_begin);
+
+            auto begin = std::chrono::steady_clock::now();
+            auto image = render(lights, options.spp, options.seed);
+            auto render_s = ms_since(begin) / 1000.0;
+
+            auto line = std::format(
+                "{{\"lights\":{},\"selection\":\"{}\",\"width\":{},\"spp\":{},"
+                "\"ref_spp\":{},\"build_ms\":{:.3f},\"render_s\":{:.4f},"
+                "\"rmse\":{:.6f}}}",
+                count, name, options.width, options.spp, options.ref_spp, build_ms,
+                render_s, rmse(image, reference));
+            emit(line);
+        }
+    }
+    return status;
+}
+
+// NOLINTEND
@@ -0,0 +1,186 @@
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "sampler.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 材质着色 benchmark：虚函数 vs 编译后的材质表（material_table）
+    bench_materials [--scene texture|perlin|bvh|cornell_box] [--hits N] [--repeat N]
+                    [--seed N] [--out 文件]
+
+1. 从相机位置向视野内随机方向发 hits 条光线（默认 100000），记下命中的 (ray, hit_record)
+2. 对这些命中记录反复（repeat 次）求 emitted + scatter，分别用
+       virtual：material::emitted / material::scatter（纹理沿 shared_ptr 链求值）
+       compiled：场景编译成的 material_table（一个记录数组 + 一张纹理表，按材质的下标取记录，switch 分派）
+   两种方式用同样的采样器调用，输出每次着色的纳秒数，checksum 相同说明结果逐位相同。
+3. 同样的命中记录只求反照率（surface_albedo / material_table::albedo），不取样本，
+   量的是分派和纹理求值本身：albedo_ns_per_lookup。
+散射方向的采样（采样器、sample_unit_vector）在两种方式里相同，是着色的主要开销；
+整帧渲染里时间主要花在求交上（bench_ray_tracing 的 --materials）。
+*/
+
+struct bench_options
+{
+    std::string scene = "texture";
+    std::string out;
+    int hits = 100000;
+    int repeat = 20;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+struct recorded_hit
+{
+    ray r;
+    hit_record rec;
+};
+
+// 结果的 FNV-1a 哈希（按位），两种方式应该相同
+uint64_t mix(uint64_t h, const color &c)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        uint64_t bits = 0;
+        auto value = c[i];
+        std::memcpy(&bits, &value, sizeof(bits));
+        h = (h ^ bits) * 1099511628211ULL;
+    }
+    return h;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--scene")
+            options.scene = value;
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--hits")
+            options.hits = std::stoi(value);
+        else if (key == "--repeat")
+            options.repeat = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(options.seed);
+    reference_scene scene;
+    if (options.scene == "texture")
+        scene = texture_scene();
+    else if (options.scene == "perlin")
+        scene = perlin_scene();
+    else if (options.scene == "bvh")
+        scene = bvh_scene();
+    else if (options.scene == "cornell_box")
+        scene = cornell_box_scene();
+    else
+    {
+        std::cerr << "ERROR: unknown scene '" << options.scene << "'.\n";
+        return 1;
+    }
+    auto world = flat_bvh_accel(scene.world);
+
+    // 第1步：视野内的随机光线，只保留命中的
+    auto forward = unit_vector(scene.cam.lookat - scene.cam.lookfrom);
+    auto spread = std::tan(degrees_to_radians(scene.cam.vfov) / 2);
+    std::vector<recorded_hit> hits;
+    auto wanted = static_cast<size_t>(options.hits);
+    hits.reserve(wanted);
+    for (int attempt = 0; attempt < 20 * options.hits && hits.size() < wanted; attempt++)
+    {
+        auto direction = forward + (spread * vec3::random(-1, 1));
+        recorded_hit hit{ray(scene.cam.lookfrom, direction, random_double()), {}};
+        if (world.hit(hit.r, interval(0.001, infinity), hit.rec))
+            hits.push_back(hit);
+    }
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    // 第2步：两种方式着色；采样器按 (命中序号, 轮次) 取数，两边完全一样
+    auto pixel_sampler = make_sampler(sampler_type::sobol, options.repeat, options.seed);
+    material_table table(world);
+    for (const auto *mode : {"virtual", "compiled"})
+    {
+        auto compiled = std::string(mode) == "compiled";
+        uint64_t checksum = 14695981039346656037ULL;
+        auto begin = std::chrono::steady_clock::now();
+        for (int round = 0; round < options.repeat; round++)
+        {
+            for (size_t i = 0; i < hits.size(); i++)
+            {
+                const auto &[r, rec] = hits[i];
+                pixel_sampler->start_pixel_sample(static_cast<int>(i), 0, round);
+                color attenuation(0, 0, 0);
+                ray scattered;
+                color emission;
+                bool scattered_ok = false;
+                if (compiled)
+                {
+                    emission = table.emitted(*rec.mat, rec.u, rec.v, rec.p);
+                    scattered_ok = table.scatter(*rec.mat, r, rec, attenuation, scattered,
+                                                 *pixel_sampler);
+                }
+                else
+                {
+                    emission = rec.mat->emitted(rec.u, rec.v, rec.p);
+                    scattered_ok = rec.mat->scatter(r, rec, attenuation, scattered,
+                                                    *pixel_sampler);
+                }
+                checksum = mix(checksum, emission);
+                if (scattered_ok)
+                    checksum = mix(mix(checksum, attenuation), scattered.direction());
+            }
+        }
+        auto ms = ms_since(begin);
+
+        // 第3步：只求反照率
+        auto albedo_begin = std::chrono::steady_clock::now();
+        for (int round = 0; round < options.repeat; round++)
+        {
+            for (const auto &[r, rec] : hits)
+            {
+                auto albedo = compiled ? table.albedo(*rec.mat, rec)
+                                       : rec.mat->surface_albedo(rec);
+                checksum = mix(checksum, albedo);
+            }
+        }
+        auto albedo_ms = ms_since(albedo_begin);
+        auto shades = static_cast<double>(hits.size()) * options.repeat;
+
+        auto line = std::format(
+            "{{\"scene\":\"{}\",\"materials\":\"{}\",\"hits\":{},\"repeat\":{},"
+            "\"ns_per_shade\":{:.2f},\"albedo_ns_per_lookup\":{:.2f},"
+            "\"checksum\":\"{:016x}\"}}",
+            options.scene, mode, hits.size(), options.repeat, 1e6 * ms / shades,
+            1e6 * albedo_ms / shades, checksum);
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    }
+    return 0;
+}
+
+// NOLINTEND
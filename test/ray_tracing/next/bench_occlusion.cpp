@@ -0,0 +1,190 @@
+#include "bvh_node.hpp"
+#include "flat_bvh.hpp"
+#include "quantized_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "sbvh.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 遮挡查询 benchmark：hittable::occluded（any-hit）vs hittable::hit（closest-hit）
+    bench_occlusion [--scene 名字] [--accel bvh_node|flat_bvh|sbvh|quantized_bvh16|quantized_bvh8]
+                    [--queries N] [--repeat N] [--distance 比例] [--seed N] [--out 文件]
+
+1. 从相机向视野内随机方向发光线，记下 queries 个（默认 200000）交点和法线
+2. 每个交点生成一条环境光遮蔽（AO）光线：沿法线半球余弦分布的方向，
+   区间 (0.001, distance * |lookat - lookfrom|)，distance 默认 0.25
+3. 同样的光线分别用 hit()（填完整的 hit_record，找最近的交点）和 occluded() 测试 repeat 次，
+   输出每条光线的纳秒数和被挡住的比例
+mismatches：两种方式结论不同的光线数。没有体积介质的场景应该是 0；
+    constant_medium / heterogeneous_medium 是否散射是随机的，两次查询的结论本来就可能不同。
+*/
+
+struct bench_options
+{
+    std::string scene;
+    std::string accel = "flat_bvh";
+    std::string out;
+    int queries = 200000;
+    int repeat = 5;
+    double distance = 0.25;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+std::shared_ptr<hittable> make_accel(const std::string &accel, const hittable_list &list)
+{
+    if (accel == "flat_bvh")
+        return std::make_shared<flat_bvh_accel>(list);
+    if (accel == "sbvh")
+        return std::make_shared<flat_bvh_accel>(list.objects, build_sbvh(list.objects));
+    if (accel == "quantized_bvh16")
+        return std::make_shared<quantized_bvh_accel<uint16_t>>(list);
+    if (accel == "quantized_bvh8")
+        return std::make_shared<quantized_bvh_accel<uint8_t>>(list);
+    return std::make_shared<bvh_node>(list);
+}
+
+using scene_builder = std::function<reference_scene(const accel_builder &)>;
+
+std::string run_scene(const std::string &name, const scene_builder &build,
+                      const bench_options &options)
+{
+    seed_random(options.seed);
+    accel_builder accel = [&](const hittable_list &list) {
+        return make_accel(options.accel, list);
+    };
+    auto scene = build(accel);
+    auto world = accel(scene.world);
+
+    // 第1步：相机光线的交点
+    auto forward = unit_vector(scene.cam.lookat - scene.cam.lookfrom);
+    auto spread = std::tan(degrees_to_radians(scene.cam.vfov) / 2);
+    auto max_distance =
+        options.distance * (scene.cam.lookat - scene.cam.lookfrom).length();
+    std::vector<ray> queries;
+    auto wanted = static_cast<size_t>(options.queries);
+    queries.reserve(wanted);
+    for (int attempt = 0; attempt < 20 * options.queries && queries.size() < wanted;
+         attempt++)
+    {
+        auto direction = forward + (spread * vec3::random(-1, 1));
+        ray primary(scene.cam.lookfrom, direction, random_double());
+        hit_record rec;
+        if (!world->hit(primary, interval(0.001, infinity), rec))
+            continue;
+
+        // 第2步：法线半球内余弦分布的 AO 方向，单位长度，所以 t 就是距离
+        auto ao_direction = rec.normal + random_unit_vector();
+        if (ao_direction.near_zero())
+            ao_direction = rec.normal;
+        queries.emplace_back(rec.p, unit_vector(ao_direction), primary.time());
+    }
+    auto ao_interval = interval(0.001, max_distance);
+
+    // 第3步：两种查询，结论逐条比较
+    std::vector<uint8_t> closest(queries.size());
+    std::vector<uint8_t> any(queries.size());
+    auto closest_begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < options.repeat; round++)
+    {
+        for (size_t i = 0; i < queries.size(); i++)
+        {
+            hit_record rec;
+            closest[i] = world->hit(queries[i], ao_interval, rec) ? 1 : 0;
+        }
+    }
+    auto closest_ms = ms_since(closest_begin);
+
+    auto any_begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < options.repeat; round++)
+    {
+        for (size_t i = 0; i < queries.size(); i++)
+            any[i] = world->occluded(queries[i], ao_interval) ? 1 : 0;
+    }
+    auto any_ms = ms_since(any_begin);
+
+    size_t blocked = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        blocked += any[i];
+        mismatches += (any[i] != closest[i]) ? 1 : 0;
+    }
+    auto count = static_cast<double>(queries.size()) * options.repeat;
+    auto closest_ns = 1e6 * closest_ms / count;
+    auto any_ns = 1e6 * any_ms / count;
+    return std::format(
+        "{{\"scene\":\"{}\",\"accel\":\"{}\",\"queries\":{},\"repeat\":{},"
+        "\"max_distance\":{:.3f},\"blocked_fraction\":{:.4f},"
+        "\"closest_hit_ns_per_query\":{:.2f},\"occluded_ns_per_query\":{:.2f},"
+        "\"speedup\":{:.3f},\"mismatches\":{}}}",
+        name, options.accel, queries.size(), options.repeat, max_distance,
+        queries.empty() ? 0.0 : static_cast<double>(blocked) / queries.size(), closest_ns,
+        any_ns, any_ns > 0 ? closest_ns / any_ns : 0.0, mismatches);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--scene")
+            options.scene = value;
+        else if (key == "--accel")
+            options.accel = value;
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--queries")
+            options.queries = std::stoi(value);
+        else if (key == "--repeat")
+            options.repeat = std::stoi(value);
+        else if (key == "--distance")
+            options.distance = std::stod(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    const std::vector<std::pair<std::string, scene_builder>> scenes = {
+        {"bvh", [](const accel_builder &) { return bvh_scene(); }},
+        {"texture", [](const accel_builder &) { return texture_scene(); }},
+        {"cornell_box", [](const accel_builder &) { return cornell_box_scene(); }},
+        {"cornell_smoke", [](const accel_builder &) { return cornell_smoke_scene(); }},
+        {"perlin", [](const accel_builder &) { return perlin_scene(); }},
+        {"final_scene", [](const accel_builder &accel) { return final_scene(accel); }},
+    };
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    for (const auto &[name, build] : scenes)
+    {
+        if (!options.scene.empty() && options.scene != name)
+            continue;
+        auto line = run_scene(name, build, options);
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    }
+    return 0;
+}
+
+// NOLINTEND
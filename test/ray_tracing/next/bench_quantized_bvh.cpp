@@ -0,0 +1,178 @@
+#include "bvh_node.hpp"
+#include "flat_bvh.hpp"
+#include "material.hpp"
+#include "quantized_bvh.hpp"
+#include "sphere.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 量化 BVH benchmark
+    bench_quantized_bvh [--count N] [--rays N] [--seed N] [--out 文件]
+
+N 个随机球（默认 10^6），对同一组随机光线比较四种加速结构：
+    bvh_node           shared_ptr 树（原实现）
+    flat_bvh           32 字节 float 节点
+    quantized_bvh16    32 字节节点存两个孩子的 16 位包围盒，叶子不占节点
+    quantized_bvh8     20 字节节点，8 位包围盒
+每种输出一行 JSON：构建时间、加速结构字节数 / 每图元字节数、单线程 Mrays/s，
+以及与 flat_bvh 最近交点不同的光线数（mismatches，量化是保守的，应该为 0）。
+
+bvh_node 的字节数是估算值：节点数 × (sizeof(bvh_node) + make_shared 控制块 16 字节)，
+不含图元本身；其余结构是节点数组 + 图元下标数组的实际大小。
+*/
+
+struct bench_options
+{
+    size_t count = 1000000;
+    size_t rays = 1000000;
+    uint32_t seed = 20240601;
+    std::string out;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+// bvh_node 的节点数：1~2 个物体直接作为左右孩子，否则对半分
+size_t bvh_node_count(size_t n)
+{
+    if (n <= 2)
+        return 1;
+    return 1 + bvh_node_count(n / 2) + bvh_node_count(n - (n / 2));
+}
+
+struct accel_result
+{
+    std::shared_ptr<hittable> accel;
+    size_t nodes = 0;
+    size_t bytes = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--count")
+            options.count = std::stoull(value);
+        else if (key == "--rays")
+            options.rays = std::stoull(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else if (key == "--out")
+            options.out = value;
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    // 球心在边长 cbrt(N) 的立方体内均匀分布（密度 1），半径 0.1 ~ 0.3，平均自由程几个单位
+    seed_random(options.seed);
+    auto side = std::cbrt(static_cast<double>(options.count));
+    auto mat = std::make_shared<lambertian>(color(0.5, 0.5, 0.5));
+    hittable_list world;
+    world.objects.reserve(options.count);
+    for (size_t i = 0; i < options.count; i++)
+    {
+        point3 center(random_double(0, side), random_double(0, side),
+                      random_double(0, side));
+        world.add(std::make_shared<sphere>(center, random_double(0.1, 0.3), mat));
+    }
+
+    std::vector<ray> rays;
+    rays.reserve(options.rays);
+    for (size_t i = 0; i < options.rays; i++)
+    {
+        point3 origin(random_double(0, side), random_double(0, side),
+                      random_double(0, side));
+        rays.emplace_back(origin, random_unit_vector());
+    }
+
+    const std::vector<std::pair<std::string, std::function<accel_result()>>> accels = {
+        {"bvh_node",
+         [&] {
+             auto nodes = bvh_node_count(options.count);
+             return accel_result{std::make_shared<bvh_node>(world), nodes,
+                                 nodes * (sizeof(bvh_node) + 16)};
+         }},
+        {"flat_bvh",
+         [&] {
+             auto accel = std::make_shared<flat_bvh_accel>(world);
+             const auto &bvh = accel->bvh();
+             auto bytes = bvh.nodes().size_bytes() + bvh.prim_indices().size_bytes();
+             return accel_result{accel, bvh.nodes().size(), bytes};
+         }},
+        {"quantized_bvh16",
+         [&] {
+             auto accel = std::make_shared<quantized_bvh_accel<uint16_t>>(world);
+             const auto &bvh = accel->bvh();
+             return accel_result{accel, bvh.nodes().size(), bvh.memory_bytes()};
+         }},
+        {"quantized_bvh8",
+         [&] {
+             auto accel = std::make_shared<quantized_bvh_accel<uint8_t>>(world);
+             const auto &bvh = accel->bvh();
+             return accel_result{accel, bvh.nodes().size(), bvh.memory_bytes()};
+         }},
+    };
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    std::vector<double> reference; // flat_bvh 的最近交点，miss 为 infinity
+    for (const auto &[name, make] : accels)
+    {
+        auto build_begin = std::chrono::steady_clock::now();
+        auto result = make();
+        auto build_ms = ms_since(build_begin);
+
+        std::vector<double> hits(rays.size(), infinity);
+        auto trace_begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            hit_record rec;
+            if (result.accel->hit(rays[i], interval(0.001, infinity), rec))
+                hits[i] = rec.t;
+        }
+        auto trace_s = ms_since(trace_begin) / 1000.0;
+
+        size_t hit_count = 0;
+        for (auto t : hits)
+            hit_count += t < infinity ? 1 : 0;
+        if (name == "flat_bvh")
+            reference = hits;
+        size_t mismatches = 0;
+        if (!reference.empty())
+            for (size_t i = 0; i < hits.size(); i++)
+                mismatches += hits[i] != reference[i] ? 1 : 0;
+
+        auto line = std::format(
+            "{{\"accel\":\"{}\",\"primitives\":{},\"build_ms\":{:.3f},\"nodes\":{},"
+            "\"bytes\":{},\"bytes_per_prim\":{:.2f},\"rays\":{},\"mrays_per_s\":{:.3f},"
+            "\"hits\":{},\"mismatches\":{}}}",
+            name, options.count, build_ms, result.nodes, result.bytes,
+            static_cast<double>(result.bytes) / static_cast<double>(options.count),
+            rays.size(), rays.size() / trace_s / 1e6, hit_count,
+            reference.empty() ? std::string("null") : std::to_string(mismatches));
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    }
+    return 0;
+}
+
+// NOLINTEND
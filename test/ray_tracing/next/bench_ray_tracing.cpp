@@ -0,0 +1,255 @@
+#include "bvh_node.hpp"
+#include "flat_bvh.hpp"
+#include "lbvh.hpp"
+#include "quantized_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "sbvh.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// NOLINTBEGIN
+
+/*
+NOTE: 光线追踪 benchmark
+    bench_ray_tracing [--scene 名字] [--width N] [--spp N] [--seed N] [--out 文件]
+                      [--accel bvh_node|flat_bvh|sbvh|lbvh|quantized_bvh16|quantized_bvh8]
+                      [--materials compiled|virtual]
+
+对每个参考场景（bvh / texture / cornell_box / cornell_smoke / perlin / final_scene）：
+    1. 固定随机种子，构建场景              -> scene_build_ms
+    2. 构建加速结构（包括场景内部嵌套的）   -> bvh_build_ms
+    3. 再次固定种子，单线程渲染             -> render_s / rays_per_s / samples_per_s
+每个场景输出一行 JSON（JSON Lines）到 stdout，--out 时同时追加到文件，方便长期记录、对比回归。
+
+rays：对 world.hit() 的调用次数，即主光线 + 所有反弹光线。
+peak_rss_bytes：进程到目前为止的峰值常驻内存，是累计值；
+    要得到单个场景的峰值，用 --scene 每个场景单独跑一个进程。
+image_hash：渲染结果（PPM）的 FNV-1a 哈希。同一个种子、同样的代码应该得到同样的值，
+    性能优化后哈希变了，说明结果也变了。
+materials：compiled 用编译后的材质表着色（默认），virtual 用材质和纹理的虚函数，两者 image_hash 应该相同。
+stats：只在 RAY_TRACING_STATS=ON 编译时输出，本场景渲染期间的热路径计数器（render_stats.hpp）。
+*/
+
+// 统计光线数：包在最外层 world 外面，每次 hit() 就是一条光线
+class ray_counter : public hittable
+{
+  public:
+    explicit ray_counter(std::shared_ptr<hittable> object) : object_(std::move(object)) {}
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_++;
+        return object_->hit(r, ray_t, rec);
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        object_->collect_materials(out);
+    }
+
+    aabb bounding_box() const override
+    {
+        return object_->bounding_box();
+    }
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+  private:
+    std::shared_ptr<hittable> object_;
+    mutable uint64_t count_ = 0;
+};
+
+uint64_t peak_rss_bytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss); // macOS：字节
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // Linux：KB
+#endif
+#endif
+}
+
+uint64_t fnv1a(std::string_view bytes)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto c : bytes)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+struct bench_options
+{
+    std::string scene;
+    std::string accel = "bvh_node";
+    std::string materials = "compiled";
+    std::string out;
+    int width = 200;
+    int spp = 16;
+    uint32_t seed = 20240601;
+};
+
+std::shared_ptr<hittable> make_accel(const std::string &accel, const hittable_list &list)
+{
+    if (accel == "flat_bvh")
+        return std::make_shared<flat_bvh_accel>(list);
+    if (accel == "sbvh")
+        return std::make_shared<flat_bvh_accel>(list.objects, build_sbvh(list.objects));
+    if (accel == "lbvh")
+    {
+        std::vector<aabb> boxes;
+        for (const auto &object : list.objects)
+            boxes.push_back(object->bounding_box());
+        return std::make_shared<flat_bvh_accel>(list.objects, build_lbvh(boxes));
+    }
+    if (accel == "quantized_bvh16")
+        return std::make_shared<quantized_bvh_accel<uint16_t>>(list);
+    if (accel == "quantized_bvh8")
+        return std::make_shared<quantized_bvh_accel<uint8_t>>(list);
+    return std::make_shared<bvh_node>(list);
+}
+
+using scene_builder = std::function<reference_scene(const accel_builder &)>;
+
+std::string run_scene(const std::string &name, const scene_builder &build,
+                      const bench_options &options)
+{
+    // 第1步：场景构建。嵌套的加速结构单独计时，从场景构建时间里扣掉
+    double bvh_ms = 0;
+    accel_builder timed_accel = [&](const hittable_list &list) {
+        auto begin = std::chrono::steady_clock::now();
+        auto accel = make_accel(options.accel, list);
+        bvh_ms += ms_since(begin);
+        return accel;
+    };
+
+    seed_random(options.seed);
+    auto scene_begin = std::chrono::steady_clock::now();
+    auto scene = build(timed_accel);
+    auto scene_ms = ms_since(scene_begin) - bvh_ms;
+
+    // 第2步：顶层加速结构
+    auto world = ray_counter(timed_accel(scene.world));
+
+    // 第3步：渲染
+    auto cam = scene.cam;
+    cam.image_width = options.width;
+    cam.samples_per_pixel = options.spp;
+    cam.show_progress = false;
+    cam.compiled_materials = options.materials != "virtual";
+    auto height = std::max(1, static_cast<int>(cam.image_width / cam.aspect_ratio));
+
+    seed_random(options.seed);
+    reset_render_stats();
+    std::ostringstream image;
+    auto render_begin = std::chrono::steady_clock::now();
+    if (scene.sky)
+        cam.render(world, image);
+    else
+        cam.render_with_background(world, image);
+    auto render_s = ms_since(render_begin) / 1000.0;
+
+    auto samples = static_cast<double>(cam.image_width) * height * cam.samples_per_pixel;
+    std::string stats;
+    if constexpr (k_render_stats_enabled)
+        stats = ",\"stats\":" + collect_render_stats().to_json();
+    return std::format(
+        "{{\"scene\":\"{}\",\"accel\":\"{}\",\"materials\":\"{}\",\"width\":{},"
+        "\"height\":{},\"spp\":{},\"max_depth\":{},\"seed\":{},\"primitives\":{},"
+        "\"scene_build_ms\":{:.3f},\"bvh_build_ms\":{:.3f},\"render_s\":{:.3f},"
+        "\"rays\":{},\"rays_per_s\":{:.0f},\"samples_per_s\":{:.0f},"
+        "\"peak_rss_bytes\":{},\"image_hash\":\"{:016x}\"{}}}",
+        name, options.accel, options.materials, cam.image_width, height,
+        cam.samples_per_pixel, cam.max_depth, options.seed, scene.world.objects.size(),
+        scene_ms, bvh_ms, render_s, world.count(), world.count() / render_s,
+        samples / render_s, peak_rss_bytes(), fnv1a(image.str()), stats);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--scene")
+            options.scene = value;
+        else if (key == "--accel")
+            options.accel = value;
+        else if (key == "--materials")
+            options.materials = value;
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--width")
+            options.width = std::stoi(value);
+        else if (key == "--spp")
+            options.spp = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    const std::vector<std::pair<std::string, scene_builder>> scenes = {
+        {"bvh", [](const accel_builder &) { return bvh_scene(); }},
+        {"texture", [](const accel_builder &) { return texture_scene(); }},
+        {"cornell_box", [](const accel_builder &) { return cornell_box_scene(); }},
+        {"cornell_smoke", [](const accel_builder &) { return cornell_smoke_scene(); }},
+        {"perlin", [](const accel_builder &) { return perlin_scene(); }},
+        {"final_scene", [](const accel_builder &accel) { return final_scene(accel); }},
+    };
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    for (const auto &[name, build] : scenes)
+    {
+        if (!options.scene.empty() && options.scene != name)
+            continue;
+        auto line = run_scene(name, build, options);
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    }
+    return 0;
+}
+
+// NOLINTEND
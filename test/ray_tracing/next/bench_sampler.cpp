@@ -0,0 +1,135 @@
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "sampler.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 采样器 benchmark：误差 - 时间
+    bench_sampler [--scene cornell_box|bvh] [--width N] [--ref-spp N] [--max-spp N]
+                  [--seed N] [--out 文件]
+
+1. 用 sobol 采样器、ref-spp 个样本（默认 2048）渲染参考图
+2. 对每种采样器（independent / stratified / halton / sobol），spp = 1, 2, 4, ... max-spp，
+   渲染同一场景，计算与参考图的 RMSE（线性颜色，三个通道一起算）
+每个 (采样器, spp) 输出一行 JSON：render_s、rmse。
+同一 spp 下 RMSE 越低越好；按 render_s 对 rmse 画图就是"误差 - 时间"曲线，
+采样器本身的开销（哈希、置换）也算在时间里。
+参考图也有噪声，RMSE 在很高的 spp 时会趋于参考图自身的误差，不再下降。
+*/
+
+struct bench_options
+{
+    std::string scene = "cornell_box";
+    std::string out;
+    int width = 64;
+    int ref_spp = 2048;
+    int max_spp = 256;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+double rmse(const std::vector<color> &image, const std::vector<color> &reference)
+{
+    double sum = 0;
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        auto d = image[i] - reference[i];
+        sum += d.length_squared();
+    }
+    return std::sqrt(sum / (3.0 * static_cast<double>(image.size())));
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--scene")
+            options.scene = value;
+        else if (key == "--out")
+            options.out = value;
+        else if (key == "--width")
+            options.width = std::stoi(value);
+        else if (key == "--ref-spp")
+            options.ref_spp = std::stoi(value);
+        else if (key == "--max-spp")
+            options.max_spp = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(options.seed);
+    reference_scene scene;
+    if (options.scene == "cornell_box")
+        scene = cornell_box_scene();
+    else if (options.scene == "bvh")
+        scene = bvh_scene();
+    else
+    {
+        std::cerr << "ERROR: unknown scene '" << options.scene << "'.\n";
+        return 1;
+    }
+    auto world = flat_bvh_accel(scene.world);
+
+    auto render = [&](sampler_type type, int spp, uint32_t seed) {
+        auto cam = scene.cam;
+        cam.image_width = options.width;
+        cam.samples_per_pixel = spp;
+        cam.sampling = type;
+        cam.sampler_seed = seed;
+        seed_random(seed);
+        return cam.render_linear(world, !scene.sky);
+    };
+
+    // 参考图用不同的种子，避免与被测图像相关
+    auto ref_begin = std::chrono::steady_clock::now();
+    auto reference = render(sampler_type::sobol, options.ref_spp, options.seed + 1);
+    std::clog << std::format("reference: {} spp in {:.2f} s\n", options.ref_spp,
+                             ms_since(ref_begin) / 1000.0);
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    for (auto type : {sampler_type::independent, sampler_type::stratified,
+                      sampler_type::halton, sampler_type::sobol})
+    {
+        for (int spp = 1; spp <= options.max_spp; spp *= 2)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            auto image = render(type, spp, options.seed);
+            auto render_s = ms_since(begin) / 1000.0;
+
+            auto line = std::format(
+                "{{\"scene\":\"{}\",\"sampler\":\"{}\",\"width\":{},\"spp\":{},"
+                "\"ref_spp\":{},\"render_s\":{:.4f},\"rmse\":{:.6f}}}",
+                options.scene, sampler_type_name(type), options.width, spp,
+                options.ref_spp, render_s, rmse(image, reference));
+            std::cout << line << '\n' << std::flush;
+            if (out.is_open())
+                out << line << '\n';
+        }
+    }
+    return 0;
+}
+
+// NOLINTEND
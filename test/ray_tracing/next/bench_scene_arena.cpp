@@ -0,0 +1,372 @@
+#include "bvh_node.hpp"
+#include "reference_scenes.hpp"
+#include "scene_arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// NOLINTBEGIN
+
+/*
+NOTE: 场景内存池 benchmark：final_scene 用 std::make_shared 和用 scene_arena 构建
+    bench_scene_arena [--width N] [--spp N] [--repeat N] [--seed N] [--out 文件]
+
+每种分配方式（shared_ptr / arena）输出一行 JSON：
+    build_ms / release_ms       构建场景（物体、材质、纹理、两层 bvh_node）和释放整个场景的时间，
+                                repeat 次（默认 20）中的最小值；包括读 earthmap.jpg，两种方式相同
+    heap_allocations            构建一次场景调用全局 operator new 的次数（本文件替换了所有形式的 operator new 来计数）
+    arena_objects / arena_bytes arena 里的对象数、向系统申请的字节数和块数
+    render_s                    用这个场景渲染一次（width 默认 200，spp 默认 16）
+    cache_misses                渲染期间的硬件缓存未命中数（Linux perf_event_open，只计用户态）；
+                                拿不到硬件计数器（虚拟机、容器、非 Linux）时为 null
+    image_hash                  两种方式的图像应该逐位相同
+*/
+
+static std::atomic<uint64_t> heap_allocations{0};
+
+// 全局 operator new / delete 的所有形式（普通、数组、nothrow、对齐、带大小）都换成下面两个函数，
+// 每次分配都计数（例如 flat_bvh_accel 里 alignas(32) 的数组走对齐版本），释放与分配配对
+static void *counted_alloc(size_t size, size_t alignment) noexcept
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    size = std::max<size_t>(size, 1);
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void counted_free(void *p) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+static void *counted_new(size_t size, size_t alignment)
+{
+    if (void *p = counted_alloc(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+constexpr size_t k_default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void *operator new(size_t size)
+{
+    return counted_new(size, k_default_alignment);
+}
+
+void *operator new[](size_t size)
+{
+    return counted_new(size, k_default_alignment);
+}
+
+void *operator new(size_t size, const std::nothrow_t & /*tag*/) noexcept
+{
+    return counted_alloc(size, k_default_alignment);
+}
+
+void *operator new[](size_t size, const std::nothrow_t & /*tag*/) noexcept
+{
+    return counted_alloc(size, k_default_alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return counted_new(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return counted_new(size, static_cast<size_t>(alignment));
+}
+
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t & /*tag*/) noexcept
+{
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t & /*tag*/) noexcept
+{
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete(void *p, size_t /*size*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete[](void *p, size_t /*size*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t & /*tag*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t & /*tag*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete(void *p, std::align_val_t /*alignment*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete[](void *p, std::align_val_t /*alignment*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete(void *p, size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete[](void *p, size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete(void *p, std::align_val_t /*alignment*/,
+                     const std::nothrow_t & /*tag*/) noexcept
+{
+    counted_free(p);
+}
+
+void operator delete[](void *p, std::align_val_t /*alignment*/,
+                       const std::nothrow_t & /*tag*/) noexcept
+{
+    counted_free(p);
+}
+
+struct bench_options
+{
+    std::string out;
+    int width = 200;
+    int spp = 16;
+    int repeat = 20;
+    uint32_t seed = 20240601;
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+uint64_t fnv1a(std::string_view bytes)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto c : bytes)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 硬件缓存未命中计数器；打不开时 stop() 返回空
+class cache_miss_counter
+{
+  public:
+    cache_miss_counter()
+    {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1; // 渲染线程也计入
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    cache_miss_counter(const cache_miss_counter &) = delete;
+    cache_miss_counter &operator=(const cache_miss_counter &) = delete;
+
+    ~cache_miss_counter()
+    {
+#ifdef __linux__
+        if (fd_ >= 0)
+            close(fd_);
+#endif
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        if (fd_ < 0)
+            return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    std::optional<uint64_t> stop()
+    {
+#ifdef __linux__
+        if (fd_ < 0)
+            return std::nullopt;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(fd_, &count, sizeof(count)) != sizeof(count))
+            return std::nullopt;
+        return count;
+#else
+        return std::nullopt;
+#endif
+    }
+
+  private:
+    int fd_ = -1;
+};
+
+// 成员按相反顺序析构：先释放场景里的对象，最后才是 arena
+struct built_scene
+{
+    std::unique_ptr<scene_arena> arena;
+    reference_scene scene;
+    std::shared_ptr<hittable> world;
+};
+
+built_scene build(bool use_arena, uint32_t seed)
+{
+    built_scene built;
+    if (use_arena)
+        built.arena = std::make_unique<scene_arena>();
+    auto *arena = built.arena.get();
+    accel_builder accel = [arena](const hittable_list &list) {
+        if (arena == nullptr)
+            return std::shared_ptr<hittable>(std::make_shared<bvh_node>(list));
+        return std::shared_ptr<hittable>(arena->make<bvh_node>(list, *arena));
+    };
+    seed_random(seed);
+    built.scene = final_scene(accel, arena);
+    built.world = accel(built.scene.world);
+    return built;
+}
+
+std::string run_mode(bool use_arena, const bench_options &options)
+{
+    // 第1步：反复构建、释放，取最小值
+    double build_ms = infinity;
+    double release_ms = infinity;
+    uint64_t allocations = 0;
+    for (int round = 0; round < options.repeat; round++)
+    {
+        auto before = heap_allocations.load();
+        auto begin = std::chrono::steady_clock::now();
+        auto built = std::make_unique<built_scene>(build(use_arena, options.seed));
+        build_ms = std::min(build_ms, ms_since(begin));
+        allocations = heap_allocations.load() - before;
+
+        begin = std::chrono::steady_clock::now();
+        built.reset();
+        release_ms = std::min(release_ms, ms_since(begin));
+    }
+
+    // 第2步：渲染，统计缓存未命中
+    auto built = build(use_arena, options.seed);
+    auto cam = built.scene.cam;
+    cam.image_width = options.width;
+    cam.samples_per_pixel = options.spp;
+    cam.show_progress = false;
+
+    seed_random(options.seed);
+    std::ostringstream image;
+    cache_miss_counter counter;
+    counter.start();
+    auto begin = std::chrono::steady_clock::now();
+    cam.render_with_background(*built.world, image);
+    auto render_s = ms_since(begin) / 1000.0;
+    auto misses = counter.stop();
+
+    auto *arena = built.arena.get();
+    return std::format(
+        "{{\"scene\":\"final_scene\",\"allocation\":\"{}\",\"build_ms\":{:.3f},"
+        "\"release_ms\":{:.3f},\"heap_allocations\":{},\"arena_objects\":{},"
+        "\"arena_bytes\":{},\"arena_blocks\":{},\"width\":{},\"spp\":{},"
+        "\"render_s\":{:.3f},\"cache_misses\":{},\"image_hash\":\"{:016x}\"}}",
+        use_arena ? "arena" : "shared_ptr", build_ms, release_ms, allocations,
+        arena ? arena->objects() : 0, arena ? arena->bytes_reserved() : 0,
+        arena ? arena->blocks() : 0, cam.image_width, cam.samples_per_pixel, render_s,
+        misses ? std::to_string(*misses) : "null", fnv1a(image.str()));
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--out")
+            options.out = value;
+        else if (key == "--width")
+            options.width = std::stoi(value);
+        else if (key == "--spp")
+            options.spp = std::stoi(value);
+        else if (key == "--repeat")
+            options.repeat = std::stoi(value);
+        else if (key == "--seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    std::ofstream out;
+    if (!options.out.empty())
+        out.open(options.out, std::ios::app);
+
+    for (bool use_arena : {false, true})
+    {
+        auto line = run_mode(use_arena, options);
+        std::cout << line << '\n' << std::flush;
+        if (out.is_open())
+            out << line << '\n';
+    }
+    return 0;
+}
+
+// NOLINTEND
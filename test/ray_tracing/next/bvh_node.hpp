@@ -3,6 +3,7 @@
 #include "aabb.hpp"
 #include "hittable.hpp"
 #include "hittable_list.hpp"
+#include "scene_arena.hpp"
 
 // BVH也将是一个hittable——就像hittable列表一样。它实际上是一个容器，但它可以响应“这个射线击中你了吗？”的查询。
 // 一个设计问题是，我们是否有两个类，一个用于树，一个用于树中的节点；
@@ -18,12 +19,19 @@ class bvh_node : public hittable // NOLINT
         // only need to persist the resulting bounding volume hierarchy.
     }
 
+    // 所有内部节点都从 arena 分配（根节点由调用者决定，通常也是 arena.make<bvh_node>）
+    bvh_node(hittable_list list, scene_arena &arena)
+        : bvh_node(list.objects, 0, list.objects.size(), &arena)
+    {
+    }
+
     /*
 任何效率结构，包括BVH，最复杂的部分是构建它。我们在构造函数中这样做。
 BVH的一个很酷的事情是，只要bvh_node中的对象列表被分成两个子列表，命中函数就会起作用。
 如果划分做得很好，那么两个孩子的边界框比他们的父边界框小，但这是为了速度而不是正确性
 */
-    bvh_node(std::vector<std::shared_ptr<hittable>> &objects, size_t start, size_t end)
+    bvh_node(std::vector<std::shared_ptr<hittable>> &objects, size_t start, size_t end,
+             scene_arena *arena = nullptr)
         : bbox_(aabb::empty)
     {
         // NOTE:我们可以加快BVH优化的速度。与其选择随机拆分轴，不如拆分包围框的最长轴以获得最大的细分
@@ -42,8 +50,8 @@ BVH的一个很酷的事情是，只要bvh_node中的对象列表被分成两个
 
         if (object_span == 1)
         {
-            // 只有一个物体：左右都指向它
-            left_ = right_ = objects[start];
+            // 只有一个物体：只挂在左边，避免同一个物体被测试两次
+            left_ = objects[start];
         }
         else if (object_span == 2)
         { // 只有两个物体：一个放左边，一个放右边
@@ -56,8 +64,8 @@ BVH的一个很酷的事情是，只要bvh_node中的对象列表被分成两个
             std::sort(std::begin(objects) + start, std::begin(objects) + end, comparator);
 
             auto mid = start + (object_span / 2);
-            left_ = make_shared<bvh_node>(objects, start, mid);
-            right_ = make_shared<bvh_node>(objects, mid, end);
+            left_ = arena_make<bvh_node>(arena, objects, start, mid, arena);
+            right_ = arena_make<bvh_node>(arena, objects, mid, end, arena);
         }
 
         // 检查是否有边界框是为了防止你发送像无限平面这样没有边界框的东西。
@@ -66,19 +74,51 @@ BVH的一个很酷的事情是，只要bvh_node中的对象列表被分成两个
 
     /*
 点击函数非常简单：检查节点的框是否被击中，如果是，检查子节点并整理任何细节。
+子节点只求交（intersect），整棵树遍历完后才为最近的交点补全命中记录（finish_hit）。
 */
     bool hit(const ray &r, interval ray_t, hit_record &rec) const override
     {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_stat(render_stat::bvh_nodes_visited);
         if (!bbox_.hit(r, ray_t))
             return false;
 
-        bool hit_left = left_->hit(r, ray_t, rec);
+        bool hit_left = left_->intersect(r, ray_t, rec);
         bool hit_right =
-            right_->hit(r, interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
+            right_ &&
+            right_->intersect(r, interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
 
         return hit_left || hit_right;
     }
 
+    // 遮挡查询：左边挡住了就不用再看右边
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        count_stat(render_stat::bvh_nodes_visited);
+        if (!bbox_.hit(r, ray_t))
+            return false;
+        return left_->occluded(r, ray_t) || (right_ && right_->occluded(r, ray_t));
+    }
+
+    [[nodiscard]] bool stochastic() const override
+    {
+        return left_->stochastic() || (right_ && right_->stochastic());
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        left_->collect_materials(out);
+        if (right_)
+            right_->collect_materials(out);
+    }
+
     [[nodiscard]] aabb bounding_box() const override
     {
         return bbox_;
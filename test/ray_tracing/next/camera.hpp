@@ -1,12 +1,19 @@
 #pragma once
 
+#include "accumulation_buffer.hpp"
 #include "material.hpp"
 
 #include "color.hpp"
 #include "degrees_to_radians.hpp"
+#include "environment_map.hpp"
+#include "feature_buffers.hpp"
 #include "hittable.hpp"
+#include "light_sampler.hpp"
+#include "render_stats.hpp"
+#include "sampler.hpp"
 
 #include <iostream>
+#include <vector>
 
 // NOLINTBEGIN
 class camera
@@ -29,68 +36,176 @@ class camera
     // NOTE: 背景颜色，可以是黑的，这样光源就只能由我们自己定义了
     color background; // Scene background color
 
-    void render(const hittable &world, std::ostream &out)
+    bool show_progress = true; // 是否打印剩余扫描行和 Done.（benchmark 时关掉，保持输出干净）
+
+    // NOTE: 像素内样本和散射方向用的采样序列（sampler.hpp），默认与原来一样是独立随机数
+    sampler_type sampling = sampler_type::independent;
+    uint32_t sampler_seed = 0; // 哈希采样器的种子，同一种子结果可复现
+
+    // NOTE: 用编译后的材质表（material_table）着色，不做虚函数调用，结果相同；false 用虚函数。
+    // materials 为空时每次渲染先为 world 编译一张；一个场景渲染多次（分 tile、常驻服务）时
+    // 由调用者建好一次放进来，复制出来的 camera 共用。要用同一个场景构建
+    bool compiled_materials = true;
+    std::shared_ptr<const material_table> materials;
+
+    // NOTE: 光源采样（light_sampler.hpp）。不为空时带背景的渲染在漫反射点直接对光源采样，
+    // 与方向采样用 MIS 合并；为空时与原来相同。要用同一个场景（顶层列表）构建
+    std::shared_ptr<const light_sampler> lights;
+
+    // NOTE: 环境光（environment_map.hpp）。不为空时没打中物体的光线取环境贴图，
+    // 代替 background 和渐变天空，漫反射点上按贴图亮度对环境采样，与方向采样用 MIS 合并。
+    // environment_sampling 为 false 时只靠散射方向碰到环境（对比用）
+    std::shared_ptr<const environment_map> environment;
+    bool environment_sampling = true;
+
+    void render(const hittable &world, std::ostream &out, feature_buffers *aovs = nullptr)
     {
         // NOTE: 禁用同步
         std::ostream::sync_with_stdio(false);
 
         initialize(); // 初始化相机参数
+        prepare_materials(world);
+        auto pixel_sampler = make_sampler(sampling, samples_per_pixel, sampler_seed);
+        if (aovs != nullptr)
+            aovs->resize(image_width, imageHeight_);
 
         out << "P3\n" << image_width << ' ' << imageHeight_ << "\n255\n";
 
         for (int j = 0; j < imageHeight_; j++)
         {
-            std::clog << "\rScanlines remaining: " << (imageHeight_ - j) << ' '
-                      << std::flush;
+            if (show_progress)
+                std::clog << "\rScanlines remaining: " << (imageHeight_ - j) << ' '
+                          << std::flush;
             for (int i = 0; i < image_width; i++)
             {
-                color pixel_color(0, 0, 0);
                 // 对每个像素进行多次采样（抗锯齿）
-                for (int sample = 0; sample < samples_per_pixel; sample++)
-                {
-                    ray r = get_ray(i, j); // 获取通过像素(i,j)的光线
-                    pixel_color += ray_color(r, max_depth, world); // 计算光线颜色
-                }
+                auto aov_sum = aovs != nullptr ? aovs->make_sample() : feature_sample{};
+                color pixel_color =
+                    sample_pixel(world, i, j, *pixel_sampler, false, 0, samples_per_pixel,
+                                 aovs != nullptr ? &aov_sum : nullptr);
                 write_color(out,
                             pixelSamplesScale_ * pixel_color); // 输出像素颜色
+                if (aovs != nullptr)
+                    aovs->store(i, j, aov_sum, samples_per_pixel);
             }
         }
 
-        std::cout << "\rDone.                 \n";
+        if (show_progress)
+            std::cout << "\rDone.                 \n";
     }
-    void render_with_background(const hittable &world, std::ostream &out)
+    void render_with_background(const hittable &world, std::ostream &out,
+                                feature_buffers *aovs = nullptr)
     {
         // NOTE: 禁用同步
         std::ostream::sync_with_stdio(false);
 
         initialize(); // 初始化相机参数
+        prepare_materials(world);
+        auto pixel_sampler = make_sampler(sampling, samples_per_pixel, sampler_seed);
+        if (aovs != nullptr)
+            aovs->resize(image_width, imageHeight_);
 
         out << "P3\n" << image_width << ' ' << imageHeight_ << "\n255\n";
 
         for (int j = 0; j < imageHeight_; j++)
         {
-            std::clog << "\rScanlines remaining: " << (imageHeight_ - j) << ' '
-                      << std::flush;
+            if (show_progress)
+                std::clog << "\rScanlines remaining: " << (imageHeight_ - j) << ' '
+                          << std::flush;
             for (int i = 0; i < image_width; i++)
             {
-                color pixel_color(0, 0, 0);
                 // 对每个像素进行多次采样（抗锯齿）
-                for (int sample = 0; sample < samples_per_pixel; sample++)
-                {
-                    ray r = get_ray(i, j); // 获取通过像素(i,j)的光线
-                    pixel_color +=
-                        ray_color_with_background(r, max_depth, world); // 计算光线颜色
-                }
+                auto aov_sum = aovs != nullptr ? aovs->make_sample() : feature_sample{};
+                color pixel_color =
+                    sample_pixel(world, i, j, *pixel_sampler, true, 0, samples_per_pixel,
+                                 aovs != nullptr ? &aov_sum : nullptr);
                 write_color(out,
                             pixelSamplesScale_ * pixel_color); // 输出像素颜色
+                if (aovs != nullptr)
+                    aovs->store(i, j, aov_sum, samples_per_pixel);
             }
         }
 
-        std::cout << "\rDone.                 \n";
+        if (show_progress)
+            std::cout << "\rDone.                 \n";
+    }
+
+    /*
+    渲染到线性颜色缓冲区（没有 gamma、没有截断），按行存放，
+    use_background 为 true 时与 render_with_background 相同，否则与 render 相同。
+    用于统计误差（与参考图比较 RMSE）等需要原始数值的场合。
+    features 不为空时同一遍渲染里填上 AOV（反照率、法线、深度等，feature_buffers.hpp），颜色不受影响。
+    render / render_with_background 的 aovs 参数相同。
+    */
+    std::vector<color> render_linear(const hittable &world, bool use_background,
+                                     feature_buffers *features = nullptr)
+    {
+        initialize();
+        prepare_materials(world);
+        auto pixel_sampler = make_sampler(sampling, samples_per_pixel, sampler_seed);
+        if (features != nullptr)
+            features->resize(image_width, imageHeight_);
+
+        std::vector<color> pixels;
+        pixels.reserve(static_cast<size_t>(image_width) * imageHeight_);
+        for (int j = 0; j < imageHeight_; j++)
+        {
+            for (int i = 0; i < image_width; i++)
+            {
+                auto feature_sum =
+                    features != nullptr ? features->make_sample() : feature_sample{};
+                auto sum = sample_pixel(world, i, j, *pixel_sampler, use_background, 0,
+                                        samples_per_pixel,
+                                        features != nullptr ? &feature_sum : nullptr);
+                pixels.push_back(pixelSamplesScale_ * sum);
+                if (features != nullptr)
+                    features->store(i, j, feature_sum, samples_per_pixel);
+            }
+        }
+        return pixels;
+    }
+
+    /*
+    NOTE: 部分渲染（分布式渲染的 worker 用）
+    只渲染 region 内的像素、region 内的样本序号，结果是样本颜色之和与样本数，
+    多个部分结果用 accumulation_buffer::merge 合并。
+    samples_per_pixel 仍应是整个渲染的总样本数：stratified 采样器按它分层。
+    */
+    accumulation_buffer render_partial(const hittable &world, bool use_background,
+                                       const render_region &region)
+    {
+        initialize();
+        prepare_materials(world);
+        auto total_samples = std::max(samples_per_pixel, region.sample_end);
+        auto pixel_sampler = make_sampler(sampling, total_samples, sampler_seed);
+
+        accumulation_buffer buffer(image_width, imageHeight_, region);
+        for (int j = region.y0; j < region.y1; j++)
+        {
+            if (show_progress)
+                std::clog << "\rScanlines remaining: " << (region.y1 - j) << ' '
+                          << std::flush;
+            for (int i = region.x0; i < region.x1; i++)
+            {
+                auto sum = sample_pixel(world, i, j, *pixel_sampler, use_background,
+                                        region.sample_begin, region.sample_end);
+                buffer.add(i, j, sum, static_cast<uint32_t>(region.samples()));
+            }
+        }
+        if (show_progress)
+            std::clog << "\rDone.                 \n";
+        return buffer;
+    }
+
+    // 与 initialize() 相同的高度计算，不需要先渲染
+    [[nodiscard]] int image_height() const
+    {
+        auto height = static_cast<int>(image_width / aspect_ratio);
+        return (height < 1) ? 1 : height;
     }
 
   private:
-    int imageHeight_;          // 渲染图像的像素高度
+    int imageHeight_ = 0;      // 渲染图像的像素高度
     double pixelSamplesScale_; // 像素采样总和的颜色缩放因子
     point3 center_;            // 相机中心位置
     point3 pixel00Loc_;        // 像素(0,0)的位置
@@ -104,6 +219,18 @@ class camera
     vec3 defocusDiskU_; // 散焦圆盘水平半径
     vec3 defocusDiskV_; // 散焦圆盘垂直半径
 
+    std::shared_ptr<const material_table> render_materials_; // 本次渲染用的材质表，空时用虚函数
+
+    void prepare_materials(const hittable &world)
+    {
+        if (!compiled_materials)
+            render_materials_ = nullptr;
+        else if (materials)
+            render_materials_ = materials;
+        else
+            render_materials_ = std::make_shared<material_table>(world);
+    }
+
     void initialize()
     {
         // NOTE:0. 基本信息
@@ -147,27 +274,75 @@ class camera
         defocusDiskV_ = v_ * defocus_radius;
     }
 
+    // 像素 (i, j) 第 [sample_begin, sample_end) 个样本的颜色之和；
+    // 采样维度：像素内位置、镜头、时间、然后是各次反弹
+    // features 不为空时把每个样本第一次命中的特征累加进去
+    color sample_pixel(const hittable &world, int i, int j, sampler &s,
+                       bool use_background, int sample_begin, int sample_end,
+                       feature_sample *features = nullptr) const
+    {
+        color pixel_color(0, 0, 0);
+        for (int sample = sample_begin; sample < sample_end; sample++)
+        {
+            s.start_pixel_sample(i, j, sample);
+            ray r = get_ray(i, j, s); // 获取通过像素(i,j)的光线
+            // 计算光线颜色
+            color sample_color;
+            if (environment || (use_background && lights))
+                sample_color =
+                    ray_color_with_lights(r, max_depth, world, s, {}, features);
+            else if (use_background)
+                sample_color =
+                    ray_color_with_background(r, max_depth, world, s, features);
+            else
+                sample_color = ray_color(r, max_depth, world, s, features);
+            pixel_color += sample_color;
+            if (features != nullptr)
+                features->add_color(sample_color);
+        }
+        return pixel_color;
+    }
+
+    // 第一次命中时记录特征；只读命中记录，不消耗采样维度
+    void record_features(const ray &r, const hit_record &rec,
+                         feature_sample *features) const
+    {
+        if (features == nullptr)
+            return;
+        if (features->want_albedo)
+            features->albedo +=
+                render_materials_ ? render_materials_->albedo(*rec.mat, rec)
+                                  : rec.mat->surface_albedo(rec);
+        features->normal += rec.normal;
+        features->depth += rec.t * r.direction().length();
+        if (features->material_id == 0)
+            features->material_id = rec.mat->id();
+    }
+
     // 构建从散焦圆盘发出并指向像素(i,j)周围随机采样点的相机光线
-    [[nodiscard]] ray get_ray(int i, int j) const
+    [[nodiscard]] ray get_ray(int i, int j, sampler &s) const
     {
-        auto offset = sample_square(); // 获取方形区域内的随机偏移
+        auto offset = sample_square(s); // 获取方形区域内的随机偏移
         auto pixel_sample = pixel00Loc_ + ((i + offset.x()) * pixelDeltaU_) +
                             ((j + offset.y()) * pixelDeltaV_); // 计算像素采样点
 
         // NOTE: 3. 光线可以来自聚焦盘
+        // 镜头维度总是占用，保证后续维度的编号与是否开景深无关
+        auto lens = s.get_2d();
         auto ray_origin =
-            (defocus_angle <= 0) ? center_ : defocus_disk_sample(); // 光线起点
-        auto ray_direction = pixel_sample - ray_origin;             // 光线方向
+            (defocus_angle <= 0) ? center_ : defocus_disk_sample(lens); // 光线起点
+        auto ray_direction = pixel_sample - ray_origin;                 // 光线方向
 
         // NOTE:4. 模拟运动模糊，需要 ray 带时间信息
-        auto ray_time = random_double();
+        auto ray_time = s.get_1d();
         return ray(ray_origin, ray_direction, ray_time);
     }
 
-    [[nodiscard]] vec3 sample_square() const
+    [[nodiscard]] vec3 sample_square(sampler &s) const
     {
         // 返回[-0.5,-0.5]到[+0.5,+0.5]单位方形区域内的随机点向量
-        return {random_double() - 0.5, random_double() - 0.5, 0};
+        auto u = s.get_2d();
+        return {u.x - 0.5, u.y - 0.5, 0};
     }
 
     [[nodiscard]] vec3 sample_disk(double radius) const
@@ -176,29 +351,54 @@ class camera
         return radius * random_in_unit_disk();
     }
 
-    [[nodiscard]] point3 defocus_disk_sample() const
+    [[nodiscard]] point3 defocus_disk_sample(sample_2d u) const
     {
         // 返回相机散焦圆盘内的随机点
-        auto p = random_in_unit_disk();
+        auto p = sample_unit_disk(u);
         return center_ + (p[0] * defocusDiskU_) + (p[1] * defocusDiskV_);
     }
 
-    [[nodiscard]] color ray_color(const ray &r, int depth, const hittable &world) const
+    bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
+                 ray &scattered, sampler &s) const
+    {
+        if (!render_materials_)
+            return rec.mat->scatter(r_in, rec, attenuation, scattered, s);
+        return render_materials_->scatter(*rec.mat, r_in, rec, attenuation, scattered, s);
+    }
+
+    [[nodiscard]] bool is_diffuse(const hit_record &rec) const
+    {
+        if (!render_materials_)
+            return rec.mat->is_diffuse();
+        return render_materials_->diffuse(*rec.mat);
+    }
+
+    [[nodiscard]] color emitted(const hit_record &rec) const
+    {
+        if (!render_materials_)
+            return rec.mat->emitted(rec.u, rec.v, rec.p);
+        return render_materials_->emitted(*rec.mat, rec.u, rec.v, rec.p);
+    }
+
+    [[nodiscard]] color ray_color(const ray &r, int depth, const hittable &world,
+                                  sampler &s, feature_sample *features = nullptr) const
     {
         // 如果达到光线反弹次数限制，不再收集光线
         if (depth <= 0)
             return {0, 0, 0};
 
+        count_ray(max_depth - depth);
         hit_record rec;
 
         // 检测光线是否与场景中的物体相交
         if (world.hit(r, interval(0.001, infinity), rec))
         {
+            record_features(r, rec, features);
             ray scattered;
             color attenuation;
             // 如果材质散射光线，递归计算散射光线颜色
-            if (rec.mat->scatter(r, rec, attenuation, scattered))
-                return attenuation * ray_color(scattered, depth - 1, world);
+            if (scatter(r, rec, attenuation, scattered, s))
+                return attenuation * ray_color(scattered, depth - 1, world, s);
             return {0, 0, 0}; // 完全吸收
         }
 
@@ -209,30 +409,132 @@ class camera
         return (1.0 - a) * color(1.0, 1.0, 1.0) + a * color(0.5, 0.7, 1.0);
     }
 
-    [[nodiscard]] color ray_color_with_background(const ray &r, int depth,
-                                                  const hittable &world) const
+    [[nodiscard]] color
+    ray_color_with_background(const ray &r, int depth, const hittable &world, sampler &s,
+                              feature_sample *features = nullptr) const
     {
         // 如果达到光线反弹次数限制，不再收集光线
         if (depth <= 0)
             return {0, 0, 0};
 
+        count_ray(max_depth - depth);
         hit_record rec;
 
         // If the ray hits nothing, return the background color.
         if (not world.hit(r, interval(0.001, infinity), rec))
             return background;
+        record_features(r, rec, features);
 
         ray scattered;
         color attenuation;
-        color color_from_emission = rec.mat->emitted(rec.u, rec.v, rec.p);
+        color color_from_emission = emitted(rec);
 
-        if (!rec.mat->scatter(r, rec, attenuation, scattered))
+        if (!scatter(r, rec, attenuation, scattered, s))
             return color_from_emission;
 
         color color_from_scatter =
-            attenuation * ray_color_with_background(scattered, depth - 1, world);
+            attenuation * ray_color_with_background(scattered, depth - 1, world, s);
 
         return color_from_emission + color_from_scatter;
     }
+
+    // 路径上的前一个顶点。漫反射点的光源采样也可能得到到达这里的光线，命中光源时按 MIS 加权
+    struct path_vertex
+    {
+        bool diffuse = false;
+        point3 p;
+        vec3 normal;
+        double bsdf_pdf = 0; // 散射出这条光线的方向密度（立体角）
+    };
+
+    /*
+    ray_color_with_background 加上光源采样：
+    漫反射点上挑一个光源取一个点，没有挡住就加上 albedo · Le · cos/π · w / p_light；
+    散射光线直接命中光源时，发光乘上 w = p_bsdf² / (p_bsdf² + p_light²)。
+    两个方向的权重之和为 1，期望与 ray_color_with_background 相同，方差小得多。
+    环境光是另一种光源，同样做一次采样，散射光线没打中物体时按环境采样的密度加权。
+    */
+    [[nodiscard]] color ray_color_with_lights(const ray &r, int depth,
+                                              const hittable &world, sampler &s,
+                                              const path_vertex &prev,
+                                              feature_sample *features = nullptr) const
+    {
+        if (depth <= 0)
+            return {0, 0, 0};
+
+        count_ray(max_depth - depth);
+        hit_record rec;
+        if (not world.hit(r, interval(0.001, infinity), rec))
+        {
+            if (!environment)
+                return background;
+            auto radiance = environment->radiance(r.direction());
+            if (prev.diffuse && environment_sampling)
+            {
+                auto env_pdf = environment->pdf(r.direction());
+                radiance *= power_heuristic(prev.bsdf_pdf, env_pdf);
+            }
+            return radiance;
+        }
+        record_features(r, rec, features);
+
+        // 光源采样的维度每次反弹都占用，后面的维度编号与这里是否做了光源采样无关
+        auto u_select = s.get_1d();
+        auto u_light = s.get_2d();
+        auto u_environment = environment ? s.get_2d() : sample_2d{0, 0};
+
+        color result = emitted(rec);
+        if (lights && prev.diffuse && (result.x() + result.y() + result.z()) > 0)
+        {
+            auto light_pdf = lights->pdf(prev.p, prev.normal, rec);
+            result *= power_heuristic(prev.bsdf_pdf, light_pdf);
+        }
+
+        ray scattered;
+        color attenuation;
+        if (!scatter(r, rec, attenuation, scattered, s))
+            return result;
+
+        // 最后一次反弹（depth == 1）不做光源采样：散射光线在 depth 0 直接返回 0，
+        // MIS 的另一半不存在，权重之和不为 1；ray_color_with_background 也看不到这些光
+        path_vertex next;
+        if (depth > 1 && is_diffuse(rec))
+        {
+            if (lights)
+            {
+                auto light = lights->sample(rec.p, rec.normal, u_select, u_light);
+                auto cos_light = light.pdf > 0 ? dot(rec.normal, light.direction) : 0.0;
+                if (cos_light > 0 &&
+                    !world.occluded(ray(rec.p, light.direction, r.time()),
+                                    interval(0.001, light.distance * (1 - 1e-4))))
+                {
+                    auto bsdf_pdf = cos_light / pi;
+                    auto weight = power_heuristic(light.pdf, bsdf_pdf);
+                    result +=
+                        attenuation * light.emission * (bsdf_pdf * weight / light.pdf);
+                }
+            }
+            if (environment && environment_sampling)
+            {
+                auto env = environment->sample(u_environment);
+                auto cos_env = env.pdf > 0 ? dot(rec.normal, env.direction) : 0.0;
+                if (cos_env > 0 && !world.occluded(ray(rec.p, env.direction, r.time()),
+                                                   interval(0.001, infinity)))
+                {
+                    auto bsdf_pdf = cos_env / pi;
+                    auto weight = power_heuristic(env.pdf, bsdf_pdf);
+                    result += attenuation * env.radiance * (bsdf_pdf * weight / env.pdf);
+                }
+            }
+            next.diffuse = true;
+            next.p = rec.p;
+            next.normal = rec.normal;
+            next.bsdf_pdf =
+                std::max(0.0, dot(rec.normal, unit_vector(scattered.direction()))) / pi;
+        }
+
+        return result +
+               attenuation * ray_color_with_lights(scattered, depth - 1, world, s, next);
+    }
 };
 // NOLINTEND
\ No newline at end of file
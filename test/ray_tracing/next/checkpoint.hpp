@@ -0,0 +1,202 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "accumulation_buffer.hpp"
+#include "camera.hpp"
+#include "sampler.hpp"
+
+/*
+NOTE: 渲染检查点与断点续渲
+长时间渲染（例如 final_scene 800x800、10000 spp）中途被杀掉时，已经算完的部分不应该丢。
+检查点就是累加缓冲区（每个像素的颜色和与样本数，还没渲染的 tile 样本数为 0）：
+render_scheduler 每完成一个 tile 发一个事件，调用者把 tile 合并进检查点，隔一段时间存一次（test_final_scene.cpp）。
+续渲时把读回的缓冲区交给 render_request::resume，已经有样本的 tile 不再渲染。
+每个 tile 的随机数只由 tile 序号决定，不用保存随机引擎，续渲的结果与不中断渲染逐位相同。
+
+写文件不阻塞渲染：渲染线程只复制一份快照交给后台写线程（checkpoint_writer），写线程先写临时文件再改名。
+后台还在写上一份时又来了新快照，只保留最新的一份。
+
+检查点里有一个 fingerprint（checkpoint_fingerprint）：所有影响像素的相机设置（图像尺寸、宽高比、spp、
+max_depth、视角、景深、背景色、采样器和种子）、背景模式、光源采样和环境光设置，再加上场景名的哈希。
+参数不同的检查点不会被误用；场景本身（随机生成的物体）由调用者固定种子保证相同。
+文件格式（.ckpt）：定长文件头 + 嵌入的 .accum 数据。
+*/
+struct render_checkpoint // NOLINT
+{
+    static constexpr uint32_t k_version = 2; // 2：去掉了按行渲染的行号和随机引擎状态
+
+    uint32_t fingerprint = 0;
+    accumulation_buffer buffer;
+
+    // 先写临时文件再改名，进程在写的过程中被杀掉时，旧的检查点仍然完整
+    [[nodiscard]] bool save(const std::string &path) const
+    {
+        header h{};
+        std::memcpy(h.magic, k_magic, sizeof(h.magic));
+        h.version = k_version;
+        h.endian = k_endian;
+        h.fingerprint = fingerprint;
+
+        auto tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&h), sizeof(h)); // NOLINT
+            if (!out || !buffer.write(out))
+            {
+                std::cerr << "ERROR: Could not write '" << tmp_path << "'.\n";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, path, ec);
+        return !ec;
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+
+        header h{};
+        in.read(reinterpret_cast<char *>(&h), sizeof(h)); // NOLINT
+        render_checkpoint checkpoint;
+        checkpoint.fingerprint = h.fingerprint;
+        if (!in || std::memcmp(h.magic, k_magic, sizeof(h.magic)) != 0 ||
+            h.version != k_version || h.endian != k_endian || !checkpoint.buffer.read(in))
+        {
+            std::cerr << "ERROR: '" << path << "' is not a valid checkpoint file.\n";
+            return false;
+        }
+        *this = std::move(checkpoint);
+        return true;
+    }
+
+  private:
+    static constexpr char k_magic[8] = {'R', 'T', 'C', 'K', 'P', 'T', '\0', '\0'};
+    static constexpr uint32_t k_endian = 0x01020304;
+
+    struct header
+    {
+        char magic[8]; // NOLINT
+        uint32_t version;
+        uint32_t endian;
+        uint32_t fingerprint;
+    };
+};
+
+// 影响像素值的全部相机参数 + 背景模式 + 场景名。换了视角、背景或光源设置的检查点不能续渲
+inline uint32_t checkpoint_fingerprint(const camera &cam, bool use_background,
+                                       std::string_view scene_name)
+{
+    auto add_double = [](uint32_t h, double value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        h = hash_combine(h, static_cast<uint32_t>(bits));
+        return hash_combine(h, static_cast<uint32_t>(bits >> 32));
+    };
+    auto add_vec = [&](uint32_t h, const vec3 &v) {
+        for (int axis = 0; axis < 3; axis++)
+            h = add_double(h, v[axis]);
+        return h;
+    };
+
+    auto h = hash_combine(0, static_cast<uint32_t>(cam.image_width));
+    h = hash_combine(h, static_cast<uint32_t>(cam.image_height()));
+    h = add_double(h, cam.aspect_ratio);
+    h = hash_combine(h, static_cast<uint32_t>(cam.samples_per_pixel));
+    h = hash_combine(h, static_cast<uint32_t>(cam.max_depth));
+    h = add_double(h, cam.vfov);
+    h = add_vec(h, cam.lookfrom);
+    h = add_vec(h, cam.lookat);
+    h = add_vec(h, cam.vup);
+    h = add_double(h, cam.defocus_angle);
+    h = add_double(h, cam.focus_dist);
+    h = add_vec(h, cam.background);
+    h = hash_combine(h, use_background ? 1U : 0U);
+    h = hash_combine(h, static_cast<uint32_t>(cam.sampling));
+    h = hash_combine(h, cam.sampler_seed);
+    // 光源采样和环境光改变噪声（环境光还改变背景）；内容由场景名代表
+    if (cam.lights)
+        h = hash_combine(h, 1U + static_cast<uint32_t>(cam.lights->selection()));
+    else
+        h = hash_combine(h, 0U);
+    h = hash_combine(h, cam.environment ? 1U : 0U);
+    h = hash_combine(h, cam.environment_sampling ? 1U : 0U);
+    for (auto c : scene_name)
+        h = hash_combine(h, static_cast<uint8_t>(c));
+    return h;
+}
+
+// 后台写检查点；submit 只是把快照放进一个槽位，马上返回
+class checkpoint_writer // NOLINT
+{
+  public:
+    explicit checkpoint_writer(std::string path)
+        : path_(std::move(path)), thread_([this](std::stop_token stop) { run(stop); })
+    {
+    }
+
+    checkpoint_writer(const checkpoint_writer &) = delete;
+    checkpoint_writer &operator=(const checkpoint_writer &) = delete;
+
+    ~checkpoint_writer()
+    {
+        flush();
+    }
+
+    void submit(render_checkpoint checkpoint)
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            pending_ = std::move(checkpoint);
+        }
+        wake_.notify_one();
+    }
+
+    // 等所有已提交的快照写完；有任何一次写失败时返回 false
+    bool flush()
+    {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [this] { return !pending_ && !writing_; });
+        return ok_;
+    }
+
+  private:
+    std::string path_;
+    std::mutex mutex_;
+    std::condition_variable_any wake_;
+    std::condition_variable idle_;
+    std::optional<render_checkpoint> pending_;
+    bool writing_ = false;
+    bool ok_ = true;
+    std::jthread thread_; // 最后构造、最先析构，线程运行时其他成员都有效
+
+    void run(const std::stop_token &stop)
+    {
+        std::unique_lock lock(mutex_);
+        while (wake_.wait(lock, stop, [this] { return pending_.has_value(); }))
+        {
+            auto checkpoint = std::move(*pending_);
+            pending_.reset();
+            writing_ = true;
+            lock.unlock();
+            auto saved = checkpoint.save(path_);
+            lock.lock();
+            writing_ = false;
+            ok_ = ok_ && saved;
+            idle_.notify_all();
+        }
+    }
+};
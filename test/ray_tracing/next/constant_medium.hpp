@@ -73,13 +73,14 @@ class constant_medium : public hittable // NOLINT
 
     bool hit(const ray &r, interval ray_t, hit_record &rec) const override
     {
+        count_stat(render_stat::medium_hits);
         hit_record rec1; // 记录光线进入体积的位置
         hit_record rec2; // 记录光线离开体积的位置
 
         // 第1步：检测光线与体积边界的第一个交点（进入点）
         // 使用无限区间确保找到第一个交点
         // 假设：边界是凸的，所以第一个交点一定是进入点
-        if (!boundary->hit(r, interval::universe, rec1))
+        if (!boundary->intersect(r, interval::universe, rec1))
             return false; // 光线没有击中体积边界
 
         // 第2步：检测光线与体积边界的第二个交点（离开点）
@@ -87,7 +88,7 @@ class constant_medium : public hittable // NOLINT
         // 关键限制：这里假设光线一旦离开边界就不会再次进入
         // 对于凸形状这是成立的，但对于有孔的非凸形状（如圆环）会出错
         // 因为光线可能会：进入→离开→再进入→再离开
-        if (!boundary->hit(r, interval(rec1.t + 0.0001, infinity), rec2))
+        if (!boundary->intersect(r, interval(rec1.t + 0.0001, infinity), rec2))
             return false; // 光线没有完全穿过体积（可能切线或内部光源）
 
         // 第3步：将交点时间限制在有效的光线时间范围内
@@ -126,11 +127,22 @@ class constant_medium : public hittable // NOLINT
         rec.normal = vec3(1, 0, 0); // 任意法向量，体积散射没有表面概念
         rec.front_face = true;      // 任意朝向，体积内部没有内外之分
 
-        rec.mat = phase_function; // 设置各向同性散射材质
+        rec.mat = phase_function.get(); // 设置各向同性散射材质
 
         return true; // 成功在体积内部发生散射
     }
 
+    // 每次 hit() 都重新取散射距离
+    [[nodiscard]] bool stochastic() const override
+    {
+        return true;
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        out.push_back(phase_function.get());
+    }
+
     aabb bounding_box() const override
     {
         // 体积的包围盒与其边界物体相同
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "color.hpp"
+#include "feature_buffers.hpp"
+
+/*
+NOTE: 降噪（edge-avoiding à-trous wavelet，Dammertz 2010）
+低 spp 的图像噪声很大，提高 samples_per_pixel 的代价是线性的。渲染后做一遍滤波：
+每一层用 5x5 的 B3 样条核，第 i 层的采样间隔是 2^i（"带孔"的核），5 层就覆盖 125x125 的范围，
+每个像素每层只读 25 个邻居。邻居 q 对像素 p 的权重再乘上边缘停止函数：
+    w = h(q) * exp(-(l_p - l_q)^2 / (σl^2 * var_p) - |n_p - n_q|^2 / σn^2
+                   - |a_p - a_q|^2 / σa^2 - |z_p - z_q| / (σz * z_p))
+l 是亮度，n / a / z 是特征缓冲区里的法线、反照率、深度（feature_buffers.hpp）。
+法线、反照率、深度在几何边缘和纹理边缘变化很大，权重接近 0，边缘不会被抹掉。
+亮度差用噪声的大小（方差 var_p）衡量，与 SVGF 相同：固定的颜色容差在低 spp 时太小（噪声滤不掉），
+在高 spp 时太大（细节被抹掉）。单个像素的样本方差在低 spp 时很不可靠（全黑的像素方差是 0），
+所以先在 7x7 窗口里取平均；每层滤波后方差按 Σw²var / (Σw)² 更新，下一层的容差跟着变小。
+1 spp 时没有方差（每个像素只有一个样本），滤波几乎不起作用，至少要 2 spp。
+
+demodulate_albedo：先把颜色除以反照率，只对"光照"滤波，滤完再乘回去，纹理细节不会被模糊。
+
+实现：颜色和特征都是按通道分开的 float 平面，对每个 (dy, dx) 一次处理一整行里邻居有效的那一段，
+内层循环没有分支，exp 用多项式近似（fast_exp），编译器可以向量化。
+每层把图像按行切成几段，多个线程同时处理，层与层之间等所有线程结束。
+*/
+struct denoise_options // NOLINT
+{
+    int iterations = 5;            // 层数，第 i 层的采样间隔是 2^i
+    float sigma_color = 6.0F;      // 亮度差容差，以噪声的标准差为单位
+    float sigma_normal = 0.3F;     // 法线差
+    float sigma_albedo = 0.1F;     // 反照率差
+    float sigma_depth = 0.05F;     // 相对深度差
+    bool demodulate_albedo = true; // 只对光照滤波，纹理乘回去
+    int threads = 0;               // 0 表示 hardware_concurrency
+};
+
+// exp(x)，x <= 0。2^x 拆成整数部分（直接拼指数位）和小数部分（5 次多项式），相对误差约 1e-4
+inline float fast_exp(float x)
+{
+    // -x >= 0 时 float 的位模式与数值同序，用整数 min 截断到 80（包括 inf）；
+    // 浮点比较在默认的 -ftrapping-math 下会变成分支，循环就不能向量化了
+    auto e = std::bit_cast<float>(
+        std::min(std::bit_cast<int32_t>(-x), std::bit_cast<int32_t>(80.0F)));
+    auto t = e * -1.44269504F; // log2(e)
+    // t 在 [-116, 0]，加 128 变成正数后截断就是向下取整，不需要比较（比较和分支会妨碍向量化）
+    auto ti = static_cast<int32_t>(t + 128.0F) - 128;
+    auto f = t - static_cast<float>(ti);
+    auto p = 0.00961812911F + (f * 0.00133335581F);
+    p = 0.0555041087F + (f * p);
+    p = 0.240226507F + (f * p);
+    p = 0.693147181F + (f * p);
+    p = 1.0F + (f * p);
+    return p * std::bit_cast<float>((ti + 127) << 23);
+}
+
+// 5x5 B3 样条核的一维系数
+inline constexpr float k_atrous_kernel[5] = {1.0F / 16, 1.0F / 4, 3.0F / 8, 1.0F / 4,
+                                             1.0F / 16};
+
+struct atrous_pass_input // NOLINT
+{
+    const float *color; // 3 个平面
+    const float *albedo;
+    const float *normal;
+    const float *depth;
+    const float *variance;
+    int width;
+    int height;
+    int step;
+    float inv_sigma_color2;
+    float inv_sigma_normal2;
+    float inv_sigma_albedo2;
+    float sigma_depth;
+};
+
+// 处理 [y0, y1) 行，结果写到 out（3 个平面）和 out_variance
+// 一行按 k_atrous_chunk 个像素分段，累加器是栈上的数组：内层循环只从平面读、只写局部数组，
+// 编译器不需要做指针别名检查就能向量化
+inline void atrous_filter_rows(const atrous_pass_input &in, float *out,
+                               float *out_variance, int y0, int y1)
+{
+    constexpr int k_atrous_chunk = 64;
+    auto w = in.width;
+    auto n = static_cast<size_t>(in.width) * in.height;
+    const float *cr = in.color;
+    const float *cg = cr + n;
+    const float *cb = cg + n;
+    const float *ar = in.albedo;
+    const float *ag = ar + n;
+    const float *ab = ag + n;
+    const float *nx = in.normal;
+    const float *ny = nx + n;
+    const float *nz = ny + n;
+    const float *z = in.depth;
+    const float *var = in.variance;
+
+    for (int y = y0; y < y1; y++)
+    {
+        auto p_row = static_cast<ptrdiff_t>(y) * w;
+        for (int chunk = 0; chunk < w; chunk += k_atrous_chunk)
+        {
+            auto chunk_end = std::min(w, chunk + k_atrous_chunk);
+            float acc_r[k_atrous_chunk] = {};
+            float acc_g[k_atrous_chunk] = {};
+            float acc_b[k_atrous_chunk] = {};
+            float acc_w[k_atrous_chunk] = {};
+            float acc_v[k_atrous_chunk] = {}; // Σ w² var
+            float inv_var[k_atrous_chunk];
+            float inv_depth[k_atrous_chunk];
+            // 完全没有噪声的像素（光源、背景）方差是 0，加一个下限避免除以 0
+            for (int x = chunk; x < chunk_end; x++)
+            {
+                inv_var[x - chunk] = in.inv_sigma_color2 / (var[p_row + x] + 1e-6F);
+                inv_depth[x - chunk] = 1.0F / ((in.sigma_depth * z[p_row + x]) + 1e-4F);
+            }
+
+            for (int ky = 0; ky < 5; ky++)
+            {
+                auto qy = y + ((ky - 2) * in.step);
+                if (qy < 0 || qy >= in.height)
+                    continue;
+                for (int kx = 0; kx < 5; kx++)
+                {
+                    auto dx = (kx - 2) * in.step;
+                    auto x_begin = std::max(chunk, -dx);
+                    auto x_end = std::min(chunk_end, w - dx);
+                    auto k = k_atrous_kernel[ky] * k_atrous_kernel[kx];
+                    // q = p + (dx, dy)，这一段 x 内邻居都在图像内
+                    auto q_row = (static_cast<ptrdiff_t>(qy) * w) + dx;
+                    for (ptrdiff_t x = x_begin; x < x_end; x++)
+                    {
+                        auto p = p_row + x;
+                        auto q = q_row + x;
+                        auto i = x - chunk;
+                        auto d_l = (0.2126F * (cr[p] - cr[q])) +
+                                   (0.7152F * (cg[p] - cg[q])) +
+                                   (0.0722F * (cb[p] - cb[q]));
+                        auto d_ar = ar[p] - ar[q];
+                        auto d_ag = ag[p] - ag[q];
+                        auto d_ab = ab[p] - ab[q];
+                        auto d_nx = nx[p] - nx[q];
+                        auto d_ny = ny[p] - ny[q];
+                        auto d_nz = nz[p] - nz[q];
+                        auto e = (d_l * d_l * inv_var[i]) +
+                                 ((d_ar * d_ar) + (d_ag * d_ag) + (d_ab * d_ab)) *
+                                     in.inv_sigma_albedo2 +
+                                 ((d_nx * d_nx) + (d_ny * d_ny) + (d_nz * d_nz)) *
+                                     in.inv_sigma_normal2 +
+                                 (std::fabs(z[p] - z[q]) * inv_depth[i]);
+                        auto weight = k * fast_exp(-e);
+                        acc_r[i] += weight * cr[q];
+                        acc_g[i] += weight * cg[q];
+                        acc_b[i] += weight * cb[q];
+                        acc_w[i] += weight;
+                        acc_v[i] += weight * weight * var[q];
+                    }
+                }
+            }
+            // 中心像素的权重是 k_atrous_kernel[2]^2 > 0，不会除以 0
+            for (int x = chunk; x < chunk_end; x++)
+            {
+                auto i = x - chunk;
+                auto inv = 1.0F / acc_w[i];
+                out[p_row + x] = acc_r[i] * inv;
+                out[n + p_row + x] = acc_g[i] * inv;
+                out[(2 * n) + p_row + x] = acc_b[i] * inv;
+                out_variance[p_row + x] = acc_v[i] * inv * inv;
+            }
+        }
+    }
+}
+
+// 把 [0, height) 行平均分给 threads 个线程
+template <typename F>
+void parallel_rows(int height, int threads, const F &fn)
+{
+    threads = std::clamp(threads, 1, height);
+    if (threads == 1)
+    {
+        fn(0, height);
+        return;
+    }
+    std::vector<std::jthread> workers;
+    workers.reserve(threads);
+    for (int t = 0; t < threads; t++)
+    {
+        auto y0 = height * t / threads;
+        auto y1 = height * (t + 1) / threads;
+        workers.emplace_back([&fn, y0, y1] { fn(y0, y1); });
+    }
+}
+
+// 每个像素取 (2r+1)^2 窗口内的平均值（窗口在图像外的部分不算），先横向再纵向
+inline void box_blur(std::vector<float> &plane, int width, int height, int radius)
+{
+    std::vector<float> tmp(plane.size());
+    for (int y = 0; y < height; y++)
+    {
+        const auto *row = plane.data() + (static_cast<size_t>(y) * width);
+        for (int x = 0; x < width; x++)
+        {
+            auto x0 = std::max(0, x - radius);
+            auto x1 = std::min(width, x + radius + 1);
+            float sum = 0;
+            for (int k = x0; k < x1; k++)
+                sum += row[k];
+            tmp[(static_cast<size_t>(y) * width) + x] = sum / static_cast<float>(x1 - x0);
+        }
+    }
+    for (int y = 0; y < height; y++)
+    {
+        auto y0 = std::max(0, y - radius);
+        auto y1 = std::min(height, y + radius + 1);
+        auto *out = plane.data() + (static_cast<size_t>(y) * width);
+        std::fill(out, out + width, 0.0F);
+        for (int k = y0; k < y1; k++)
+        {
+            const auto *row = tmp.data() + (static_cast<size_t>(k) * width);
+            for (int x = 0; x < width; x++)
+                out[x] += row[x];
+        }
+        auto inv = 1.0F / static_cast<float>(y1 - y0);
+        for (int x = 0; x < width; x++)
+            out[x] *= inv;
+    }
+}
+
+// 反照率太暗（或没有命中物体）的通道不做除法，乘回去时用同一个值，来回是精确的
+inline float demodulation_factor(float albedo)
+{
+    return albedo > 1e-3F ? albedo : 1.0F;
+}
+
+// image 是线性颜色（camera::render_linear 的输出），features 与 image 同样大小
+inline std::vector<color> denoise(const std::vector<color> &image,
+                                  const feature_buffers &features,
+                                  const denoise_options &options = {})
+{
+    auto n = features.pixels();
+    if (image.size() != n || n == 0)
+        return image;
+    if (features.albedo.empty() || features.normal.empty() || features.depth.empty() ||
+        features.variance.empty())
+    {
+        std::cerr << "ERROR: denoise needs albedo, normal, depth and variance AOVs.\n";
+        return image;
+    }
+
+    std::vector<float> current(3 * n);
+    std::vector<float> variance = features.variance;
+    for (size_t i = 0; i < n; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            auto value = static_cast<float>(image[i][c]);
+            if (options.demodulate_albedo)
+                value /= demodulation_factor(features.albedo[(c * n) + i]);
+            current[(c * n) + i] = value;
+        }
+        // 方差是对颜色算的，去掉反照率后按亮度近似换算
+        if (options.demodulate_albedo)
+        {
+            auto a = feature_sample::luminance_of(color(features.albedo[i],
+                                                        features.albedo[n + i],
+                                                        features.albedo[(2 * n) + i]));
+            auto f = demodulation_factor(static_cast<float>(a));
+            variance[i] /= f * f;
+        }
+    }
+    box_blur(variance, features.width, features.height, 3);
+
+    auto threads = options.threads;
+    if (threads <= 0)
+        threads = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+    std::vector<float> next(3 * n);
+    std::vector<float> next_variance(n);
+    for (int level = 0; level < options.iterations; level++)
+    {
+        atrous_pass_input in{current.data(),
+                             features.albedo.data(),
+                             features.normal.data(),
+                             features.depth.data(),
+                             variance.data(),
+                             features.width,
+                             features.height,
+                             1 << level,
+                             1.0F / (options.sigma_color * options.sigma_color),
+                             1.0F / (options.sigma_normal * options.sigma_normal),
+                             1.0F / (options.sigma_albedo * options.sigma_albedo),
+                             options.sigma_depth};
+        parallel_rows(features.height, threads, [&](int y0, int y1) {
+            atrous_filter_rows(in, next.data(), next_variance.data(), y0, y1);
+        });
+        std::swap(current, next);
+        std::swap(variance, next_variance);
+    }
+
+    std::vector<color> result(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            auto value = current[(c * n) + i];
+            if (options.demodulate_albedo)
+                value *= demodulation_factor(features.albedo[(c * n) + i]);
+            result[i][c] = value;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "aabb.hpp"
+#include "perlin.hpp"
+#include "vec3.hpp"
+
+/*
+NOTE: 非均匀介质的密度场
+constant_medium 只有一个常数密度；这里把"某点的密度"抽象出来：
+    density(p)：       点 p 处的消光系数（越大越浓）
+    max_density(box)： 区域内密度的上界（majorant），给 delta tracking 用
+                       必须是严格的上界；上界越紧，空区域越能被快速跳过
+
+两种实现：
+    perlin_density：程序化密度，湍流噪声驱动的云/烟
+    grid_density：  体素网格，三线性插值
+*/
+class density_field // NOLINT
+{
+  public:
+    virtual ~density_field() = default;
+
+    [[nodiscard]] virtual double density(const point3 &p) const = 0;
+
+    // 必须是真正的上界（不能是采样估计），否则 delta tracking 有偏
+    [[nodiscard]] virtual double max_density(const aabb &region) const = 0;
+};
+
+// NOTE: 湍流噪声驱动的密度：density = scale * max(0, turb(frequency * p) - threshold)
+// threshold 把噪声的低值部分削成 0，得到一团一团的云，中间是真正的空区域
+class perlin_density : public density_field // NOLINT
+{
+  public:
+    perlin_density(double scale, double frequency, double threshold, int octaves = 7)
+        : scale_(scale), frequency_(frequency), threshold_(threshold), octaves_(octaves)
+    {
+    }
+
+    [[nodiscard]] double density(const point3 &p) const override
+    {
+        return scale_ * std::max(0.0, noise_.turb(frequency_ * p, octaves_) - threshold_);
+    }
+
+    // NOTE: 湍流在区域上的解析上界（perlin_with_random_vec::turb_bound），再减去阈值
+    [[nodiscard]] double max_density(const aabb &region) const override
+    {
+        point3 lo;
+        point3 hi;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const auto &extent = region.axis_interval(axis);
+            auto a = frequency_ * extent.min;
+            auto b = frequency_ * extent.max;
+            lo[axis] = std::min(a, b);
+            hi[axis] = std::max(a, b);
+        }
+        return scale_ * std::max(0.0, noise_.turb_bound(lo, hi, octaves_) - threshold_);
+    }
+
+  private:
+    perlin_with_random_vec noise_;
+    double scale_;
+    double frequency_;
+    double threshold_;
+    int octaves_;
+};
+
+// NOTE: 体素网格密度。体素值位于体素中心，采样时三线性插值，区域外密度为 0
+class grid_density : public density_field // NOLINT
+{
+  public:
+    grid_density(const aabb &bounds, int nx, int ny, int nz, std::vector<float> values)
+        : bounds_(bounds), nx_(nx), ny_(ny), nz_(nz), values_(std::move(values))
+    {
+    }
+
+    // 用一个函数 f(p) 在每个体素中心采样，方便构造测试用的密度网格
+    template <typename F>
+    static grid_density from_function(const aabb &bounds, int nx, int ny, int nz, F &&f)
+    {
+        std::vector<float> values(static_cast<size_t>(nx) * ny * nz);
+        for (int k = 0; k < nz; k++)
+            for (int j = 0; j < ny; j++)
+                for (int i = 0; i < nx; i++)
+                {
+                    auto p = point3(bounds.x.min + (bounds.x.size() * (i + 0.5) / nx),
+                                    bounds.y.min + (bounds.y.size() * (j + 0.5) / ny),
+                                    bounds.z.min + (bounds.z.size() * (k + 0.5) / nz));
+                    values[index(nx, ny, i, j, k)] = static_cast<float>(f(p));
+                }
+        return {bounds, nx, ny, nz, std::move(values)};
+    }
+
+    [[nodiscard]] double density(const point3 &p) const override
+    {
+        // 连续体素坐标：体素中心在整数位置
+        auto gx = ((p.x() - bounds_.x.min) / bounds_.x.size() * nx_) - 0.5;
+        auto gy = ((p.y() - bounds_.y.min) / bounds_.y.size() * ny_) - 0.5;
+        auto gz = ((p.z() - bounds_.z.min) / bounds_.z.size() * nz_) - 0.5;
+        if (gx < -0.5 || gy < -0.5 || gz < -0.5 || gx > nx_ - 0.5 || gy > ny_ - 0.5 ||
+            gz > nz_ - 0.5)
+            return 0;
+
+        auto i0 = static_cast<int>(std::floor(gx));
+        auto j0 = static_cast<int>(std::floor(gy));
+        auto k0 = static_cast<int>(std::floor(gz));
+        auto fx = gx - i0;
+        auto fy = gy - j0;
+        auto fz = gz - k0;
+
+        double accum = 0;
+        for (int di = 0; di < 2; di++)
+            for (int dj = 0; dj < 2; dj++)
+                for (int dk = 0; dk < 2; dk++)
+                {
+                    auto w = (di ? fx : 1 - fx) * (dj ? fy : 1 - fy) * (dk ? fz : 1 - fz);
+                    accum += w * voxel(i0 + di, j0 + dj, k0 + dk);
+                }
+        return accum;
+    }
+
+    // NOTE: 三线性插值不会超过参与插值的体素值，所以取覆盖区域的体素最大值就是精确上界
+    [[nodiscard]] double max_density(const aabb &region) const override
+    {
+        auto [i0, i1] = voxel_range(region.x, bounds_.x, nx_);
+        auto [j0, j1] = voxel_range(region.y, bounds_.y, ny_);
+        auto [k0, k1] = voxel_range(region.z, bounds_.z, nz_);
+
+        double result = 0;
+        for (int k = k0; k <= k1; k++)
+            for (int j = j0; j <= j1; j++)
+                for (int i = i0; i <= i1; i++)
+                    result = std::max(result, voxel(i, j, k));
+        return result;
+    }
+
+  private:
+    aabb bounds_;
+    int nx_, ny_, nz_;
+    std::vector<float> values_;
+
+    static size_t index(int nx, int ny, int i, int j, int k)
+    {
+        return (((static_cast<size_t>(k) * ny) + j) * nx) + i;
+    }
+
+    [[nodiscard]] double voxel(int i, int j, int k) const
+    {
+        i = std::clamp(i, 0, nx_ - 1);
+        j = std::clamp(j, 0, ny_ - 1);
+        k = std::clamp(k, 0, nz_ - 1);
+        return values_[index(nx_, ny_, i, j, k)];
+    }
+
+    // 区域内任意一点插值时可能用到的体素下标范围（向外多取一格）
+    static std::pair<int, int> voxel_range(const interval &region, const interval &bounds,
+                                           int n)
+    {
+        auto to_grid = [&](double x) {
+            return ((x - bounds.min) / bounds.size() * n) - 0.5;
+        };
+        auto lo = static_cast<int>(std::floor(to_grid(region.min)));
+        auto hi = static_cast<int>(std::floor(to_grid(region.max))) + 1;
+        return {std::clamp(lo, 0, n - 1), std::clamp(hi, 0, n - 1)};
+    }
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "color.hpp"
+#include "rtw_image.hpp"
+#include "sampler.hpp"
+
+/*
+NOTE: HDR 环境光（环境贴图做背景和光源）
+没打中任何物体的光线取环境贴图的颜色，代替 camera::background 的常量颜色和 ray_color 的渐变天空。
+贴图是经纬度展开（equirectangular），与 sphere::get_sphere_uv 相同：
+    u = 经度 φ/(2π)，v = 从正上方（+y）往下的角度 θ/π，图片第一行是正上方。
+贴图通过 rtw_image 的浮点通道读入，.hdr 文件保留大于 1 的亮度（太阳可以比天空亮几万倍）。
+
+重要性采样：把每个像素看成常数，按 亮度 × sinθ 建二维分段常数分布
+（行的边缘分布 + 每行的条件分布，都是 CDF，二分查找），取方向的密度正比于这个方向的亮度。
+sinθ 是经纬度展开在两极的面积压缩：p_ω = p_uv / (2π² sinθ)。
+太阳只占几个像素，却提供了大部分的光照，均匀散射几乎碰不到它，按亮度取方向则大部分样本都朝着它。
+camera 用 MIS 把这里的样本和漫反射的散射方向合并（camera::environment）。
+*/
+struct environment_sample // NOLINT
+{
+    vec3 direction; // 单位向量
+    double pdf = 0; // 立体角上的概率密度；0 表示没有样本
+    color radiance;
+};
+
+class environment_map
+{
+  public:
+    // 按行存放的线性颜色，从上往下；intensity 整体缩放亮度
+    environment_map(int width, int height, std::vector<color> pixels,
+                    double intensity = 1.0)
+        : width_(std::max(1, width)), height_(std::max(1, height)),
+          pixels_(std::move(pixels))
+    {
+        pixels_.resize(static_cast<size_t>(width_) * height_);
+        for (auto &pixel : pixels_)
+            pixel = intensity * pixel;
+
+        std::vector<double> row_integrals(height_);
+        rows_.reserve(height_);
+        for (int y = 0; y < height_; y++)
+        {
+            auto sin_theta = std::sin(pi * (y + 0.5) / height_);
+            std::vector<double> weights(width_);
+            for (int x = 0; x < width_; x++)
+                weights[x] = std::max(0.0, luminance(texel(x, y))) * sin_theta;
+            rows_.emplace_back(std::move(weights));
+            row_integrals[y] = rows_.back().integral;
+        }
+        marginal_ = piecewise_constant(std::move(row_integrals));
+    }
+
+    // 从 HDR（或普通）图片读入，找文件的方式与 image_texture 相同；失败时返回空
+    static std::shared_ptr<environment_map> load(const std::string &filename,
+                                                 double intensity = 1.0)
+    {
+        rtw_image image(filename.c_str());
+        if (image.width() <= 0 || image.height() <= 0)
+            return nullptr;
+        std::vector<color> pixels;
+        pixels.reserve(static_cast<size_t>(image.width()) * image.height());
+        for (int y = 0; y < image.height(); y++)
+        {
+            for (int x = 0; x < image.width(); x++)
+            {
+                const auto *p = image.float_pixel_data(x, y);
+                pixels.emplace_back(p[0], p[1], p[2]);
+            }
+        }
+        return std::make_shared<environment_map>(image.width(), image.height(),
+                                                 std::move(pixels), intensity);
+    }
+
+    [[nodiscard]] int width() const
+    {
+        return width_;
+    }
+
+    [[nodiscard]] int height() const
+    {
+        return height_;
+    }
+
+    // 贴图坐标 (u, v) 对应的单位方向
+    static vec3 direction_of(double u, double v)
+    {
+        auto theta = v * pi;
+        auto phi = u * 2 * pi;
+        auto sin_theta = std::sin(theta);
+        return {-sin_theta * std::cos(phi), std::cos(theta), sin_theta * std::sin(phi)};
+    }
+
+    // direction_of 的逆
+    static void uv_of(const vec3 &direction, double &u, double &v)
+    {
+        auto d = unit_vector(direction);
+        v = std::acos(std::clamp(d.y(), -1.0, 1.0)) / pi;
+        u = (std::atan2(-d.z(), d.x()) + pi) / (2 * pi);
+    }
+
+    // 方向上的亮度（最近的像素，与采样分布一致）
+    [[nodiscard]] color radiance(const vec3 &direction) const
+    {
+        double u = 0;
+        double v = 0;
+        uv_of(direction, u, v);
+        return texel(column_of(u), row_of(v));
+    }
+
+    [[nodiscard]] environment_sample sample(sample_2d u) const
+    {
+        environment_sample result;
+        if (!(marginal_.integral > 0))
+            return result;
+        double pdf_v = 0;
+        double pdf_u = 0;
+        size_t row = 0;
+        size_t column = 0;
+        auto v = marginal_.sample(u.y, pdf_v, row);
+        auto uu = rows_[row].sample(u.x, pdf_u, column);
+        auto sin_theta = std::sin(v * pi);
+        if (!(sin_theta > 0) || !(pdf_u * pdf_v > 0))
+            return result;
+        result.direction = direction_of(uu, v);
+        result.pdf = pdf_u * pdf_v / (2 * pi * pi * sin_theta);
+        result.radiance = texel(static_cast<int>(column), static_cast<int>(row));
+        return result;
+    }
+
+    // sample 得到 direction 的概率密度（立体角）
+    [[nodiscard]] double pdf(const vec3 &direction) const
+    {
+        if (!(marginal_.integral > 0))
+            return 0;
+        double u = 0;
+        double v = 0;
+        uv_of(direction, u, v);
+        auto sin_theta = std::sin(v * pi);
+        if (!(sin_theta > 0))
+            return 0;
+        // p_uv = 条件密度 × 边缘密度 = f(行, 列) / 总积分
+        auto pdf_uv = rows_[row_of(v)].func[column_of(u)] / marginal_.integral;
+        return pdf_uv / (2 * pi * pi * sin_theta);
+    }
+
+  private:
+    // [0,1) 上的一维分段常数分布：func 是各段的值，cdf 有 n+1 项
+    struct piecewise_constant
+    {
+        std::vector<double> func;
+        std::vector<double> cdf;
+        double integral = 0;
+
+        piecewise_constant() = default;
+
+        explicit piecewise_constant(std::vector<double> values)
+            : func(std::move(values)), cdf(func.size() + 1)
+        {
+            auto n = static_cast<double>(func.size());
+            for (size_t i = 0; i < func.size(); i++)
+                cdf[i + 1] = cdf[i] + (func[i] / n);
+            integral = cdf.back();
+            for (size_t i = 1; i < cdf.size(); i++)
+                cdf[i] = integral > 0 ? cdf[i] / integral : static_cast<double>(i) / n;
+        }
+
+        // 连续样本 ∈ [0,1)；pdf 是相对 [0,1) 的密度，index 是落在哪一段
+        double sample(double u, double &pdf, size_t &index) const
+        {
+            auto n = func.size();
+            auto it = std::upper_bound(cdf.begin(), cdf.end(), u);
+            auto after = static_cast<size_t>(it - cdf.begin());
+            index = std::clamp<size_t>(after, 1, n) - 1;
+            auto offset = u - cdf[index];
+            auto width = cdf[index + 1] - cdf[index];
+            if (width > 0)
+                offset /= width;
+            pdf = integral > 0 ? func[index] / integral : 1.0;
+            return (static_cast<double>(index) + offset) / static_cast<double>(n);
+        }
+    };
+
+    int width_;
+    int height_;
+    std::vector<color> pixels_;
+    std::vector<piecewise_constant> rows_; // 每行的条件分布
+    piecewise_constant marginal_;          // 行的边缘分布
+
+    static double luminance(const color &c)
+    {
+        return (0.2126 * c.x()) + (0.7152 * c.y()) + (0.0722 * c.z());
+    }
+
+    [[nodiscard]] const color &texel(int x, int y) const
+    {
+        return pixels_[(static_cast<size_t>(y) * width_) + x];
+    }
+
+    [[nodiscard]] int column_of(double u) const
+    {
+        return std::clamp(static_cast<int>(u * width_), 0, width_ - 1);
+    }
+
+    [[nodiscard]] int row_of(double v) const
+    {
+        return std::clamp(static_cast<int>(v * height_), 0, height_ - 1);
+    }
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "color.hpp"
+#include "vec3.hpp"
+
+/*
+NOTE: 特征缓冲区 / AOV（arbitrary output variables）
+与颜色在同一遍渲染里得到，不需要第二遍：每个样本在第一次命中时记下
+    albedo       表面反照率（material::surface_albedo，即纹理的 value）
+    normal       着色法线
+    depth        交点到相机的距离
+    material_id  材质编号（material::id，按创建顺序从 1 开始，0 表示没有命中）
+像素内所有样本取平均（边缘像素是几个表面的混合，和颜色一样是抗锯齿的），没有命中物体的样本记 0；
+material_id 不能平均，取像素内第一个命中物体的样本。另外每个像素还有
+    variance     像素平均亮度的方差（样本方差 / 样本数），降噪时颜色差异按噪声大小衡量
+    samples      样本数
+aov_set 选择要哪些缓冲区：没选的不分配内存；albedo 要查纹理，不选时渲染也不查。
+
+存储是按通道分开的 float 平面（planar）：第 c 个通道的第 i 个像素在 data[c * pixels + i]，
+降噪时对一行像素做同样的运算，连续的 float 数组编译器可以直接向量化。
+save() 把每个缓冲区写成一个 PFM 文件（1 或 3 通道 float），常见的图像工具都能打开。
+*/
+struct aov_set // NOLINT
+{
+    bool albedo = true;
+    bool normal = true;
+    bool depth = true;
+    bool variance = true;
+    bool material_id = true;
+    bool samples = true;
+};
+
+struct feature_sample // NOLINT
+{
+    bool want_albedo = true; // 不需要 albedo 时跳过纹理查询
+    color albedo{0, 0, 0};
+    vec3 normal{0, 0, 0};
+    double depth = 0;
+    uint32_t material_id = 0;
+    double luminance = 0;
+    double luminance_sq = 0;
+
+    // 一个样本的颜色（camera::sample_pixel 调用）
+    void add_color(const color &c)
+    {
+        auto l = luminance_of(c);
+        luminance += l;
+        luminance_sq += l * l;
+    }
+
+    static double luminance_of(const color &c)
+    {
+        return (0.2126 * c.x()) + (0.7152 * c.y()) + (0.0722 * c.z());
+    }
+};
+
+struct feature_buffers // NOLINT
+{
+    aov_set enabled;
+    int width = 0;
+    int height = 0;
+    std::vector<float> albedo;      // 3 个平面
+    std::vector<float> normal;      // 3 个平面
+    std::vector<float> depth;       // 1 个平面
+    std::vector<float> variance;    // 1 个平面
+    std::vector<float> material_id; // 1 个平面，编号小于 2^24 时用 float 存是精确的
+    std::vector<float> samples;     // 1 个平面
+
+    feature_buffers() = default;
+    explicit feature_buffers(const aov_set &aovs) : enabled(aovs) {}
+
+    [[nodiscard]] size_t pixels() const
+    {
+        return static_cast<size_t>(width) * height;
+    }
+
+    // 只分配 enabled 里选中的缓冲区，其余清空
+    void resize(int image_width, int image_height)
+    {
+        width = image_width;
+        height = image_height;
+        auto assign = [this](std::vector<float> &plane, bool on, size_t channels) {
+            plane.assign(on ? channels * pixels() : 0, 0.0F);
+        };
+        assign(albedo, enabled.albedo, 3);
+        assign(normal, enabled.normal, 3);
+        assign(depth, enabled.depth, 1);
+        assign(variance, enabled.variance, 1);
+        assign(material_id, enabled.material_id, 1);
+        assign(samples, enabled.samples, 1);
+    }
+
+    // 一个像素的累加器，camera 每个像素开始时调用
+    [[nodiscard]] feature_sample make_sample() const
+    {
+        feature_sample sample;
+        sample.want_albedo = enabled.albedo;
+        return sample;
+    }
+
+    // sum 是像素内 sample_count 个样本的和
+    void store(int x, int y, const feature_sample &sum, int sample_count)
+    {
+        auto n = pixels();
+        auto i = (static_cast<size_t>(y) * width) + x;
+        auto inv_samples = sample_count > 0 ? 1.0 / sample_count : 0.0;
+        for (size_t c = 0; c < 3; c++)
+        {
+            if (!albedo.empty())
+                albedo[(c * n) + i] = static_cast<float>(sum.albedo[c] * inv_samples);
+            if (!normal.empty())
+                normal[(c * n) + i] = static_cast<float>(sum.normal[c] * inv_samples);
+        }
+        if (!depth.empty())
+            depth[i] = static_cast<float>(sum.depth * inv_samples);
+        if (!variance.empty())
+        {
+            auto mean = sum.luminance * inv_samples;
+            auto sample_variance =
+                std::max(0.0, (sum.luminance_sq * inv_samples) - (mean * mean));
+            variance[i] = static_cast<float>(sample_variance * inv_samples);
+        }
+        if (!material_id.empty())
+            material_id[i] = static_cast<float>(sum.material_id);
+        if (!samples.empty())
+            samples[i] = static_cast<float>(sample_count);
+    }
+
+    // 每个启用的缓冲区写一个文件：<prefix>.albedo.pfm、<prefix>.depth.pfm 等
+    [[nodiscard]] bool save(const std::string &prefix) const
+    {
+        struct named_plane
+        {
+            const char *name;
+            const std::vector<float> *data;
+            int channels;
+        };
+        const named_plane planes[] = {
+            {"albedo", &albedo, 3},
+            {"normal", &normal, 3},
+            {"depth", &depth, 1},
+            {"variance", &variance, 1},
+            {"material_id", &material_id, 1},
+            {"samples", &samples, 1},
+        };
+        for (const auto &plane : planes)
+        {
+            if (plane.data->empty())
+                continue;
+            if (!write_pfm(prefix + "." + plane.name + ".pfm", *plane.data,
+                           plane.channels))
+                return false;
+        }
+        return true;
+    }
+
+    /*
+    PFM：文本头 "PF"（3 通道）或 "Pf"（1 通道）、宽高、比例因子（负数表示小端），
+    然后是 float 数据，通道交错，从最下面一行开始。先写临时文件再改名。
+    */
+    [[nodiscard]] bool write_pfm(const std::string &path, const std::vector<float> &data,
+                                 int channels) const
+    {
+        auto tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            out << (channels == 3 ? "PF" : "Pf") << '\n'
+                << width << ' ' << height << '\n'
+                << (std::endian::native == std::endian::little ? "-1.0" : "1.0") << '\n';
+
+            auto n = pixels();
+            std::vector<float> row(static_cast<size_t>(width) * channels);
+            for (int y = height - 1; y >= 0; y--)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    auto i = (static_cast<size_t>(y) * width) + x;
+                    for (int c = 0; c < channels; c++)
+                        row[(static_cast<size_t>(x) * channels) + c] = data[(c * n) + i];
+                }
+                out.write(reinterpret_cast<const char *>(row.data()), // NOLINT
+                          static_cast<std::streamsize>(row.size() * sizeof(float)));
+            }
+            if (!out)
+            {
+                std::cerr << "ERROR: Could not write '" << tmp_path << "'.\n";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, path, ec);
+        return !ec;
+    }
+};
@@ -0,0 +1,666 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "aabb.hpp"
+#include "hittable.hpp"
+#include "hittable_list.hpp"
+#include "sphere.hpp"
+
+/*
+NOTE: 扁平化 BVH（线性数组形式）
+bvh_node 是一棵由 shared_ptr 串起来的树：每个节点一次堆分配，遍历时是虚函数递归，
+节点散落在堆上，缓存不友好，也没法直接写进文件。
+
+flat_bvh 把整棵树按深度优先顺序放进一个连续数组：
+    内部节点：左孩子紧跟在自己后面（下标 +1），右孩子下标存在 offset 里
+    叶子节点：offset 是 prim_indices 中第一个图元的位置，count 是图元个数
+图元本身不动，prim_indices 是排好序的图元下标。
+节点只有 32 字节、没有指针，所以可以原样写入缓存文件，再用 mmap 直接拿来遍历。
+*/
+struct flat_bvh_node // NOLINT
+{
+    float min[3];    // NOLINT 包围盒下界（向下取整到 float，保证保守）
+    float max[3];    // NOLINT 包围盒上界（向上取整到 float）
+    uint32_t offset; // 内部节点：右孩子下标；叶子：第一个图元在 prim_indices 中的位置
+    uint16_t count;  // 叶子中的图元个数，0 表示内部节点
+    uint16_t axis;   // 内部节点的分割轴，遍历时据此决定先走近的孩子
+};
+static_assert(sizeof(flat_bvh_node) == 32);
+
+class flat_bvh // NOLINT
+{
+  public:
+    flat_bvh() = default;
+
+    // 不拥有数据的视图：节点和下标在别处（例如 mmap 的缓存文件），owner 负责保活
+    flat_bvh(std::span<const flat_bvh_node> nodes, std::span<const uint32_t> prim_indices,
+             std::shared_ptr<const void> owner = nullptr)
+        : nodes_(nodes), prim_indices_(prim_indices), owner_(std::move(owner))
+    {
+    }
+
+    // span 指向自己的 vector，拷贝后会指向别人的数据，所以只允许移动
+    flat_bvh(const flat_bvh &) = delete;
+    flat_bvh &operator=(const flat_bvh &) = delete;
+    flat_bvh(flat_bvh &&) = default;
+    flat_bvh &operator=(flat_bvh &&) = default;
+    ~flat_bvh() = default;
+
+    /*
+    从图元包围盒构建。分割用分桶 SAH（surface area heuristic）：
+        沿质心跨度最大的轴分成 k_bins 个桶，枚举桶之间的 k_bins-1 个分割位置，
+        取 面积(左)*个数(左) + 面积(右)*个数(右) 最小的那个
+    叶子大小也由同一个代价模型决定（以一次图元求交为单位）：
+        做成叶子：count
+        分割：    k_traversal_cost + (面积(左)*个数(左) + 面积(右)*个数(右)) / 面积(节点)
+    图元数不超过 max_leaf_size 且做成叶子不更贵时就停止分割，所以叶子里有 1..max_leaf_size 个图元，
+    而不是一律分到 1、2 个。
+    质心全部重合（无法分割）或递归过深时退回中位数分割，保证树的深度有界。
+    */
+    static constexpr int k_default_max_leaf_size = 8;
+
+    static flat_bvh build(std::span<const aabb> boxes,
+                          int max_leaf_size = k_default_max_leaf_size)
+    {
+        flat_bvh bvh;
+        if (boxes.empty())
+            return bvh;
+
+        builder b{boxes, bvh.node_storage_, bvh.index_storage_,
+                  std::max(1, std::min(max_leaf_size, 0xffff))};
+        bvh.index_storage_.resize(boxes.size());
+        std::iota(bvh.index_storage_.begin(), bvh.index_storage_.end(), 0U);
+        bvh.node_storage_.reserve(2 * boxes.size());
+        b.build(0, static_cast<uint32_t>(boxes.size()), 0);
+
+        bvh.nodes_ = bvh.node_storage_;
+        bvh.prim_indices_ = bvh.index_storage_;
+        return bvh;
+    }
+
+    [[nodiscard]] std::span<const flat_bvh_node> nodes() const
+    {
+        return nodes_;
+    }
+
+    [[nodiscard]] std::span<const uint32_t> prim_indices() const
+    {
+        return prim_indices_;
+    }
+
+    [[nodiscard]] aabb bounds() const
+    {
+        if (nodes_.empty())
+            return aabb::empty;
+        const auto &root = nodes_[0];
+        return {point3(root.min[0], root.min[1], root.min[2]),
+                point3(root.max[0], root.max[1], root.max[2])};
+    }
+
+    /*
+    最近交点遍历。hit_prim(prim, ray_t) 测试一个图元，命中时负责把 ray_t.max 缩短到交点，
+    之后的包围盒测试都用缩短后的区间，远处的节点会被直接剔除。
+    */
+    template <typename F>
+    bool closest_hit(const ray &r, interval ray_t, F &&hit_prim) const
+    {
+        return closest_hit_leaves(r, ray_t, [&](uint32_t offset, uint32_t count,
+                                                interval &t) {
+            bool hit_anything = false;
+            for (uint32_t i = 0; i < count; i++)
+                hit_anything |= hit_prim(prim_indices_[offset + i], t);
+            return hit_anything;
+        });
+    }
+
+    /*
+    同样的遍历，但每个叶子只回调一次：hit_leaf(offset, count, ray_t) 测试
+    prim_indices[offset, offset + count) 中的图元，调用方可以按叶子批量求交。
+    */
+    template <typename F>
+    bool closest_hit_leaves(const ray &r, interval ray_t, F &&hit_leaf) const
+    {
+        return traverse<false>(r, ray_t, hit_leaf);
+    }
+
+    /*
+    遮挡查询（any-hit）：hit_prim(prim, ray_t) 返回 true 表示图元挡住了 ray_t，遍历立刻结束。
+    不缩短 ray_t，也不需要找最近的交点。
+    */
+    template <typename F>
+    bool any_hit(const ray &r, interval ray_t, F &&hit_prim) const
+    {
+        return any_hit_leaves(r, ray_t, [&](uint32_t offset, uint32_t count,
+                                            const interval &t) {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (hit_prim(prim_indices_[offset + i], t))
+                    return true;
+            }
+            return false;
+        });
+    }
+
+    template <typename F>
+    bool any_hit_leaves(const ray &r, interval ray_t, F &&hit_leaf) const
+    {
+        return traverse<true>(r, ray_t, hit_leaf);
+    }
+
+    // SAH 递归深度超过 k_max_sah_depth 后改用中位数分割，总深度 <= 64 + log2(n) < k_max_depth
+    static constexpr uint32_t k_max_depth = 128;
+
+  private:
+    static constexpr int k_max_sah_depth = 64;
+    static constexpr int k_bins = 12;
+    static constexpr double k_traversal_cost = 4.0; // 访问一个节点相对一次图元求交的代价
+
+    std::vector<flat_bvh_node> node_storage_;
+    std::vector<uint32_t> index_storage_;
+    std::span<const flat_bvh_node> nodes_;
+    std::span<const uint32_t> prim_indices_;
+    std::shared_ptr<const void> owner_;
+
+    /*
+    用显式栈代替递归，先走光线方向上近的孩子。
+    AnyHit 时叶子报告命中就直接返回：近处的遮挡物最先被测试，阴影光线通常走不了几个节点。
+    */
+    template <bool AnyHit, typename F>
+    bool traverse(const ray &r, interval ray_t, F &hit_leaf) const
+    {
+        if (nodes_.empty())
+            return false;
+
+        const vec3 inv_dir(1.0 / r.direction().x(), 1.0 / r.direction().y(),
+                           1.0 / r.direction().z());
+        const bool dir_neg[3] = {inv_dir.x() < 0, inv_dir.y() < 0, inv_dir.z() < 0};
+
+        bool hit_anything = false;
+        std::array<uint32_t, k_max_depth> stack; // NOLINT
+        int top = 0;
+        uint32_t index = 0;
+        while (true)
+        {
+            const auto &node = nodes_[index];
+            count_stat(render_stat::bvh_nodes_visited);
+            count_stat(render_stat::ray_box_tests);
+            if (hit_node(node, r.origin(), inv_dir, ray_t))
+            {
+                if (node.count > 0)
+                {
+                    bool hit = hit_leaf(node.offset, node.count, ray_t);
+                    if constexpr (AnyHit)
+                    {
+                        if (hit)
+                            return true;
+                    }
+                    hit_anything |= hit;
+                }
+                else if (dir_neg[node.axis])
+                {
+                    // 光线沿分割轴负方向：右孩子更近
+                    stack[top++] = index + 1;
+                    index = node.offset;
+                    continue;
+                }
+                else
+                {
+                    stack[top++] = node.offset;
+                    index = index + 1;
+                    continue;
+                }
+            }
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+        return hit_anything;
+    }
+
+    static bool hit_node(const flat_bvh_node &node, const point3 &origin,
+                         const vec3 &inv_dir, const interval &ray_t)
+    {
+        double t_min = ray_t.min;
+        double t_max = ray_t.max;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto t0 = (node.min[axis] - origin[axis]) * inv_dir[axis];
+            auto t1 = (node.max[axis] - origin[axis]) * inv_dir[axis];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            t_min = std::max(t0, t_min);
+            t_max = std::min(t1, t_max);
+            if (t_max <= t_min)
+                return false;
+        }
+        return true;
+    }
+
+    // double -> float 时朝外取整，保证 float 包围盒仍然包住原来的 double 包围盒
+    static float round_down(double x)
+    {
+        auto f = static_cast<float>(x);
+        return (f > x) ? std::nextafter(f, -INFINITY) : f;
+    }
+
+    static float round_up(double x)
+    {
+        auto f = static_cast<float>(x);
+        return (f < x) ? std::nextafter(f, INFINITY) : f;
+    }
+
+    static double half_area(const aabb &box)
+    {
+        auto dx = box.x.size();
+        auto dy = box.y.size();
+        auto dz = box.z.size();
+        return (dx * dy) + (dy * dz) + (dz * dx);
+    }
+
+    struct builder
+    {
+        std::span<const aabb> boxes;
+        std::vector<flat_bvh_node> &nodes;
+        std::vector<uint32_t> &indices;
+        int max_leaf_size;
+
+        [[nodiscard]] double centroid(uint32_t prim, int axis) const
+        {
+            const auto &ax = boxes[prim].axis_interval(axis);
+            return 0.5 * (ax.min + ax.max);
+        }
+
+        uint32_t build(uint32_t begin, uint32_t end, int depth) // NOLINT
+        {
+            aabb bounds = aabb::empty;
+            aabb centroid_bounds = aabb::empty;
+            for (auto i = begin; i < end; i++)
+            {
+                const auto &box = boxes[indices[i]];
+                bounds = aabb(bounds, box);
+                auto c = point3(centroid(indices[i], 0), centroid(indices[i], 1),
+                                centroid(indices[i], 2));
+                centroid_bounds = aabb(centroid_bounds, aabb(c, c));
+            }
+
+            auto node_index = static_cast<uint32_t>(nodes.size());
+            nodes.push_back({});
+            for (int axis = 0; axis < 3; axis++)
+            {
+                nodes[node_index].min[axis] = round_down(bounds.axis_interval(axis).min);
+                nodes[node_index].max[axis] = round_up(bounds.axis_interval(axis).max);
+            }
+
+            auto count = end - begin;
+            int axis = centroid_bounds.longest_axis();
+            sah_split split;
+            if (count > 1 && depth < k_max_sah_depth)
+                split = find_sah_split(begin, end, axis, centroid_bounds);
+
+            if (count <= static_cast<uint32_t>(max_leaf_size))
+            {
+                auto area = half_area(bounds);
+                auto split_cost = (split.bin >= 0 && area > 0)
+                                      ? k_traversal_cost + (split.cost / area)
+                                      : infinity;
+                if (static_cast<double>(count) <= split_cost)
+                {
+                    nodes[node_index].offset = begin;
+                    nodes[node_index].count = static_cast<uint16_t>(count);
+                    return node_index;
+                }
+            }
+
+            auto mid = (split.bin >= 0)
+                           ? partition(begin, end, axis, centroid_bounds, split.bin)
+                           : begin;
+            if (mid == begin || mid == end)
+            {
+                // 中位数分割：只需要部分排序
+                mid = begin + (count / 2);
+                std::nth_element(indices.begin() + begin, indices.begin() + mid,
+                                 indices.begin() + end, [&](uint32_t a, uint32_t b) {
+                                     return centroid(a, axis) < centroid(b, axis);
+                                 });
+            }
+
+            build(begin, mid, depth + 1); // 左孩子紧跟在 node_index 后面
+            auto right = build(mid, end, depth + 1);
+            nodes[node_index].offset = right;
+            nodes[node_index].count = 0;
+            nodes[node_index].axis = static_cast<uint16_t>(axis);
+            return node_index;
+        }
+
+        struct sah_split
+        {
+            int bin = -1; // 左边是 [0, bin) 号桶；-1 表示无法分割
+            double cost = infinity;
+        };
+
+        [[nodiscard]] int bin_of(uint32_t prim, int axis,
+                                 const aabb &centroid_bounds) const
+        {
+            const auto &extent = centroid_bounds.axis_interval(axis);
+            auto b = static_cast<int>(k_bins * (centroid(prim, axis) - extent.min) /
+                                      extent.size());
+            return std::clamp(b, 0, k_bins - 1);
+        }
+
+        // 只求最优分割和它的代价（面积*个数之和），不移动图元
+        [[nodiscard]] sah_split find_sah_split(uint32_t begin, uint32_t end, int axis,
+                                               const aabb &centroid_bounds) const
+        {
+            const auto &extent = centroid_bounds.axis_interval(axis);
+            if (!(extent.size() > 0))
+                return {};
+
+            auto bin_of = [&](uint32_t prim) {
+                return this->bin_of(prim, axis, centroid_bounds);
+            };
+
+            std::array<aabb, k_bins> bin_boxes;
+            bin_boxes.fill(aabb::empty);
+            std::array<uint32_t, k_bins> bin_counts{};
+            for (auto i = begin; i < end; i++)
+            {
+                auto b = bin_of(indices[i]);
+                bin_boxes[b] = aabb(bin_boxes[b], boxes[indices[i]]);
+                bin_counts[b]++;
+            }
+
+            // 从右往左扫一遍，得到每个分割位置右侧的面积*个数
+            std::array<double, k_bins> right_cost{};
+            aabb acc = aabb::empty;
+            uint32_t acc_count = 0;
+            for (int b = k_bins - 1; b > 0; b--)
+            {
+                acc = aabb(acc, bin_boxes[b]);
+                acc_count += bin_counts[b];
+                right_cost[b] = acc_count ? half_area(acc) * acc_count : 0;
+            }
+
+            // 再从左往右扫，找代价最小的分割
+            sah_split best;
+            acc = aabb::empty;
+            acc_count = 0;
+            for (int b = 1; b < k_bins; b++)
+            {
+                acc = aabb(acc, bin_boxes[b - 1]);
+                acc_count += bin_counts[b - 1];
+                auto cost = (acc_count ? half_area(acc) * acc_count : 0) + right_cost[b];
+                if (acc_count > 0 && acc_count < end - begin && cost < best.cost)
+                    best = {b, cost};
+            }
+            return best;
+        }
+
+        // 按 find_sah_split 选出的桶分开，返回分割位置
+        uint32_t partition(uint32_t begin, uint32_t end, int axis,
+                           const aabb &centroid_bounds, int bin)
+        {
+            auto it = std::partition(indices.begin() + begin, indices.begin() + end,
+                                     [&](uint32_t prim) {
+                                         return bin_of(prim, axis, centroid_bounds) < bin;
+                                     });
+            return static_cast<uint32_t>(it - indices.begin());
+        }
+    };
+};
+
+/*
+NOTE: 用 flat_bvh 加速一组 hittable，可以替代 bvh_node。
+图元保持原来的顺序，BVH 只保存下标，所以同一份 BVH 可以序列化后配合重新构造的图元使用。
+
+叶子按图元类型批量求交：构造时把每个叶子里的静止球体取出来，球心和半径平方按 SoA 排成
+每组 k_pack_width 个的 sphere_pack（不满的组用半径平方 -inf 填充，判别式恒为负）。
+遍历到叶子时一组球在定长循环里同时求交（只有算术和选择、没有分支，便于编译器向量化），
+取最近的根，只记下 t 和这个球（rec.deferred），和其他图元一样等整棵树遍历完才补全命中记录。
+求根的运算顺序与 sphere::hit 完全相同，所以结果与逐个调用 hit() 逐位相同。
+其余图元（quad、盒子、运动球体、嵌套的 BVH 等）仍然逐个调用 intersect()。
+*/
+class flat_bvh_accel : public hittable // NOLINT
+{
+  public:
+    explicit flat_bvh_accel(const hittable_list &list,
+                            int max_leaf_size = flat_bvh::k_default_max_leaf_size)
+        : objects_(list.objects)
+    {
+        std::vector<aabb> boxes;
+        boxes.reserve(objects_.size());
+        for (const auto &object : objects_)
+            boxes.push_back(object->bounding_box());
+        bvh_ = flat_bvh::build(boxes, max_leaf_size);
+        bbox_ = bvh_.bounds();
+        build_leaf_batches();
+    }
+
+    // 使用已经构建好的 BVH（例如从缓存加载）；prim_indices 必须对应 objects 的下标
+    flat_bvh_accel(std::vector<std::shared_ptr<hittable>> objects, flat_bvh bvh)
+        : objects_(std::move(objects)), bvh_(std::move(bvh)), bbox_(bvh_.bounds())
+    {
+        build_leaf_batches();
+    }
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        return bvh_.closest_hit_leaves(
+            r, ray_t, [&](uint32_t offset, uint32_t /*count*/, interval &t) {
+                return hit_leaf(leaves_[leaf_of_offset_[offset]], r, t, rec);
+            });
+    }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        return bvh_.any_hit_leaves(
+            r, ray_t, [&](uint32_t offset, uint32_t /*count*/, const interval &t) {
+                return occluded_leaf(leaves_[leaf_of_offset_[offset]], r, t);
+            });
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        for (const auto &object : objects_)
+            object->collect_materials(out);
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return bbox_;
+    }
+
+    [[nodiscard]] const flat_bvh &bvh() const
+    {
+        return bvh_;
+    }
+
+    static constexpr int k_pack_width = 4;
+
+  private:
+    struct alignas(32) sphere_pack
+    {
+        double center_x[k_pack_width];
+        double center_y[k_pack_width];
+        double center_z[k_pack_width];
+        double radius_sq[k_pack_width];
+        const sphere *spheres[k_pack_width];
+    };
+
+    // 一个叶子：packs_[first_pack, +pack_count) 和 others_[first_other, +other_count)
+    struct leaf_batch
+    {
+        uint32_t first_pack;
+        uint32_t pack_count;
+        uint32_t first_other;
+        uint32_t other_count;
+    };
+
+    std::vector<std::shared_ptr<hittable>> objects_;
+    flat_bvh bvh_;
+    aabb bbox_;
+    std::vector<sphere_pack> packs_;
+    std::vector<uint32_t> others_;
+    std::vector<leaf_batch> leaves_;
+    std::vector<uint32_t> leaf_of_offset_; // 叶子的 offset -> leaves_ 下标
+
+    void build_leaf_batches()
+    {
+        auto prims = bvh_.prim_indices();
+        leaf_of_offset_.assign(prims.size(), 0);
+        for (const auto &node : bvh_.nodes())
+        {
+            if (node.count == 0)
+                continue;
+            leaf_batch leaf{static_cast<uint32_t>(packs_.size()), 0,
+                            static_cast<uint32_t>(others_.size()), 0};
+            int lane = k_pack_width;
+            for (uint32_t i = 0; i < node.count; i++)
+            {
+                auto prim = prims[node.offset + i];
+                const auto *s = dynamic_cast<const sphere *>(objects_[prim].get());
+                if (s == nullptr || s->is_moving())
+                {
+                    others_.push_back(prim);
+                    leaf.other_count++;
+                    continue;
+                }
+                if (lane == k_pack_width)
+                {
+                    packs_.push_back(empty_pack());
+                    leaf.pack_count++;
+                    lane = 0;
+                }
+                auto &pack = packs_.back();
+                auto center = s->center();
+                pack.center_x[lane] = center.x();
+                pack.center_y[lane] = center.y();
+                pack.center_z[lane] = center.z();
+                pack.radius_sq[lane] = s->radius() * s->radius();
+                pack.spheres[lane] = s;
+                lane++;
+            }
+            leaf_of_offset_[node.offset] = static_cast<uint32_t>(leaves_.size());
+            leaves_.push_back(leaf);
+        }
+    }
+
+    static sphere_pack empty_pack()
+    {
+        sphere_pack pack{};
+        for (int lane = 0; lane < k_pack_width; lane++)
+            pack.radius_sq[lane] = -infinity;
+        return pack;
+    }
+
+    bool hit_leaf(const leaf_batch &leaf, const ray &r, interval &ray_t,
+                  hit_record &rec) const
+    {
+        bool hit_anything = false;
+        if (leaf.pack_count > 0)
+        {
+            const sphere *nearest = nullptr;
+            double nearest_t = 0;
+            for (uint32_t i = 0; i < leaf.pack_count; i++)
+            {
+                if (hit_pack(packs_[leaf.first_pack + i], r, ray_t, nearest, nearest_t))
+                    ray_t.max = nearest_t;
+            }
+            if (nearest != nullptr)
+            {
+                rec.t = nearest_t;
+                rec.deferred = nearest;
+                hit_anything = true;
+            }
+        }
+        for (uint32_t i = 0; i < leaf.other_count; i++)
+        {
+            if (objects_[others_[leaf.first_other + i]]->intersect(r, ray_t, rec))
+            {
+                ray_t.max = rec.t;
+                hit_anything = true;
+            }
+        }
+        return hit_anything;
+    }
+
+    bool occluded_leaf(const leaf_batch &leaf, const ray &r, const interval &ray_t) const
+    {
+        for (uint32_t i = 0; i < leaf.pack_count; i++)
+        {
+            const sphere *nearest = nullptr;
+            double nearest_t = 0;
+            if (hit_pack(packs_[leaf.first_pack + i], r, ray_t, nearest, nearest_t))
+                return true;
+        }
+        for (uint32_t i = 0; i < leaf.other_count; i++)
+        {
+            if (objects_[others_[leaf.first_other + i]]->occluded(r, ray_t))
+                return true;
+        }
+        return false;
+    }
+
+    // 一组球同时求交，与 sphere::hit 的运算相同；比 nearest_t 更近时更新 nearest
+    static bool hit_pack(const sphere_pack &pack, const ray &r, const interval &ray_t,
+                         const sphere *&nearest, double &nearest_t)
+    {
+        count_stat(render_stat::sphere_tests, k_pack_width);
+        const auto &o = r.origin();
+        const auto &d = r.direction();
+        auto a = d.length_squared();
+
+        double h[k_pack_width];
+        double discriminant[k_pack_width];
+        for (int lane = 0; lane < k_pack_width; lane++)
+        {
+            auto ocx = pack.center_x[lane] - o.x();
+            auto ocy = pack.center_y[lane] - o.y();
+            auto ocz = pack.center_z[lane] - o.z();
+            h[lane] = (d.x() * ocx) + (d.y() * ocy) + (d.z() * ocz);
+            auto c = ((ocx * ocx) + (ocy * ocy) + (ocz * ocz)) - pack.radius_sq[lane];
+            discriminant[lane] = (h[lane] * h[lane]) - (a * c);
+        }
+
+        const auto t_min = ray_t.min;
+        const auto t_max = ray_t.max;
+        double roots[k_pack_width];
+        for (int lane = 0; lane < k_pack_width; lane++)
+        {
+            auto sqrtd = std::sqrt(std::max(discriminant[lane], 0.0));
+            auto near_root = (h[lane] - sqrtd) / a;
+            auto far_root = (h[lane] + sqrtd) / a;
+            auto far = (t_min < far_root && far_root < t_max) ? far_root : infinity;
+            auto root = (t_min < near_root && near_root < t_max) ? near_root : far;
+            roots[lane] = (discriminant[lane] < 0) ? infinity : root;
+        }
+
+        int best = -1;
+        for (int lane = 0; lane < k_pack_width; lane++)
+        {
+            if (roots[lane] < t_max && (best < 0 || roots[lane] < roots[best]))
+                best = lane;
+        }
+        if (best < 0)
+            return false;
+        nearest = pack.spheres[best];
+        nearest_t = roots[best];
+        return true;
+    }
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "density_field.hpp"
+#include "hittable.hpp"
+#include "material.hpp"
+
+/*
+NOTE: 粗粒度 majorant 网格
+把介质的包围盒切成 res^3 个格子，每个格子存该区域密度的上界。
+delta tracking 在每个格子里用格子自己的上界采样自由程：
+    上界为 0 的格子：直接跳过，一个随机数都不用
+    上界很小的格子：步长很大，几步就走完
+比全局一个 majorant 快得多（全局上界由最浓的那团烟决定）。
+*/
+class majorant_grid // NOLINT
+{
+  public:
+    majorant_grid(const density_field &field, const aabb &bounds, int res)
+        : bounds_(bounds), res_(res), values_(static_cast<size_t>(res) * res * res)
+    {
+        for (int k = 0; k < res; k++)
+            for (int j = 0; j < res; j++)
+                for (int i = 0; i < res; i++)
+                    values_[index(i, j, k)] = field.max_density(cell_box(i, j, k));
+    }
+
+    [[nodiscard]] const aabb &bounds() const
+    {
+        return bounds_;
+    }
+
+    [[nodiscard]] int resolution() const
+    {
+        return res_;
+    }
+
+    [[nodiscard]] double value(int i, int j, int k) const
+    {
+        return values_[index(i, j, k)];
+    }
+
+    [[nodiscard]] double cell_size(int axis) const
+    {
+        return bounds_.axis_interval(axis).size() / res_;
+    }
+
+  private:
+    aabb bounds_;
+    int res_;
+    std::vector<double> values_;
+
+    [[nodiscard]] size_t index(int i, int j, int k) const
+    {
+        return (((static_cast<size_t>(k) * res_) + j) * res_) + i;
+    }
+
+    [[nodiscard]] aabb cell_box(int i, int j, int k) const
+    {
+        auto lo = point3(bounds_.x.min + (cell_size(0) * i),
+                         bounds_.y.min + (cell_size(1) * j),
+                         bounds_.z.min + (cell_size(2) * k));
+        return {lo, lo + vec3(cell_size(0), cell_size(1), cell_size(2))};
+    }
+};
+
+/*
+NOTE: 非均匀介质（烟、云）
+与 constant_medium 的区别：
+    1. 密度来自 density_field，可以是程序化噪声或体素网格
+    2. 进出距离只算一次：介质由一个 aabb 包围，一次 slab 测试（aabb::clip）得到 [进入, 离开]，
+       而不是对边界物体做两次完整求交（其中一次还是对 interval::universe）
+    3. 散射距离用 delta tracking 采样：
+           按 majorant 采样一个"候选碰撞"，以 density/majorant 的概率接受为真实碰撞，
+           否则是"空碰撞"，从这里继续走。
+           majorant 是严格的上界（density_field::max_density），结果是无偏的
+       沿光线用 3D DDA 逐格走 majorant 网格，每个格子用自己的上界
+*/
+class heterogeneous_medium : public hittable // NOLINT
+{
+  public:
+    heterogeneous_medium(std::shared_ptr<density_field> field, const aabb &bounds,
+                         const std::shared_ptr<texture> &tex, int majorant_res = 16)
+        : field_(std::move(field)), majorants_(*field_, bounds, majorant_res),
+          phase_function_(std::make_shared<isotropic>(tex))
+    {
+    }
+
+    heterogeneous_medium(std::shared_ptr<density_field> field, const aabb &bounds,
+                         const color &albedo, int majorant_res = 16)
+        : field_(std::move(field)), majorants_(*field_, bounds, majorant_res),
+          phase_function_(std::make_shared<isotropic>(albedo))
+    {
+    }
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_stat(render_stat::hetero_medium_hits);
+        double t_hit = 0;
+        bool collided = false;
+
+        // NOTE: delta tracking：候选碰撞以 density/majorant 的概率成为真实碰撞
+        track(r, ray_t, [&](double t, double majorant) {
+            auto sigma = field_->density(r.at(t));
+            if (random_double() * majorant < sigma)
+            {
+                t_hit = t;
+                collided = true;
+                return false; // 停止
+            }
+            return true; // 空碰撞，继续
+        });
+
+        if (!collided)
+            return false;
+
+        rec.t = t_hit;
+        rec.p = r.at(t_hit);
+        rec.normal = vec3(1, 0, 0); // 任意法向量，体积散射没有表面概念
+        rec.front_face = true;
+        rec.u = 0;
+        rec.v = 0;
+        rec.mat = phase_function_.get();
+        return true;
+    }
+
+    // delta tracking 每次 hit() 都重新取候选碰撞
+    [[nodiscard]] bool stochastic() const override
+    {
+        return true;
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        out.push_back(phase_function_.get());
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return majorants_.bounds();
+    }
+
+  private:
+    std::shared_ptr<density_field> field_;
+    majorant_grid majorants_;
+    std::shared_ptr<material> phase_function_;
+
+    /*
+    沿光线逐格走 majorant 网格（Amanatides-Woo DDA），在每个格子里按该格子的上界采样候选碰撞。
+    on_collision(t, majorant) 返回 false 时提前结束。
+    注意：光线方向不是单位向量，密度是按世界距离定义的，所以参数 t 上的消光系数要乘 |d|
+    */
+    template <typename F>
+    void track(const ray &r, interval ray_t, F &&on_collision) const
+    {
+        // 第1步：一次 slab 测试得到进入、离开距离
+        if (!majorants_.bounds().clip(r, ray_t))
+            return;
+
+        const int res = majorants_.resolution();
+        const auto &bounds = majorants_.bounds();
+        const auto ray_length = r.direction().length();
+
+        // 第2步：DDA 初始化：进入点所在格子，以及到下一个格子边界的 t
+        auto entry = r.at(ray_t.min);
+        int cell[3];
+        int step[3];
+        double next_t[3];
+        double delta_t[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const auto &ax = bounds.axis_interval(axis);
+            auto size = majorants_.cell_size(axis);
+            auto index = static_cast<int>((entry[axis] - ax.min) / size);
+            cell[axis] = std::clamp(index, 0, res - 1);
+
+            auto dir = r.direction()[axis];
+            if (dir > 0)
+            {
+                step[axis] = 1;
+                auto plane = ax.min + ((cell[axis] + 1) * size);
+                next_t[axis] = (plane - r.origin()[axis]) / dir;
+                delta_t[axis] = size / dir;
+            }
+            else if (dir < 0)
+            {
+                step[axis] = -1;
+                auto plane = ax.min + (cell[axis] * size);
+                next_t[axis] = (plane - r.origin()[axis]) / dir;
+                delta_t[axis] = -size / dir;
+            }
+            else
+            {
+                step[axis] = 0;
+                next_t[axis] = infinity;
+                delta_t[axis] = infinity;
+            }
+        }
+
+        // 第3步：逐格前进
+        double t = ray_t.min;
+        while (t < ray_t.max)
+        {
+            int axis = (next_t[0] < next_t[1]) ? (next_t[0] < next_t[2] ? 0 : 2)
+                                               : (next_t[1] < next_t[2] ? 1 : 2);
+            auto cell_exit = std::min(next_t[axis], ray_t.max);
+            auto majorant = majorants_.value(cell[0], cell[1], cell[2]);
+
+            // 空格子直接跳过；否则在格子内按指数分布采样候选碰撞
+            if (majorant > 0)
+            {
+                auto sigma_t = majorant * ray_length;
+                while (true)
+                {
+                    t -= std::log(1 - random_double()) / sigma_t;
+                    if (t >= cell_exit)
+                        break; // 无记忆性：越过格子边界后用下一个格子的上界重新采样
+                    if (!on_collision(t, majorant))
+                        return;
+                }
+            }
+
+            t = cell_exit;
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= res)
+                return;
+            next_t[axis] += delta_t[axis];
+        }
+    }
+};
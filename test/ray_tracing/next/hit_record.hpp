@@ -1,10 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include "ray.hpp"
 #include "vec3.hpp"
 
 class material;
+struct hittable;
 
 // NOLINTBEGIN
 struct hit_record
@@ -13,7 +15,8 @@ struct hit_record
     vec3 normal; // 法向量
     double t;    // 光线参数
 
-    std::shared_ptr<material> mat; // 材质
+    // 材质，由物体持有（shared_ptr）；这里只是借用，命中检测时复制不改引用计数
+    const material *mat = nullptr;
 
     bool front_face; // 正面还是背面
 
@@ -22,6 +25,17 @@ struct hit_record
     double u;
     double v;
 
+    // NOTE: 延迟的表面信息（见 hittable::intersect）：求交时只记下 t 和下面几项，
+    // 最近的交点确定后由 deferred->surface_interaction() 补全 p、normal、front_face、u、v、mat。
+    // deferred 为空表示记录已经完整。
+    const hittable *deferred = nullptr;
+    uint32_t prim = 0; // 图元编号（三角形序号、盒子的面……），含义由 deferred 决定
+    double b1 = 0;     // 重心坐标
+    double b2 = 0;
+
+    // 补全记录的图元（finish_hit 填写；translate 等不延迟的物体为空）。光源采样据此认出命中的光源
+    const hittable *object = nullptr;
+
     constexpr void set_face_normal(const ray &r, const vec3 &outward_normal)
     {
         // NOTE: 假设参数'outard_normal'具有单位长度。
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "aabb.hpp"
 #include "degrees_to_radians.hpp"
 #include "hit_record.hpp"
@@ -12,8 +14,71 @@ struct hittable // NOLINT
 
     virtual bool hit(const ray &r, interval ray_t, hit_record &rec) const = 0;
 
+    /*
+    NOTE: 延迟的表面信息（deferred surface interaction）
+    遍历加速结构时一条光线会先后命中好几个图元，越来越近，只有最后一个有用。
+    如果每次命中都算交点、法线、UV（球面 UV 要 acos + atan2）和材质，大部分都白算了。所以求交分两步：
+        intersect()            只写 rec.t，并在 rec.deferred / prim / b1 / b2 里记下补全需要的东西
+        surface_interaction()  对最终最近的交点补全 p、normal、front_face、u、v、mat
+    finish_hit() 在遍历结束后调用一次第二步。图元和加速结构的 hit() = intersect() + finish_hit()。
+    约定：与 hit() 一样，没有命中时不修改 rec（rec 里可能是别的物体的候选交点）。
+    默认实现调用 hit()，得到的记录已经是完整的（translate、rotate_y、体积介质不延迟）。
+    */
+    virtual bool intersect(const ray &r, interval ray_t, hit_record &rec) const
+    {
+        if (!hit(r, ray_t, rec))
+            return false;
+        rec.deferred = nullptr; // 覆盖了之前的候选，它的补全信息作废
+        rec.object = nullptr;
+        return true;
+    }
+
+    // 根据 intersect() 记下的 rec.t、prim、b1、b2 补全命中记录
+    virtual void surface_interaction(const ray & /*r*/, hit_record & /*rec*/) const {}
+
+    static void finish_hit(const ray &r, hit_record &rec)
+    {
+        if (rec.deferred == nullptr)
+            return;
+        count_stat(render_stat::surface_interactions);
+        const auto *object = rec.deferred;
+        rec.deferred = nullptr;
+        rec.object = object;
+        object->surface_interaction(r, rec);
+    }
+
+    /*
+    NOTE: 遮挡查询（any-hit）：ray_t 内只要有任何交点就返回 true。
+    阴影光线、可见性、环境光遮蔽只关心"有没有挡住"，不需要最近的交点，也不需要法线、UV、材质。
+    几何体和加速结构覆写它：找到第一个交点就返回，不计算着色数据。
+    默认实现退回 hit()，结果正确，只是没有提前退出（体积介质用默认实现：是否散射本身是随机的）。
+    */
+    [[nodiscard]] virtual bool occluded(const ray &r, interval ray_t) const
+    {
+        hit_record rec;
+        return hit(r, ray_t, rec);
+    }
+
+    // NOTE: hit() 是否带随机性：体积介质每次调用都重新取一个自由程。
+    // 这样的物体对同一条光线多测一次就多一次散射的机会，加速结构只能让它出现在一个叶子里（sbvh.hpp）
+    [[nodiscard]] virtual bool stochastic() const
+    {
+        return false;
+    }
+
+    // NOTE: 把自己用到的材质追加到 out（可以重复），material_table 在场景建好后用它收集所有材质。
+    // 容器和变换转给子物体；没有材质的物体不用覆写
+    virtual void collect_materials(std::vector<const material *> & /*out*/) const {}
+
     // 为Hittable构建边界框
     [[nodiscard]] virtual aabb bounding_box() const = 0; // NOLINT
+
+    // NOTE: 运动模糊：某一时刻(快门时间 [0,1])的包围盒。
+    // 默认返回整个快门区间的并集，静止物体两端相同；运动物体覆写它，给出 t=0/t=1 的紧包围盒
+    [[nodiscard]] virtual aabb bounding_box_at(double /*time*/) const // NOLINT
+    {
+        return bounding_box();
+    }
 };
 
 /*
@@ -53,11 +118,32 @@ class translate : public hittable
 
         return true;
     }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        return object->occluded(ray(r.origin() - offset, r.direction(), r.time()), ray_t);
+    }
+
+    [[nodiscard]] bool stochastic() const override
+    {
+        return object->stochastic();
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        object->collect_materials(out);
+    }
+
     aabb bounding_box() const override
     {
         return bbox;
     }
 
+    aabb bounding_box_at(double time) const override
+    {
+        return object->bounding_box_at(time) + offset;
+    }
+
   private:
     std::shared_ptr<hittable> object;
     vec3 offset;
@@ -137,22 +223,8 @@ class rotate_y : public hittable
 
     bool hit(const ray &r, interval ray_t, hit_record &rec) const override
     {
-
-        // Transform the ray from world space to object space.
         // 第1步：光线从世界空间到物体空间（反向旋转）
-        // 使用逆旋转矩阵：x' = x·cosθ - z·sinθ, z' = x·sinθ + z·cosθ
-        auto origin = point3((cos_theta * r.origin().x()) - (sin_theta * r.origin().z()),
-                             r.origin().y(), // Y分量不变
-                             (sin_theta * r.origin().x()) + (cos_theta * r.origin().z()));
-
-        // 同样变换光线方向向量
-        auto direction =
-            vec3((cos_theta * r.direction().x()) - (sin_theta * r.direction().z()),
-                 r.direction().y(), // Y分量不变
-                 (sin_theta * r.direction().x()) + (cos_theta * r.direction().z()));
-
-        // 创建在物体空间中的光线
-        ray rotated_r(origin, direction, r.time());
+        ray rotated_r = to_object_space(r);
 
         // Determine whether an intersection exists in object space (and if so, where).
         // 第2步：在物体空间中检测相交（物体保持轴对齐状态）
@@ -173,12 +245,45 @@ class rotate_y : public hittable
 
         return true;
     }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        return object->occluded(to_object_space(r), ray_t);
+    }
+
+    [[nodiscard]] bool stochastic() const override
+    {
+        return object->stochastic();
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        object->collect_materials(out);
+    }
+
     aabb bounding_box() const override
     {
         return bbox;
     }
 
   private:
+    // Transform the ray from world space to object space.
+    // 使用逆旋转矩阵：x' = x·cosθ - z·sinθ, z' = x·sinθ + z·cosθ
+    [[nodiscard]] ray to_object_space(const ray &r) const
+    {
+        auto origin = point3((cos_theta * r.origin().x()) - (sin_theta * r.origin().z()),
+                             r.origin().y(), // Y分量不变
+                             (sin_theta * r.origin().x()) + (cos_theta * r.origin().z()));
+
+        // 同样变换光线方向向量
+        auto direction =
+            vec3((cos_theta * r.direction().x()) - (sin_theta * r.direction().z()),
+                 r.direction().y(), // Y分量不变
+                 (sin_theta * r.direction().x()) + (cos_theta * r.direction().z()));
+
+        return {origin, direction, r.time()};
+    }
+
     std::shared_ptr<hittable> object; // 被旋转的物体
     double sin_theta;                 // 预计算的正弦值
     double cos_theta;                 // 预计算的余弦值
@@ -33,28 +33,70 @@ struct hittable_list : public hittable
     // NOTE: 遍历。但是不会覆盖
     bool hit(const ray &r, interval ray_t, hit_record &rec) const override
     {
-        hit_record temp_rec;
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    // 每个物体只求交，区间逐渐缩短；没命中的物体不改 rec，所以不需要临时记录
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
         bool hit_anything = false;
         auto closest_so_far = ray_t.max;
 
         for (const auto &object : objects)
         {
-            if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec))
+            if (object->intersect(r, interval(ray_t.min, closest_so_far), rec))
             {
                 hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
+                closest_so_far = rec.t;
             }
         }
 
         return hit_anything;
     }
 
+    // 任何一个物体挡住就返回，不需要找最近的
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        for (const auto &object : objects)
+        {
+            if (object->occluded(r, ray_t))
+                return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool stochastic() const override
+    {
+        for (const auto &object : objects)
+        {
+            if (object->stochastic())
+                return true;
+        }
+        return false;
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        for (const auto &object : objects)
+            object->collect_materials(out);
+    }
+
     [[nodiscard]] aabb bounding_box() const override
     {
         return bbox_;
     }
 
+    [[nodiscard]] aabb bounding_box_at(double time) const override
+    {
+        aabb box = aabb::empty;
+        for (const auto &object : objects)
+            box = aabb(box, object->bounding_box_at(time));
+        return box;
+    }
+
   private:
     aabb bbox_; // NOTE: 添加 AABB矩形
 };
\ No newline at end of file
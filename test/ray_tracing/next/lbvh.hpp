@@ -0,0 +1,517 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "flat_bvh.hpp"
+
+/*
+NOTE: Morton 码 LBVH（Lauterbach 2009 / Karras 2012）
+flat_bvh（分桶 SAH）和 sbvh 追求树的质量，每个节点都要扫描、分桶、划分，百万图元要几百毫秒到几秒。
+每帧都在变的场景（动画、粒子）更在意构建时间：LBVH 不评估任何代价，只按空间位置排序：
+    1. 图元包围盒中心量化到质心包围盒里的整数格点，三个坐标的位交错成 Morton 码
+       （63 位：每轴 21 位；30 位：每轴 10 位，排序少一半趟数，但格点粗，重码多）
+    2. 并行基数排序（LSD，每趟 11 位，每个线程先统计自己那段的直方图，再各自散射到算好的位置）
+    3. 排好序的码构成一棵基数树：节点的区间在最高的不同位处一分为二。
+       Karras 的做法让每个内部节点独立地用二分查找求出自己的区间和分割位置，完全并行；
+       码相同时用数组下标作为码的延续，保证每个节点都能分开
+    4. 按深度优先顺序写成 flat_bvh 的节点：顶部几层串行，下面的子树并行写入各自预留的位置，
+       包围盒自底向上合并
+区间里的图元数不超过 max_leaf_size 时直接做成叶子。分割轴取最高不同位所在的轴，遍历时按它先走近的孩子。
+树的深度不超过 Morton 位数 + log2(重码数)，远小于 flat_bvh::k_max_depth。
+没有做 treelet 重排（Karras & Aila 2013），质量与 SAH 的差距见 bench_lbvh。
+
+结果仍然是 flat_bvh（prim_indices 就是排序后的图元下标），flat_bvh_accel、quantized_bvh 都可以直接用。
+*/
+class lbvh_builder // NOLINT
+{
+  public:
+    static constexpr int k_default_max_leaf_size = 4;
+    static constexpr int k_radix_bits = 11;
+
+    // morton_bits：63 或 30；threads = 0 表示 std::thread::hardware_concurrency()
+    static flat_bvh build(std::span<const aabb> boxes,
+                          int max_leaf_size = k_default_max_leaf_size,
+                          int morton_bits = 63, int threads = 0)
+    {
+        if (boxes.empty())
+            return {};
+        if (threads <= 0)
+            threads = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+
+        auto storage = std::make_shared<result>();
+        lbvh_builder b(boxes, std::max(1, std::min(max_leaf_size, 0xffff)),
+                       morton_bits <= 30 ? 30 : 63, threads, *storage);
+        b.compute_codes();
+        b.sort_codes();
+        b.build_radix_tree();
+        b.emit_nodes();
+
+        auto *data = storage.get();
+        return {data->nodes, data->indices, std::move(storage)};
+    }
+
+  private:
+    // 节点和下标的存储；flat_bvh 以视图的形式引用它们，并通过 owner 保活
+    struct result
+    {
+        std::vector<flat_bvh_node> nodes;
+        std::vector<uint32_t> indices;
+    };
+
+    // 排序后 [first, last] 的图元；first < last 时 internal 是它在基数树里的内部节点
+    struct range
+    {
+        uint32_t first;
+        uint32_t last;
+        uint32_t internal;
+
+        [[nodiscard]] uint32_t size() const
+        {
+            return last - first + 1;
+        }
+    };
+
+    // 并行写入的子树：base 是它的根在节点数组里的下标
+    struct subtree
+    {
+        range root;
+        uint32_t base = 0;
+        uint32_t nodes = 0;
+    };
+
+    static constexpr uint32_t k_min_chunk = 4096; // 每个线程至少这么多个元素，否则开线程不划算
+    static constexpr int k_subtrees_per_thread = 8;
+
+    std::span<const aabb> boxes_;
+    uint32_t max_leaf_size_;
+    int morton_bits_;
+    int threads_;
+    result &out_;
+    std::vector<uint64_t> codes_;
+    std::vector<uint32_t> split_; // 内部节点 i 的左孩子区间是 [first, split_[i]]
+
+    lbvh_builder(std::span<const aabb> boxes, int max_leaf_size, int morton_bits,
+                 int threads, result &out)
+        : boxes_(boxes), max_leaf_size_(static_cast<uint32_t>(max_leaf_size)),
+          morton_bits_(morton_bits), threads_(threads), out_(out)
+    {
+    }
+
+    // 把 [0, count) 分成若干段交给线程，fn(段号, begin, end)；返回实际的段数
+    template <typename F>
+    int parallel_chunks(size_t count, const F &fn) const
+    {
+        auto chunks = static_cast<int>(
+            std::clamp<size_t>(count / k_min_chunk, 1, static_cast<size_t>(threads_)));
+        if (chunks == 1)
+        {
+            fn(0, size_t{0}, count);
+            return 1;
+        }
+        std::vector<std::jthread> workers;
+        workers.reserve(static_cast<size_t>(chunks));
+        for (int t = 0; t < chunks; t++)
+        {
+            auto begin = count * t / chunks;
+            auto end = count * (t + 1) / chunks;
+            workers.emplace_back([&fn, t, begin, end] { fn(t, begin, end); });
+        }
+        return chunks;
+    }
+
+    [[nodiscard]] point3 centroid(uint32_t prim) const
+    {
+        const auto &box = boxes_[prim];
+        return {0.5 * (box.x.min + box.x.max), 0.5 * (box.y.min + box.y.max),
+                0.5 * (box.z.min + box.z.max)};
+    }
+
+    // 把 bits 位整数的每一位隔两位放开：b2 b1 b0 -> b2 0 0 b1 0 0 b0
+    static uint64_t expand_bits(uint64_t v, int bits)
+    {
+        if (bits == 10)
+        {
+            v &= 0x3ffU;
+            v = (v | (v << 16)) & 0x30000ffU;
+            v = (v | (v << 8)) & 0x300f00fU;
+            v = (v | (v << 4)) & 0x30c30c3U;
+            v = (v | (v << 2)) & 0x9249249U;
+            return v;
+        }
+        v &= 0x1fffffU;
+        v = (v | (v << 32)) & 0x1f00000000ffffULL;
+        v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+        v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+        v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+        v = (v | (v << 2)) & 0x1249249249249249ULL;
+        return v;
+    }
+
+    // 第1步：质心包围盒（每段各自求，再合并），然后每个图元一个 Morton 码
+    void compute_codes()
+    {
+        auto n = boxes_.size();
+        std::vector<std::array<point3, 2>> partial(static_cast<size_t>(threads_));
+        auto chunks = parallel_chunks(n, [&](int t, size_t begin, size_t end) {
+            point3 lo(infinity, infinity, infinity);
+            point3 hi(-infinity, -infinity, -infinity);
+            for (auto i = begin; i < end; i++)
+            {
+                auto c = centroid(static_cast<uint32_t>(i));
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    lo[axis] = std::min(lo[axis], c[axis]);
+                    hi[axis] = std::max(hi[axis], c[axis]);
+                }
+            }
+            partial[static_cast<size_t>(t)] = {lo, hi};
+        });
+
+        auto axis_bits = morton_bits_ / 3;
+        auto cells = static_cast<double>((uint64_t{1} << axis_bits) - 1);
+        double lo[3];
+        double scale[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            lo[axis] = infinity;
+            double hi = -infinity;
+            for (int t = 0; t < chunks; t++)
+            {
+                lo[axis] = std::min(lo[axis], partial[static_cast<size_t>(t)][0][axis]);
+                hi = std::max(hi, partial[static_cast<size_t>(t)][1][axis]);
+            }
+            scale[axis] = hi > lo[axis] ? cells / (hi - lo[axis]) : 0.0;
+        }
+
+        codes_.resize(n);
+        out_.indices.resize(n);
+        parallel_chunks(n, [&](int /*t*/, size_t begin, size_t end) {
+            for (auto i = begin; i < end; i++)
+            {
+                auto c = centroid(static_cast<uint32_t>(i));
+                uint64_t code = 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    auto q = std::clamp((c[axis] - lo[axis]) * scale[axis], 0.0, cells);
+                    auto bits = expand_bits(static_cast<uint64_t>(q), axis_bits);
+                    code |= bits << (2 - axis);
+                }
+                codes_[i] = code;
+                out_.indices[i] = static_cast<uint32_t>(i);
+            }
+        });
+    }
+
+    // 第2步：LSD 基数排序 (code, 图元下标)，稳定，所以重码按原来的下标排
+    void sort_codes()
+    {
+        constexpr size_t digits = size_t{1} << k_radix_bits;
+        auto n = codes_.size();
+        std::vector<uint64_t> codes_tmp(n);
+        std::vector<uint32_t> indices_tmp(n);
+        std::vector<std::array<uint32_t, digits>> counts(static_cast<size_t>(threads_));
+
+        for (int shift = 0; shift < morton_bits_; shift += k_radix_bits)
+        {
+            auto digit = [shift](uint64_t code) {
+                return static_cast<size_t>((code >> shift) & (digits - 1));
+            };
+            auto chunks = parallel_chunks(n, [&](int t, size_t begin, size_t end) {
+                auto &count = counts[static_cast<size_t>(t)];
+                count.fill(0);
+                for (auto i = begin; i < end; i++)
+                    count[digit(codes_[i])]++;
+            });
+
+            // 所有码这一段都相同时跳过这一趟
+            bool trivial = false;
+            for (size_t d = 0; d < digits && !trivial; d++)
+            {
+                uint64_t total = 0;
+                for (int t = 0; t < chunks; t++)
+                    total += counts[static_cast<size_t>(t)][d];
+                trivial = total == n;
+            }
+            if (trivial)
+                continue;
+
+            // 每个 (数字, 段) 的起始位置：数字优先，同一个数字里段号小的在前
+            uint32_t offset = 0;
+            for (size_t d = 0; d < digits; d++)
+                for (int t = 0; t < chunks; t++)
+                {
+                    auto c = counts[static_cast<size_t>(t)][d];
+                    counts[static_cast<size_t>(t)][d] = offset;
+                    offset += c;
+                }
+
+            parallel_chunks(n, [&](int t, size_t begin, size_t end) {
+                auto &next = counts[static_cast<size_t>(t)];
+                for (auto i = begin; i < end; i++)
+                {
+                    auto pos = next[digit(codes_[i])]++;
+                    codes_tmp[pos] = codes_[i];
+                    indices_tmp[pos] = out_.indices[i];
+                }
+            });
+            codes_.swap(codes_tmp);
+            out_.indices.swap(indices_tmp);
+        }
+    }
+
+    // 排序后第 i、j 个码的公共前缀长度；码相同时接着比较下标；j 越界返回 -1
+    [[nodiscard]] int common_prefix(int64_t i, int64_t j) const
+    {
+        if (j < 0 || j >= static_cast<int64_t>(codes_.size()))
+            return -1;
+        auto a = codes_[static_cast<size_t>(i)];
+        auto b = codes_[static_cast<size_t>(j)];
+        if (a != b)
+            return std::countl_zero(a ^ b);
+        return 64 + std::countl_zero(static_cast<uint32_t>(i ^ j));
+    }
+
+    // 第3步：Karras 2012，每个内部节点独立求自己的区间和分割位置
+    void build_radix_tree()
+    {
+        auto n = static_cast<int64_t>(codes_.size());
+        if (n < 2)
+            return;
+        split_.resize(static_cast<size_t>(n - 1));
+        parallel_chunks(split_.size(), [&](int /*t*/, size_t begin, size_t end) {
+            for (auto k = begin; k < end; k++)
+            {
+                auto i = static_cast<int64_t>(k);
+                // 区间朝公共前缀更长的一侧延伸
+                int64_t d = common_prefix(i, i + 1) > common_prefix(i, i - 1) ? 1 : -1;
+                auto min_prefix = common_prefix(i, i - d);
+
+                // 先倍增找上界，再二分出区间另一端 j
+                int64_t max_length = 2;
+                while (common_prefix(i, i + (max_length * d)) > min_prefix)
+                    max_length *= 2;
+                int64_t length = 0;
+                for (auto t = max_length / 2; t >= 1; t /= 2)
+                    if (common_prefix(i, i + ((length + t) * d)) > min_prefix)
+                        length += t;
+                auto j = i + (length * d);
+
+                // 二分找区间内公共前缀变短的位置
+                auto node_prefix = common_prefix(i, j);
+                int64_t s = 0;
+                int64_t t = length;
+                do
+                {
+                    t = (t + 1) / 2;
+                    if (common_prefix(i, i + ((s + t) * d)) > node_prefix)
+                        s += t;
+                } while (t > 1);
+                split_[k] = static_cast<uint32_t>(i + (s * d) + std::min<int64_t>(d, 0));
+            }
+        });
+    }
+
+    [[nodiscard]] std::pair<range, range> children(const range &r) const
+    {
+        auto g = split_[r.internal];
+        return {range{r.first, g, g}, range{g + 1, r.last, g + 1}};
+    }
+
+    [[nodiscard]] bool is_leaf(const range &r) const
+    {
+        return r.size() <= max_leaf_size_;
+    }
+
+    [[nodiscard]] uint32_t count_nodes(const range &r) const // NOLINT
+    {
+        if (is_leaf(r))
+            return 1;
+        auto [left, right] = children(r);
+        return 1 + count_nodes(left) + count_nodes(right);
+    }
+
+    // 分割轴：区间两端的码最高不同位所在的轴（码 = x<<2 | y<<1 | z）；码相同时随便取 x
+    [[nodiscard]] uint16_t split_axis(const range &r) const
+    {
+        auto diff = codes_[r.first] ^ codes_[r.last];
+        if (diff == 0)
+            return 0;
+        auto bit = 63 - std::countl_zero(diff);
+        return static_cast<uint16_t>(2 - (bit % 3));
+    }
+
+    static float round_down(double x)
+    {
+        auto f = static_cast<float>(x);
+        return (f > x) ? std::nextafter(f, -INFINITY) : f;
+    }
+
+    static float round_up(double x)
+    {
+        auto f = static_cast<float>(x);
+        return (f < x) ? std::nextafter(f, INFINITY) : f;
+    }
+
+    void make_leaf(const range &r, flat_bvh_node &node) const
+    {
+        // 直接比较坐标，不经过 aabb 的构造函数（每次都要 pad_to_minimums）
+        double lo[3] = {infinity, infinity, infinity};
+        double hi[3] = {-infinity, -infinity, -infinity};
+        for (auto i = r.first; i <= r.last; i++)
+        {
+            const auto &box = boxes_[out_.indices[i]];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                lo[axis] = std::min(lo[axis], box.axis_interval(axis).min);
+                hi[axis] = std::max(hi[axis], box.axis_interval(axis).max);
+            }
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            node.min[axis] = round_down(lo[axis]);
+            node.max[axis] = round_up(hi[axis]);
+        }
+        node.offset = r.first;
+        node.count = static_cast<uint16_t>(r.size());
+        node.axis = 0;
+    }
+
+    // 内部节点的包围盒：左孩子紧跟在后面，右孩子在 offset
+    void merge_children(uint32_t index)
+    {
+        auto &node = out_.nodes[index];
+        const auto &left = out_.nodes[index + 1];
+        const auto &right = out_.nodes[node.offset];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            node.min[axis] = std::min(left.min[axis], right.min[axis]);
+            node.max[axis] = std::max(left.max[axis], right.max[axis]);
+        }
+    }
+
+    // 把 r 为根的子树按深度优先顺序写到 index 开始的位置，返回写完后的下一个位置
+    uint32_t emit(const range &r, uint32_t index) // NOLINT
+    {
+        auto &node = out_.nodes[index];
+        if (is_leaf(r))
+        {
+            make_leaf(r, node);
+            return index + 1;
+        }
+        auto [left, right] = children(r);
+        node.count = 0;
+        node.axis = split_axis(r);
+        auto right_index = emit(left, index + 1);
+        out_.nodes[index].offset = right_index;
+        auto next = emit(right, right_index);
+        merge_children(index);
+        return next;
+    }
+
+    // 顶部：把树切成若干棵子树（每个线程 k_subtrees_per_thread 棵左右）
+    void collect_subtrees(const range &r, uint32_t wanted,
+                          std::vector<subtree> &subtrees) const // NOLINT
+    {
+        if (wanted <= 1 || is_leaf(r))
+        {
+            subtrees.push_back({r});
+            return;
+        }
+        auto [left, right] = children(r);
+        collect_subtrees(left, wanted / 2, subtrees);
+        collect_subtrees(right, wanted - (wanted / 2), subtrees);
+    }
+
+    // 按与 collect_subtrees 相同的顺序写顶部节点，每遇到一棵子树就为它预留位置
+    uint32_t emit_top(const range &r, uint32_t wanted, uint32_t index, // NOLINT
+                      std::vector<subtree> &subtrees, size_t &next_subtree,
+                      std::vector<uint32_t> &top)
+    {
+        if (wanted <= 1 || is_leaf(r))
+        {
+            auto &s = subtrees[next_subtree++];
+            s.base = index;
+            return index + s.nodes;
+        }
+        top.push_back(index);
+        auto [left, right] = children(r);
+        auto &node = out_.nodes[index];
+        node.count = 0;
+        node.axis = split_axis(r);
+        auto right_index =
+            emit_top(left, wanted / 2, index + 1, subtrees, next_subtree, top);
+        out_.nodes[index].offset = right_index;
+        return emit_top(right, wanted - (wanted / 2), right_index, subtrees, next_subtree,
+                        top);
+    }
+
+    // 第4步：写节点。子树的节点数先并行数出来，顶部串行排好位置，子树再并行写入
+    void emit_nodes()
+    {
+        auto n = static_cast<uint32_t>(codes_.size());
+        range root{0, n - 1, 0};
+        auto wanted = static_cast<uint32_t>(threads_ * k_subtrees_per_thread);
+        if (n / k_min_chunk < static_cast<uint32_t>(threads_))
+            wanted = 1;
+
+        std::vector<subtree> subtrees;
+        collect_subtrees(root, wanted, subtrees);
+        parallel_tasks(subtrees.size(), [&](size_t k) {
+            subtrees[k].nodes = count_nodes(subtrees[k].root);
+        });
+
+        // 顶部是一棵以这些子树为叶子的二叉树，有 子树数 - 1 个节点
+        auto total = subtrees.size() - 1;
+        for (const auto &s : subtrees)
+            total += s.nodes;
+        out_.nodes.resize(total);
+        std::vector<uint32_t> top;
+        size_t next_subtree = 0;
+        emit_top(root, wanted, 0, subtrees, next_subtree, top);
+        parallel_tasks(subtrees.size(),
+                       [&](size_t k) { emit(subtrees[k].root, subtrees[k].base); });
+
+        // 深度优先顺序里孩子在父节点之后，倒过来合并就是自底向上
+        for (auto it = top.rbegin(); it != top.rend(); ++it)
+            merge_children(*it);
+    }
+
+    // 任务数不均匀（子树大小不同），线程从共享计数器里领任务
+    template <typename F>
+    void parallel_tasks(size_t count, const F &fn) const
+    {
+        auto workers_wanted = std::min(count, static_cast<size_t>(threads_));
+        if (workers_wanted <= 1)
+        {
+            for (size_t k = 0; k < count; k++)
+                fn(k);
+            return;
+        }
+        std::atomic<size_t> next{0};
+        std::vector<std::jthread> workers;
+        workers.reserve(workers_wanted);
+        for (size_t t = 0; t < workers_wanted; t++)
+            workers.emplace_back([&] {
+                for (auto k = next++; k < count; k = next++)
+                    fn(k);
+            });
+    }
+};
+
+// 便捷函数：与 flat_bvh::build 参数相同，多一个 Morton 码位数（63 或 30）和线程数
+inline flat_bvh build_lbvh(std::span<const aabb> boxes,
+                           int max_leaf_size = lbvh_builder::k_default_max_leaf_size,
+                           int morton_bits = 63, int threads = 0)
+{
+    return lbvh_builder::build(boxes, max_leaf_size, morton_bits, threads);
+}
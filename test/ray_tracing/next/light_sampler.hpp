@@ -0,0 +1,495 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include "hittable_list.hpp"
+#include "material.hpp"
+#include "quad.hpp"
+#include "sampler.hpp"
+#include "sphere.hpp"
+
+/*
+NOTE: 光源采样（next event estimation）
+原来的积分器只靠漫反射随机弹到光源上：光源小、多时，绝大部分路径什么都没找到，收敛极慢。
+光源采样在每个漫反射点直接挑一个光源、在它上面取一个点，打一条阴影光线（occluded）看有没有挡住。
+两种方式都能得到同一份光照，用 MIS（多重重要性采样，power heuristic）合并，
+光源小而亮时靠光源采样，光源大、表面光滑时靠方向采样，哪种都不会比单独用更差。
+
+挑哪个光源（light_selection）：
+    uniform  等概率
+    power    按功率（亮度 × 面积），别名表（alias table），O(1)
+    bvh      光源 BVH：每个节点存包围盒和总功率，从根往下走，每层按两个孩子对着色点的重要性
+             （功率 × 最大可能余弦 / 距离²）随机选一边，O(log n)。
+             离得远的、在着色点法线背面的光源几乎不会被选到；某个光源被选中的概率
+             是路径上各层概率之积，命中光源后算 MIS 权重时沿同一条路径再走一遍
+
+支持的光源：发光材质（emitted 不为 0）的静止 sphere 和 quad，直接放在场景的顶层列表里。
+其他发光物体（运动球、translate / rotate_y 包着的、嵌套的 BVH 里的）不参与光源采样，
+只能被方向采样弹到，MIS 权重为 1，结果仍然正确。
+球在着色点外面时在它张成的圆锥里均匀取方向；quad 在面积上均匀取点。
+*/
+enum class light_selection : uint8_t // NOLINT
+{
+    uniform,
+    power,
+    bvh,
+};
+
+struct light_sample // NOLINT
+{
+    vec3 direction;  // 单位向量，着色点指向光源上的点
+    double distance = 0;
+    double pdf = 0;  // 立体角上的概率密度，已经乘上挑中这个光源的概率；0 表示没有样本
+    color emission;
+};
+
+// power heuristic（β = 2）
+inline double power_heuristic(double pdf, double other_pdf)
+{
+    auto a = pdf * pdf;
+    auto b = other_pdf * other_pdf;
+    return a + b > 0 ? a / (a + b) : 0.0;
+}
+
+class light_sampler // NOLINT
+{
+  public:
+    explicit light_sampler(const hittable_list &world,
+                           light_selection selection = light_selection::bvh)
+        : selection_(selection)
+    {
+        for (const auto &object : world.objects)
+            add_emitter(*object);
+        for (uint32_t i = 0; i < emitters_.size(); i++)
+            index_of_[emitters_[i].object] = i;
+        build_alias_table();
+        if (!emitters_.empty())
+        {
+            std::vector<uint32_t> ids(emitters_.size());
+            for (uint32_t i = 0; i < ids.size(); i++)
+                ids[i] = i;
+            trails_.resize(emitters_.size());
+            nodes_.reserve(2 * emitters_.size());
+            build_node(ids, 0, static_cast<uint32_t>(ids.size()), 0, 0);
+        }
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return emitters_.size();
+    }
+
+    [[nodiscard]] light_selection selection() const
+    {
+        return selection_;
+    }
+
+    // 着色点 p（法线 n）处挑一个光源、在上面取一个点；u_select 挑光源，u 取点
+    [[nodiscard]] light_sample sample(const point3 &p, const vec3 &n, double u_select,
+                                      sample_2d u) const
+    {
+        double pmf = 0;
+        auto index = select(p, n, u_select, pmf);
+        if (pmf <= 0)
+            return {};
+        auto result = sample_emitter(emitters_[index], p, u);
+        result.pdf *= pmf;
+        return result;
+    }
+
+    // 从 p（法线 n）出发的光线命中 rec 时，光源采样得到这个方向的概率密度；不是光源返回 0
+    [[nodiscard]] double pdf(const point3 &p, const vec3 &n, const hit_record &rec) const
+    {
+        auto it = index_of_.find(rec.object);
+        if (it == index_of_.end())
+            return 0;
+        auto pmf = select_pmf(it->second, p, n);
+        if (pmf <= 0)
+            return 0;
+        return pmf * emitter_pdf(emitters_[it->second], p, rec.p);
+    }
+
+  private:
+    struct emitter
+    {
+        const hittable *object = nullptr;
+        const material *mat = nullptr;
+        bool is_sphere = false;
+        point3 center; // 球心；quad 的角点
+        double radius = 0;
+        vec3 edge_u;
+        vec3 edge_v;
+        vec3 normal; // quad 的单位法线
+        double area = 0;
+        double power = 0;
+        aabb bounds;
+    };
+
+    // 光源 BVH 节点，深度优先存放：左孩子紧跟在后面，右孩子在 right
+    struct light_node
+    {
+        point3 lo;
+        point3 hi;
+        double power = 0;
+        uint32_t right = 0;
+        uint32_t light = 0; // 叶子：光源下标
+        bool leaf = false;
+    };
+
+    // 从根到某个光源的路径：第 k 层往右走时第 k 位为 1
+    struct trail
+    {
+        uint64_t bits = 0;
+        uint32_t depth = 0;
+    };
+
+    light_selection selection_;
+    std::vector<emitter> emitters_;
+    std::unordered_map<const hittable *, uint32_t> index_of_;
+    std::vector<double> pmf_; // 按功率挑中每个光源的概率
+    std::vector<double> alias_prob_;
+    std::vector<uint32_t> alias_;
+    std::vector<light_node> nodes_;
+    std::vector<trail> trails_;
+
+    static double luminance(const color &c)
+    {
+        return (0.2126 * c.x()) + (0.7152 * c.y()) + (0.0722 * c.z());
+    }
+
+    void add_emitter(const hittable &object)
+    {
+        emitter e;
+        e.object = &object;
+        if (const auto *s = dynamic_cast<const sphere *>(&object))
+        {
+            if (s->is_moving())
+                return;
+            e.is_sphere = true;
+            e.mat = s->surface_material();
+            e.center = s->center();
+            e.radius = s->radius();
+            e.area = 4 * pi * e.radius * e.radius;
+        }
+        else if (typeid(object) == typeid(quad))
+        {
+            const auto &q = static_cast<const quad &>(object);
+            e.mat = q.surface_material();
+            e.center = q.corner();
+            e.edge_u = q.edge_u();
+            e.edge_v = q.edge_v();
+            e.normal = q.unit_normal();
+            e.area = cross(e.edge_u, e.edge_v).length();
+        }
+        else
+            return;
+        if (e.mat == nullptr || !(e.area > 0))
+            return;
+        // 功率只用来挑光源，纹理光源取中间一点的颜色作为估计
+        auto middle = e.is_sphere ? e.center : e.center + (0.5 * (e.edge_u + e.edge_v));
+        e.power = luminance(e.mat->emitted(0.5, 0.5, middle)) * e.area;
+        if (!(e.power > 0))
+            return;
+        e.bounds = object.bounding_box();
+        emitters_.push_back(e);
+    }
+
+    // Vose 别名表：每个格子放自己的一部分概率，剩下的由一个"别名"光源补满
+    void build_alias_table()
+    {
+        auto n = emitters_.size();
+        double total = 0;
+        for (const auto &e : emitters_)
+            total += e.power;
+        pmf_.resize(n);
+        alias_prob_.assign(n, 1.0);
+        alias_.resize(n);
+        std::vector<uint32_t> small;
+        std::vector<uint32_t> large;
+        std::vector<double> scaled(n);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            pmf_[i] = emitters_[i].power / total;
+            scaled[i] = pmf_[i] * static_cast<double>(n);
+            alias_[i] = i;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty())
+        {
+            auto s = small.back();
+            small.pop_back();
+            auto l = large.back();
+            alias_prob_[s] = scaled[s];
+            alias_[s] = l;
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+    }
+
+    // 沿质心跨度最大的轴按中位数分，叶子一个光源
+    uint32_t build_node(std::vector<uint32_t> &ids, uint32_t begin, // NOLINT
+                        uint32_t end, uint32_t depth, uint64_t bits)
+    {
+        auto index = static_cast<uint32_t>(nodes_.size());
+        nodes_.push_back({});
+        point3 lo(infinity, infinity, infinity);
+        point3 hi(-infinity, -infinity, -infinity);
+        point3 clo = lo;
+        point3 chi = hi;
+        double power = 0;
+        for (auto i = begin; i < end; i++)
+        {
+            const auto &e = emitters_[ids[i]];
+            power += e.power;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const auto &extent = e.bounds.axis_interval(axis);
+                lo[axis] = std::min(lo[axis], extent.min);
+                hi[axis] = std::max(hi[axis], extent.max);
+                auto c = 0.5 * (extent.min + extent.max);
+                clo[axis] = std::min(clo[axis], c);
+                chi[axis] = std::max(chi[axis], c);
+            }
+        }
+        nodes_[index].lo = lo;
+        nodes_[index].hi = hi;
+        nodes_[index].power = power;
+
+        if (end - begin == 1)
+        {
+            nodes_[index].leaf = true;
+            nodes_[index].light = ids[begin];
+            trails_[ids[begin]] = {bits, depth};
+            return index;
+        }
+
+        auto extent = chi - clo;
+        int axis = 0;
+        if (extent.y() > extent[axis])
+            axis = 1;
+        if (extent.z() > extent[axis])
+            axis = 2;
+        auto mid = begin + ((end - begin) / 2);
+        std::nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end,
+                         [&](uint32_t a, uint32_t b) {
+                             const auto &ba = emitters_[a].bounds.axis_interval(axis);
+                             const auto &bb = emitters_[b].bounds.axis_interval(axis);
+                             return ba.min + ba.max < bb.min + bb.max;
+                         });
+        build_node(ids, begin, mid, depth + 1, bits);
+        auto right = build_node(ids, mid, end, depth + 1, bits | (uint64_t{1} << depth));
+        nodes_[index].right = right;
+        return index;
+    }
+
+    /*
+    节点对着色点的重要性：功率 × 余弦上界 / 距离²。
+    余弦上界：包围球张成的圆锥里与法线最小的夹角的余弦；整个包围球在法线背面时为 0。
+    着色点在包围球里面时距离取包围球半径，余弦取 1。
+    */
+    static double importance(const light_node &node, const point3 &p, const vec3 &n)
+    {
+        auto center = 0.5 * (node.lo + node.hi);
+        auto radius2 = 0.25 * (node.hi - node.lo).length_squared();
+        auto to = center - p;
+        auto d2 = to.length_squared();
+        double cos_bound = 1;
+        if (d2 > radius2)
+        {
+            auto d = std::sqrt(d2);
+            auto cos_i = dot(n, to) / d;
+            auto sin2_b = radius2 / d2;
+            auto cos_b = std::sqrt(1 - sin2_b);
+            if (cos_i < cos_b)
+            {
+                // cos(θi - θb) = cosθi·cosθb + sinθi·sinθb
+                auto sin_i = std::sqrt(std::max(0.0, 1 - (cos_i * cos_i)));
+                cos_bound = (cos_i * cos_b) + (sin_i * std::sqrt(sin2_b));
+            }
+        }
+        if (cos_bound <= 0)
+            return 0;
+        return node.power * cos_bound / std::max(d2, radius2);
+    }
+
+    uint32_t select(const point3 &p, const vec3 &n, double u, double &pmf) const
+    {
+        auto count = static_cast<uint32_t>(emitters_.size());
+        pmf = 0;
+        if (count == 0)
+            return 0;
+        if (selection_ == light_selection::uniform)
+        {
+            pmf = 1.0 / count;
+            return std::min(count - 1, static_cast<uint32_t>(u * count));
+        }
+        if (selection_ == light_selection::power)
+        {
+            auto scaled = u * count;
+            auto slot = std::min(count - 1, static_cast<uint32_t>(scaled));
+            auto index = (scaled - slot) < alias_prob_[slot] ? slot : alias_[slot];
+            pmf = pmf_[index];
+            return index;
+        }
+
+        // 光源 BVH：每层按重要性选一边，u 重新缩放到 [0,1) 给下一层用
+        pmf = 1;
+        uint32_t index = 0;
+        while (!nodes_[index].leaf)
+        {
+            auto left = importance(nodes_[index + 1], p, n);
+            auto right = importance(nodes_[nodes_[index].right], p, n);
+            if (left + right <= 0)
+            {
+                pmf = 0;
+                return 0;
+            }
+            auto p_left = left / (left + right);
+            if (u < p_left)
+            {
+                u = std::min(u / p_left, 1 - 1e-12);
+                pmf *= p_left;
+                index = index + 1;
+            }
+            else
+            {
+                u = std::min((u - p_left) / (1 - p_left), 1 - 1e-12);
+                pmf *= 1 - p_left;
+                index = nodes_[index].right;
+            }
+        }
+        return nodes_[index].light;
+    }
+
+    // select 挑中光源 light 的概率
+    [[nodiscard]] double select_pmf(uint32_t light, const point3 &p, const vec3 &n) const
+    {
+        if (selection_ == light_selection::uniform)
+            return 1.0 / static_cast<double>(emitters_.size());
+        if (selection_ == light_selection::power)
+            return pmf_[light];
+
+        double pmf = 1;
+        uint32_t index = 0;
+        const auto &path = trails_[light];
+        for (uint32_t level = 0; level < path.depth; level++)
+        {
+            auto left = importance(nodes_[index + 1], p, n);
+            auto right = importance(nodes_[nodes_[index].right], p, n);
+            if (left + right <= 0)
+                return 0;
+            if ((path.bits >> level) & 1U)
+            {
+                pmf *= right / (left + right);
+                index = nodes_[index].right;
+            }
+            else
+            {
+                pmf *= left / (left + right);
+                index = index + 1;
+            }
+        }
+        return pmf;
+    }
+
+    [[nodiscard]] static light_sample sample_emitter(const emitter &e, const point3 &p,
+                                                     sample_2d u)
+    {
+        light_sample result;
+        point3 point;
+        double pdf = 0;
+        double tex_u = 0;
+        double tex_v = 0;
+        if (e.is_sphere && (e.center - p).length_squared() > e.radius * e.radius)
+        {
+            // 在球张成的圆锥里均匀取方向，再求与球的交点
+            auto to = e.center - p;
+            auto d2 = to.length_squared();
+            auto d = std::sqrt(d2);
+            auto sin2_max = e.radius * e.radius / d2;
+            auto cos_max = std::sqrt(std::max(0.0, 1 - sin2_max));
+            auto one_minus_cos_max = sin2_max / (1 + cos_max); // 小球时不损失精度
+            auto cos_theta = 1 - (u.x * one_minus_cos_max);
+            auto sin2_theta = std::max(0.0, 1 - (cos_theta * cos_theta));
+            auto phi = 2 * pi * u.y;
+
+            auto w = to / d;
+            vec3 a;
+            vec3 b;
+            make_basis(w, a, b);
+            auto sin_theta = std::sqrt(sin2_theta);
+            auto direction = (sin_theta * std::cos(phi) * a) +
+                             (sin_theta * std::sin(phi) * b) + (cos_theta * w);
+            auto t = (d * cos_theta) -
+                     std::sqrt(std::max(0.0, (e.radius * e.radius) - (d2 * sin2_theta)));
+            point = p + (t * direction);
+            pdf = 1 / (2 * pi * one_minus_cos_max);
+            sphere::get_sphere_uv((point - e.center) / e.radius, tex_u, tex_v);
+        }
+        else
+        {
+            if (e.is_sphere)
+            {
+                point = e.center + (e.radius * sample_unit_vector(u));
+                sphere::get_sphere_uv((point - e.center) / e.radius, tex_u, tex_v);
+            }
+            else
+            {
+                point = e.center + (u.x * e.edge_u) + (u.y * e.edge_v);
+                tex_u = u.x;
+                tex_v = u.y;
+            }
+            pdf = emitter_pdf(e, p, point);
+        }
+
+        auto offset = point - p;
+        auto distance = offset.length();
+        if (!(pdf > 0) || !(distance > 0) || !std::isfinite(pdf))
+            return result;
+        result.direction = offset / distance;
+        result.distance = distance;
+        result.pdf = pdf;
+        result.emission = e.mat->emitted(tex_u, tex_v, point);
+        return result;
+    }
+
+    // 从 p 看光源上的点 point 的立体角密度（与 sample_emitter 的取样方式一致）
+    [[nodiscard]] static double emitter_pdf(const emitter &e, const point3 &p,
+                                            const point3 &point)
+    {
+        auto to = e.center - p;
+        if (e.is_sphere && to.length_squared() > e.radius * e.radius)
+        {
+            auto sin2_max = e.radius * e.radius / to.length_squared();
+            auto cos_max = std::sqrt(std::max(0.0, 1 - sin2_max));
+            return 1 / (2 * pi * (sin2_max / (1 + cos_max)));
+        }
+        // 面积均匀：p_ω = 距离² / (|cos θ_光源| · 面积)
+        auto offset = point - p;
+        auto distance2 = offset.length_squared();
+        auto normal = e.is_sphere ? unit_vector(point - e.center) : e.normal;
+        auto cos_light = std::fabs(dot(normal, offset)) / std::sqrt(distance2);
+        if (!(cos_light > 0))
+            return 0;
+        return distance2 / (cos_light * e.area);
+    }
+
+    // 以 w 为 z 轴的正交基（Duff 等 2017）
+    static void make_basis(const vec3 &w, vec3 &a, vec3 &b)
+    {
+        auto sign = std::copysign(1.0, w.z());
+        auto c = -1 / (sign + w.z());
+        auto d = w.x() * w.y() * c;
+        a = vec3(1 + (sign * w.x() * w.x() * c), sign * d, -sign * w.x());
+        b = vec3(d, sign + (w.y() * w.y() * c), -w.y());
+    }
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+NOTE: 只读内存映射文件
+把整个文件映射进地址空间，不做任何拷贝：操作系统按页缺页加载，
+多次运行之间文件还留在页缓存里，所以"打开"一个很大的缓存文件几乎不花时间。
+打开失败时 is_open() 为 false，由调用者决定回退方案。
+*/
+class mapped_file // NOLINT
+{
+  public:
+    mapped_file() = default;
+
+    explicit mapped_file(const std::string &path)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+            return close();
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr)
+            return close();
+
+        auto *view = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr)
+            return close();
+
+        data_ = static_cast<const std::byte *>(view);
+        size_ = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return;
+        }
+
+        // NOTE: 映射建立后就可以关掉文件描述符，映射本身会持有文件的引用
+        auto *view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                            MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return;
+
+        data_ = static_cast<const std::byte *>(view);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    mapped_file(mapped_file &&other) noexcept
+    {
+        swap(other);
+    }
+
+    mapped_file &operator=(mapped_file &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        close();
+    }
+
+    [[nodiscard]] bool is_open() const
+    {
+        return data_ != nullptr;
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() const
+    {
+        return {data_, size_};
+    }
+
+  private:
+    const std::byte *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+
+    void swap(mapped_file &other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#endif
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (data_ != nullptr)
+            UnmapViewOfFile(data_);
+        if (mapping_ != nullptr)
+            CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE)
+            CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = nullptr;
+#else
+        if (data_ != nullptr)
+            ::munmap(const_cast<std::byte *>(data_), size_); // NOLINT
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+};
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include "color.hpp"
 #include "hit_record.hpp"
+#include "hittable.hpp"
+#include "render_stats.hpp"
+#include "sampler.hpp"
 #include "texture.hpp"
 
 // NOLINTBEGIN
@@ -9,7 +17,42 @@
 产生散射光（或者说吸收了入射光）。
 如果散射，说明光线应该衰减多少。
 NOTE: 现在射线有了时间属性，我们需要更新 material::scatter() 来计算交集时间：
+NOTE: 散射需要的随机数都从 sampler 取（sampler.hpp），按请求顺序占用维度，
+这样分层 / 低差异采样器也能作用到反弹方向上。
 */
+class material;
+
+/*
+NOTE: 编译后的材质
+material_record 是定长的 POD 记录：类型标签 + 参数 + 纹理节点下标（texture_table）。
+material_table 在场景建好以后把场景里所有的材质编译成一个连续数组，纹理编译进同一张 texture_table
+（几个材质共用的纹理只编译一次）。scatter / emitted 按类型 switch 到各材质类的静态函数
+（与虚函数版本是同一份代码，取样本的顺序相同，结果逐位相同），不做虚函数调用，纹理也不沿 shared_ptr 链求值。
+没有对应记录类型的材质编译成回退记录，仍然调用虚函数。
+原来的材质类不变，作为构建器：material::compile 生成自己的记录。
+编译时每个材质记下自己在表里的下标，着色时按 rec.mat 的下标直接取记录，不查哈希表、不加锁；
+表建好以后不再修改，render_job / render_scheduler 的所有 tile、render_server 同一场景的所有请求共用一张。
+*/
+enum class material_type : uint8_t // NOLINT
+{
+    lambertian,
+    metal,
+    dielectric,
+    diffuse_light,
+    isotropic,
+    fallback,
+};
+
+struct material_record // NOLINT
+{
+    material_type type = material_type::fallback;
+    bool solid = false;   // 纹理是纯色，颜色在 albedo 里
+    uint32_t texture = 0; // lambertian / diffuse_light / isotropic 的纹理节点
+    color albedo;         // metal；纯色纹理的颜色
+    double param = 0;     // metal：fuzz；dielectric：折射率
+    const material *source = nullptr; // 编译出这条记录的材质；fallback 调用它的虚函数
+};
+
 class material
 {
   public:
@@ -17,8 +60,9 @@ class material
 
     // NOTE：scatter 分散的意思
     virtual bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-                         ray &scattered) const
+                         ray &scattered, sampler &s) const
     {
+        count_stat(render_stat::scatter_absorb);
         return false;
     }
 
@@ -27,6 +71,122 @@ class material
     {
         return color(0, 0, 0);
     }
+
+    // NOTE: 表面的反照率（降噪用的特征缓冲区）。不取随机数，不影响渲染结果
+    virtual color surface_albedo(const hit_record & /*rec*/) const
+    {
+        return color(0, 0, 0);
+    }
+
+    // NOTE: 理想漫反射（余弦分布散射）。积分器据此在命中点做光源采样，散射方向的密度是 cos/π
+    virtual bool is_diffuse() const
+    {
+        return false;
+    }
+
+    // NOTE: 编译成 material_table 里的记录，纹理编译进 textures；默认是调用虚函数的回退记录
+    virtual material_record compile(texture_table & /*textures*/) const
+    {
+        material_record record;
+        record.type = material_type::fallback;
+        return record;
+    }
+
+    // NOTE: 材质编号（AOV 的 material_id），按创建顺序从 1 开始，0 留给没有命中
+    uint32_t id() const
+    {
+        return id_;
+    }
+
+    // NOTE: 在最近一张编译了它的 material_table 里的下标
+    uint32_t table_index() const
+    {
+        return std::atomic_ref(table_index_).load(std::memory_order_relaxed);
+    }
+
+  private:
+    friend class material_table;
+
+    static constexpr uint32_t k_no_index = std::numeric_limits<uint32_t>::max();
+
+    uint32_t id_ = next_id();
+    // 别的线程可能正在为另一个场景编译表，用 atomic_ref 读写。材质被几张表共用时下标只对最近一张有效，
+    // 其余的表查到的记录 source 对不上，退回虚函数，结果不变
+    mutable uint32_t table_index_ = k_no_index;
+
+    static uint32_t next_id()
+    {
+        static std::atomic<uint32_t> counter{1};
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+class material_table // NOLINT
+{
+  public:
+    // 收集 world 里所有物体用到的材质（hittable::collect_materials）编译成一张表。
+    // 构造后不再修改，几个线程可以同时用；只能用在构建它的场景上
+    explicit material_table(const hittable &world)
+    {
+        std::vector<const material *> materials;
+        world.collect_materials(materials);
+        for (const auto *mat : materials)
+        {
+            if (mat != nullptr && find(*mat) == nullptr)
+                add(*mat);
+        }
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return records_.size();
+    }
+
+    // 下面四个与 material 的同名虚函数结果相同；不在表里的材质直接调用虚函数
+    bool scatter(const material &mat, const ray &r_in, const hit_record &rec,
+                 color &attenuation, ray &scattered, sampler &s) const;
+
+    [[nodiscard]] color emitted(const material &mat, double u, double v,
+                                const point3 &p) const;
+
+    [[nodiscard]] color albedo(const material &mat, const hit_record &rec) const;
+
+    [[nodiscard]] bool diffuse(const material &mat) const;
+
+  private:
+    std::vector<material_record> records_;
+    texture_table textures_;
+
+    // 材质在这张表里的记录；编译以后才创建的材质、另一张表里的材质返回空
+    [[nodiscard]] const material_record *find(const material &mat) const
+    {
+        auto index = mat.table_index();
+        if (index < records_.size() && records_[index].source == &mat)
+            return &records_[index];
+        return nullptr;
+    }
+
+    void add(const material &mat)
+    {
+        auto record = mat.compile(textures_);
+        // 纯色纹理直接放进记录，求值时少读一个节点
+        auto textured = record.type == material_type::lambertian ||
+                        record.type == material_type::diffuse_light ||
+                        record.type == material_type::isotropic;
+        record.solid = textured && textures_.constant(record.texture, record.albedo);
+        record.source = &mat;
+        std::atomic_ref(mat.table_index_)
+            .store(static_cast<uint32_t>(records_.size()), std::memory_order_relaxed);
+        records_.push_back(record);
+    }
+
+    [[nodiscard]] color texture_value(const material_record &record,
+                                      const hit_record &rec) const
+    {
+        if (record.solid)
+            return record.albedo;
+        return textures_.value(record.texture, rec.u, rec.v, rec.p);
+    }
 };
 
 // NOTE: 反射建模。 反射的是材质的颜色。朗伯材料类
@@ -42,11 +202,41 @@ class lambertian : public material
     rec：击中记录（包含交点、法线等信息）
     attenuation：出参，光线衰减系数（颜色）
     scattered：出参，散射后的光线
+    s：采样器，提供散射方向需要的随机数
     */
     bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-                 ray &scattered) const override
+                 ray &scattered, sampler &s) const override
     {
-        auto scatter_direction = rec.normal + random_unit_vector();
+        sample(r_in, rec, scattered, s);
+
+        // NOTE: 使用材料绑定的 纹理颜色
+        attenuation = tex->value(rec.u, rec.v, rec.p);
+        return true;
+    }
+
+    color surface_albedo(const hit_record &rec) const override
+    {
+        return tex->value(rec.u, rec.v, rec.p);
+    }
+
+    bool is_diffuse() const override
+    {
+        return true;
+    }
+
+    material_record compile(texture_table &textures) const override
+    {
+        material_record record;
+        record.type = material_type::lambertian;
+        record.texture = textures.compile(*tex);
+        return record;
+    }
+
+    // 散射方向，与纹理无关（material_table 共用）
+    static void sample(const ray &r_in, const hit_record &rec, ray &scattered, sampler &s)
+    {
+        count_stat(render_stat::scatter_lambertian);
+        auto scatter_direction = rec.normal + sample_unit_vector(s.get_2d());
 
         // 捕获零向量情况
         if (scatter_direction.near_zero())
@@ -54,10 +244,6 @@ class lambertian : public material
 
         // NOTE: ray 追加时间信息
         scattered = ray(rec.p, scatter_direction, r_in.time());
-
-        // NOTE: 使用材料绑定的 纹理颜色
-        attenuation = tex->value(rec.u, rec.v, rec.p);
-        return true;
     }
 
   private:
@@ -70,8 +256,30 @@ class metal : public material
     metal(const color &albedo, double fuzz) : albedo(albedo), fuzz(fuzz < 1 ? fuzz : 1) {}
 
     bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-                 ray &scattered) const override
+                 ray &scattered, sampler &s) const override
     {
+        return sample(albedo, fuzz, r_in, rec, attenuation, scattered, s);
+    }
+
+    color surface_albedo(const hit_record & /*rec*/) const override
+    {
+        return albedo;
+    }
+
+    material_record compile(texture_table & /*textures*/) const override
+    {
+        material_record record;
+        record.type = material_type::metal;
+        record.albedo = albedo;
+        record.param = fuzz;
+        return record;
+    }
+
+    static bool sample(const color &albedo, double fuzz, const ray &r_in,
+                       const hit_record &rec, color &attenuation, ray &scattered,
+                       sampler &s)
+    {
+        count_stat(render_stat::scatter_metal);
         // 计算入射光线在表面法线方向的理想反射方向。
         vec3 reflected = reflect(r_in.direction(), rec.normal);
 
@@ -81,7 +289,7 @@ class metal : public material
             fuzz = 0 时是完美镜面反射
             fuzz 被限制在 [0, 1] 范围内
         */
-        reflected = unit_vector(reflected) + (fuzz * random_unit_vector());
+        reflected = unit_vector(reflected) + (fuzz * sample_unit_vector(s.get_2d()));
 
         scattered = ray(rec.p, reflected, r_in.time());
         attenuation = albedo;
@@ -103,9 +311,31 @@ class dielectric : public material
 
     // 这是改进版的电介质散射函数，增加了全反射处理
     bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-                 ray &scattered) const override
+                 ray &scattered, sampler &s) const override
     {
         attenuation = color(1.0, 1.0, 1.0);
+        sample(refraction_index, r_in, rec, scattered, s);
+        return true;
+    }
+
+    // 透明材质不改变颜色
+    color surface_albedo(const hit_record & /*rec*/) const override
+    {
+        return color(1, 1, 1);
+    }
+
+    material_record compile(texture_table & /*textures*/) const override
+    {
+        material_record record;
+        record.type = material_type::dielectric;
+        record.param = refraction_index;
+        return record;
+    }
+
+    static void sample(double refraction_index, const ray &r_in, const hit_record &rec,
+                       ray &scattered, sampler &s)
+    {
+        count_stat(render_stat::scatter_dielectric);
         double ri = rec.front_face ? (1.0 / refraction_index) : refraction_index;
 
         vec3 unit_direction = unit_vector(r_in.direction());
@@ -118,13 +348,14 @@ class dielectric : public material
         // NOTE: 还使用 Schlick 近似决定反射概率
         // NOTE: 随机数是实现基于物理的随机采样的关键。
         // 固定数，光线数量指数增长：每次交互都分裂成2条光线。经过几次反射后会有 2ⁿ 条光线
-        if (cannot_refract || reflectance(cos_theta, ri) > random_double())
+        // 无论是否全反射都取一个 1D 样本，后续维度的编号不随路径变化
+        auto u = s.get_1d();
+        if (cannot_refract || reflectance(cos_theta, ri) > u)
             direction = reflect(unit_direction, rec.normal);
         else
             direction = refract(unit_direction, rec.normal, ri);
 
         scattered = ray(rec.p, direction, r_in.time());
-        return true;
     }
 
   private:
@@ -157,6 +388,19 @@ class diffuse_light : public material
         return tex->value(u, v, p);
     }
 
+    color surface_albedo(const hit_record &rec) const override
+    {
+        return tex->value(rec.u, rec.v, rec.p);
+    }
+
+    material_record compile(texture_table &textures) const override
+    {
+        material_record record;
+        record.type = material_type::diffuse_light;
+        record.texture = textures.compile(*tex);
+        return record;
+    }
+
   private:
     std::shared_ptr<texture> tex;
 };
@@ -178,19 +422,112 @@ class isotropic : public material
     isotropic(std::shared_ptr<texture> tex) : tex(tex) {}
 
     bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-                 ray &scattered) const override
+                 ray &scattered, sampler &s) const override
     {
         /*
         rec.p：散射发生的位置（在体积内部）
-        random_unit_vector()：随机单位向量 - 这就是各向同性的核心！
+        sample_unit_vector()：球面上均匀的单位向量 - 这就是各向同性的核心！
         r_in.time()：保持光线时间一致性
         */
-        scattered = ray(rec.p, random_unit_vector(), r_in.time());
+        sample(r_in, rec, scattered, s);
         attenuation = tex->value(rec.u, rec.v, rec.p);
         return true;
     }
 
+    color surface_albedo(const hit_record &rec) const override
+    {
+        return tex->value(rec.u, rec.v, rec.p);
+    }
+
+    material_record compile(texture_table &textures) const override
+    {
+        material_record record;
+        record.type = material_type::isotropic;
+        record.texture = textures.compile(*tex);
+        return record;
+    }
+
+    static void sample(const ray &r_in, const hit_record &rec, ray &scattered, sampler &s)
+    {
+        count_stat(render_stat::scatter_isotropic);
+        scattered = ray(rec.p, sample_unit_vector(s.get_2d()), r_in.time());
+    }
+
   private:
     std::shared_ptr<texture> tex;
 };
-// NOLINTEND
\ No newline at end of file
+
+// 按类型分派到各材质类的静态函数；纹理在散射方向之后求值，与虚函数版本的顺序相同
+inline bool material_table::scatter(const material &mat, const ray &r_in,
+                                    const hit_record &rec, color &attenuation,
+                                    ray &scattered, sampler &s) const
+{
+    const auto *record = find(mat);
+    if (record == nullptr)
+        return mat.scatter(r_in, rec, attenuation, scattered, s);
+    switch (record->type)
+    {
+    case material_type::lambertian:
+        lambertian::sample(r_in, rec, scattered, s);
+        attenuation = texture_value(*record, rec);
+        return true;
+    case material_type::metal:
+        return metal::sample(record->albedo, record->param, r_in, rec, attenuation,
+                             scattered, s);
+    case material_type::dielectric:
+        attenuation = color(1.0, 1.0, 1.0);
+        dielectric::sample(record->param, r_in, rec, scattered, s);
+        return true;
+    case material_type::diffuse_light:
+        count_stat(render_stat::scatter_absorb);
+        return false;
+    case material_type::isotropic:
+        isotropic::sample(r_in, rec, scattered, s);
+        attenuation = texture_value(*record, rec);
+        return true;
+    case material_type::fallback:
+        break;
+    }
+    return mat.scatter(r_in, rec, attenuation, scattered, s);
+}
+
+inline color material_table::emitted(const material &mat, double u, double v,
+                                     const point3 &p) const
+{
+    const auto *record = find(mat);
+    if (record == nullptr || record->type == material_type::fallback)
+        return mat.emitted(u, v, p);
+    if (record->type != material_type::diffuse_light)
+        return {0, 0, 0};
+    return record->solid ? record->albedo : textures_.value(record->texture, u, v, p);
+}
+
+inline color material_table::albedo(const material &mat, const hit_record &rec) const
+{
+    const auto *record = find(mat);
+    if (record == nullptr)
+        return mat.surface_albedo(rec);
+    switch (record->type)
+    {
+    case material_type::lambertian:
+    case material_type::diffuse_light:
+    case material_type::isotropic:
+        return texture_value(*record, rec);
+    case material_type::metal:
+        return record->albedo;
+    case material_type::dielectric:
+        return {1, 1, 1};
+    case material_type::fallback:
+        break;
+    }
+    return mat.surface_albedo(rec);
+}
+
+inline bool material_table::diffuse(const material &mat) const
+{
+    const auto *record = find(mat);
+    if (record == nullptr || record->type == material_type::fallback)
+        return mat.is_diffuse();
+    return record->type == material_type::lambertian;
+}
+// NOLINTEND
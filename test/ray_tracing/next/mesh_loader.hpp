@@ -0,0 +1,580 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "material.hpp"
+#include "texture.hpp"
+#include "triangle_mesh.hpp"
+
+// NOTE: 与 rtw_image 的 stb_image 一样，两个加载库的实现都放在这个（唯一的）翻译单元里
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+// NOTE: 贴图解码交给 rtw_image（stb_image 已经在 rtw_image.hpp 里实现），
+// tinygltf 不再带一份 stb_image，只把贴图的原始字节交给我们
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include <tiny_gltf.h>
+
+/*
+NOTE: 网格加载：OBJ（tinyobjloader）和 glTF / glb（tinygltf）
+两种格式都变成一个 triangle_mesh：所有子网格合并进同一份 mesh_data、同一棵 BVH，
+材质按三角形记录下标。
+
+材质映射（只映射这个光线追踪器已有的材质）：
+    贴图（OBJ map_Kd / glTF baseColorTexture） -> lambertian(image_texture)，UV 来自网格
+    漫反射颜色（OBJ Kd / glTF baseColorFactor）  -> lambertian(color)
+    自发光（OBJ Ke / glTF emissiveFactor 非 0）   -> diffuse_light
+    没有材质的面                                  -> fallback（默认灰色 lambertian）
+glTF 的 UV 原点在左上角，image_texture 的 v 向上，所以读入时 v -> 1 - v。
+加载失败时打印 ERROR 并返回 nullptr。
+*/
+inline std::shared_ptr<material> default_mesh_material(std::shared_ptr<material> fallback)
+{
+    if (fallback)
+        return fallback;
+    return std::make_shared<lambertian>(color(0.73, 0.73, 0.73));
+}
+
+// 网格构建前的统一出口：检查下标，然后构建 BVH
+inline std::shared_ptr<triangle_mesh> make_mesh(
+    const std::string &path, mesh_data data, std::vector<std::shared_ptr<material>> mats)
+{
+    if (data.triangle_count() == 0 || !data.validate(mats.size()))
+    {
+        std::cerr << "ERROR: Mesh file '" << path << "' has no valid triangles.\n";
+        return nullptr;
+    }
+    return std::make_shared<triangle_mesh>(
+        std::make_shared<const mesh_data>(std::move(data)), std::move(mats));
+}
+
+inline std::shared_ptr<triangle_mesh> load_obj_mesh(const std::string &path,
+                                                    std::shared_ptr<material> fallback =
+                                                        nullptr)
+{
+    auto base_dir = std::filesystem::path(path).parent_path().string();
+    if (!base_dir.empty())
+        base_dir += "/";
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> obj_materials;
+    std::string warn;
+    std::string err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &obj_materials, &warn, &err, path.c_str(),
+                          base_dir.c_str(), true))
+    {
+        std::cerr << "ERROR: Could not load OBJ file '" << path << "'. " << err << '\n';
+        return nullptr;
+    }
+    if (!warn.empty())
+        std::cerr << "WARNING: " << warn << '\n';
+
+    // 第1步：材质。最后一个是给没有材质的面用的 fallback
+    std::vector<std::shared_ptr<material>> mats;
+    for (const auto &m : obj_materials)
+    {
+        color emission(m.emission[0], m.emission[1], m.emission[2]);
+        if (emission.length_squared() > 0)
+            mats.push_back(std::make_shared<diffuse_light>(emission));
+        else if (!m.diffuse_texname.empty())
+            mats.push_back(std::make_shared<lambertian>(
+                std::make_shared<image_texture>((base_dir + m.diffuse_texname).c_str())));
+        else
+            mats.push_back(std::make_shared<lambertian>(
+                color(m.diffuse[0], m.diffuse[1], m.diffuse[2])));
+    }
+    auto fallback_id = static_cast<uint32_t>(mats.size());
+    mats.push_back(default_mesh_material(std::move(fallback)));
+
+    // 第2步：OBJ 的位置、法线、UV 各有各的下标，按 (位置, 法线, UV) 三元组去重成统一的顶点
+    struct key_hash
+    {
+        size_t operator()(const std::array<int, 3> &k) const
+        {
+            auto h = static_cast<uint64_t>(static_cast<uint32_t>(k[0]));
+            h = (h * 0x9E3779B97F4A7C15ULL) ^ static_cast<uint32_t>(k[1]);
+            h = (h * 0x9E3779B97F4A7C15ULL) ^ static_cast<uint32_t>(k[2]);
+            return static_cast<size_t>(h);
+        }
+    };
+    std::unordered_map<std::array<int, 3>, uint32_t, key_hash> unique_vertices;
+
+    bool has_normals = !attrib.normals.empty();
+    bool has_uvs = !attrib.texcoords.empty();
+    mesh_data data;
+    for (const auto &shape : shapes)
+    {
+        const auto &mesh = shape.mesh;
+        data.indices.reserve(data.indices.size() + mesh.indices.size());
+        size_t offset = 0; // 当前面的第一个顶点在 mesh.indices 中的位置
+        for (size_t face = 0; face < mesh.num_face_vertices.size(); face++)
+        {
+            auto face_vertices = static_cast<size_t>(mesh.num_face_vertices[face]);
+            offset += face_vertices;
+            if (face_vertices != 3)
+                continue; // triangulate 之后都是三角形，保险起见跳过其他面
+            for (int corner = 0; corner < 3; corner++)
+            {
+                const auto &index = mesh.indices[offset - 3 + corner];
+                std::array<int, 3> key{index.vertex_index, index.normal_index,
+                                       index.texcoord_index};
+                auto [it, inserted] = unique_vertices.try_emplace(
+                    key, static_cast<uint32_t>(data.positions.size()));
+                if (inserted)
+                {
+                    const auto *p = &attrib.vertices[3 * size_t(index.vertex_index)];
+                    data.positions.emplace_back(p[0], p[1], p[2]);
+                    if (has_normals)
+                    {
+                        // 没有法线的顶点补 0，插值后为 0 则退回几何法线
+                        auto normal_index = std::max(index.normal_index, 0);
+                        const auto *n = &attrib.normals[3 * size_t(normal_index)];
+                        if (index.normal_index < 0)
+                            data.normals.emplace_back(0, 0, 0);
+                        else
+                            data.normals.emplace_back(n[0], n[1], n[2]);
+                    }
+                    if (has_uvs)
+                    {
+                        auto uv_index = std::max(index.texcoord_index, 0);
+                        data.uvs.push_back(attrib.texcoords[2 * size_t(uv_index)]);
+                        data.uvs.push_back(attrib.texcoords[(2 * size_t(uv_index)) + 1]);
+                    }
+                }
+                data.indices.push_back(it->second);
+            }
+
+            auto id = mesh.material_ids.empty() ? -1 : mesh.material_ids[face];
+            data.material_ids.push_back(id < 0 || static_cast<uint32_t>(id) >= fallback_id
+                                            ? fallback_id
+                                            : static_cast<uint32_t>(id));
+        }
+    }
+    return make_mesh(path, std::move(data), std::move(mats));
+}
+
+/*
+NOTE: glTF 读取
+glTF 的顶点数据在 buffer 里，通过 bufferView（字节区间、步长）和 accessor（类型、个数）描述。
+网格挂在节点树上，每个节点有自己的变换（matrix 或 TRS），这里把变换直接烘焙进顶点。
+*/
+class gltf_mesh_reader // NOLINT
+{
+  public:
+    gltf_mesh_reader(const tinygltf::Model &model, std::shared_ptr<material> fallback)
+        : model_(model), fallback_(default_mesh_material(std::move(fallback)))
+    {
+    }
+
+    // 按默认场景（没有时用第 0 个场景）遍历节点树；没有场景时把所有网格按单位变换读入
+    bool read(mesh_data &data)
+    {
+        if (!model_.scenes.empty())
+        {
+            auto scene_index = model_.defaultScene;
+            if (!valid_index(scene_index, model_.scenes))
+                scene_index = 0;
+            for (int node : model_.scenes[scene_index].nodes)
+                if (!read_node(node, identity(), 0, data))
+                    return false;
+            return true;
+        }
+        for (const auto &mesh : model_.meshes)
+            if (!read_mesh(mesh, identity(), data))
+                return false;
+        return true;
+    }
+
+    std::vector<std::shared_ptr<material>> &materials()
+    {
+        return materials_;
+    }
+
+  private:
+    using mat4 = std::array<double, 16>; // 列主序，与 glTF 相同
+
+    const tinygltf::Model &model_;
+    std::shared_ptr<material> fallback_;
+    std::vector<std::shared_ptr<material>> materials_;
+    std::unordered_map<int, uint32_t> material_ids_;  // glTF 材质下标 -> materials_ 下标
+    std::unordered_map<int, std::shared_ptr<texture>> textures_; // glTF 图片下标 -> 纹理
+
+    static constexpr int k_max_node_depth = 64; // 防止损坏文件里的节点环
+
+    template <typename T>
+    static bool valid_index(int index, const std::vector<T> &items)
+    {
+        return index >= 0 && static_cast<size_t>(index) < items.size();
+    }
+
+    static mat4 identity()
+    {
+        return {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    }
+
+    static mat4 multiply(const mat4 &a, const mat4 &b)
+    {
+        mat4 m{};
+        for (int col = 0; col < 4; col++)
+            for (int row = 0; row < 4; row++)
+                for (int k = 0; k < 4; k++)
+                    m[(col * 4) + row] += a[(k * 4) + row] * b[(col * 4) + k];
+        return m;
+    }
+
+    // 节点的局部变换：matrix，或者 T * R * S
+    static mat4 local_transform(const tinygltf::Node &node)
+    {
+        if (node.matrix.size() == 16)
+        {
+            mat4 m{};
+            std::copy(node.matrix.begin(), node.matrix.end(), m.begin());
+            return m;
+        }
+
+        auto m = identity();
+        if (node.scale.size() == 3)
+            for (int i = 0; i < 3; i++)
+                for (int row = 0; row < 3; row++)
+                    m[(i * 4) + row] *= node.scale[i];
+        if (node.rotation.size() == 4)
+        {
+            double x = node.rotation[0], y = node.rotation[1], z = node.rotation[2];
+            double w = node.rotation[3];
+            mat4 r = {1 - (2 * ((y * y) + (z * z))), 2 * ((x * y) + (z * w)),
+                      2 * ((x * z) - (y * w)),       0,
+                      2 * ((x * y) - (z * w)),       1 - (2 * ((x * x) + (z * z))),
+                      2 * ((y * z) + (x * w)),       0,
+                      2 * ((x * z) + (y * w)),       2 * ((y * z) - (x * w)),
+                      1 - (2 * ((x * x) + (y * y))), 0,
+                      0,                             0,
+                      0,                             1};
+            m = multiply(r, m);
+        }
+        if (node.translation.size() == 3)
+            for (int row = 0; row < 3; row++)
+                m[12 + row] += node.translation[row];
+        return m;
+    }
+
+    bool read_node(int node_index, const mat4 &parent, int depth, mesh_data &data)
+    {
+        if (!valid_index(node_index, model_.nodes) || depth > k_max_node_depth)
+            return false;
+        const auto &node = model_.nodes[node_index];
+        auto world = multiply(parent, local_transform(node));
+        if (node.mesh >= 0)
+        {
+            if (!valid_index(node.mesh, model_.meshes))
+                return false;
+            if (!read_mesh(model_.meshes[node.mesh], world, data))
+                return false;
+        }
+        for (int child : node.children)
+            if (!read_node(child, world, depth + 1, data))
+                return false;
+        return true;
+    }
+
+    /*
+    读取 accessor 的每个元素的前 components 个分量，转成 double 追加到 out。
+    支持 float 和（可选归一化的）整数分量，处理 byteStride；越界时返回 false。
+    */
+    bool read_accessor(int accessor_index, int components, std::vector<double> &out) const
+    {
+        if (!valid_index(accessor_index, model_.accessors))
+            return false;
+        const auto &accessor = model_.accessors[accessor_index];
+        if (!valid_index(accessor.bufferView, model_.bufferViews) ||
+            accessor.sparse.isSparse)
+            return false;
+        const auto &view = model_.bufferViews[accessor.bufferView];
+        if (!valid_index(view.buffer, model_.buffers))
+            return false;
+        const auto &buffer = model_.buffers[view.buffer];
+
+        auto component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+        auto element_components = tinygltf::GetNumComponentsInType(accessor.type);
+        auto stride = accessor.ByteStride(view);
+        if (component_size <= 0 || element_components < components || stride <= 0)
+            return false;
+
+        auto begin = view.byteOffset + accessor.byteOffset;
+        auto element_size = static_cast<size_t>(component_size * element_components);
+        if (accessor.count > 0 &&
+            begin + ((accessor.count - 1) * stride) + element_size > buffer.data.size())
+            return false;
+
+        out.reserve(out.size() + (accessor.count * components));
+        for (size_t i = 0; i < accessor.count; i++)
+        {
+            const auto *element = buffer.data.data() + begin + (i * stride);
+            for (int c = 0; c < components; c++)
+                out.push_back(read_component(element + (c * component_size),
+                                         accessor.componentType, accessor.normalized));
+        }
+        return true;
+    }
+
+    static double read_component(const unsigned char *p, int type, bool normalized)
+    {
+        // NOTE: 用 memcpy 读，buffer 里的数据不保证对齐
+        switch (type)
+        {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return normalized ? p[0] / 255.0 : p[0];
+        case TINYGLTF_COMPONENT_TYPE_BYTE: {
+            auto v = static_cast<int8_t>(p[0]);
+            return normalized ? std::max(v / 127.0, -1.0) : v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return normalized ? v / 65535.0 : v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return normalized ? std::max(v / 32767.0, -1.0) : v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    std::shared_ptr<texture> image_texture_for(int texture_index)
+    {
+        if (!valid_index(texture_index, model_.textures))
+            return nullptr;
+        auto image_index = model_.textures[texture_index].source;
+        if (!valid_index(image_index, model_.images))
+            return nullptr;
+
+        auto &tex = textures_[image_index];
+        if (!tex)
+        {
+            // 贴图的原始（已编码）字节由 keep_encoded_image 保存在 image.image 里
+            const auto &bytes = model_.images[image_index].image;
+            tex = std::make_shared<image_texture>(bytes.data(), bytes.size());
+        }
+        return tex;
+    }
+
+    uint32_t material_id(int gltf_material)
+    {
+        auto [it, inserted] =
+            material_ids_.try_emplace(gltf_material, uint32_t(materials_.size()));
+        if (!inserted)
+            return it->second;
+
+        if (!valid_index(gltf_material, model_.materials))
+        {
+            materials_.push_back(fallback_);
+            return it->second;
+        }
+
+        const auto &m = model_.materials[gltf_material];
+        const auto &pbr = m.pbrMetallicRoughness;
+        color emission(0, 0, 0);
+        if (m.emissiveFactor.size() == 3)
+        {
+            const auto &e = m.emissiveFactor;
+            emission = color(e[0], e[1], e[2]);
+        }
+
+        if (emission.length_squared() > 0)
+            materials_.push_back(std::make_shared<diffuse_light>(emission));
+        else if (auto tex = image_texture_for(pbr.baseColorTexture.index))
+            materials_.push_back(std::make_shared<lambertian>(tex));
+        else if (pbr.baseColorFactor.size() >= 3)
+            materials_.push_back(std::make_shared<lambertian>(color(
+                pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2])));
+        else
+            materials_.push_back(fallback_);
+        return it->second;
+    }
+
+    bool read_mesh(const tinygltf::Mesh &mesh, const mat4 &m, mesh_data &data)
+    {
+        // 法线用变换的余子式矩阵（= det * 逆转置），非均匀缩放下也正确；
+        // det < 0（镜像）时三角形绕序反了，交换两个顶点保持几何法线朝外
+        auto cofactor = [&](int r, int c) {
+            auto at = [&](int row, int col) { return m[(col * 4) + row]; };
+            int r0 = (r + 1) % 3, r1 = (r + 2) % 3, c0 = (c + 1) % 3, c1 = (c + 2) % 3;
+            return (at(r0, c0) * at(r1, c1)) - (at(r0, c1) * at(r1, c0));
+        };
+        double det = (m[0] * cofactor(0, 0)) + (m[4] * cofactor(0, 1)) +
+                     (m[8] * cofactor(0, 2));
+        bool mirrored = det < 0;
+
+        for (const auto &primitive : mesh.primitives)
+        {
+            if (primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != -1)
+                continue; // 只支持三角形列表
+
+            auto position = primitive.attributes.find("POSITION");
+            if (position == primitive.attributes.end())
+                continue;
+
+            std::vector<double> positions;
+            if (!read_accessor(position->second, 3, positions))
+                return false;
+            auto vertex_count = positions.size() / 3;
+            auto base = static_cast<uint32_t>(data.positions.size());
+
+            for (size_t i = 0; i < vertex_count; i++)
+            {
+                double x = positions[3 * i], y = positions[(3 * i) + 1];
+                double z = positions[(3 * i) + 2];
+                data.positions.emplace_back(
+                    (m[0] * x) + (m[4] * y) + (m[8] * z) + m[12],
+                    (m[1] * x) + (m[5] * y) + (m[9] * z) + m[13],
+                    (m[2] * x) + (m[6] * y) + (m[10] * z) + m[14]);
+            }
+
+            // 可选属性：只要有一个图元有，所有顶点都要有（没有的补 0，插值后退回几何法线）
+            std::vector<double> normals;
+            auto normal = primitive.attributes.find("NORMAL");
+            if (normal != primitive.attributes.end() &&
+                !read_accessor(normal->second, 3, normals))
+                return false;
+            if (!normals.empty() || !data.normals.empty())
+            {
+                data.normals.resize(base, vec3(0, 0, 0));
+                double sign = mirrored ? -1 : 1;
+                for (size_t i = 0; i < vertex_count; i++)
+                {
+                    if (normals.empty())
+                    {
+                        data.normals.emplace_back(0, 0, 0);
+                        continue;
+                    }
+                    vec3 n(normals[3 * i], normals[(3 * i) + 1], normals[(3 * i) + 2]);
+                    vec3 t(0, 0, 0);
+                    for (int r = 0; r < 3; r++)
+                        t[r] = sign * ((cofactor(r, 0) * n[0]) + (cofactor(r, 1) * n[1]) +
+                                       (cofactor(r, 2) * n[2]));
+                    data.normals.push_back(t);
+                }
+            }
+
+            std::vector<double> uvs;
+            auto texcoord = primitive.attributes.find("TEXCOORD_0");
+            if (texcoord != primitive.attributes.end() &&
+                !read_accessor(texcoord->second, 2, uvs))
+                return false;
+            if (!uvs.empty() || !data.uvs.empty())
+            {
+                data.uvs.resize(2 * size_t(base), 0);
+                for (size_t i = 0; i < vertex_count; i++)
+                {
+                    data.uvs.push_back(uvs.empty() ? 0 : uvs[2 * i]);
+                    data.uvs.push_back(uvs.empty() ? 0 : 1.0 - uvs[(2 * i) + 1]);
+                }
+            }
+
+            // 没有 indices 的图元：顶点按顺序每 3 个一个三角形
+            std::vector<double> indices;
+            if (primitive.indices >= 0)
+            {
+                if (!read_accessor(primitive.indices, 1, indices))
+                    return false;
+            }
+            else
+            {
+                indices.resize(vertex_count);
+                for (size_t i = 0; i < vertex_count; i++)
+                    indices[i] = static_cast<double>(i);
+            }
+
+            auto id = material_id(primitive.material);
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                uint32_t tri[3];
+                for (int k = 0; k < 3; k++)
+                    tri[k] = base + static_cast<uint32_t>(indices[i + k]);
+                if (mirrored)
+                    std::swap(tri[1], tri[2]);
+                data.indices.insert(data.indices.end(), {tri[0], tri[1], tri[2]});
+                data.material_ids.push_back(id);
+            }
+        }
+        return true;
+    }
+};
+
+// tinygltf 的贴图回调：不解码，只保存原始字节，交给 image_texture(rtw_image) 解码
+inline bool keep_encoded_image(tinygltf::Image *image, const int /*image_idx*/,
+                               std::string * /*err*/, std::string * /*warn*/,
+                               int /*req_width*/, int /*req_height*/,
+                               const unsigned char *bytes, int size, void * /*user_data*/)
+{
+    image->image.assign(bytes, bytes + size);
+    return true;
+}
+
+inline std::shared_ptr<triangle_mesh> load_gltf_mesh(const std::string &path,
+                                                     std::shared_ptr<material> fallback =
+                                                         nullptr)
+{
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(keep_encoded_image, nullptr);
+
+    std::string warn;
+    std::string err;
+    auto extension = std::filesystem::path(path).extension().string();
+    bool ok = (extension == ".glb")
+                  ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
+                  : loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    if (!warn.empty())
+        std::cerr << "WARNING: " << warn << '\n';
+    if (!ok)
+    {
+        std::cerr << "ERROR: Could not load glTF file '" << path << "'. " << err << '\n';
+        return nullptr;
+    }
+
+    gltf_mesh_reader reader(model, std::move(fallback));
+    mesh_data data;
+    if (!reader.read(data))
+    {
+        std::cerr << "ERROR: glTF file '" << path << "' has invalid mesh data.\n";
+        return nullptr;
+    }
+    return make_mesh(path, std::move(data), std::move(reader.materials()));
+}
+
+// 按扩展名选择加载器：.obj 用 tinyobjloader，.gltf / .glb 用 tinygltf
+inline std::shared_ptr<triangle_mesh> load_mesh(const std::string &path,
+                                                std::shared_ptr<material> fallback =
+                                                    nullptr)
+{
+    auto extension = std::filesystem::path(path).extension().string();
+    if (extension == ".gltf" || extension == ".glb")
+        return load_gltf_mesh(path, std::move(fallback));
+    return load_obj_mesh(path, std::move(fallback));
+}
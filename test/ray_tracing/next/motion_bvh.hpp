@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+
+#include "aabb.hpp"
+#include "hittable.hpp"
+#include "hittable_list.hpp"
+
+/*
+NOTE: 运动 BVH（Motion BVH）
+bvh_node 用的是 bounding_box()：运动球体的包围盒是 t=0 与 t=1 两个包围盒的并集。
+位移越大，这个并集越松，光线在任意时刻都会去访问大量其实已经"离开"的节点。
+
+运动 BVH 的节点保存两个包围盒：
+    box0_：快门打开时刻(time=0)的包围盒
+    box1_：快门关闭时刻(time=1)的包围盒
+遍历时先按 r.time() 插值出当前时刻的包围盒，再做 slab 测试。
+
+为什么插值是保守的？
+    图元线性运动：box(t) = lerp(box0, box1, t)，精确
+    父节点：box0_ = 子节点 box0 的并集，box1_ = 子节点 box1 的并集
+        lerp(min(a0,b0), min(a1,b1), t) <= lerp(a0, a1, t)，max 同理
+    所以插值后的父包围盒一定包含插值后的子包围盒
+*/
+class motion_bvh_node : public hittable // NOLINT
+{
+  public:
+    explicit motion_bvh_node(hittable_list list)
+        : motion_bvh_node(list.objects, 0, list.objects.size())
+    {
+    }
+
+    motion_bvh_node(std::vector<std::shared_ptr<hittable>> &objects, size_t start,
+                    size_t end)
+        : box0_(aabb::empty), box1_(aabb::empty)
+    {
+        // NOTE: 分割依据是快门中点时刻的包围盒，它最能代表图元"平均"的位置
+        aabb mid_box = aabb::empty;
+        for (size_t object_index = start; object_index < end; object_index++)
+        {
+            const auto &object = objects[object_index];
+            box0_ = aabb(box0_, object->bounding_box_at(0));
+            box1_ = aabb(box1_, object->bounding_box_at(1));
+            mid_box = aabb(mid_box, object->bounding_box_at(0.5));
+        }
+
+        size_t object_span = end - start;
+
+        if (object_span == 1)
+        {
+            // 只有一个物体：只挂在左边，避免同一个物体被测试两次
+            left_ = objects[start];
+        }
+        else if (object_span == 2)
+        {
+            left_ = objects[start];
+            right_ = objects[start + 1];
+        }
+        else
+        {
+            int axis = mid_box.longest_axis();
+            std::sort(std::begin(objects) + start, std::begin(objects) + end,
+                      [axis](const std::shared_ptr<hittable> &a,
+                             const std::shared_ptr<hittable> &b) {
+                          return centroid(a, axis) < centroid(b, axis);
+                      });
+
+            auto mid = start + (object_span / 2);
+            left_ = std::make_shared<motion_bvh_node>(objects, start, mid);
+            right_ = std::make_shared<motion_bvh_node>(objects, mid, end);
+        }
+    }
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_stat(render_stat::bvh_nodes_visited);
+        // NOTE: 只测试光线所在时刻的包围盒
+        if (!hit_box_at(r, ray_t))
+            return false;
+
+        bool hit_left = left_->intersect(r, ray_t, rec);
+        bool hit_right =
+            right_ &&
+            right_->intersect(r, interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
+
+        return hit_left || hit_right;
+    }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        count_stat(render_stat::bvh_nodes_visited);
+        if (!hit_box_at(r, ray_t))
+            return false;
+        return left_->occluded(r, ray_t) || (right_ && right_->occluded(r, ray_t));
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        left_->collect_materials(out);
+        if (right_)
+            right_->collect_materials(out);
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return aabb(box0_, box1_);
+    }
+
+    [[nodiscard]] aabb bounding_box_at(double time) const override
+    {
+        return lerp(box0_, box1_, time);
+    }
+
+  private:
+    std::shared_ptr<hittable> left_;
+    std::shared_ptr<hittable> right_;
+    aabb box0_;
+    aabb box1_;
+
+    // NOTE: 与 aabb::hit 相同的 slab 测试，只是每个轴的区间先按时间插值。
+    // 直接在这里插值，省掉构造临时 aabb（及其 pad_to_minimums）的开销
+    [[nodiscard]] bool hit_box_at(const ray &r, interval ray_t) const
+    {
+        const double time = r.time();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto ax = lerp(box0_.axis_interval(axis), box1_.axis_interval(axis), time);
+            const double adinv = 1.0 / r.direction()[axis];
+
+            auto t0 = (ax.min - r.origin()[axis]) * adinv;
+            auto t1 = (ax.max - r.origin()[axis]) * adinv;
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            ray_t.min = std::max(t0, ray_t.min);
+            ray_t.max = std::min(t1, ray_t.max);
+            if (ray_t.max <= ray_t.min)
+                return false;
+        }
+        return true;
+    }
+
+    static double centroid(const std::shared_ptr<hittable> &object, int axis)
+    {
+        auto box = object->bounding_box_at(0.5);
+        const auto &ax = box.axis_interval(axis);
+        return ax.min + ax.max;
+    }
+};
@@ -282,6 +282,60 @@ class perlin_with_random_vec
         return std::fabs(accum); // NOTE: 颜色负数，没有意义
     }
 
+    /*
+    NOTE: |noise(p)| 在盒子 [lo, hi] 上的上界（非均匀介质的 majorant 要用真正的上界）
+    每个格点项 g·(p - 格点) 是 p 的线性函数，绝对值的最大值在盒子的角上取到；
+    三线性权重是平滑步 (uu, vv, ww) 的多线性函数，所以 Σ 权重 × 格点项上界 的最大值
+    也在 (uu, vv, ww) 范围的角上取到。盒子跨多个格子时逐格取最大。
+    全局上界 √3/2：由 Jensen 不等式 |noise| ≤ sqrt(Σ w|o|²)，每个轴上 Σ w o² ≤ 1/4
+    */
+    [[nodiscard]] double noise_bound(const point3 &lo, const point3 &hi) const
+    {
+        constexpr double k_global = 0.8660254037844386; // √3/2
+        constexpr long k_max_cells = 64;
+
+        int first[3];
+        int last[3];
+        long cells = 1;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            first[axis] = static_cast<int>(std::floor(lo[axis]));
+            last[axis] = static_cast<int>(std::floor(hi[axis]));
+            cells *= last[axis] - first[axis] + 1;
+        }
+        if (cells > k_max_cells)
+            return k_global;
+
+        double result = 0;
+        for (int i = first[0]; i <= last[0]; i++)
+            for (int j = first[1]; j <= last[1]; j++)
+                for (int k = first[2]; k <= last[2]; k++)
+                {
+                    int cell[3] = {i, j, k};
+                    result = std::max(result, cell_bound(cell, lo, hi));
+                    if (result >= k_global)
+                        return k_global;
+                }
+        return result;
+    }
+
+    // turb 在盒子上的上界：|Σ 0.5^i noise| ≤ Σ 0.5^i |noise|
+    [[nodiscard]] double turb_bound(const point3 &lo, const point3 &hi, int depth) const
+    {
+        auto accum = 0.0;
+        auto temp_lo = lo;
+        auto temp_hi = hi;
+        auto weight = 1.0;
+        for (int i = 0; i < depth; i++)
+        {
+            accum += weight * noise_bound(temp_lo, temp_hi);
+            weight *= 0.5;
+            temp_lo *= 2;
+            temp_hi *= 2;
+        }
+        return accum;
+    }
+
   private:
     static const int point_count = 256;
     vec3 randvec[point_count]; // NOTE: 向量而不是点
@@ -309,6 +363,61 @@ class perlin_with_random_vec
         }
     }
 
+    // 盒子 [lo, hi] 与整数格子 cell 相交部分上 |noise| 的上界（见 noise_bound）
+    [[nodiscard]] double cell_bound(const int cell[3], const point3 &lo,
+                                    const point3 &hi) const
+    {
+        // 交集在格子内的局部坐标 [a_lo, a_hi] ⊂ [0,1]，以及对应的平滑步范围
+        double center[3];
+        double half[3];
+        double smooth[3][2];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto a_lo = std::clamp(lo[axis] - cell[axis], 0.0, 1.0);
+            auto a_hi = std::clamp(hi[axis] - cell[axis], 0.0, 1.0);
+            center[axis] = 0.5 * (a_lo + a_hi);
+            half[axis] = 0.5 * (a_hi - a_lo);
+            smooth[axis][0] = a_lo * a_lo * (3 - 2 * a_lo);
+            smooth[axis][1] = a_hi * a_hi * (3 - 2 * a_hi);
+        }
+
+        // 每个格点项在盒子上的最大绝对值：|g·(中心 - 格点)| + Σ |g_axis| · 半宽
+        double term[2][2][2];
+        for (int di = 0; di < 2; di++)
+            for (int dj = 0; dj < 2; dj++)
+                for (int dk = 0; dk < 2; dk++)
+                {
+                    const auto &g = randvec[perm_x[(cell[0] + di) & 255] ^
+                                            perm_y[(cell[1] + dj) & 255] ^
+                                            perm_z[(cell[2] + dk) & 255]];
+                    vec3 offset(center[0] - di, center[1] - dj, center[2] - dk);
+                    term[di][dj][dk] = std::fabs(dot(g, offset)) +
+                                       (std::fabs(g.x()) * half[0]) +
+                                       (std::fabs(g.y()) * half[1]) +
+                                       (std::fabs(g.z()) * half[2]);
+                }
+
+        double result = 0;
+        for (int ci = 0; ci < 2; ci++)
+            for (int cj = 0; cj < 2; cj++)
+                for (int ck = 0; ck < 2; ck++)
+                {
+                    auto uu = smooth[0][ci];
+                    auto vv = smooth[1][cj];
+                    auto ww = smooth[2][ck];
+                    auto accum = 0.0;
+                    for (int di = 0; di < 2; di++)
+                        for (int dj = 0; dj < 2; dj++)
+                            for (int dk = 0; dk < 2; dk++)
+                                accum += (di * uu + (1 - di) * (1 - uu)) *
+                                         (dj * vv + (1 - dj) * (1 - vv)) *
+                                         (dk * ww + (1 - dk) * (1 - ww)) *
+                                         term[di][dj][dk];
+                    result = std::max(result, accum);
+                }
+        return result;
+    }
+
     // NOTE: 光滑的魔法：三线性插值
     static double perlin_interp(const vec3 c[2][2][2], double u, double v, double w)
     {
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <utility>
 
 #include "hittable.hpp"
@@ -126,6 +129,11 @@ class quad : public hittable
         bbox = aabb(bbox_diagonal1, bbox_diagonal2);
     }
 
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        out.push_back(mat.get());
+    }
+
     [[nodiscard]] aabb bounding_box() const override
     {
         return bbox;
@@ -138,6 +146,51 @@ class quad : public hittable
     确定命中点是否位于四边形内部。
 */
     bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_stat(render_stat::quad_tests);
+        double t = 0;
+        double alpha = 0;
+        double beta = 0;
+        if (!hit_plane(r, ray_t, t, alpha, beta))
+            return false;
+
+        // 第4步：内部点检测（顺便写 UV，平面坐标已经算出来了）
+        if (!is_interior(alpha, beta, rec))
+            return false;
+
+        rec.t = t;
+        rec.deferred = this;
+        return true;
+    }
+
+    void surface_interaction(const ray &r, hit_record &rec) const override
+    {
+        rec.p = r.at(rec.t);
+        rec.mat = mat.get();
+        rec.set_face_normal(r, normal);
+    }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        count_stat(render_stat::quad_tests);
+        double t = 0;
+        double alpha = 0;
+        double beta = 0;
+        hit_record unused; // is_interior 顺便写 UV，遮挡查询用不到
+        return hit_plane(r, ray_t, t, alpha, beta) && is_interior(alpha, beta, unused);
+    }
+
+    // 第1~3步：与平面求交，得到 t 和平面坐标 (α, β)
+    bool hit_plane(const ray &r, const interval &ray_t, double &t, double &alpha,
+                   double &beta) const
     {
         // 第1步：检查光线是否平行于平面
         auto denom = dot(normal, r.direction());
@@ -149,26 +202,16 @@ class quad : public hittable
         // 第2步：计算交点参数t
         // NOTE: t = (D-n·P)/(n·d)
         // 如果命中点参数t在射线间隔之外，则返回false
-        auto t = (D - dot(normal, r.origin())) / denom;
+        t = (D - dot(normal, r.origin())) / denom;
         if (!ray_t.contains(t))
             return false;
 
-        // 第3步：计算交点坐标并设置命中记录
+        // 第3步：计算交点坐标
         auto intersection = r.at(t);
 
-        vec3 planar_hitpt_vector = intersection - Q;        // p = P - Q
-        auto alpha = dot(w, cross(planar_hitpt_vector, v)); // α坐标
-        auto beta = dot(w, cross(u, planar_hitpt_vector));  // β坐标
-
-        // 第4步：内部点检测
-        if (!is_interior(alpha, beta, rec))
-            return false;
-
-        rec.t = t;
-        rec.p = intersection;
-        rec.mat = mat;
-        rec.set_face_normal(r, normal);
-
+        vec3 planar_hitpt_vector = intersection - Q;   // p = P - Q
+        alpha = dot(w, cross(planar_hitpt_vector, v)); // α坐标
+        beta = dot(w, cross(u, planar_hitpt_vector));  // β坐标
         return true;
     }
 
@@ -197,6 +240,32 @@ class quad : public hittable
         return true;
     }
 
+    // 光源采样用：P = corner() + α·edge_u() + β·edge_v()，α、β ∈ [0, 1]
+    [[nodiscard]] point3 corner() const
+    {
+        return Q;
+    }
+
+    [[nodiscard]] vec3 edge_u() const
+    {
+        return u;
+    }
+
+    [[nodiscard]] vec3 edge_v() const
+    {
+        return v;
+    }
+
+    [[nodiscard]] vec3 unit_normal() const
+    {
+        return normal;
+    }
+
+    [[nodiscard]] const material *surface_material() const
+    {
+        return mat.get();
+    }
+
   private:
     /*
 原理图：
@@ -228,11 +297,233 @@ NOTE:为了修正这种情况，我们插入一个小的填充量，以确保新
     vec3 w; // NOTE: 四边形常量向量
 };
 
+/*
+NOTE: 轴对齐长方体图元
+box_quads() 的盒子是 6 个 quad：一条光线要做 6 次虚函数调用、6 次平面求交和内部点检测，
+BVH 叶子里放的是 hittable_list，还要再多一层。axis_aligned_box 一次 slab 测试（与 aabb::clip 相同）
+同时得到进入和离开的 t 以及对应的轴：
+    t_enter 在 ray_t 内：命中进入面；否则 t_exit 在 ray_t 内：光线从盒子内部出发，命中离开面
+面由（轴，min/max 侧）决定，法线就是该轴的正/负方向，UV 按 box_quads() 里对应 quad 的 (α, β) 计算，
+所以两种盒子渲染出的图像只有浮点舍入级别的差别。
+每个面可以有自己的材质（face_materials 按 box_face 的顺序），整个盒子是一个 hittable，
+BVH 的叶子直接引用它。
+*/
+enum class box_face // NOLINT
+{
+    front,  // z = max
+    right,  // x = max
+    back,   // z = min
+    left,   // x = min
+    top,    // y = max
+    bottom, // y = min
+};
+
+class axis_aligned_box : public hittable // NOLINT
+{
+  public:
+    using face_materials = std::array<std::shared_ptr<material>, 6>;
+
+    // a、b 是任意两个相对的顶点
+    axis_aligned_box(const point3 &a, const point3 &b,
+                     const std::shared_ptr<material> &mat)
+        : axis_aligned_box(a, b, face_materials{mat, mat, mat, mat, mat, mat})
+    {
+    }
+
+    axis_aligned_box(const point3 &a, const point3 &b, face_materials mats)
+        : min_(std::fmin(a.x(), b.x()), std::fmin(a.y(), b.y()), std::fmin(a.z(), b.z())),
+          max_(std::fmax(a.x(), b.x()), std::fmax(a.y(), b.y()), std::fmax(a.z(), b.z())),
+          mats_(std::move(mats)), bbox_(min_, max_)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto extent = max_[axis] - min_[axis];
+            inv_extent_[axis] = extent > 0 ? 1.0 / extent : 0.0;
+        }
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        for (const auto &mat : mats_)
+            out.push_back(mat.get());
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return bbox_;
+    }
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    // 只求 t 和命中的面：rec.prim = axis * 2 + (是否 max 一侧)
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_stat(render_stat::box_tests);
+        const vec3 &dir = r.direction();
+
+        // 第1步：slab 测试，记下进入和离开时对应的轴
+        slab_span span;
+        if (!clip(r, span))
+            return false;
+        auto [t_enter, t_exit, enter_axis, exit_axis] = span;
+
+        // 第2步：选进入面；起点在盒子内（或进入点在 ray_t 之前）时选离开面
+        double t = 0;
+        int axis = 0;
+        bool max_side = false;
+        if (ray_t.contains(t_enter))
+        {
+            t = t_enter;
+            axis = enter_axis;
+            max_side = dir[axis] < 0;
+        }
+        else if (ray_t.contains(t_exit))
+        {
+            t = t_exit;
+            axis = exit_axis;
+            max_side = dir[axis] > 0;
+        }
+        else
+            return false;
+
+        rec.t = t;
+        rec.prim = static_cast<uint32_t>((axis * 2) + (max_side ? 1 : 0));
+        rec.deferred = this;
+        return true;
+    }
+
+    void surface_interaction(const ray &r, hit_record &rec) const override
+    {
+        auto axis = static_cast<int>(rec.prim / 2);
+        auto max_side = (rec.prim % 2) != 0;
+
+        // 第3步：交点落在面上（消掉 r.at(t) 在这个轴上的舍入误差），法线和 UV 由面决定
+        rec.p = r.at(rec.t);
+        rec.p[axis] = max_side ? max_[axis] : min_[axis];
+        auto face = face_of(axis, max_side);
+        rec.mat = mats_[static_cast<size_t>(face)].get();
+        set_face_uv(face, rec);
+
+        vec3 outward_normal(0, 0, 0);
+        outward_normal[axis] = max_side ? 1.0 : -1.0;
+        rec.set_face_normal(r, outward_normal);
+    }
+
+    // 遮挡查询只要 slab 测试：进入点或离开点在 ray_t 内就挡住了
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        count_stat(render_stat::box_tests);
+        slab_span span;
+        return clip(r, span) &&
+               (ray_t.contains(span.t_enter) || ray_t.contains(span.t_exit));
+    }
+
+  private:
+    struct slab_span
+    {
+        double t_enter = -infinity;
+        double t_exit = infinity;
+        int enter_axis = 0;
+        int exit_axis = 0;
+    };
+
+    point3 min_;
+    point3 max_;
+    vec3 inv_extent_;
+    face_materials mats_;
+    aabb bbox_;
+
+    bool clip(const ray &r, slab_span &span) const
+    {
+        const point3 &orig = r.origin();
+        const vec3 &dir = r.direction();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto inv_d = 1.0 / dir[axis];
+            auto t0 = (min_[axis] - orig[axis]) * inv_d;
+            auto t1 = (max_[axis] - orig[axis]) * inv_d;
+            if (inv_d < 0)
+                std::swap(t0, t1);
+            // NOTE: 光线平行于某个 slab 且起点恰好在边界上时 t0/t1 是 NaN，比较为假，不影响结果
+            if (t0 > span.t_enter)
+            {
+                span.t_enter = t0;
+                span.enter_axis = axis;
+            }
+            if (t1 < span.t_exit)
+            {
+                span.t_exit = t1;
+                span.exit_axis = axis;
+            }
+        }
+        return span.t_enter <= span.t_exit;
+    }
+
+    static box_face face_of(int axis, bool max_side)
+    {
+        static constexpr box_face faces[3][2] = {
+            {box_face::left, box_face::right},
+            {box_face::bottom, box_face::top},
+            {box_face::back, box_face::front},
+        };
+        return faces[axis][max_side ? 1 : 0];
+    }
+
+    // 与 box_quads() 中每个 quad 的 (Q, u, v) 一致：rec.u = α，rec.v = β
+    void set_face_uv(box_face face, hit_record &rec) const
+    {
+        const auto &p = rec.p;
+        auto from_min = [&](int a) { return (p[a] - min_[a]) * inv_extent_[a]; };
+        auto from_max = [&](int a) { return (max_[a] - p[a]) * inv_extent_[a]; };
+        switch (face)
+        {
+        case box_face::front: // Q=(min.x, min.y, max.z), u=dx, v=dy
+            rec.u = from_min(0);
+            rec.v = from_min(1);
+            break;
+        case box_face::right: // Q=(max.x, min.y, max.z), u=-dz, v=dy
+            rec.u = from_max(2);
+            rec.v = from_min(1);
+            break;
+        case box_face::back: // Q=(max.x, min.y, min.z), u=-dx, v=dy
+            rec.u = from_max(0);
+            rec.v = from_min(1);
+            break;
+        case box_face::left: // Q=(min.x, min.y, min.z), u=dz, v=dy
+            rec.u = from_min(2);
+            rec.v = from_min(1);
+            break;
+        case box_face::top: // Q=(min.x, max.y, max.z), u=dx, v=-dz
+            rec.u = from_min(0);
+            rec.v = from_max(2);
+            break;
+        case box_face::bottom: // Q=(min.x, min.y, min.z), u=dx, v=dz
+            rec.u = from_min(0);
+            rec.v = from_min(2);
+            break;
+        }
+    }
+};
+
+// 包含两个相对顶点 a、b 的盒子，所有面用同一个材质
+inline std::shared_ptr<axis_aligned_box> box(const point3 &a, const point3 &b,
+                                             std::shared_ptr<material> mat)
+{
+    return std::make_shared<axis_aligned_box>(a, b, mat);
+}
+
 /*
 康奈尔盒子通常有两个块。它们相对于墙壁旋转。
-首先，让我们创建一个返回一个盒子的函数，通过创建一个由六个矩形组成的hittable_list
+最初的做法：由六个矩形组成的hittable_list。现在 box() 返回 axis_aligned_box，
+这个函数留着用来对比（bench / 图像比较）
 */
-inline std::shared_ptr<hittable_list> box(const point3 &a, const point3 &b,
+inline std::shared_ptr<hittable_list> box_quads(const point3 &a, const point3 &b,
                                           std::shared_ptr<material> mat)
 {
     // Returns the 3D box (six sides) that contains the two opposite vertices a & b.
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "flat_bvh.hpp"
+
+/*
+NOTE: 量化 BVH 节点
+bvh_node 每个节点：虚表指针 8 + 两个 shared_ptr 32 + 六个 double 的 aabb 48 = 88 字节，
+再加上 make_shared 的控制块和一次堆分配；flat_bvh 已经压到 32 字节，但仍是每个节点
+（包括叶子）都存一份完整的 float 包围盒。
+
+这里每个内部节点只存两个孩子的包围盒，并且相对于"自己的包围盒"量化成 Q 位整数：
+    孩子.min = 父.min + lo * (父.max - 父.min) / (2^bits - 1)
+    孩子.max = 父.min + hi * (父.max - 父.min) / (2^bits - 1)
+编码时 lo 向下取整、hi 向上取整，并用解码函数本身验证，保证解码后的盒子一定包住真实的盒子
+（保守：只会多访问节点，不会漏掉命中）。遍历时父节点的盒子是上一层解出来的，随栈一起保存，
+所以节点里不需要任何完整精度的坐标，只有根节点的盒子以 float 单独保存。
+
+    quantized_bvh_node<uint8_t>  ：2*6 字节 + 2 个 uint32 孩子引用 = 20 字节
+    quantized_bvh_node<uint16_t> ：2*12 字节 + 8                    = 32 字节
+叶子不占节点：孩子引用最高位为 1 表示叶子，接着 4 位是图元个数 - 1，低 27 位是 prim_indices 中的位置。
+所以叶子最多 16 个图元，图元最多 2^27 个。
+*/
+template <typename Q>
+struct quantized_bvh_node // NOLINT
+{
+    Q lo[2][3];         // NOLINT 两个孩子包围盒的量化下界
+    Q hi[2][3];         // NOLINT 两个孩子包围盒的量化上界
+    uint32_t child[2];  // NOLINT 内部节点下标，或叶子引用（最高位为 1）
+};
+static_assert(sizeof(quantized_bvh_node<uint8_t>) == 20);
+static_assert(sizeof(quantized_bvh_node<uint16_t>) == 32);
+
+template <typename Q>
+class quantized_bvh // NOLINT
+{
+  public:
+    using node = quantized_bvh_node<Q>;
+
+    static constexpr uint32_t k_leaf_flag = 0x80000000U;
+    static constexpr int k_offset_bits = 27;
+    static constexpr uint32_t k_max_leaf_size = 16;
+    static constexpr uint32_t k_max_prims = 1U << k_offset_bits;
+
+    quantized_bvh() = default;
+
+    // 从图元包围盒构建：先构建 flat_bvh（分桶 SAH），再压缩
+    static quantized_bvh build(std::span<const aabb> boxes, int max_leaf_size = 2)
+    {
+        auto leaf_size = std::min(max_leaf_size, static_cast<int>(k_max_leaf_size));
+        return from(flat_bvh::build(boxes, leaf_size));
+    }
+
+    // 把已有的 flat_bvh 压缩成量化节点；叶子过大或图元过多时返回空的 BVH
+    static quantized_bvh from(const flat_bvh &source)
+    {
+        quantized_bvh bvh;
+        auto nodes = source.nodes();
+        if (nodes.empty())
+            return bvh;
+        if (source.prim_indices().size() >= k_max_prims)
+        {
+            std::cerr << "ERROR: quantized_bvh supports at most " << k_max_prims
+                      << " primitives.\n";
+            return bvh;
+        }
+
+        bvh.prim_indices_.assign(source.prim_indices().begin(),
+                                 source.prim_indices().end());
+        bvh.root_box_ = box_of(nodes[0]);
+        bvh.nodes_.reserve(nodes.size() / 2);
+        if (!bvh.encode(nodes, 0, bvh.root_box_, bvh.root_))
+        {
+            std::cerr << "ERROR: quantized_bvh leaves hold at most " << k_max_leaf_size
+                      << " primitives.\n";
+            return {};
+        }
+        return bvh;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return prim_indices_.empty();
+    }
+
+    [[nodiscard]] std::span<const node> nodes() const
+    {
+        return nodes_;
+    }
+
+    [[nodiscard]] std::span<const uint32_t> prim_indices() const
+    {
+        return prim_indices_;
+    }
+
+    // 节点 + 图元下标占用的字节数
+    [[nodiscard]] size_t memory_bytes() const
+    {
+        return (nodes_.size() * sizeof(node)) +
+               (prim_indices_.size() * sizeof(uint32_t)) + sizeof(box3);
+    }
+
+    [[nodiscard]] aabb bounds() const
+    {
+        if (empty())
+            return aabb::empty;
+        return {point3(root_box_.min[0], root_box_.min[1], root_box_.min[2]),
+                point3(root_box_.max[0], root_box_.max[1], root_box_.max[2])};
+    }
+
+    // 与 flat_bvh::closest_hit 相同的接口：hit_prim(prim, ray_t) 命中时负责缩短 ray_t.max
+    template <typename F>
+    bool closest_hit(const ray &r, interval ray_t, F &&hit_prim) const
+    {
+        return traverse<false>(r, ray_t, hit_prim);
+    }
+
+    // 与 flat_bvh::any_hit 相同：hit_prim 返回 true（图元挡住了 ray_t）时立即结束
+    template <typename F>
+    bool any_hit(const ray &r, interval ray_t, F &&hit_prim) const
+    {
+        return traverse<true>(r, ray_t, hit_prim);
+    }
+
+  private:
+    static constexpr float k_levels = static_cast<float>(std::numeric_limits<Q>::max());
+
+    template <bool AnyHit, typename F>
+    bool traverse(const ray &r, interval ray_t, F &hit_prim) const
+    {
+        if (empty())
+            return false;
+
+        const vec3 inv_dir(1.0 / r.direction().x(), 1.0 / r.direction().y(),
+                           1.0 / r.direction().z());
+        double t_enter = 0;
+        count_stat(render_stat::ray_box_tests);
+        if (!hit_box(root_box_, r.origin(), inv_dir, ray_t, t_enter))
+            return false;
+
+        struct entry
+        {
+            uint32_t ref;
+            double t_enter;
+            box3 box; // ref 是内部节点时，它自己的（解码后的）包围盒
+        };
+        std::array<entry, flat_bvh::k_max_depth> stack; // NOLINT
+        int top = 0;
+
+        bool hit_anything = false;
+        entry current{root_, t_enter, root_box_};
+        while (true)
+        {
+            count_stat(render_stat::bvh_nodes_visited);
+            if ((current.ref & k_leaf_flag) != 0)
+            {
+                auto offset = current.ref & (k_max_prims - 1);
+                auto count = ((current.ref & ~k_leaf_flag) >> k_offset_bits) + 1;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    bool hit = hit_prim(prim_indices_[offset + i], ray_t);
+                    if constexpr (AnyHit)
+                    {
+                        if (hit)
+                            return true;
+                    }
+                    hit_anything |= hit;
+                }
+            }
+            else
+            {
+                const auto &n = nodes_[current.ref];
+                auto box0 = decode(current.box, n.lo[0], n.hi[0]);
+                auto box1 = decode(current.box, n.lo[1], n.hi[1]);
+                double t0 = 0;
+                double t1 = 0;
+                count_stat(render_stat::ray_box_tests, 2);
+                bool hit0 = hit_box(box0, r.origin(), inv_dir, ray_t, t0);
+                bool hit1 = hit_box(box1, r.origin(), inv_dir, ray_t, t1);
+                if (hit0 && hit1)
+                {
+                    // 先走近的孩子，远的入栈
+                    if (t1 < t0)
+                    {
+                        stack[top++] = {n.child[0], t0, box0};
+                        current = {n.child[1], t1, box1};
+                    }
+                    else
+                    {
+                        stack[top++] = {n.child[1], t1, box1};
+                        current = {n.child[0], t0, box0};
+                    }
+                    continue;
+                }
+                if (hit0 || hit1)
+                {
+                    current = hit0 ? entry{n.child[0], t0, box0}
+                                   : entry{n.child[1], t1, box1};
+                    continue;
+                }
+            }
+
+            // 出栈；入栈之后找到了更近的命中，远处的节点可以直接跳过
+            do
+            {
+                if (top == 0)
+                    return hit_anything;
+                current = stack[--top];
+            } while (current.t_enter > ray_t.max);
+        }
+    }
+
+    struct box3
+    {
+        float min[3]; // NOLINT
+        float max[3]; // NOLINT
+    };
+
+    std::vector<node> nodes_;
+    std::vector<uint32_t> prim_indices_;
+    uint32_t root_ = 0;
+    box3 root_box_{};
+
+    static box3 box_of(const flat_bvh_node &n)
+    {
+        return {{n.min[0], n.min[1], n.min[2]}, {n.max[0], n.max[1], n.max[2]}};
+    }
+
+    // NOTE: 编码和遍历必须用同一个函数解码，编码时的保守性检查才对遍历有效
+    static float decode_min(const box3 &parent, int axis, Q q)
+    {
+        float scale = (parent.max[axis] - parent.min[axis]) / k_levels;
+        return parent.min[axis] + (static_cast<float>(q) * scale);
+    }
+
+    static float decode_max(const box3 &parent, int axis, Q q)
+    {
+        // 最大值直接取父节点的上界，避免 min + levels * scale 舍入后比 max 小
+        if (q == std::numeric_limits<Q>::max())
+            return parent.max[axis];
+        float scale = (parent.max[axis] - parent.min[axis]) / k_levels;
+        return parent.min[axis] + (static_cast<float>(q) * scale);
+    }
+
+    static box3 decode(const box3 &parent, const Q (&lo)[3], const Q (&hi)[3])
+    {
+        box3 b;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            b.min[axis] = decode_min(parent, axis, lo[axis]);
+            b.max[axis] = decode_max(parent, axis, hi[axis]);
+        }
+        return b;
+    }
+
+    // 量化一个孩子：先按比例估算，再用解码函数逐步修正，直到解码结果包住真实盒子
+    static void quantize(const box3 &parent, const box3 &child, Q (&lo)[3], Q (&hi)[3])
+    {
+        constexpr auto k_max = std::numeric_limits<Q>::max();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            // 多留 1 ulp，编译器对解码表达式用不用 FMA 不影响保守性
+            auto child_min = std::nextafter(child.min[axis], -INFINITY);
+            auto child_max = std::nextafter(child.max[axis], INFINITY);
+            float extent = parent.max[axis] - parent.min[axis];
+            if (!(extent > 0))
+            {
+                lo[axis] = 0;
+                hi[axis] = k_max;
+                continue;
+            }
+
+            auto to_level = [&](float x) {
+                return static_cast<double>(x - parent.min[axis]) / extent * k_levels;
+            };
+            auto l = std::clamp(std::floor(to_level(child_min)), 0.0, double(k_max));
+            auto h = std::clamp(std::ceil(to_level(child_max)), 0.0, double(k_max));
+            lo[axis] = static_cast<Q>(l);
+            hi[axis] = static_cast<Q>(h);
+            while (lo[axis] > 0 && decode_min(parent, axis, lo[axis]) > child_min)
+                lo[axis]--;
+            while (hi[axis] < k_max && decode_max(parent, axis, hi[axis]) < child_max)
+                hi[axis]++;
+        }
+    }
+
+    // 编码 source[index]（它的包围盒按解码结果为 frame），把它的引用写到 ref
+    bool encode(std::span<const flat_bvh_node> source, uint32_t index, const box3 &frame,
+                uint32_t &ref)
+    {
+        const auto &n = source[index];
+        if (n.count > 0)
+        {
+            if (n.count > k_max_leaf_size)
+                return false;
+            ref = k_leaf_flag | ((n.count - 1U) << k_offset_bits) | n.offset;
+            return true;
+        }
+
+        ref = static_cast<uint32_t>(nodes_.size());
+        nodes_.push_back({});
+        uint32_t children[2] = {index + 1, n.offset};
+        for (int c = 0; c < 2; c++)
+        {
+            quantize(frame, box_of(source[children[c]]), nodes_[ref].lo[c],
+                     nodes_[ref].hi[c]);
+            auto child_frame = decode(frame, nodes_[ref].lo[c], nodes_[ref].hi[c]);
+            uint32_t child_ref = 0;
+            if (!encode(source, children[c], child_frame, child_ref))
+                return false;
+            nodes_[ref].child[c] = child_ref;
+        }
+        return true;
+    }
+
+    static bool hit_box(const box3 &box, const point3 &origin, const vec3 &inv_dir,
+                        const interval &ray_t, double &t_enter)
+    {
+        double t_min = ray_t.min;
+        double t_max = ray_t.max;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto t0 = (box.min[axis] - origin[axis]) * inv_dir[axis];
+            auto t1 = (box.max[axis] - origin[axis]) * inv_dir[axis];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            t_min = std::max(t0, t_min);
+            t_max = std::min(t1, t_max);
+            if (t_max <= t_min)
+                return false;
+        }
+        t_enter = t_min;
+        return true;
+    }
+};
+
+using quantized_bvh8 = quantized_bvh<uint8_t>;   // NOLINT
+using quantized_bvh16 = quantized_bvh<uint16_t>; // NOLINT
+
+/*
+NOTE: 用 quantized_bvh 加速一组 hittable，用法与 flat_bvh_accel 相同。
+*/
+template <typename Q>
+class quantized_bvh_accel : public hittable // NOLINT
+{
+  public:
+    explicit quantized_bvh_accel(const hittable_list &list, int max_leaf_size = 2)
+        : objects_(list.objects)
+    {
+        std::vector<aabb> boxes;
+        boxes.reserve(objects_.size());
+        for (const auto &object : objects_)
+            boxes.push_back(object->bounding_box());
+        bvh_ = quantized_bvh<Q>::build(boxes, max_leaf_size);
+        bbox_ = bvh_.bounds();
+    }
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        return bvh_.closest_hit(r, ray_t, [&](uint32_t prim, interval &t) {
+            if (!objects_[prim]->intersect(r, t, rec))
+                return false;
+            t.max = rec.t;
+            return true;
+        });
+    }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        return bvh_.any_hit(r, ray_t, [&](uint32_t prim, const interval &t) {
+            return objects_[prim]->occluded(r, t);
+        });
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        for (const auto &object : objects_)
+            object->collect_materials(out);
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return bbox_;
+    }
+
+    [[nodiscard]] const quantized_bvh<Q> &bvh() const
+    {
+        return bvh_;
+    }
+
+  private:
+    std::vector<std::shared_ptr<hittable>> objects_;
+    quantized_bvh<Q> bvh_;
+    aabb bbox_;
+};
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <cstdint>
 #include <random>
 
+// NOTE: 每个线程一个随机数引擎：多个 jthread 同时渲染时不会争用同一个引擎
+inline std::mt19937 &random_engine()
+{
+    thread_local std::mt19937 generator(std::random_device{}());
+    return generator;
+}
+
+// NOTE: 固定当前线程的随机种子。benchmark 和需要可复现结果的渲染在构建场景、渲染之前调用
+inline void seed_random(uint32_t seed)
+{
+    random_engine().seed(seed);
+}
+
 constexpr double random_double()
 {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator(std::random_device{}());
-    return distribution(generator);
+    thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(random_engine());
 }
 
 constexpr double random_double(double min, double max)
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "camera.hpp"
+#include "constant_medium.hpp"
+#include "hittable_list.hpp"
+#include "quad.hpp"
+#include "scene_arena.hpp"
+#include "sphere.hpp"
+
+/*
+NOTE: 参考场景
+与 test_bvh / test_cornell_box / test_cornell_smoke / test_perlin_spheres / test_final_scene
+中的场景相同，但只构建物体列表和相机，不构建 BVH、不渲染。
+benchmark 需要分开计时"场景构建"和"BVH 构建"，也需要在固定随机种子下重复构建同一个场景。
+camera 里是原测试的设置（分辨率、采样数由调用者按需覆盖）。
+*/
+struct reference_scene // NOLINT
+{
+    std::string name;
+    hittable_list world;
+    camera cam;
+    bool sky = false; // true：用 camera::render（天空渐变背景）；false：render_with_background
+};
+
+// 场景内部嵌套的加速结构（例如 final_scene 的地面箱子）由调用者决定用哪种、并负责计时
+using accel_builder = std::function<std::shared_ptr<hittable>(const hittable_list &)>;
+
+inline camera cornell_camera()
+{
+    camera cam;
+    cam.aspect_ratio = 1.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 100;
+    cam.max_depth = 50;
+    cam.background = color(0, 0, 0);
+
+    cam.vfov = 40;
+    cam.lookfrom = point3(278, 278, -800);
+    cam.lookat = point3(278, 278, 0);
+    cam.vup = vec3(0, 1, 0);
+
+    cam.defocus_angle = 0;
+    return cam;
+}
+
+// test_bvh.cpp：随机小球 + 三个大球
+inline reference_scene bvh_scene()
+{
+    reference_scene scene{"bvh", {}, {}, true};
+    auto &world = scene.world;
+
+    auto ground_material = std::make_shared<lambertian>(color(0.5, 0.5, 0.5));
+    world.add(std::make_shared<sphere>(point3(0, -1000, 0), 1000, ground_material));
+
+    for (int a = -11; a < 11; a++)
+    {
+        for (int b = -11; b < 11; b++)
+        {
+            auto choose_mat = random_double();
+            point3 center(a + (0.9 * random_double()), 0.2, b + (0.9 * random_double()));
+            if ((center - point3(4, 0.2, 0)).length() <= 0.9)
+                continue;
+
+            if (choose_mat < 0.8)
+            {
+                auto albedo = color::random() * color::random();
+                auto center2 = center + vec3(0, random_double(0, .5), 0);
+                world.add(std::make_shared<sphere>(center, center2, 0.2,
+                                                   std::make_shared<lambertian>(albedo)));
+            }
+            else if (choose_mat < 0.95)
+            {
+                auto albedo = color::random(0.5, 1);
+                auto fuzz = random_double(0, 0.5);
+                world.add(std::make_shared<sphere>(
+                    center, 0.2, std::make_shared<metal>(albedo, fuzz)));
+            }
+            else
+            {
+                world.add(std::make_shared<sphere>(center, 0.2,
+                                                   std::make_shared<dielectric>(1.5)));
+            }
+        }
+    }
+
+    world.add(std::make_shared<sphere>(point3(0, 1, 0), 1.0,
+                                       std::make_shared<dielectric>(1.5)));
+    world.add(std::make_shared<sphere>(
+        point3(-4, 1, 0), 1.0, std::make_shared<lambertian>(color(0.4, 0.2, 0.1))));
+    world.add(std::make_shared<sphere>(
+        point3(4, 1, 0), 1.0, std::make_shared<metal>(color(0.7, 0.6, 0.5), 0.0)));
+
+    auto &cam = scene.cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 100;
+    cam.max_depth = 50;
+
+    cam.vfov = 20;
+    cam.lookfrom = point3(13, 2, 3);
+    cam.lookat = point3(0, 0, 0);
+    cam.vup = vec3(0, 1, 0);
+
+    cam.defocus_angle = 0.6;
+    cam.focus_dist = 10.0;
+    return scene;
+}
+
+// test_texture.cpp：bvh 场景，地面球换成棋盘格纹理（材质、纹理求值占比更高的场景）
+inline reference_scene texture_scene()
+{
+    auto scene = bvh_scene();
+    scene.name = "texture";
+    auto checker =
+        std::make_shared<checker_texture>(0.32, color(.2, .3, .1), color(.9, .9, .9));
+    scene.world.objects.front() = std::make_shared<sphere>(
+        point3(0, -1000, 0), 1000, std::make_shared<lambertian>(checker));
+    return scene;
+}
+
+// 康奈尔盒子的五面墙和顶灯
+inline void add_cornell_walls(hittable_list &world, const color &light_color,
+                              bool small_light)
+{
+    auto red = std::make_shared<lambertian>(color(.65, .05, .05));
+    auto white = std::make_shared<lambertian>(color(.73, .73, .73));
+    auto green = std::make_shared<lambertian>(color(.12, .45, .15));
+    auto light = std::make_shared<diffuse_light>(light_color);
+
+    world.add(
+        make_shared<quad>(point3(555, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), green));
+    world.add(make_shared<quad>(point3(0, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), red));
+    if (small_light)
+        world.add(make_shared<quad>(point3(343, 554, 332), vec3(-130, 0, 0),
+                                    vec3(0, 0, -105), light));
+    else
+        world.add(make_shared<quad>(point3(113, 554, 127), vec3(330, 0, 0),
+                                    vec3(0, 0, 305), light));
+    world.add(
+        make_shared<quad>(point3(0, 0, 0), vec3(555, 0, 0), vec3(0, 0, 555), white));
+    world.add(make_shared<quad>(point3(555, 555, 555), vec3(-555, 0, 0), vec3(0, 0, -555),
+                                white));
+    world.add(
+        make_shared<quad>(point3(0, 0, 555), vec3(555, 0, 0), vec3(0, 555, 0), white));
+}
+
+// 旋转后的两个箱子，位置与 test_cornell_box.cpp 相同
+inline std::pair<std::shared_ptr<hittable>, std::shared_ptr<hittable>>
+cornell_boxes(const std::shared_ptr<material> &mat)
+{
+    std::shared_ptr<hittable> box1 = box(point3(0, 0, 0), point3(165, 330, 165), mat);
+    box1 = make_shared<rotate_y>(box1, 15);
+    box1 = make_shared<translate>(box1, vec3(265, 0, 295));
+
+    std::shared_ptr<hittable> box2 = box(point3(0, 0, 0), point3(165, 165, 165), mat);
+    box2 = make_shared<rotate_y>(box2, -18);
+    box2 = make_shared<translate>(box2, vec3(130, 0, 65));
+    return {box1, box2};
+}
+
+// test_cornell_box.cpp：两个旋转的箱子
+inline reference_scene cornell_box_scene()
+{
+    reference_scene scene{"cornell_box", {}, cornell_camera(), false};
+    add_cornell_walls(scene.world, color(15, 15, 15), true);
+
+    auto [box1, box2] = cornell_boxes(std::make_shared<lambertian>(color(.73, .73, .73)));
+    scene.world.add(box1);
+    scene.world.add(box2);
+    return scene;
+}
+
+// test_cornell_smoke.cpp：箱子换成烟雾，灯更大更暗
+inline reference_scene cornell_smoke_scene()
+{
+    reference_scene scene{"cornell_smoke", {}, cornell_camera(), false};
+    add_cornell_walls(scene.world, color(7, 7, 7), false);
+
+    auto [box1, box2] = cornell_boxes(std::make_shared<lambertian>(color(.73, .73, .73)));
+    scene.world.add(std::make_shared<constant_medium>(box1, 0.01, color(0, 0, 0)));
+    scene.world.add(std::make_shared<constant_medium>(box2, 0.01, color(1, 1, 1)));
+    return scene;
+}
+
+// test_perlin_spheres.cpp：地面和球都用 Perlin 噪声纹理
+inline reference_scene perlin_scene()
+{
+    reference_scene scene{"perlin", {}, {}, true};
+
+    auto pertext = std::make_shared<noise_texture_nosmooth>();
+    scene.world.add(make_shared<sphere>(point3(0, -1000, 0), 1000,
+                                        make_shared<lambertian>(pertext)));
+    scene.world.add(
+        make_shared<sphere>(point3(0, 2, 0), 2, make_shared<lambertian>(pertext)));
+
+    auto &cam = scene.cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 100;
+    cam.max_depth = 50;
+
+    cam.vfov = 20;
+    cam.lookfrom = point3(13, 2, 3);
+    cam.lookat = point3(0, 0, 0);
+    cam.vup = vec3(0, 1, 0);
+
+    cam.defocus_angle = 0;
+    return scene;
+}
+
+// test_final_scene.cpp：地面箱子、运动球、玻璃/金属球、次表面、薄雾、地球、大理石和 1000 个小球
+// arena 不为空时物体、材质、纹理都从它分配，arena 必须比返回的场景活得久（见 scene_arena.hpp）
+inline reference_scene final_scene(const accel_builder &build_accel,
+                                   scene_arena *arena = nullptr)
+{
+    reference_scene scene{"final_scene", {}, {}, false};
+    auto &world = scene.world;
+
+    hittable_list boxes1;
+    auto ground = arena_make<lambertian>(arena, color(0.48, 0.83, 0.53));
+    int boxes_per_side = 20;
+    for (int i = 0; i < boxes_per_side; i++)
+    {
+        for (int j = 0; j < boxes_per_side; j++)
+        {
+            auto w = 100.0;
+            auto x0 = -1000.0 + (i * w);
+            auto z0 = -1000.0 + (j * w);
+            auto y0 = 0.0;
+            auto x1 = x0 + w;
+            auto y1 = random_double(1, 101);
+            auto z1 = z0 + w;
+            boxes1.add(arena_make<axis_aligned_box>(arena, point3(x0, y0, z0),
+                                                  point3(x1, y1, z1), ground));
+        }
+    }
+    world.add(build_accel(boxes1));
+
+    auto light = arena_make<diffuse_light>(arena, color(7, 7, 7));
+    world.add(arena_make<quad>(arena, point3(123, 554, 147), vec3(300, 0, 0),
+                               vec3(0, 0, 265), light));
+
+    auto center1 = point3(400, 400, 200);
+    auto center2 = center1 + vec3(30, 0, 0);
+    auto sphere_material = arena_make<lambertian>(arena, color(0.7, 0.3, 0.1));
+    world.add(arena_make<sphere>(arena, center1, center2, 50, sphere_material));
+
+    world.add(arena_make<sphere>(arena, point3(260, 150, 45), 50,
+                                 arena_make<dielectric>(arena, 1.5)));
+    world.add(arena_make<sphere>(arena, point3(0, 150, 145), 50,
+                                 arena_make<metal>(arena, color(0.8, 0.8, 0.9), 1.0)));
+
+    auto boundary = arena_make<sphere>(arena, point3(360, 150, 145), 70,
+                                       arena_make<dielectric>(arena, 1.5));
+    world.add(boundary);
+    world.add(arena_make<constant_medium>(arena, boundary, 0.2, color(0.2, 0.4, 0.9)));
+    boundary = arena_make<sphere>(arena, point3(0, 0, 0), 5000,
+                                  arena_make<dielectric>(arena, 1.5));
+    world.add(arena_make<constant_medium>(arena, boundary, .0001, color(1, 1, 1)));
+
+    auto emat =
+        arena_make<lambertian>(arena, arena_make<image_texture>(arena, "earthmap.jpg"));
+    world.add(arena_make<sphere>(arena, point3(400, 200, 400), 100, emat));
+    auto pertext = arena_make<noise_texture_with_vec_and_turb_phase>(arena, 0.2);
+    world.add(arena_make<sphere>(arena, point3(220, 280, 300), 80,
+                                 arena_make<lambertian>(arena, pertext)));
+
+    hittable_list boxes2;
+    auto white = arena_make<lambertian>(arena, color(.73, .73, .73));
+    int ns = 1000;
+    for (int j = 0; j < ns; j++)
+        boxes2.add(arena_make<sphere>(arena, point3::random(0, 165), 10, white));
+    auto rotated = arena_make<rotate_y>(arena, build_accel(boxes2), 15);
+    world.add(arena_make<translate>(arena, rotated, vec3(-100, 270, 395)));
+
+    auto &cam = scene.cam;
+    cam.aspect_ratio = 1.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 250;
+    cam.max_depth = 4;
+    cam.background = color(0, 0, 0);
+
+    cam.vfov = 40;
+    cam.lookfrom = point3(478, 278, -600);
+    cam.lookat = point3(278, 278, 0);
+    cam.vup = vec3(0, 1, 0);
+
+    cam.defocus_angle = 0;
+    return scene;
+}
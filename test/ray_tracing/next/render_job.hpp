@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "accumulation_buffer.hpp"
+#include "camera.hpp"
+
+/*
+NOTE: 异步渲染任务
+camera::render* 阻塞调用者直到整幅图渲染完。render_job 在构造时把渲染交给后台线程，马上返回句柄：
+    cancel()      请求取消；正在渲染的 tile 渲染完后线程退出，所以延迟最多是一个 tile
+    progress()    已完成的 tile 数、样本数、耗时，任何线程随时可以查询
+    next_tile()   从有界队列取下一个完成的 tile（阻塞）；任务结束且队列为空时返回空
+    wait()        等任务结束，返回 finished 或 cancelled
+    result()      等任务结束，返回合并后的累加缓冲区；取消时只有已完成的 tile 有样本
+析构时自动取消并等线程退出，丢掉句柄就等于中止任务。
+
+图像切成 tile_size x tile_size 的块，工作线程按行优先的顺序领取，每块用 camera::render_partial 渲染，
+所以哈希采样器（stratified / halton / sobol）的结果与 camera::render 逐位相同，与线程数无关。
+
+完成的 tile 有两种交付方式，可以同时用：
+    on_event 回调：started / tile / finished / cancelled 事件，带进度快照，取代 std::clog 的扫描行计数。
+                  在工作线程里调用（started 在构造函数里），同一时刻只有一个回调在执行，回调里不需要加锁；
+                  回调应该很快，它会拖住调用它的工作线程。
+    有界队列：tile_queue_capacity > 0 时每个 tile 也放进队列。队列满时工作线程等待（背压），
+              消费者跟不上时渲染变慢，而不是无限占用内存；取消会唤醒等待的线程。
+*/
+enum class render_status // NOLINT
+{
+    running,
+    finished,
+    cancelled,
+};
+
+struct render_progress // NOLINT
+{
+    int tiles_done = 0;
+    int tiles_total = 0;
+    uint64_t samples_done = 0; // 像素样本数
+    uint64_t samples_total = 0;
+    double elapsed_seconds = 0;
+
+    [[nodiscard]] double fraction() const
+    {
+        return tiles_total > 0 ? static_cast<double>(tiles_done) / tiles_total : 1.0;
+    }
+};
+
+enum class render_event_type // NOLINT
+{
+    started,
+    tile,
+    finished,
+    cancelled,
+};
+
+struct render_event // NOLINT
+{
+    render_event_type type = render_event_type::started;
+    render_progress progress;
+    const accumulation_buffer *tile = nullptr; // 只有 tile 事件不为空，回调返回后失效
+};
+
+struct render_job_options // NOLINT
+{
+    int tile_size = 32;
+    int threads = 0;                // 0 表示 std::thread::hardware_concurrency()
+    size_t tile_queue_capacity = 0; // 0 表示不用队列，只用回调
+    std::function<void(const render_event &)> on_event;
+};
+
+class render_job // NOLINT
+{
+  public:
+    render_job() = default;
+
+    // world 由任务共同持有，调用者可以在任务结束前释放自己的引用
+    render_job(const camera &cam, std::shared_ptr<const hittable> world,
+               bool use_background, render_job_options options = {})
+        : state_(std::make_unique<state>())
+    {
+        auto &s = *state_;
+        s.cam = cam;
+        s.cam.show_progress = false;
+        s.world = std::move(world);
+        // 材质表只编译一次，所有 tile 共用
+        if (s.cam.compiled_materials && !s.cam.materials)
+            s.cam.materials = std::make_shared<material_table>(*s.world);
+        s.use_background = use_background;
+        s.options = std::move(options);
+
+        auto width = cam.image_width;
+        auto height = cam.image_height();
+        auto spp = cam.samples_per_pixel;
+        auto tile_size = std::max(1, s.options.tile_size);
+        for (int y = 0; y < height; y += tile_size)
+            for (int x = 0; x < width; x += tile_size)
+                s.tiles.push_back({x, y, std::min(x + tile_size, width),
+                                   std::min(y + tile_size, height), 0, spp});
+        s.result =
+            accumulation_buffer(width, height, render_region::full(width, height, spp));
+        s.progress.tiles_total = static_cast<int>(s.tiles.size());
+        s.progress.samples_total = static_cast<uint64_t>(width) * height * spp;
+        s.begin = std::chrono::steady_clock::now();
+        s.emit({render_event_type::started, s.progress, nullptr});
+
+        auto threads = s.options.threads > 0
+                           ? s.options.threads
+                           : static_cast<int>(std::thread::hardware_concurrency());
+        threads = std::clamp(threads, 1, std::max(1, s.progress.tiles_total));
+        s.active_workers = threads;
+        for (int t = 0; t < threads; t++)
+            threads_.emplace_back([&s] { work(s); });
+    }
+
+    render_job(render_job &&) noexcept = default;
+
+    // 覆盖一个正在运行的任务时先中止它
+    render_job &operator=(render_job &&other) noexcept
+    {
+        if (this != &other)
+        {
+            cancel();
+            threads_.clear();
+            state_ = std::move(other.state_);
+            threads_ = std::move(other.threads_);
+        }
+        return *this;
+    }
+
+    render_job(const render_job &) = delete;
+    render_job &operator=(const render_job &) = delete;
+
+    ~render_job()
+    {
+        cancel();
+    }
+
+    void cancel()
+    {
+        if (!state_)
+            return;
+        state_->stop.request_stop();
+        state_->changed.notify_all();
+    }
+
+    [[nodiscard]] bool done() const
+    {
+        if (!state_)
+            return true;
+        std::scoped_lock lock(state_->mutex);
+        return state_->status != render_status::running;
+    }
+
+    [[nodiscard]] render_progress progress() const
+    {
+        if (!state_)
+            return {};
+        std::scoped_lock lock(state_->mutex);
+        auto progress = state_->progress;
+        if (state_->status == render_status::running)
+            progress.elapsed_seconds = state_->elapsed();
+        return progress;
+    }
+
+    std::optional<accumulation_buffer> next_tile()
+    {
+        if (!state_)
+            return std::nullopt;
+        auto &s = *state_;
+        std::unique_lock lock(s.mutex);
+        s.changed.wait(lock, [&s] {
+            return !s.queue.empty() || s.status != render_status::running;
+        });
+        if (s.queue.empty())
+            return std::nullopt;
+        auto tile = std::move(s.queue.front());
+        s.queue.pop_front();
+        s.changed.notify_all(); // 队列有空位了
+        return tile;
+    }
+
+    render_status wait()
+    {
+        if (!state_)
+            return render_status::cancelled;
+        auto &s = *state_;
+        std::unique_lock lock(s.mutex);
+        s.changed.wait(lock, [&s] { return s.status != render_status::running; });
+        return s.status;
+    }
+
+    accumulation_buffer result()
+    {
+        if (!state_)
+            return {};
+        wait();
+        std::scoped_lock lock(state_->mutex);
+        return state_->result;
+    }
+
+  private:
+    struct state
+    {
+        camera cam;
+        std::shared_ptr<const hittable> world;
+        bool use_background = false;
+        render_job_options options;
+        std::vector<render_region> tiles;
+        std::atomic<size_t> next_tile{0};
+        std::stop_source stop;
+        std::chrono::steady_clock::time_point begin;
+
+        // mutex 保护下面这些；changed 在状态、队列变化和取消时通知
+        std::mutex mutex;
+        std::condition_variable_any changed;
+        accumulation_buffer result;
+        std::deque<accumulation_buffer> queue;
+        render_progress progress;
+        int active_workers = 0;
+        render_status status = render_status::running;
+
+        std::mutex event_mutex; // 回调一次只执行一个
+
+        [[nodiscard]] double elapsed() const
+        {
+            auto d = std::chrono::steady_clock::now() - begin;
+            return std::chrono::duration<double>(d).count();
+        }
+
+        void emit(const render_event &event)
+        {
+            if (!options.on_event)
+                return;
+            std::scoped_lock lock(event_mutex);
+            options.on_event(event);
+        }
+    };
+
+    std::unique_ptr<state> state_;
+    std::vector<std::jthread> threads_; // 在 state_ 之前析构：先等线程退出
+
+    static void work(state &s)
+    {
+        auto cam = s.cam; // render_partial 会调用 initialize()，每个线程一份
+        auto stop = s.stop.get_token();
+        auto capacity = s.options.tile_queue_capacity;
+        while (!stop.stop_requested())
+        {
+            auto index = s.next_tile.fetch_add(1);
+            if (index >= s.tiles.size())
+                break;
+            const auto &region = s.tiles[index];
+            auto tile = cam.render_partial(*s.world, s.use_background, region);
+
+            render_progress snapshot;
+            {
+                std::scoped_lock lock(s.mutex);
+                s.result.merge(tile);
+                s.progress.tiles_done++;
+                s.progress.samples_done += static_cast<uint64_t>(region.width()) *
+                                           region.height() * region.samples();
+                s.progress.elapsed_seconds = s.elapsed();
+                snapshot = s.progress;
+            }
+            s.emit({render_event_type::tile, snapshot, &tile});
+
+            if (capacity > 0)
+            {
+                std::unique_lock lock(s.mutex);
+                auto has_room = [&] { return s.queue.size() < capacity; };
+                if (!s.changed.wait(lock, stop, has_room))
+                    break;
+                s.queue.push_back(std::move(tile));
+                s.changed.notify_all();
+            }
+        }
+
+        // 最后一个退出的线程发结束事件，然后才把状态改成结束，wait() 返回时所有回调都已执行完
+        {
+            std::scoped_lock lock(s.mutex);
+            if (--s.active_workers > 0)
+                return;
+            s.progress.elapsed_seconds = s.elapsed();
+        }
+        auto finished = s.progress.tiles_done == s.progress.tiles_total;
+        s.emit({finished ? render_event_type::finished : render_event_type::cancelled,
+                s.progress, nullptr});
+        std::scoped_lock lock(s.mutex);
+        s.status = finished ? render_status::finished : render_status::cancelled;
+        s.changed.notify_all();
+    }
+};
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "render_job.hpp"
+#include "sampler.hpp"
+
+/*
+NOTE: 多个渲染任务共用一个线程池
+render_job 每个任务自己开线程：同时跑一个预览和一个最终渲染时，两边各占一半的线程，
+预览先做完后它的线程就闲着，最终渲染用不上；也没有办法让预览先做。
+render_scheduler 持有一组工作线程，任务（场景 + 相机 + 优先级）提交后切成 tile，
+tile 轮流分到各个线程的本地队列里，队列按（优先级从高到低，提交顺序）排好：
+    工作线程每次取所有队列的队首里优先级最高的 tile，优先级相同时先取自己的队列，
+    自己的队列空了就从别的线程那里偷（work stealing），所以一个任务做完后所有线程马上转去做剩下的任务
+    抢占发生在 tile 边界：正在渲染的 tile 渲染完后，线程先去做更高优先级任务的 tile，
+    低优先级的任务只是暂停，不丢已经完成的 tile
+每个 tile 渲染前用 (seed, tile 序号) 重置本线程的随机引擎（介质、运动模糊等用它），
+所以结果只取决于任务本身，与线程数、调度顺序、同时还有哪些任务无关。
+
+任务句柄 scheduled_render 与 render_job 的接口相同：cancel / progress / wait / result，
+事件回调 on_event 也相同（同一个任务的回调不会同时执行）。
+resume 不为空时，样本数已经够的 tile 直接从 resume 复制，不再渲染（断点续渲）。
+*/
+struct render_request // NOLINT
+{
+    camera cam;
+    std::shared_ptr<const hittable> world;
+    bool use_background = false;
+    int priority = 0; // 越大越先渲染
+    int tile_size = 32;
+    uint32_t seed = 0;
+    accumulation_buffer resume;
+    std::function<void(const render_event &)> on_event;
+};
+
+class render_scheduler; // NOLINT
+
+class scheduled_render // NOLINT
+{
+  public:
+    scheduled_render() = default;
+
+    void cancel()
+    {
+        if (state_)
+            state_->cancelled = true;
+    }
+
+    [[nodiscard]] bool done() const
+    {
+        if (!state_)
+            return true;
+        std::scoped_lock lock(state_->mutex);
+        return state_->status != render_status::running;
+    }
+
+    [[nodiscard]] int priority() const
+    {
+        return state_ ? state_->request.priority : 0;
+    }
+
+    [[nodiscard]] render_progress progress() const
+    {
+        if (!state_)
+            return {};
+        std::scoped_lock lock(state_->mutex);
+        auto progress = state_->progress;
+        if (state_->status == render_status::running)
+            progress.elapsed_seconds = state_->elapsed();
+        return progress;
+    }
+
+    render_status wait()
+    {
+        if (!state_)
+            return render_status::cancelled;
+        auto &s = *state_;
+        std::unique_lock lock(s.mutex);
+        s.changed.wait(lock, [&s] { return s.status != render_status::running; });
+        return s.status;
+    }
+
+    accumulation_buffer result()
+    {
+        if (!state_)
+            return {};
+        wait();
+        std::scoped_lock lock(state_->mutex);
+        return state_->result;
+    }
+
+  private:
+    friend class render_scheduler;
+
+    struct state
+    {
+        render_request request;
+        std::vector<render_region> tiles;
+        std::atomic<bool> cancelled{false};
+        std::chrono::steady_clock::time_point begin;
+
+        // mutex 保护下面这些
+        std::mutex mutex;
+        std::condition_variable changed;
+        accumulation_buffer result;
+        render_progress progress;
+        int tiles_left = 0; // 还没渲染也没跳过的 tile
+        bool skipped = false;
+        render_status status = render_status::running;
+
+        std::mutex event_mutex;
+
+        [[nodiscard]] double elapsed() const
+        {
+            auto d = std::chrono::steady_clock::now() - begin;
+            return std::chrono::duration<double>(d).count();
+        }
+
+        void emit(const render_event &event)
+        {
+            if (!request.on_event)
+                return;
+            std::scoped_lock lock(event_mutex);
+            request.on_event(event);
+        }
+    };
+
+    explicit scheduled_render(std::shared_ptr<state> s) : state_(std::move(s))
+    {
+    }
+
+    std::shared_ptr<state> state_;
+};
+
+class render_scheduler // NOLINT
+{
+  public:
+    // threads = 0 表示 std::thread::hardware_concurrency()
+    explicit render_scheduler(int threads = 0)
+    {
+        auto count = threads > 0 ? threads
+                                 : static_cast<int>(std::thread::hardware_concurrency());
+        count = std::max(1, count);
+        queues_ = std::vector<worker_queue>(static_cast<size_t>(count));
+        for (int i = 0; i < count; i++)
+            workers_.emplace_back([this, i](std::stop_token stop) { work(stop, i); });
+    }
+
+    render_scheduler(const render_scheduler &) = delete;
+    render_scheduler &operator=(const render_scheduler &) = delete;
+
+    // 先停线程，再把没渲染的 tile 当作取消处理，等待中的 wait() 都会返回
+    ~render_scheduler()
+    {
+        for (auto &worker : workers_)
+            worker.request_stop();
+        {
+            std::scoped_lock lock(idle_mutex_);
+            idle_.notify_all();
+        }
+        workers_.clear();
+        for (auto &queue : queues_)
+        {
+            for (auto &task : queue.tasks)
+                finish_tile(*task.job, nullptr);
+            queue.tasks.clear();
+        }
+    }
+
+    [[nodiscard]] int threads() const
+    {
+        return static_cast<int>(queues_.size());
+    }
+
+    scheduled_render submit(render_request request)
+    {
+        auto job = std::make_shared<scheduled_render::state>();
+        auto &s = *job;
+        s.request = std::move(request);
+        s.request.cam.show_progress = false;
+        // 材质表只编译一次，所有 tile 共用
+        if (s.request.cam.compiled_materials && !s.request.cam.materials)
+            s.request.cam.materials = std::make_shared<material_table>(*s.request.world);
+
+        auto width = s.request.cam.image_width;
+        auto height = s.request.cam.image_height();
+        auto spp = s.request.cam.samples_per_pixel;
+        auto tile_size = std::max(1, s.request.tile_size);
+        for (int y = 0; y < height; y += tile_size)
+            for (int x = 0; x < width; x += tile_size)
+                s.tiles.push_back({x, y, std::min(x + tile_size, width),
+                                   std::min(y + tile_size, height), 0, spp});
+        s.result =
+            accumulation_buffer(width, height, render_region::full(width, height, spp));
+        s.progress.tiles_total = static_cast<int>(s.tiles.size());
+        s.progress.samples_total = static_cast<uint64_t>(width) * height * spp;
+        s.tiles_left = s.progress.tiles_total;
+        s.begin = std::chrono::steady_clock::now();
+        s.emit({render_event_type::started, s.progress, nullptr});
+
+        // 续渲：已经完成的 tile 直接复制
+        std::vector<uint32_t> pending;
+        for (uint32_t t = 0; t < s.tiles.size(); t++)
+        {
+            if (!copy_resumed_tile(s, s.tiles[t]))
+                pending.push_back(t);
+        }
+        if (pending.empty())
+        {
+            finish_if_done(s);
+            return scheduled_render(std::move(job));
+        }
+
+        {
+            std::scoped_lock submit_lock(submit_mutex_);
+            auto sequence = next_sequence_++;
+            for (size_t i = 0; i < pending.size(); i++)
+            {
+                auto &queue = queues_[(next_queue_ + i) % queues_.size()];
+                tile_task task{job, {s.request.priority, sequence, pending[i]}};
+                std::scoped_lock lock(queue.mutex);
+                auto pos = std::upper_bound(
+                    queue.tasks.begin(), queue.tasks.end(), task,
+                    [](const tile_task &a, const tile_task &b) {
+                        return runs_before(a.key, b.key);
+                    });
+                queue.tasks.insert(pos, std::move(task));
+            }
+            next_queue_ = (next_queue_ + pending.size()) % queues_.size();
+        }
+        {
+            std::scoped_lock lock(idle_mutex_);
+            pending_tiles_ += pending.size();
+        }
+        idle_.notify_all();
+        return scheduled_render(std::move(job));
+    }
+
+  private:
+    struct task_key
+    {
+        int priority = 0;
+        uint64_t sequence = 0; // 提交顺序，同优先级先提交的先做；也用来区分任务
+        uint32_t tile = 0;
+
+        bool operator==(const task_key &) const = default;
+    };
+
+    struct tile_task
+    {
+        std::shared_ptr<scheduled_render::state> job;
+        task_key key;
+    };
+
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<tile_task> tasks; // runs_before 排好序，队首最先做
+    };
+
+    std::vector<worker_queue> queues_;
+    std::mutex idle_mutex_;
+    std::condition_variable_any idle_;
+    size_t pending_tiles_ = 0; // 队列里的 tile 数（已经被线程预定的不算），idle_mutex_ 保护
+    std::mutex submit_mutex_;  // 保护下面两个
+    uint64_t next_sequence_ = 0;
+    size_t next_queue_ = 0;
+    std::vector<std::jthread> workers_; // 最后构造：线程运行时其他成员都有效
+
+    static bool runs_before(const task_key &a, const task_key &b)
+    {
+        if (a.priority != b.priority)
+            return a.priority > b.priority;
+        return a.sequence < b.sequence;
+    }
+
+    void work(const std::stop_token &stop, int self)
+    {
+        while (true)
+        {
+            // 先在计数上预定一个 tile，队列里就一定有一个属于自己
+            {
+                std::unique_lock lock(idle_mutex_);
+                if (!idle_.wait(lock, stop, [this] { return pending_tiles_ > 0; }))
+                    return;
+                pending_tiles_--;
+            }
+            run(take(static_cast<size_t>(self)));
+        }
+    }
+
+    // 取所有队首里最先该做的 tile：先看一遍各队首，再锁住选中的队列确认，期间被别人取走就重来
+    tile_task take(size_t self)
+    {
+        while (true)
+        {
+            auto best_queue = queues_.size();
+            task_key best;
+            for (size_t k = 0; k < queues_.size(); k++)
+            {
+                auto q = (self + k) % queues_.size(); // 自己的队列排第一，同优先级时优先
+                std::scoped_lock lock(queues_[q].mutex);
+                if (queues_[q].tasks.empty())
+                    continue;
+                const auto &key = queues_[q].tasks.front().key;
+                if (best_queue == queues_.size() || runs_before(key, best))
+                {
+                    best = key;
+                    best_queue = q;
+                }
+            }
+            if (best_queue == queues_.size())
+                continue;
+
+            auto &queue = queues_[best_queue];
+            std::scoped_lock lock(queue.mutex);
+            if (!queue.tasks.empty() && queue.tasks.front().key == best)
+            {
+                auto task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return task;
+            }
+        }
+    }
+
+    static void run(const tile_task &task)
+    {
+        auto &s = *task.job;
+        if (s.cancelled)
+        {
+            finish_tile(s, nullptr);
+            return;
+        }
+        const auto &region = s.tiles[task.key.tile];
+        auto cam = s.request.cam;
+        seed_random(hash_combine(s.request.seed, task.key.tile));
+        auto tile =
+            cam.render_partial(*s.request.world, s.request.use_background, region);
+        finish_tile(s, &tile);
+    }
+
+    // tile 为空表示跳过（任务取消或调度器析构）
+    static void finish_tile(scheduled_render::state &s, const accumulation_buffer *tile)
+    {
+        render_progress snapshot;
+        {
+            std::scoped_lock lock(s.mutex);
+            if (tile != nullptr)
+            {
+                s.result.merge(*tile);
+                s.progress.tiles_done++;
+                const auto &r = tile->region();
+                s.progress.samples_done +=
+                    static_cast<uint64_t>(r.width()) * r.height() * r.samples();
+            }
+            else
+                s.skipped = true;
+            s.progress.elapsed_seconds = s.elapsed();
+            snapshot = s.progress;
+        }
+        // 先发 tile 事件再计数：计数归零时所有 tile 事件都已经发完，结束事件一定在最后
+        if (tile != nullptr)
+            s.emit({render_event_type::tile, snapshot, tile});
+        bool last = false;
+        {
+            std::scoped_lock lock(s.mutex);
+            last = --s.tiles_left == 0;
+        }
+        if (last)
+            finish_if_done(s);
+    }
+
+    // 最后一个 tile 的线程发结束事件，然后才改状态，wait() 返回时所有回调都已执行完。
+    // 只由把 tiles_left 减到 0 的线程调用（或者提交时没有要渲染的 tile），结束事件只发一次
+    static void finish_if_done(scheduled_render::state &s)
+    {
+        render_progress snapshot;
+        bool finished = false;
+        {
+            std::scoped_lock lock(s.mutex);
+            if (s.tiles_left > 0)
+                return;
+            finished = !s.skipped;
+            s.progress.elapsed_seconds = s.elapsed();
+            snapshot = s.progress;
+        }
+        s.emit({finished ? render_event_type::finished : render_event_type::cancelled,
+                snapshot, nullptr});
+        std::scoped_lock lock(s.mutex);
+        s.status = finished ? render_status::finished : render_status::cancelled;
+        s.changed.notify_all();
+    }
+
+    // resume 里这个 tile 的每个像素都有足够的样本时复制过来，返回 true
+    static bool copy_resumed_tile(scheduled_render::state &s, const render_region &tile)
+    {
+        const auto &resume = s.request.resume;
+        if (resume.empty() || resume.image_width() != s.result.image_width() ||
+            resume.image_height() != s.result.image_height())
+            return false;
+        const auto &r = resume.region();
+        if (tile.x0 < r.x0 || tile.y0 < r.y0 || tile.x1 > r.x1 || tile.y1 > r.y1)
+            return false;
+        auto spp = static_cast<uint32_t>(tile.samples());
+        for (int y = tile.y0; y < tile.y1; y++)
+            for (int x = tile.x0; x < tile.x1; x++)
+                if (resume.samples(x, y) < spp)
+                    return false;
+
+        for (int y = tile.y0; y < tile.y1; y++)
+            for (int x = tile.x0; x < tile.x1; x++)
+                s.result.add(x, y, resume.sum(x, y), resume.samples(x, y));
+        s.progress.tiles_done++;
+        s.progress.samples_done += static_cast<uint64_t>(tile.width()) * tile.height() *
+                                   tile.samples();
+        s.tiles_left--;
+        return true;
+    }
+};
@@ -0,0 +1,475 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "render_scheduler.hpp"
+#include "scene_arena.hpp"
+#include "scene_parser.hpp"
+
+/*
+NOTE: 常驻渲染服务（look-dev 用）
+每次渲染都新开一个进程的话，大部分时间花在准备上：构建场景、建 BVH、生成 Perlin 表、解码贴图、开线程。
+render_server 把这些只做一次：场景第一次被请求时加载并建好加速结构，之后一直留在内存里；
+工作线程是一个 render_scheduler，也一直在。每个请求只复制一份相机、改几个参数、渲染。
+
+协议是文本行，一行一个请求，一行一个 JSON 回复（stdin/stdout 或本地 socket 上都一样）：
+    load <场景>                       预先加载场景
+    render <场景> [键=值 ...]         渲染，键：
+        lookfrom=x,y,z lookat=x,y,z vup=x,y,z vfov=度 width=N height=N spp=N depth=N
+        sampler=independent|stratified|halton|sobol seed=N out=文件.ppm
+    scenes                            列出已加载的场景
+    quit                              结束这个连接（stdin 模式下结束服务）
+    shutdown                          结束服务
+场景是 reference_scenes 里的名字（bvh / texture / cornell_box / cornell_smoke / perlin /
+final_scene），或者 .scene 文件（与 test_render_scene 相同：当前目录，然后逐级向上找 scenes/）。
+只给 width 时高度按场景的宽高比；同时给 height 时改宽高比。没有 out 时只渲染不写文件。
+回复里 setup_ms 是这次请求花在加载场景上的时间（已加载时为 0），render_ms 是渲染时间。
+
+同一个场景的请求顺序执行，渲染本身由 render_scheduler 并行；
+随机数按 (seed, tile) 设置，同样的请求得到逐位相同的图像。
+*/
+struct server_scene // NOLINT
+{
+    std::unique_ptr<scene_arena> arena; // 最先构造、最后析构
+    reference_scene scene;
+    std::shared_ptr<hittable> world;
+    double load_ms = 0;
+};
+
+class render_server // NOLINT
+{
+  public:
+    explicit render_server(int threads = 0) : scheduler_(threads)
+    {
+    }
+
+    render_server(const render_server &) = delete;
+    render_server &operator=(const render_server &) = delete;
+
+    [[nodiscard]] int threads() const
+    {
+        return scheduler_.threads();
+    }
+
+    // 处理一行请求，返回一行 JSON。quit 为 true 表示结束这个连接（quit 或 shutdown），
+    // stop 为 true 表示结束服务（shutdown）
+    std::string handle(std::string_view line, bool &stop, bool &quit)
+    {
+        auto words = split_words(line);
+        if (words.empty())
+            return error_reply("empty request");
+        const auto &command = words[0];
+        if (command == "quit" || command == "shutdown")
+        {
+            stop = command == "shutdown";
+            quit = true;
+            return std::format("{{\"ok\":true,\"command\":{}}}", json_string(command));
+        }
+        if (command == "scenes")
+        {
+            std::string names;
+            for (const auto &[name, scene] : scenes_)
+                names += std::format("{}{}", names.empty() ? "" : ",", json_string(name));
+            return std::format("{{\"ok\":true,\"command\":\"scenes\",\"scenes\":[{}]}}",
+                               names);
+        }
+        if ((command != "load" && command != "render") || words.size() < 2)
+            return error_reply(std::format("unknown request '{}'", line));
+
+        auto setup_begin = std::chrono::steady_clock::now();
+        auto *loaded = find_or_load(words[1]);
+        if (loaded == nullptr)
+            return error_reply(std::format("could not load scene '{}'", words[1]));
+        auto setup_ms = ms_since(setup_begin);
+        if (command == "load")
+            return std::format("{{\"ok\":true,\"command\":\"load\",\"scene\":{},"
+                               "\"setup_ms\":{:.3f}}}",
+                               json_string(words[1]), setup_ms);
+        return render(*loaded, words, setup_ms);
+    }
+
+    // 从 in 读请求直到 quit / shutdown / 输入结束，回复写到 out
+    bool serve(std::istream &in, std::ostream &out)
+    {
+        std::string line;
+        bool stop = false;
+        bool quit = false;
+        while (std::getline(in, line))
+        {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            out << handle(line, stop, quit) << '\n' << std::flush;
+            if (quit)
+                return stop;
+        }
+        return false;
+    }
+
+    /*
+    本地 socket（Unix domain socket）：一次服务一个连接，连接内一行一个请求。
+    客户端例如：  printf 'render cornell_box spp=16 out=a.ppm\n' | nc -U /tmp/rt.sock
+    */
+    bool serve_socket(const std::string &path)
+    {
+#ifdef _WIN32
+        std::cerr << "ERROR: Local sockets are not supported on this platform.\n";
+        return false;
+#else
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            std::cerr << "ERROR: Socket path '" << path << "' is too long.\n";
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::copy(path.begin(), path.end(), address.sun_path);
+
+        if (!remove_socket(path))
+            return false;
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        auto *addr = reinterpret_cast<const sockaddr *>(&address); // NOLINT
+        if (listener < 0 || bind(listener, addr, sizeof(address)) != 0 ||
+            listen(listener, 4) != 0)
+        {
+            std::cerr << "ERROR: Could not listen on socket '" << path << "'.\n";
+            if (listener >= 0)
+                close(listener);
+            return false;
+        }
+        std::clog << std::format("listening on {}\n", path);
+
+        bool stop = false;
+        while (!stop)
+        {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0)
+                continue;
+            stop = serve_connection(client);
+            close(client);
+        }
+        close(listener);
+        return remove_socket(path);
+#endif
+    }
+
+  private:
+    std::map<std::string, std::unique_ptr<server_scene>> scenes_;
+    render_scheduler scheduler_; // 在场景之后声明：先停线程，再释放场景
+    uint64_t requests_ = 0;
+
+    static double ms_since(std::chrono::steady_clock::time_point begin)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+
+    static std::vector<std::string> split_words(std::string_view line)
+    {
+        std::vector<std::string> words;
+        std::istringstream in{std::string(line)};
+        std::string word;
+        while (in >> word)
+            words.push_back(word);
+        return words;
+    }
+
+    // 带引号的 JSON 字符串。回复里所有来自请求的文字（场景名、文件名、原样的请求行）
+    // 都经过这里；控制字符（例如 CRLF 客户端的 \r）转成 \u00XX
+    static std::string json_string(std::string_view text)
+    {
+        std::string quoted = "\"";
+        for (auto c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (auto code = static_cast<int>(static_cast<unsigned char>(c));
+                     code < 0x20 || code == 0x7f)
+                quoted += std::format("\\u{:04x}", code);
+            else
+                quoted += c;
+        }
+        quoted += '"';
+        return quoted;
+    }
+
+    static std::string error_reply(std::string_view message)
+    {
+        return std::format("{{\"ok\":false,\"error\":{}}}", json_string(message));
+    }
+
+    static bool parse_vec3(const std::string &text, vec3 &v)
+    {
+        double x = 0;
+        double y = 0;
+        double z = 0;
+        char comma1 = 0;
+        char comma2 = 0;
+        std::istringstream in(text);
+        if (!(in >> x >> comma1 >> y >> comma2 >> z) || comma1 != ',' || comma2 != ',')
+            return false;
+        v = vec3(x, y, z);
+        return true;
+    }
+
+    // 与 rtw_image 找图片的方式相同：当前目录，然后逐级向上找 scenes/ 目录
+    static std::string find_scene_file(const std::string &name)
+    {
+        if (std::filesystem::exists(name))
+            return name;
+        std::string prefix = "scenes/";
+        for (int level = 0; level < 7; level++)
+        {
+            if (std::filesystem::exists(prefix + name))
+                return prefix + name;
+            prefix = "../" + prefix;
+        }
+        return {};
+    }
+
+    // 构建失败（未知名字、场景文件找不到或有错）时返回空
+    static std::unique_ptr<server_scene> load_scene(const std::string &name)
+    {
+        auto loaded = std::make_unique<server_scene>();
+        loaded->arena = std::make_unique<scene_arena>();
+        auto *arena = loaded->arena.get();
+        accel_builder build_accel = [](const hittable_list &list) {
+            return std::shared_ptr<hittable>(std::make_shared<flat_bvh_accel>(list));
+        };
+
+        // 与 bench_ray_tracing 相同：固定种子构建场景，同一个场景每次加载都一样
+        seed_random(20240601);
+        auto &scene = loaded->scene;
+        if (name == "bvh")
+            scene = bvh_scene();
+        else if (name == "texture")
+            scene = texture_scene();
+        else if (name == "cornell_box")
+            scene = cornell_box_scene();
+        else if (name == "cornell_smoke")
+            scene = cornell_smoke_scene();
+        else if (name == "perlin")
+            scene = perlin_scene();
+        else if (name == "final_scene")
+            scene = final_scene(build_accel, arena);
+        else
+            return load_scene_file(name);
+        loaded->world = build_accel(scene.world);
+        return loaded;
+    }
+
+    static std::unique_ptr<server_scene> load_scene_file(const std::string &name)
+    {
+        auto path = find_scene_file(name);
+        if (path.empty())
+        {
+            std::cerr << "ERROR: Could not find scene file '" << name << "'.\n";
+            return nullptr;
+        }
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        scene_description description;
+        if (!parse_scene(buffer.str(), description))
+            return nullptr;
+
+        auto objects = instantiate(description.view());
+        std::vector<aabb> boxes;
+        boxes.reserve(objects.size());
+        for (const auto &object : objects)
+            boxes.push_back(object->bounding_box());
+        auto bvh = flat_bvh::build(boxes);
+
+        auto loaded = std::make_unique<server_scene>();
+        loaded->scene.name = name;
+        description.camera.apply_to(loaded->scene.cam);
+        loaded->scene.sky = description.camera.sky != 0;
+        loaded->world =
+            std::make_shared<flat_bvh_accel>(std::move(objects), std::move(bvh));
+        // 材质随场景编译一次，这个场景的所有请求共用
+        loaded->scene.cam.materials = std::make_shared<material_table>(*loaded->world);
+        return loaded;
+    }
+
+    server_scene *find_or_load(const std::string &name)
+    {
+        if (auto it = scenes_.find(name); it != scenes_.end())
+            return it->second.get();
+        auto begin = std::chrono::steady_clock::now();
+        auto loaded = load_scene(name);
+        if (!loaded)
+            return nullptr;
+        loaded->load_ms = ms_since(begin);
+        std::clog << std::format("loaded {} in {:.1f} ms\n", name, loaded->load_ms);
+        return scenes_.emplace(name, std::move(loaded)).first->second.get();
+    }
+
+    // 请求里的键值覆盖场景的相机；出错时返回错误信息
+    static std::string apply_overrides(const std::vector<std::string> &words, camera &cam,
+                                       uint32_t &seed, std::string &out)
+    {
+        int height = 0;
+        for (size_t i = 2; i < words.size(); i++)
+        {
+            auto eq = words[i].find('=');
+            if (eq == std::string::npos)
+                return std::format("expected key=value, got '{}'", words[i]);
+            auto key = words[i].substr(0, eq);
+            auto value = words[i].substr(eq + 1);
+            bool ok = true;
+            try
+            {
+                if (key == "lookfrom")
+                    ok = parse_vec3(value, cam.lookfrom);
+                else if (key == "lookat")
+                    ok = parse_vec3(value, cam.lookat);
+                else if (key == "vup")
+                    ok = parse_vec3(value, cam.vup);
+                else if (key == "vfov")
+                    cam.vfov = std::stod(value);
+                else if (key == "width")
+                    cam.image_width = std::stoi(value);
+                else if (key == "height")
+                    height = std::stoi(value);
+                else if (key == "spp")
+                    cam.samples_per_pixel = std::stoi(value);
+                else if (key == "depth")
+                    cam.max_depth = std::stoi(value);
+                else if (key == "sampler")
+                    ok = parse_sampler_type(value, cam.sampling);
+                else if (key == "seed")
+                    seed = static_cast<uint32_t>(std::stoul(value));
+                else if (key == "out")
+                    out = value;
+                else
+                    return std::format("unknown key '{}'", key);
+            }
+            catch (const std::exception &)
+            {
+                ok = false;
+            }
+            if (!ok)
+                return std::format("bad value for '{}': '{}'", key, value);
+        }
+        if (cam.image_width <= 0 || cam.samples_per_pixel <= 0 || height < 0)
+            return "width, height and spp must be positive";
+        if (height > 0)
+            cam.aspect_ratio = static_cast<double>(cam.image_width) / height;
+        return {};
+    }
+
+    std::string render(const server_scene &loaded, const std::vector<std::string> &words,
+                       double setup_ms)
+    {
+        render_request request;
+        request.cam = loaded.scene.cam;
+        std::string out;
+        auto error = apply_overrides(words, request.cam, request.seed, out);
+        if (!error.empty())
+            return error_reply(error);
+        auto spp = request.cam.samples_per_pixel;
+        request.world = loaded.world;
+        request.use_background = !loaded.scene.sky;
+
+        auto begin = std::chrono::steady_clock::now();
+        auto job = scheduler_.submit(std::move(request));
+        auto image = job.result();
+        auto render_ms = ms_since(begin);
+        if (!out.empty())
+        {
+            std::ofstream file(out);
+            image.write_ppm(file);
+            if (!file)
+                return error_reply(std::format("could not write '{}'", out));
+        }
+        requests_++;
+        return std::format("{{\"ok\":true,\"command\":\"render\",\"request\":{},"
+                           "\"scene\":{},\"width\":{},\"height\":{},\"spp\":{},"
+                           "\"setup_ms\":{:.3f},\"render_ms\":{:.3f},\"out\":{}}}",
+                           requests_, json_string(words[1]), image.image_width(),
+                           image.image_height(), spp, setup_ms, render_ms,
+                           json_string(out));
+    }
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+    static constexpr int k_send_flags = MSG_NOSIGNAL; // 客户端提前断开时不要被 SIGPIPE 杀掉
+#else
+    static constexpr int k_send_flags = 0;
+#endif
+
+    // 删掉 path 上留下的 socket 文件（上次没有正常退出）；不存在时什么都不做。
+    // 只删 socket：路径写错指到普通文件、目录时报错，不删
+    static bool remove_socket(const std::string &path)
+    {
+        struct stat info{};
+        if (lstat(path.c_str(), &info) != 0)
+        {
+            if (errno == ENOENT)
+                return true;
+            std::cerr << "ERROR: Could not stat '" << path << "'.\n";
+            return false;
+        }
+        if (!S_ISSOCK(info.st_mode))
+        {
+            std::cerr << "ERROR: '" << path << "' exists and is not a socket.\n";
+            return false;
+        }
+        if (::unlink(path.c_str()) != 0)
+        {
+            std::cerr << "ERROR: Could not remove socket '" << path << "'.\n";
+            return false;
+        }
+        return true;
+    }
+
+    // 一个连接：按行读请求、写回复；返回 true 表示收到 shutdown
+    bool serve_connection(int client)
+    {
+        std::string pending;
+        char chunk[4096];
+        while (true)
+        {
+            auto got = read(client, chunk, sizeof(chunk));
+            if (got <= 0)
+                return false;
+            pending.append(chunk, static_cast<size_t>(got));
+            size_t newline = 0;
+            while ((newline = pending.find('\n')) != std::string::npos)
+            {
+                auto line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                if (line.find_first_not_of(" \t\r") == std::string::npos)
+                    continue;
+                bool stop = false;
+                bool quit = false;
+                auto reply = handle(line, stop, quit) + '\n';
+                if (send(client, reply.data(), reply.size(), k_send_flags) < 0 || quit)
+                    return stop;
+            }
+        }
+    }
+#endif
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+NOTE: 热路径计数器（默认编译掉）
+定义 RT_STATS 后（CMake: -DRAY_TRACING_STATS=ON）才真正计数：
+    每次反弹深度的光线数、BVH 节点访问数、光线-包围盒测试数、
+    各类图元求交次数、各类材质 scatter 次数、介质 hit 尝试次数。
+没定义时 count_stat() 是空的 if constexpr，调用点不产生任何代码，不影响正常渲染的性能。
+
+每个线程写自己的 thread_local 计数块，不加锁、不用原子操作，没有竞争；
+线程第一次计数时把计数块登记到全局列表（只有这一次加锁），线程退出时把计数累加到 retired_。
+collect_render_stats() 合并所有计数块，必须在渲染结束后（没有线程还在计数时）调用。
+*/
+#ifdef RT_STATS
+inline constexpr bool k_render_stats_enabled = true;
+#else
+inline constexpr bool k_render_stats_enabled = false;
+#endif
+
+enum class render_stat : uint32_t // NOLINT
+{
+    bvh_nodes_visited,    // bvh_node / motion_bvh_node / flat_bvh 访问的节点
+    ray_box_tests,        // 光线-包围盒 slab 测试
+    sphere_tests,         // sphere::hit
+    quad_tests,           // quad::hit
+    box_tests,            // axis_aligned_box::hit
+    triangle_tests,       // triangle_mesh 中的三角形求交
+    surface_interactions, // hittable::finish_hit 补全的命中记录
+    medium_hits,          // constant_medium::hit 尝试
+    hetero_medium_hits,   // heterogeneous_medium::hit 尝试
+    scatter_lambertian,   // lambertian::scatter
+    scatter_metal,        // metal::scatter
+    scatter_dielectric,   // dielectric::scatter
+    scatter_isotropic,    // isotropic::scatter
+    scatter_absorb,       // material::scatter 的默认实现（diffuse_light 等不散射的材质）
+    count,
+};
+
+inline constexpr std::array<std::string_view, static_cast<size_t>(render_stat::count)>
+    k_render_stat_names = {
+        "bvh_nodes_visited",    "ray_box_tests",      "sphere_tests",
+        "quad_tests",           "box_tests",          "triangle_tests",
+        "surface_interactions", "medium_hits",        "hetero_medium_hits",
+        "scatter_lambertian",   "scatter_metal",      "scatter_dielectric",
+        "scatter_isotropic",    "scatter_absorb",
+};
+
+struct render_stats // NOLINT
+{
+    // 第 i 个元素：第 i 次反弹的光线数（0 = 主光线），更深的都记在最后一格
+    static constexpr size_t k_max_tracked_depth = 64;
+
+    std::array<uint64_t, static_cast<size_t>(render_stat::count)> counters{};
+    std::array<uint64_t, k_max_tracked_depth> rays_per_depth{};
+
+    void merge(const render_stats &other)
+    {
+        for (size_t i = 0; i < counters.size(); i++)
+            counters[i] += other.counters[i];
+        for (size_t i = 0; i < rays_per_depth.size(); i++)
+            rays_per_depth[i] += other.rays_per_depth[i];
+    }
+
+    [[nodiscard]] uint64_t operator[](render_stat stat) const
+    {
+        return counters[static_cast<size_t>(stat)];
+    }
+
+    [[nodiscard]] uint64_t total_rays() const
+    {
+        uint64_t total = 0;
+        for (auto n : rays_per_depth)
+            total += n;
+        return total;
+    }
+
+    // 单行 JSON 对象；rays_per_depth 去掉末尾的 0
+    [[nodiscard]] std::string to_json() const
+    {
+        std::string json = "{";
+        for (size_t i = 0; i < counters.size(); i++)
+            json += std::format("\"{}\":{},", k_render_stat_names[i], counters[i]);
+
+        size_t depth_count = rays_per_depth.size();
+        while (depth_count > 0 && rays_per_depth[depth_count - 1] == 0)
+            depth_count--;
+        json += "\"rays_per_depth\":[";
+        for (size_t i = 0; i < depth_count; i++)
+            json += std::format("{}{}", i == 0 ? "" : ",", rays_per_depth[i]);
+        json += "]}";
+        return json;
+    }
+
+    void print(std::ostream &out) const
+    {
+        out << "render stats:\n";
+        for (size_t i = 0; i < counters.size(); i++)
+            out << std::format("  {:<20}{:>16}\n", k_render_stat_names[i], counters[i]);
+        out << std::format("  {:<20}{:>16}\n", "rays", total_rays());
+        for (size_t i = 0; i < rays_per_depth.size(); i++)
+            if (rays_per_depth[i] != 0)
+                out << std::format("    depth {:<12}{:>16}\n", i, rays_per_depth[i]);
+    }
+};
+
+class render_stats_registry // NOLINT
+{
+  public:
+    static render_stats_registry &instance()
+    {
+        static render_stats_registry registry;
+        return registry;
+    }
+
+    // 当前线程的计数块
+    render_stats &local()
+    {
+        thread_local thread_block block(*this);
+        return block.stats;
+    }
+
+    [[nodiscard]] render_stats merged()
+    {
+        std::lock_guard lock(mutex_);
+        auto total = retired_;
+        for (const auto *stats : threads_)
+            total.merge(*stats);
+        return total;
+    }
+
+    void reset()
+    {
+        std::lock_guard lock(mutex_);
+        retired_ = {};
+        for (auto *stats : threads_)
+            *stats = {};
+    }
+
+  private:
+    std::mutex mutex_;
+    std::vector<render_stats *> threads_;
+    render_stats retired_;
+
+    struct thread_block
+    {
+        render_stats stats;
+        render_stats_registry &owner;
+
+        explicit thread_block(render_stats_registry &registry) : owner(registry)
+        {
+            std::lock_guard lock(owner.mutex_);
+            owner.threads_.push_back(&stats);
+        }
+
+        ~thread_block()
+        {
+            std::lock_guard lock(owner.mutex_);
+            owner.retired_.merge(stats);
+            std::erase(owner.threads_, &stats);
+        }
+
+        thread_block(const thread_block &) = delete;
+        thread_block &operator=(const thread_block &) = delete;
+    };
+};
+
+inline void count_stat(render_stat stat, uint64_t n = 1)
+{
+    if constexpr (k_render_stats_enabled)
+    {
+        auto &stats = render_stats_registry::instance().local();
+        stats.counters[static_cast<size_t>(stat)] += n;
+    }
+}
+
+inline void count_ray(int bounce)
+{
+    if constexpr (k_render_stats_enabled)
+    {
+        auto index = std::min(static_cast<size_t>(bounce),
+                              render_stats::k_max_tracked_depth - 1);
+        render_stats_registry::instance().local().rays_per_depth[index]++;
+    }
+}
+
+inline render_stats collect_render_stats()
+{
+    return render_stats_registry::instance().merged();
+}
+
+inline void reset_render_stats()
+{
+    render_stats_registry::instance().reset();
+}
@@ -52,6 +52,21 @@ class rtw_image
         std::cerr << "ERROR: Could not load image file '" << image_filename << "'.\n";
     }
 
+    // 从内存中的已编码图片（png / jpg 等文件内容）加载，例如 glb 里内嵌的贴图
+    rtw_image(const unsigned char *encoded, size_t size)
+    {
+        auto n = bytes_per_pixel;
+        fdata = stbi_loadf_from_memory(encoded, static_cast<int>(size), &image_width,
+                                       &image_height, &n, bytes_per_pixel);
+        if (fdata == nullptr)
+        {
+            std::cerr << "ERROR: Could not decode embedded image.\n";
+            return;
+        }
+        bytes_per_scanline = image_width * bytes_per_pixel;
+        convert_to_bytes();
+    }
+
     ~rtw_image()
     {
         delete[] bdata;
@@ -100,6 +115,19 @@ class rtw_image
         return bdata + y * bytes_per_scanline + x * bytes_per_pixel;
     }
 
+    const float *float_pixel_data(int x, int y) const
+    {
+        // 像素 x,y 的三个线性浮点分量。HDR（.hdr）图片的值不截断到 [0,1]，
+        // 环境光源要用原始亮度。没有图像数据时返回 nullptr。
+        if (fdata == nullptr)
+            return nullptr;
+
+        x = clamp(x, 0, image_width);
+        y = clamp(y, 0, image_height);
+
+        return fdata + y * bytes_per_scanline + x * bytes_per_pixel;
+    }
+
   private:
     const int bytes_per_pixel = 3;
     float *fdata = nullptr;         // Linear floating point pixel data
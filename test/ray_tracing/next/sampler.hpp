@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "constant.hpp"
+#include "random_double.hpp"
+#include "vec3.hpp"
+
+/*
+NOTE: 采样器
+原来相机和材质里的每个随机数都直接来自 random_double()，相互独立，收敛是 O(1/sqrt(N))。
+采样器把"一个像素的第 i 个样本"需要的随机数按请求顺序编号成维度：
+    像素内位置 (2D)、镜头 (2D)、时间 (1D)，然后每次反弹材质需要的 1D / 2D ...
+同一个维度在同一像素的 N 个样本之间是分层 / 低差异的，误差下降得比独立随机数快。
+
+    independent  每个维度都是独立随机数（与原来相同）
+    stratified   每个维度按样本数分层并抖动，层的顺序按维度随机打乱（2D 分成网格）
+    halton       Halton 序列，每个像素、每个维度独立做哈希嵌套数字平移（Owen 式随机化）
+    sobol        Burley 2020：每个 1D/2D 请求用 Sobol 前两维，样本下标先打乱再取点，
+                 再用 Laine-Karras 哈希做 Owen 扰乱；不同请求之间没有相关性
+
+所有采样器都是确定的：同一个种子、同一像素、同一个样本序号得到同样的数（independent 除外，它用线程的随机引擎）。
+采样器对象有状态（当前像素和维度），每个渲染线程各用一个。
+*/
+struct sample_2d // NOLINT
+{
+    double x;
+    double y;
+};
+
+class sampler // NOLINT
+{
+  public:
+    virtual ~sampler() = default;
+
+    // 开始像素 (x, y) 的第 index 个样本，维度从 0 重新计数
+    virtual void start_pixel_sample(int x, int y, int index) = 0;
+    virtual double get_1d() = 0;
+    virtual sample_2d get_2d() = 0;
+};
+
+// ==================== 哈希与置换 ====================
+
+// murmur3 的 32 位收尾混合
+inline uint32_t mix_bits(uint32_t v)
+{
+    v ^= v >> 16;
+    v *= 0x85ebca6bU;
+    v ^= v >> 13;
+    v *= 0xc2b2ae35U;
+    v ^= v >> 16;
+    return v;
+}
+
+inline uint32_t hash_combine(uint32_t seed, uint32_t v)
+{
+    return mix_bits(seed ^ (v + 0x9e3779b9U + (seed << 6) + (seed >> 2)));
+}
+
+inline uint32_t reverse_bits(uint32_t v)
+{
+    v = ((v >> 1) & 0x55555555U) | ((v & 0x55555555U) << 1);
+    v = ((v >> 2) & 0x33333333U) | ((v & 0x33333333U) << 2);
+    v = ((v >> 4) & 0x0f0f0f0fU) | ((v & 0x0f0f0f0fU) << 4);
+    v = ((v >> 8) & 0x00ff00ffU) | ((v & 0x00ff00ffU) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+// 32 位定点小数 -> [0, 1)
+inline double unit_from_bits(uint32_t v)
+{
+    return static_cast<double>(v) * 0x1p-32;
+}
+
+// Laine-Karras 置换：每一位只受更低位影响，作用在反转后的位上就是以 2 为底的 Owen 扰乱
+inline uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cU;
+    x ^= x * 0xb82f1e52U;
+    x ^= x * 0xc7afe638U;
+    x ^= x * 0x8d22f6e6U;
+    return x;
+}
+
+inline uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+{
+    return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+// Kensler 2013：不需要存表的 [0, n) 随机置换，p 选择具体哪一个置换
+inline uint32_t permute_index(uint32_t i, uint32_t n, uint32_t p)
+{
+    if (n <= 1)
+        return 0;
+    uint32_t w = n - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do
+    {
+        i ^= p;
+        i *= 0xe170893dU;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3fU;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69U;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303U;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3U;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfU;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+    return (i + p) % n;
+}
+
+// ==================== 从 [0,1)^2 映射到几何域 ====================
+
+// 单位球面上的均匀分布（替代 random_unit_vector 的拒绝采样）
+inline vec3 sample_unit_vector(sample_2d u)
+{
+    auto z = 1 - (2 * u.x);
+    auto r = std::sqrt(std::fmax(0.0, 1 - (z * z)));
+    auto phi = 2 * pi * u.y;
+    return {r * std::cos(phi), r * std::sin(phi), z};
+}
+
+// 单位圆盘上的均匀分布，同心映射（Shirley-Chiu），保持分层结构（替代 random_in_unit_disk）
+inline vec3 sample_unit_disk(sample_2d u)
+{
+    auto a = (2 * u.x) - 1;
+    auto b = (2 * u.y) - 1;
+    if (a == 0 && b == 0)
+        return {0, 0, 0};
+    double r = 0;
+    double theta = 0;
+    if (std::fabs(a) > std::fabs(b))
+    {
+        r = a;
+        theta = (pi / 4) * (b / a);
+    }
+    else
+    {
+        r = b;
+        theta = (pi / 2) - ((pi / 4) * (a / b));
+    }
+    return {r * std::cos(theta), r * std::sin(theta), 0};
+}
+
+// ==================== 实现 ====================
+
+class independent_sampler : public sampler // NOLINT
+{
+  public:
+    void start_pixel_sample(int /*x*/, int /*y*/, int /*index*/) override {}
+
+    double get_1d() override
+    {
+        return random_double();
+    }
+
+    sample_2d get_2d() override
+    {
+        auto x = random_double();
+        return {x, random_double()};
+    }
+};
+
+// 哈希采样器的公共部分：像素种子和维度计数
+class hashed_sampler : public sampler // NOLINT
+{
+  public:
+    explicit hashed_sampler(uint32_t seed) : seed_(seed) {}
+
+    void start_pixel_sample(int x, int y, int index) override
+    {
+        pixel_seed_ = hash_combine(hash_combine(seed_, static_cast<uint32_t>(x)),
+                                   static_cast<uint32_t>(y));
+        index_ = static_cast<uint32_t>(index);
+        dimension_ = 0;
+    }
+
+  protected:
+    uint32_t seed_;
+    uint32_t pixel_seed_ = 0;
+    uint32_t index_ = 0;
+    uint32_t dimension_ = 0;
+
+    // 当前维度（及其第 k 个分量）的哈希
+    [[nodiscard]] uint32_t dimension_hash(uint32_t k = 0) const
+    {
+        return hash_combine(hash_combine(pixel_seed_, dimension_), k);
+    }
+
+    // 与当前样本相关的均匀随机数，用于抖动
+    [[nodiscard]] double jitter(uint32_t k) const
+    {
+        return unit_from_bits(hash_combine(dimension_hash(k + 2), index_));
+    }
+};
+
+class stratified_sampler : public hashed_sampler // NOLINT
+{
+  public:
+    stratified_sampler(int samples_per_pixel, uint32_t seed)
+        : hashed_sampler(seed),
+          samples_(static_cast<uint32_t>(std::max(1, samples_per_pixel)))
+    {
+        // 2D 网格：nx * ny >= 样本数，尽量接近正方形
+        nx_ = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(samples_))));
+        ny_ = (samples_ + nx_ - 1) / nx_;
+    }
+
+    double get_1d() override
+    {
+        auto stratum = permute_index(index_ % samples_, samples_, dimension_hash());
+        auto value = (stratum + jitter(0)) / samples_;
+        dimension_++;
+        return std::fmin(value, k_one_minus_epsilon);
+    }
+
+    sample_2d get_2d() override
+    {
+        auto cell = permute_index(index_ % samples_, nx_ * ny_, dimension_hash());
+        auto x = ((cell % nx_) + jitter(0)) / nx_;
+        auto y = ((cell / nx_) + jitter(1)) / ny_;
+        dimension_ += 2;
+        return {std::fmin(x, k_one_minus_epsilon), std::fmin(y, k_one_minus_epsilon)};
+    }
+
+  private:
+    static constexpr double k_one_minus_epsilon = 0x1.fffffffffffffp-1;
+    uint32_t samples_;
+    uint32_t nx_;
+    uint32_t ny_;
+};
+
+class halton_sampler : public hashed_sampler // NOLINT
+{
+  public:
+    static constexpr std::array<uint32_t, 32> k_primes = {
+        2,  3,  5,  7,  11, 13, 17, 19, 23, 29, 31, 37, 41, 43,  47,  53,
+        59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131};
+
+    explicit halton_sampler(uint32_t seed) : hashed_sampler(seed) {}
+
+    double get_1d() override
+    {
+        auto value = sample(dimension_);
+        dimension_++;
+        return value;
+    }
+
+    sample_2d get_2d() override
+    {
+        auto x = sample(dimension_);
+        auto y = sample(dimension_ + 1);
+        dimension_ += 2;
+        return {x, y};
+    }
+
+  private:
+    // 维度超过素数表后，高维 Halton 的相关性很强，退回到哈希随机数
+    [[nodiscard]] double sample(uint32_t dimension) const
+    {
+        auto seed = hash_combine(pixel_seed_, dimension);
+        if (dimension >= k_primes.size())
+            return unit_from_bits(hash_combine(seed, index_));
+        return scrambled_radical_inverse(index_, k_primes[dimension], seed);
+    }
+
+    /*
+    以 base 为底的根式反演，每一位加一个随机平移，平移量由"更高位的数字前缀"哈希得到，
+    也就是在每个节点上独立随机化的嵌套平移（Owen 扰乱的一种）。
+    下标的数字用完以后继续对前导 0 做平移，直到精度用完，结果不会落在 1/base^k 的格点上。
+    */
+    static double scrambled_radical_inverse(uint32_t index, uint32_t base, uint32_t seed)
+    {
+        const double inv_base = 1.0 / base;
+        double scale = inv_base;
+        double value = 0;
+        uint32_t prefix = seed;
+        while (scale > 1e-15)
+        {
+            auto digit = index % base;
+            index /= base;
+            auto shifted = (digit + mix_bits(prefix)) % base;
+            value += shifted * scale;
+            prefix = hash_combine(prefix, digit);
+            scale *= inv_base;
+        }
+        return std::fmin(value, 0x1.fffffffffffffp-1);
+    }
+};
+
+class sobol_sampler : public hashed_sampler // NOLINT
+{
+  public:
+    explicit sobol_sampler(uint32_t seed) : hashed_sampler(seed) {}
+
+    double get_1d() override
+    {
+        auto index = nested_uniform_scramble(index_, dimension_hash());
+        auto x = nested_uniform_scramble(reverse_bits(index), dimension_hash(1));
+        dimension_++;
+        return unit_from_bits(x);
+    }
+
+    sample_2d get_2d() override
+    {
+        auto index = nested_uniform_scramble(index_, dimension_hash());
+        auto x = nested_uniform_scramble(reverse_bits(index), dimension_hash(1));
+        auto y = nested_uniform_scramble(sobol_dimension1(index), dimension_hash(2));
+        dimension_ += 2;
+        return {unit_from_bits(x), unit_from_bits(y)};
+    }
+
+  private:
+    // Sobol 第二维（本原多项式 x + 1）：方向数 v[k] = v[k-1] ^ (v[k-1] >> 1)
+    static uint32_t sobol_dimension1(uint32_t index)
+    {
+        uint32_t result = 0;
+        uint32_t v = 1U << 31;
+        for (; index != 0; index >>= 1)
+        {
+            if ((index & 1U) != 0)
+                result ^= v;
+            v ^= v >> 1;
+        }
+        return result;
+    }
+};
+
+// ==================== 选择采样器 ====================
+
+enum class sampler_type : uint8_t // NOLINT
+{
+    independent,
+    stratified,
+    halton,
+    sobol,
+};
+
+inline std::string_view sampler_type_name(sampler_type type)
+{
+    switch (type)
+    {
+    case sampler_type::stratified:
+        return "stratified";
+    case sampler_type::halton:
+        return "halton";
+    case sampler_type::sobol:
+        return "sobol";
+    default:
+        return "independent";
+    }
+}
+
+inline bool parse_sampler_type(std::string_view name, sampler_type &type)
+{
+    for (auto t : {sampler_type::independent, sampler_type::stratified,
+                   sampler_type::halton, sampler_type::sobol})
+    {
+        if (sampler_type_name(t) == name)
+        {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline std::unique_ptr<sampler> make_sampler(sampler_type type, int samples_per_pixel,
+                                             uint32_t seed)
+{
+    switch (type)
+    {
+    case sampler_type::stratified:
+        return std::make_unique<stratified_sampler>(samples_per_pixel, seed);
+    case sampler_type::halton:
+        return std::make_unique<halton_sampler>(seed);
+    case sampler_type::sobol:
+        return std::make_unique<sobol_sampler>(seed);
+    default:
+        return std::make_unique<independent_sampler>();
+    }
+}
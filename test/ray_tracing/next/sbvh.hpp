@@ -0,0 +1,471 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "flat_bvh.hpp"
+
+/*
+NOTE: 空间分割 BVH（SBVH，Stich / Friedrich / Dietrich 2009）
+flat_bvh 是"物体分割"：每个图元只进一个孩子，孩子的包围盒可以任意重叠。
+final_scene 里的地面箱子、半径 5000 的雾球、大面积的 quad 互相压在一起，
+分到两边以后两个孩子的包围盒几乎一样大，光线两个孩子都要进。
+
+SBVH 在每个节点同时评估两种分割，取 SAH 代价小的：
+    物体分割：与 flat_bvh 相同，按图元包围盒中心分桶
+    空间分割：用一个平面把节点切开，跨过平面的图元在左右两边各放一份"引用"，
+              每份引用的包围盒裁剪到自己那一侧，两个孩子不再重叠
+引用的包围盒只是图元包围盒与节点的交集（对任意 hittable 都成立，只是不如按几何裁剪紧），
+同一个图元可能出现在多个叶子里，closest_hit 对它多测一次，确定性的几何体结果不变。
+体积介质不行：hit() 每次都重新取自由程，测 N 次就是 N 个独立样本里取最近的，雾会变浓。
+所以 hittable::stochastic() 为真的图元不做空间分割：空间分割时整个引用按包围盒中心放到一侧，
+每个这样的图元只出现在一个叶子里。只给包围盒的 build() 认为所有图元都可以分割。
+
+max_growth 限制引用总数：最多 图元数 * (1 + max_growth)，用完以后只做物体分割。
+只有物体分割的两个孩子重叠面积超过节点面积的 k_min_overlap 时才尝试空间分割（论文中的 alpha），
+不重叠的节点不会因为空间分割多花构建时间和内存。
+
+结果仍然是 flat_bvh（prim_indices 里有重复的下标），遍历、flat_bvh_accel、quantized_bvh 都可以直接用。
+*/
+class sbvh_builder // NOLINT
+{
+  public:
+    static constexpr int k_bins = 16;
+    static constexpr double k_min_overlap = 1e-5;
+    static constexpr int k_max_spatial_depth = 48;
+    // 与 flat_bvh 相同：超过这个深度只做中位数分割，总深度 < flat_bvh::k_max_depth
+    static constexpr int k_max_sah_depth = 64;
+
+    // unsplittable[i] 非 0 时第 i 个图元不做空间分割；为空表示都可以分割
+    static flat_bvh build(std::span<const aabb> boxes, int max_leaf_size = 2,
+                          double max_growth = 0.5,
+                          std::span<const uint8_t> unsplittable = {})
+    {
+        if (boxes.empty())
+            return {};
+
+        auto storage = std::make_shared<result>();
+        sbvh_builder b(boxes.size(), std::max(1, std::min(max_leaf_size, 0xffff)),
+                       max_growth, *storage);
+
+        std::vector<reference> refs;
+        refs.reserve(boxes.size());
+        for (uint32_t prim = 0; prim < boxes.size(); prim++)
+        {
+            const auto &box = boxes[prim];
+            refs.push_back({prim,
+                            {{box.x.min, box.y.min, box.z.min},
+                             {box.x.max, box.y.max, box.z.max}},
+                            unsplittable.empty() || unsplittable[prim] == 0});
+        }
+        storage->nodes.reserve(2 * boxes.size());
+        storage->indices.reserve(boxes.size());
+        b.build(std::move(refs), 0);
+
+        auto *data = storage.get();
+        return {data->nodes, data->indices, std::move(storage)};
+    }
+
+  private:
+    // 节点和下标的存储；flat_bvh 以视图的形式引用它们，并通过 owner 保活
+    struct result
+    {
+        std::vector<flat_bvh_node> nodes;
+        std::vector<uint32_t> indices;
+    };
+
+    struct box3
+    {
+        double min[3]; // NOLINT
+        double max[3]; // NOLINT
+
+        static box3 empty()
+        {
+            return {{infinity, infinity, infinity}, {-infinity, -infinity, -infinity}};
+        }
+
+        void grow(const box3 &other)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                min[axis] = std::min(min[axis], other.min[axis]);
+                max[axis] = std::max(max[axis], other.max[axis]);
+            }
+        }
+
+        [[nodiscard]] double centroid(int axis) const
+        {
+            return 0.5 * (min[axis] + max[axis]);
+        }
+
+        [[nodiscard]] bool valid() const
+        {
+            return min[0] <= max[0] && min[1] <= max[1] && min[2] <= max[2];
+        }
+
+        [[nodiscard]] double half_area() const
+        {
+            if (!valid())
+                return 0;
+            auto dx = max[0] - min[0];
+            auto dy = max[1] - min[1];
+            auto dz = max[2] - min[2];
+            return (dx * dy) + (dy * dz) + (dz * dx);
+        }
+
+        [[nodiscard]] box3 intersect(const box3 &other) const
+        {
+            box3 b;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                b.min[axis] = std::max(min[axis], other.min[axis]);
+                b.max[axis] = std::min(max[axis], other.max[axis]);
+            }
+            return b;
+        }
+    };
+
+    struct reference
+    {
+        uint32_t prim;
+        box3 box;        // 图元包围盒裁剪到当前节点以后的部分
+        bool splittable; // false：空间分割时整个放到一侧，不复制
+    };
+
+    struct split
+    {
+        double cost = infinity;
+        int axis = -1;
+        int bin = -1;       // 在第 bin 个桶之前分割
+        bool spatial = false;
+        double plane = 0;   // 空间分割的平面位置
+    };
+
+    result &out_;
+    int max_leaf_size_;
+    size_t ref_budget_; // 还可以增加的引用数
+
+    sbvh_builder(size_t prim_count, int max_leaf_size, double max_growth, result &out)
+        : out_(out), max_leaf_size_(max_leaf_size),
+          ref_budget_(static_cast<size_t>(std::max(0.0, max_growth) *
+                                          static_cast<double>(prim_count)))
+    {
+    }
+
+    // 与 flat_bvh 相同的 double -> float 朝外取整
+    static float round_down(double x)
+    {
+        auto f = static_cast<float>(x);
+        return (f > x) ? std::nextafter(f, -INFINITY) : f;
+    }
+
+    static float round_up(double x)
+    {
+        auto f = static_cast<float>(x);
+        return (f < x) ? std::nextafter(f, INFINITY) : f;
+    }
+
+    uint32_t build(std::vector<reference> refs, int depth) // NOLINT
+    {
+        auto bounds = box3::empty();
+        auto centroid_bounds = box3::empty();
+        for (const auto &ref : refs)
+        {
+            bounds.grow(ref.box);
+            box3 c{{ref.box.centroid(0), ref.box.centroid(1), ref.box.centroid(2)},
+                   {ref.box.centroid(0), ref.box.centroid(1), ref.box.centroid(2)}};
+            centroid_bounds.grow(c);
+        }
+
+        auto node_index = static_cast<uint32_t>(out_.nodes.size());
+        out_.nodes.push_back({});
+        for (int axis = 0; axis < 3; axis++)
+        {
+            out_.nodes[node_index].min[axis] = round_down(bounds.min[axis]);
+            out_.nodes[node_index].max[axis] = round_up(bounds.max[axis]);
+        }
+
+        auto count = refs.size();
+        if (count <= static_cast<size_t>(max_leaf_size_))
+        {
+            out_.nodes[node_index].offset = static_cast<uint32_t>(out_.indices.size());
+            out_.nodes[node_index].count = static_cast<uint16_t>(count);
+            for (const auto &ref : refs)
+                out_.indices.push_back(ref.prim);
+            return node_index;
+        }
+
+        // 物体分割；它的两个孩子重叠明显、深度和引用预算都允许时，再试空间分割
+        box3 left_box;
+        box3 right_box;
+        split best;
+        if (depth < k_max_sah_depth)
+            best = object_split(refs, centroid_bounds, left_box, right_box);
+        auto overlap = best.axis >= 0 ? left_box.intersect(right_box).half_area() : 0;
+        if (overlap > k_min_overlap * bounds.half_area() && depth < k_max_spatial_depth &&
+            ref_budget_ > 0)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                auto candidate = spatial_split(refs, bounds, axis);
+                if (candidate.cost < best.cost)
+                    best = candidate;
+            }
+        }
+
+        std::vector<reference> left;
+        std::vector<reference> right;
+        if (best.spatial)
+            partition_spatial(refs, best, left, right);
+        else if (best.axis >= 0)
+            partition_object(refs, best, centroid_bounds, left, right);
+        if (left.empty() || right.empty())
+        {
+            // 中位数分割：质心重合或没有可用的分割时，保证两边都不空
+            left.clear();
+            right.clear();
+            int axis = longest_axis(centroid_bounds);
+            auto mid = refs.begin() + static_cast<std::ptrdiff_t>(count / 2);
+            std::nth_element(refs.begin(), mid, refs.end(),
+                             [&](const reference &a, const reference &b) {
+                                 return a.box.centroid(axis) < b.box.centroid(axis);
+                             });
+            left.assign(refs.begin(), mid);
+            right.assign(mid, refs.end());
+            best.axis = axis;
+        }
+        refs = {}; // 递归前释放，峰值内存只有当前路径上的引用
+
+        build(std::move(left), depth + 1); // 左孩子紧跟在 node_index 后面
+        auto right_index = build(std::move(right), depth + 1);
+        out_.nodes[node_index].offset = right_index;
+        out_.nodes[node_index].count = 0;
+        out_.nodes[node_index].axis = static_cast<uint16_t>(best.axis);
+        return node_index;
+    }
+
+    static int longest_axis(const box3 &box)
+    {
+        auto dx = box.max[0] - box.min[0];
+        auto dy = box.max[1] - box.min[1];
+        auto dz = box.max[2] - box.min[2];
+        if (dx > dy)
+            return dx > dz ? 0 : 2;
+        return dy > dz ? 1 : 2;
+    }
+
+    static double sah_cost(const box3 &left, size_t left_count, const box3 &right,
+                           size_t right_count)
+    {
+        return (left.half_area() * static_cast<double>(left_count)) +
+               (right.half_area() * static_cast<double>(right_count));
+    }
+
+    static int centroid_bin(const reference &ref, int axis, const box3 &centroid_bounds)
+    {
+        auto extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        auto offset = ref.box.centroid(axis) - centroid_bounds.min[axis];
+        auto b = static_cast<int>(k_bins * offset / extent);
+        return std::clamp(b, 0, k_bins - 1);
+    }
+
+    // 三个轴上的分桶 SAH；同时返回最佳分割两个孩子的包围盒，用来判断重叠
+    static split object_split(const std::vector<reference> &refs,
+                              const box3 &centroid_bounds, box3 &best_left,
+                              box3 &best_right)
+    {
+        split best;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!(centroid_bounds.max[axis] - centroid_bounds.min[axis] > 0))
+                continue;
+
+            std::array<box3, k_bins> bin_boxes;
+            bin_boxes.fill(box3::empty());
+            std::array<size_t, k_bins> bin_counts{};
+            for (const auto &ref : refs)
+            {
+                auto b = centroid_bin(ref, axis, centroid_bounds);
+                bin_boxes[b].grow(ref.box);
+                bin_counts[b]++;
+            }
+
+            std::array<box3, k_bins> right_boxes;
+            std::array<size_t, k_bins> right_counts{};
+            auto acc = box3::empty();
+            size_t acc_count = 0;
+            for (int b = k_bins - 1; b > 0; b--)
+            {
+                acc.grow(bin_boxes[b]);
+                acc_count += bin_counts[b];
+                right_boxes[b] = acc;
+                right_counts[b] = acc_count;
+            }
+
+            acc = box3::empty();
+            acc_count = 0;
+            for (int b = 1; b < k_bins; b++)
+            {
+                acc.grow(bin_boxes[b - 1]);
+                acc_count += bin_counts[b - 1];
+                if (acc_count == 0 || right_counts[b] == 0)
+                    continue;
+                auto cost = sah_cost(acc, acc_count, right_boxes[b], right_counts[b]);
+                if (cost < best.cost)
+                {
+                    best = {cost, axis, b, false, 0};
+                    best_left = acc;
+                    best_right = right_boxes[b];
+                }
+            }
+        }
+        return best;
+    }
+
+    /*
+    空间分割：沿 axis 把节点等分成 k_bins 个桶，每个引用的包围盒裁剪到它跨过的每个桶里。
+    entries[b] / exits[b]：从第 b 个桶开始 / 在第 b 个桶结束的引用数，
+    在 b 之前分割时，左边的引用数是 entries[0..b) 之和，右边是 exits[b..] 之和。
+    */
+    [[nodiscard]] split spatial_split(const std::vector<reference> &refs,
+                                      const box3 &bounds, int axis) const
+    {
+        split best;
+        auto lo = bounds.min[axis];
+        auto extent = bounds.max[axis] - lo;
+        if (!(extent > 0))
+            return best;
+        auto bin_width = extent / k_bins;
+        auto bin_of = [&](double x) {
+            return std::clamp(static_cast<int>((x - lo) / bin_width), 0, k_bins - 1);
+        };
+
+        std::array<box3, k_bins> bin_boxes;
+        bin_boxes.fill(box3::empty());
+        std::array<size_t, k_bins> entries{};
+        std::array<size_t, k_bins> exits{};
+        for (const auto &ref : refs)
+        {
+            if (!ref.splittable)
+            {
+                // 与 partition_spatial 相同：按中心放进一个桶，包围盒不裁剪
+                auto b = bin_of(ref.box.centroid(axis));
+                bin_boxes[b].grow(ref.box);
+                entries[b]++;
+                exits[b]++;
+                continue;
+            }
+            auto first = bin_of(ref.box.min[axis]);
+            auto last = bin_of(ref.box.max[axis]);
+            for (int b = first; b <= last; b++)
+            {
+                auto piece = ref.box;
+                auto bin_max = lo + ((b + 1) * bin_width);
+                piece.min[axis] = std::max(piece.min[axis], lo + (b * bin_width));
+                if (b < k_bins - 1)
+                    piece.max[axis] = std::min(piece.max[axis], bin_max);
+                bin_boxes[b].grow(piece);
+            }
+            entries[first]++;
+            exits[last]++;
+        }
+
+        std::array<box3, k_bins> right_boxes;
+        std::array<size_t, k_bins> right_counts{};
+        auto acc = box3::empty();
+        size_t acc_count = 0;
+        for (int b = k_bins - 1; b > 0; b--)
+        {
+            acc.grow(bin_boxes[b]);
+            acc_count += exits[b];
+            right_boxes[b] = acc;
+            right_counts[b] = acc_count;
+        }
+
+        acc = box3::empty();
+        acc_count = 0;
+        for (int b = 1; b < k_bins; b++)
+        {
+            acc.grow(bin_boxes[b - 1]);
+            acc_count += entries[b - 1];
+            // 两边都要比父节点少：否则空间分割不会让问题变小
+            if (acc_count == 0 || right_counts[b] == 0 || acc_count == refs.size() ||
+                right_counts[b] == refs.size())
+                continue;
+            if (acc_count + right_counts[b] - refs.size() > ref_budget_)
+                continue;
+            auto cost = sah_cost(acc, acc_count, right_boxes[b], right_counts[b]);
+            if (cost < best.cost)
+                best = {cost, axis, b, true, lo + (b * bin_width)};
+        }
+        return best;
+    }
+
+    static void partition_object(const std::vector<reference> &refs, const split &s,
+                                 const box3 &centroid_bounds,
+                                 std::vector<reference> &left,
+                                 std::vector<reference> &right)
+    {
+        for (const auto &ref : refs)
+        {
+            if (centroid_bin(ref, s.axis, centroid_bounds) < s.bin)
+                left.push_back(ref);
+            else
+                right.push_back(ref);
+        }
+    }
+
+    // 完全在平面一侧的引用放到那一侧，跨过平面的引用裁剪成两份；不能分割的引用按中心放到一侧
+    void partition_spatial(const std::vector<reference> &refs, const split &s,
+                           std::vector<reference> &left, std::vector<reference> &right)
+    {
+        for (const auto &ref : refs)
+        {
+            if (!ref.splittable)
+                (ref.box.centroid(s.axis) < s.plane ? left : right).push_back(ref);
+            else if (ref.box.max[s.axis] <= s.plane)
+                left.push_back(ref);
+            else if (ref.box.min[s.axis] >= s.plane)
+                right.push_back(ref);
+            else
+            {
+                auto l = ref;
+                auto r = ref;
+                l.box.max[s.axis] = s.plane;
+                r.box.min[s.axis] = s.plane;
+                left.push_back(l);
+                right.push_back(r);
+            }
+        }
+        ref_budget_ -= std::min(ref_budget_, left.size() + right.size() - refs.size());
+    }
+};
+
+// 便捷函数：与 flat_bvh::build 参数相同，多一个引用增长上限
+inline flat_bvh build_sbvh(std::span<const aabb> boxes, int max_leaf_size = 2,
+                           double max_growth = 0.5)
+{
+    return sbvh_builder::build(boxes, max_leaf_size, max_growth);
+}
+
+// 从物体构建：hit() 带随机性的物体（体积介质）不做空间分割
+inline flat_bvh build_sbvh(std::span<const std::shared_ptr<hittable>> objects,
+                           int max_leaf_size = 2, double max_growth = 0.5)
+{
+    std::vector<aabb> boxes;
+    std::vector<uint8_t> unsplittable;
+    boxes.reserve(objects.size());
+    unsplittable.reserve(objects.size());
+    for (const auto &object : objects)
+    {
+        boxes.push_back(object->bounding_box());
+        unsplittable.push_back(object->stochastic() ? 1 : 0);
+    }
+    return sbvh_builder::build(boxes, max_leaf_size, max_growth, unsplittable);
+}
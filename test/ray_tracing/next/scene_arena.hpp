@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+/*
+NOTE: 场景内存池（arena）
+一个场景由成千上万个小对象组成：图元、材质、纹理、BVH 节点。每个都 make_shared 一次，
+也就是一次单独的堆分配，散落在堆上，遍历时父子节点、节点和它的图元常常不在同一个缓存行、同一页。
+scene_arena 是单调（bump）分配器：从大块内存里按构造顺序一个挨一个地切出对象，
+单个对象释放时什么也不做，arena 析构时所有块一次归还。
+
+对象仍然是 std::shared_ptr（std::allocate_shared：控制块和对象相邻，都在 arena 里），
+所以所有接受 shared_ptr<hittable> / shared_ptr<material> / shared_ptr<texture> 的接口都不用改。
+引用计数的原子操作还在，但只发生在构建和释放场景时；渲染时只借用裸指针（hit_record::mat 等）。
+
+约束：
+    arena 必须比从它分配的所有对象活得久：先声明 arena，再声明场景（局部变量按相反顺序析构）
+    对象的析构函数照常执行（释放它们自己持有的 vector 等），只是对象本身的内存不单独归还
+    不是线程安全的：场景在一个线程里构建
+*/
+class scene_arena // NOLINT
+{
+  public:
+    explicit scene_arena(size_t initial_bytes = size_t{1} << 20)
+        : pool_(initial_bytes, &upstream_)
+    {
+    }
+
+    scene_arena(const scene_arena &) = delete;
+    scene_arena &operator=(const scene_arena &) = delete;
+
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make(Args &&...args)
+    {
+        objects_++;
+        return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(&pool_),
+                                       std::forward<Args>(args)...);
+    }
+
+    [[nodiscard]] size_t objects() const
+    {
+        return objects_;
+    }
+
+    // 向系统申请的块数和总字节数（块大小按几何级数增长，块数很少）
+    [[nodiscard]] size_t blocks() const
+    {
+        return upstream_.blocks;
+    }
+
+    [[nodiscard]] size_t bytes_reserved() const
+    {
+        return upstream_.bytes;
+    }
+
+  private:
+    // 记录 monotonic_buffer_resource 向上游要了多少内存
+    struct counting_resource : std::pmr::memory_resource
+    {
+        size_t blocks = 0;
+        size_t bytes = 0;
+
+        void *do_allocate(size_t bytes_wanted, size_t alignment) override
+        {
+            blocks++;
+            bytes += bytes_wanted;
+            return std::pmr::new_delete_resource()->allocate(bytes_wanted, alignment);
+        }
+
+        void do_deallocate(void *p, size_t bytes_given, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes_given, alignment);
+        }
+
+        [[nodiscard]] bool do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    counting_resource upstream_; // 必须在 pool_ 之前构造、之后析构
+    std::pmr::monotonic_buffer_resource pool_;
+    size_t objects_ = 0;
+};
+
+// arena 为空时退回 std::make_shared：同一段场景构建代码可以用两种分配方式
+template <typename T, typename... Args>
+std::shared_ptr<T> arena_make(scene_arena *arena, Args &&...args)
+{
+    if (arena == nullptr)
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    return arena->make<T>(std::forward<Args>(args)...);
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "flat_bvh.hpp"
+#include "mapped_file.hpp"
+#include "scene_description.hpp"
+
+/*
+NOTE: 场景二进制缓存
+文件布局：一个定长文件头 + 若干段（section），每段按 16 字节对齐：
+
+    header   magic / 版本 / 字节序标记 / 场景内容哈希 / 每段的 (offset, bytes)
+    textures     texture_desc[]
+    materials    material_desc[]
+    shapes       shape_desc[]
+    modifiers    modifier_desc[]
+    strings      char[]
+    bvh_nodes    flat_bvh_node[]
+    bvh_indices  uint32_t[]
+
+加载时把整个文件 mmap 进来，各段直接当数组用（零拷贝）：
+不需要解析文本，也不需要重新构建 BVH，只剩下按描述创建对象这一步。
+内容哈希对不上（场景文件改过）、版本/字节序不同、或任何段越界，都视为缓存无效。
+*/
+class scene_cache // NOLINT
+{
+  public:
+    static constexpr uint32_t k_version = 1;
+
+    // 写缓存：先写临时文件再改名，中途失败不会留下半个缓存文件
+    static bool write(const std::string &path, uint64_t content_hash,
+                      const scene_description &scene, const flat_bvh &bvh)
+    {
+        std::array<std::span<const std::byte>, k_section_count> payloads = {
+            std::as_bytes(std::span(scene.textures)),
+            std::as_bytes(std::span(scene.materials)),
+            std::as_bytes(std::span(scene.shapes)),
+            std::as_bytes(std::span(scene.modifiers)),
+            std::as_bytes(std::span(scene.strings)),
+            std::as_bytes(bvh.nodes()),
+            std::as_bytes(bvh.prim_indices()),
+        };
+
+        header h{};
+        std::memcpy(h.magic, k_magic, sizeof(h.magic));
+        h.version = k_version;
+        h.endian = k_endian;
+        h.content_hash = content_hash;
+        uint64_t offset = align(sizeof(header));
+        for (size_t i = 0; i < k_section_count; i++)
+        {
+            h.sections[i] = {offset, payloads[i].size()};
+            offset = align(offset + payloads[i].size());
+        }
+
+        auto tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+            out.write(reinterpret_cast<const char *>(&h), sizeof(h)); // NOLINT
+            uint64_t written = sizeof(h);
+            for (size_t i = 0; i < k_section_count; i++)
+            {
+                static constexpr char k_zeros[k_alignment] = {};
+                out.write(k_zeros,
+                          static_cast<std::streamsize>(h.sections[i].offset - written));
+                out.write(reinterpret_cast<const char *>(payloads[i].data()), // NOLINT
+                          static_cast<std::streamsize>(payloads[i].size()));
+                written = h.sections[i].offset + payloads[i].size();
+            }
+            if (!out)
+                return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, path, ec);
+        return !ec;
+    }
+
+    /*
+    打开缓存。成功时 scene() / bvh() 指向映射的内存，
+    bvh() 返回的 flat_bvh 持有映射的引用，scene_cache 对象本身可以先销毁；
+    scene() 里的 span 则只在 scene_cache 存活期间有效。
+    */
+    bool open(const std::string &path, uint64_t expected_hash)
+    {
+        auto file = std::make_shared<mapped_file>(path);
+        if (!file->is_open())
+            return false;
+
+        auto bytes = file->bytes();
+        if (bytes.size() < sizeof(header))
+            return false;
+        header h{};
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        if (std::memcmp(h.magic, k_magic, sizeof(h.magic)) != 0 ||
+            h.version != k_version || h.endian != k_endian ||
+            h.content_hash != expected_hash)
+            return false;
+
+        for (const auto &s : h.sections)
+            if (s.offset % k_alignment != 0 || s.offset > bytes.size() ||
+                s.bytes > bytes.size() - s.offset)
+                return false;
+
+        scene_view scene;
+        std::span<const flat_bvh_node> nodes;
+        std::span<const uint32_t> indices;
+        if (!section(bytes, h, textures, scene.textures) ||
+            !section(bytes, h, materials, scene.materials) ||
+            !section(bytes, h, shapes, scene.shapes) ||
+            !section(bytes, h, modifiers, scene.modifiers) ||
+            !section(bytes, h, bvh_nodes, nodes) ||
+            !section(bytes, h, bvh_indices, indices))
+            return false;
+        const auto &string_section = h.sections[section_index::strings];
+        scene.strings = {reinterpret_cast<const char *>(bytes.data() + // NOLINT
+                                                        string_section.offset),
+                         string_section.bytes};
+
+        if (!scene.validate() || !validate_bvh(nodes, indices, scene.shapes.size()))
+            return false;
+
+        file_ = std::move(file);
+        scene_ = scene;
+        nodes_ = nodes;
+        indices_ = indices;
+        return true;
+    }
+
+    [[nodiscard]] const scene_view &scene() const
+    {
+        return scene_;
+    }
+
+    [[nodiscard]] flat_bvh bvh() const
+    {
+        return {nodes_, indices_, file_};
+    }
+
+  private:
+    static constexpr char k_magic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+    static constexpr uint32_t k_endian = 0x01020304;
+    static constexpr uint64_t k_alignment = 16;
+
+    enum section_index : uint32_t // NOLINT
+    {
+        textures,
+        materials,
+        shapes,
+        modifiers,
+        strings,
+        bvh_nodes,
+        bvh_indices,
+        k_section_count,
+    };
+
+    struct section_entry
+    {
+        uint64_t offset;
+        uint64_t bytes;
+    };
+
+    struct header
+    {
+        char magic[8]; // NOLINT
+        uint32_t version;
+        uint32_t endian; // 写入端的 0x01020304，读出来不一样说明字节序不同
+        uint64_t content_hash;
+        section_entry sections[k_section_count]; // NOLINT
+    };
+
+    std::shared_ptr<const mapped_file> file_;
+    scene_view scene_;
+    std::span<const flat_bvh_node> nodes_;
+    std::span<const uint32_t> indices_;
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + k_alignment - 1) / k_alignment * k_alignment;
+    }
+
+    // NOTE: mmap 的起始地址按页对齐，段又按 16 字节对齐，所以可以直接把字节解释成结构体数组
+    template <typename T>
+    static bool section(std::span<const std::byte> bytes, const header &h,
+                        section_index index, std::span<const T> &out)
+    {
+        static_assert(alignof(T) <= k_alignment);
+        const auto &s = h.sections[index];
+        if (s.bytes % sizeof(T) != 0)
+            return false;
+        out = {reinterpret_cast<const T *>(bytes.data() + s.offset), // NOLINT
+               s.bytes / sizeof(T)};
+        return true;
+    }
+
+    // 孩子下标必须比父节点大（深度优先布局），这样不会有环；同时检查深度不超过遍历栈
+    static bool validate_bvh(std::span<const flat_bvh_node> nodes,
+                             std::span<const uint32_t> indices, size_t prim_count)
+    {
+        if (indices.size() != prim_count || (nodes.empty() != (prim_count == 0)))
+            return false;
+        for (auto prim : indices)
+            if (prim >= prim_count)
+                return false;
+
+        std::vector<uint32_t> depth(nodes.size(), 0);
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            const auto &node = nodes[i];
+            if (depth[i] >= flat_bvh::k_max_depth)
+                return false;
+            if (node.count > 0)
+            {
+                if (static_cast<uint64_t>(node.offset) + node.count > indices.size())
+                    return false;
+                continue;
+            }
+            if (node.offset <= i + 1 || node.offset >= nodes.size() || node.axis > 2)
+                return false;
+            depth[i + 1] = std::max(depth[i + 1], depth[i] + 1);
+            depth[node.offset] = std::max(depth[node.offset], depth[i] + 1);
+        }
+        return true;
+    }
+};
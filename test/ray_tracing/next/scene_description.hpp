@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "camera.hpp"
+#include "constant_medium.hpp"
+#include "hittable.hpp"
+#include "material.hpp"
+#include "quad.hpp"
+#include "sphere.hpp"
+#include "texture.hpp"
+
+/*
+NOTE: 场景描述（"编译后"的场景）
+文本场景文件解析后得到的是一组纯数据数组，而不是 shared_ptr 对象图：
+    textures / materials / shapes / modifiers：定长结构体，互相之间用数组下标引用
+    strings：所有字符串（图片路径）拼在一起，结构体里只存 offset + length
+这样同一份数据既可以在内存里直接用，也可以原样写进二进制缓存、再用 mmap 读回来。
+instantiate() 负责把它变成真正的 hittable / material / texture 对象。
+
+所以这些结构体必须是 trivially copyable，且不含指针；字段按 8 字节对齐排列，避免隐式填充。
+*/
+enum class texture_kind : uint32_t // NOLINT
+{
+    solid,      // albedo
+    checker,    // scale, even, odd
+    image,      // path
+    noise,      // scale -> noise_texture_with_vec
+    turbulence, // scale -> noise_texture_with_vec_and_turb
+    marble,     // scale -> noise_texture_with_vec_and_turb_phase
+};
+
+struct texture_desc // NOLINT
+{
+    color albedo;
+    double scale = 1;
+    texture_kind kind = texture_kind::solid;
+    uint32_t even = 0; // checker 的两个子纹理，只能引用之前定义的纹理
+    uint32_t odd = 0;
+    uint32_t path_offset = 0; // image 的文件路径在 strings 中的位置
+    uint32_t path_length = 0;
+    uint32_t pad = 0;
+};
+
+enum class material_kind : uint32_t // NOLINT
+{
+    lambertian,    // texture
+    metal,         // albedo, param = fuzz
+    dielectric,    // param = refraction index
+    diffuse_light, // texture
+    isotropic,     // texture
+};
+
+struct material_desc // NOLINT
+{
+    color albedo;
+    double param = 0;
+    material_kind kind = material_kind::lambertian;
+    uint32_t texture = 0;
+};
+
+enum class shape_kind : uint32_t // NOLINT
+{
+    sphere,        // p0 = center, radius
+    moving_sphere, // p0 = center (time=0), p1 = center (time=1), radius
+    quad,          // p0 = Q, p1 = u, p2 = v
+    box,           // p0, p1 = 对角顶点
+};
+
+// NOTE: 形状外面一层层套上的修饰：按文件中的书写顺序从内到外应用
+enum class modifier_kind : uint32_t // NOLINT
+{
+    translate,       // offset
+    rotate_y,        // value = 角度
+    constant_medium, // value = density, texture
+};
+
+struct modifier_desc // NOLINT
+{
+    vec3 offset;
+    double value = 0;
+    modifier_kind kind = modifier_kind::translate;
+    uint32_t texture = 0;
+};
+
+struct shape_desc // NOLINT
+{
+    point3 p0, p1, p2;
+    double radius = 0;
+    shape_kind kind = shape_kind::sphere;
+    uint32_t material = 0;
+    uint32_t first_modifier = 0;
+    uint32_t modifier_count = 0;
+};
+
+struct camera_desc // NOLINT
+{
+    point3 lookfrom = point3(0, 0, 0);
+    point3 lookat = point3(0, 0, -1);
+    vec3 vup = vec3(0, 1, 0);
+    color background = color(0, 0, 0);
+    double aspect_ratio = 1.0;
+    double vfov = 90;
+    double defocus_angle = 0;
+    double focus_dist = 10;
+    int32_t image_width = 100;
+    int32_t samples_per_pixel = 10;
+    int32_t max_depth = 10;
+    int32_t sky = 0; // 非 0：背景用 camera::render 的天空渐变，而不是纯色 background
+
+    void apply_to(camera &cam) const
+    {
+        cam.aspect_ratio = aspect_ratio;
+        cam.image_width = image_width;
+        cam.samples_per_pixel = samples_per_pixel;
+        cam.max_depth = max_depth;
+        cam.vfov = vfov;
+        cam.lookfrom = lookfrom;
+        cam.lookat = lookat;
+        cam.vup = vup;
+        cam.defocus_angle = defocus_angle;
+        cam.focus_dist = focus_dist;
+        cam.background = background;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<texture_desc>);
+static_assert(std::is_trivially_copyable_v<material_desc>);
+static_assert(std::is_trivially_copyable_v<modifier_desc>);
+static_assert(std::is_trivially_copyable_v<shape_desc>);
+
+// 不拥有数据的场景视图：数据可以在 scene_description 里，也可以在 mmap 的缓存文件里
+struct scene_view // NOLINT
+{
+    std::span<const texture_desc> textures;
+    std::span<const material_desc> materials;
+    std::span<const shape_desc> shapes;
+    std::span<const modifier_desc> modifiers;
+    std::string_view strings;
+
+    // 检查所有类型标签和下标引用都在范围内；缓存文件可能被截断或损坏，用之前必须先检查。
+    // 类型标签超出枚举范围时 instantiate() 的 switch 哪个分支都不进，会得到空指针
+    [[nodiscard]] bool validate() const
+    {
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            const auto &t = textures[i];
+            if (t.kind > texture_kind::marble)
+                return false;
+            if (t.kind == texture_kind::checker && (t.even >= i || t.odd >= i))
+                return false;
+            if (t.kind == texture_kind::image &&
+                static_cast<size_t>(t.path_offset) + t.path_length > strings.size())
+                return false;
+        }
+        for (const auto &m : materials)
+        {
+            if (m.kind > material_kind::isotropic)
+                return false;
+            if (m.texture >= textures.size() && m.kind != material_kind::metal &&
+                m.kind != material_kind::dielectric)
+                return false;
+        }
+        for (const auto &m : modifiers)
+        {
+            if (m.kind > modifier_kind::constant_medium)
+                return false;
+            if (m.kind == modifier_kind::constant_medium && m.texture >= textures.size())
+                return false;
+        }
+        for (const auto &s : shapes)
+            if (s.kind > shape_kind::box || s.material >= materials.size() ||
+                static_cast<size_t>(s.first_modifier) + s.modifier_count >
+                    modifiers.size())
+                return false;
+        return true;
+    }
+};
+
+struct scene_description // NOLINT
+{
+    camera_desc camera;
+    std::vector<texture_desc> textures;
+    std::vector<material_desc> materials;
+    std::vector<shape_desc> shapes;
+    std::vector<modifier_desc> modifiers;
+    std::string strings;
+
+    [[nodiscard]] scene_view view() const
+    {
+        return {textures, materials, shapes, modifiers, strings};
+    }
+};
+
+/*
+NOTE: 把场景描述变成对象。返回的数组与 shapes 一一对应（同样的下标），
+所以基于 shapes 包围盒构建的 BVH 可以直接用在返回的对象上。
+纹理、材质只创建一次，被多个形状共享（图片纹理只加载一次）。
+*/
+inline std::vector<std::shared_ptr<hittable>> instantiate(const scene_view &scene)
+{
+    std::vector<std::shared_ptr<texture>> textures;
+    textures.reserve(scene.textures.size());
+    for (const auto &t : scene.textures)
+    {
+        switch (t.kind)
+        {
+        case texture_kind::solid:
+            textures.push_back(std::make_shared<solid_color>(t.albedo));
+            break;
+        case texture_kind::checker:
+            textures.push_back(std::make_shared<checker_texture>(
+                t.scale, textures[t.even], textures[t.odd]));
+            break;
+        case texture_kind::image: {
+            auto path = std::string(scene.strings.substr(t.path_offset, t.path_length));
+            textures.push_back(std::make_shared<image_texture>(path.c_str()));
+            break;
+        }
+        case texture_kind::noise:
+            textures.push_back(std::make_shared<noise_texture_with_vec>(t.scale));
+            break;
+        case texture_kind::turbulence:
+            textures.push_back(
+                std::make_shared<noise_texture_with_vec_and_turb>(t.scale));
+            break;
+        case texture_kind::marble:
+            textures.push_back(
+                std::make_shared<noise_texture_with_vec_and_turb_phase>(t.scale));
+            break;
+        }
+    }
+
+    std::vector<std::shared_ptr<material>> materials;
+    materials.reserve(scene.materials.size());
+    for (const auto &m : scene.materials)
+    {
+        switch (m.kind)
+        {
+        case material_kind::lambertian:
+            materials.push_back(std::make_shared<lambertian>(textures[m.texture]));
+            break;
+        case material_kind::metal:
+            materials.push_back(std::make_shared<metal>(m.albedo, m.param));
+            break;
+        case material_kind::dielectric:
+            materials.push_back(std::make_shared<dielectric>(m.param));
+            break;
+        case material_kind::diffuse_light:
+            materials.push_back(std::make_shared<diffuse_light>(textures[m.texture]));
+            break;
+        case material_kind::isotropic:
+            materials.push_back(std::make_shared<isotropic>(textures[m.texture]));
+            break;
+        }
+    }
+
+    std::vector<std::shared_ptr<hittable>> objects;
+    objects.reserve(scene.shapes.size());
+    for (const auto &s : scene.shapes)
+    {
+        const auto &mat = materials[s.material];
+        std::shared_ptr<hittable> object;
+        switch (s.kind)
+        {
+        case shape_kind::sphere:
+            object = std::make_shared<sphere>(s.p0, s.radius, mat);
+            break;
+        case shape_kind::moving_sphere:
+            object = std::make_shared<sphere>(s.p0, s.p1, s.radius, mat);
+            break;
+        case shape_kind::quad:
+            object = std::make_shared<quad>(s.p0, s.p1, s.p2, mat);
+            break;
+        case shape_kind::box:
+            object = box(s.p0, s.p1, mat);
+            break;
+        }
+
+        for (const auto &m : scene.modifiers.subspan(s.first_modifier, s.modifier_count))
+        {
+            switch (m.kind)
+            {
+            case modifier_kind::translate:
+                object = std::make_shared<translate>(object, m.offset);
+                break;
+            case modifier_kind::rotate_y:
+                object = std::make_shared<rotate_y>(object, m.value);
+                break;
+            case modifier_kind::constant_medium:
+                object = std::make_shared<constant_medium>(object, m.value,
+                                                           textures[m.texture]);
+                break;
+            }
+        }
+        objects.push_back(std::move(object));
+    }
+    return objects;
+}
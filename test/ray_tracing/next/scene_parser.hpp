@@ -0,0 +1,506 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "scene_description.hpp"
+
+/*
+NOTE: 文本场景格式
+一行一条指令，# 之后是注释，空白分隔。纹理、材质先定义名字，再被引用：
+
+    camera  width 600 spp 200 depth 50 aspect 16/9 vfov 40
+    camera  lookfrom 278 278 -800 lookat 278 278 0 vup 0 1 0 defocus_angle 0 focus_dist 10
+    background 0 0 0                  # 或 background sky：使用天空渐变
+
+    texture <名字> solid r g b
+    texture <名字> checker <scale> <纹理> <纹理>
+    texture <名字> image <文件名>
+    texture <名字> noise|turbulence|marble <scale>
+
+    material <名字> lambertian <纹理>
+    material <名字> metal r g b <fuzz>
+    material <名字> dielectric <折射率>
+    material <名字> light <纹理>
+    material <名字> isotropic <纹理>
+
+    sphere x y z <半径> <材质> [to x y z]  # to：快门关闭时的球心（运动模糊）
+    quad   Qx Qy Qz ux uy uz vx vy vz <材质>
+    box    ax ay az bx by bz <材质>
+
+"<纹理>" 可以是纹理名字，也可以是 rgb r g b（就地定义一个纯色纹理）。
+形状后面可以跟任意个修饰，按书写顺序从内到外套上：
+    rotate_y <角度>
+    translate x y z
+    medium <密度> <纹理>              # 把形状当作边界，变成 constant_medium
+
+camera / background 只影响相机，不参与 scene_content_hash()：
+只改相机参数时，二进制缓存（几何 + BVH）仍然有效。
+*/
+class scene_parser // NOLINT
+{
+  public:
+    explicit scene_parser(scene_description &scene) : scene_(scene) {}
+
+    static bool is_camera_line(std::string_view keyword)
+    {
+        return keyword == "camera" || keyword == "background";
+    }
+
+    // 去掉注释和首尾空白
+    static std::string_view strip(std::string_view line)
+    {
+        if (auto comment = line.find('#'); comment != std::string_view::npos)
+            line = line.substr(0, comment);
+        auto is_space = [](char c) {
+            return std::isspace(static_cast<unsigned char>(c)) != 0;
+        };
+        while (!line.empty() && is_space(line.front()))
+            line.remove_prefix(1);
+        while (!line.empty() && is_space(line.back()))
+            line.remove_suffix(1);
+        return line;
+    }
+
+    static std::string_view first_word(std::string_view line)
+    {
+        auto end = std::find_if(line.begin(), line.end(), [](char c) {
+            return std::isspace(static_cast<unsigned char>(c));
+        });
+        return line.substr(0, end - line.begin());
+    }
+
+    // 按空白切分（line 已经 strip 过）
+    static std::vector<std::string_view> tokenize(std::string_view line)
+    {
+        std::vector<std::string_view> tokens;
+        size_t i = 0;
+        while (i < line.size())
+        {
+            while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i])))
+                i++;
+            auto begin = i;
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i])))
+                i++;
+            if (i > begin)
+                tokens.push_back(line.substr(begin, i - begin));
+        }
+        return tokens;
+    }
+
+    // 逐行遍历非空行，f(行号, strip 后的行)；f 返回 false 时停止
+    template <typename F>
+    static bool for_each_line(std::string_view text, F &&f)
+    {
+        int line_number = 0;
+        while (!text.empty())
+        {
+            auto end = text.find('\n');
+            auto line = strip(text.substr(0, end));
+            text = (end == std::string_view::npos) ? std::string_view{}
+                                                   : text.substr(end + 1);
+            line_number++;
+
+            if (!line.empty() && !f(line_number, line))
+                return false;
+        }
+        return true;
+    }
+
+    bool parse_line(int line_number, const std::vector<std::string_view> &tokens)
+    {
+        line_number_ = line_number;
+        tokens_ = &tokens;
+        pos_ = 1;
+
+        auto keyword = tokens[0];
+        bool ok = false;
+        if (keyword == "camera")
+            ok = parse_camera();
+        else if (keyword == "background")
+            ok = parse_background();
+        else if (keyword == "texture")
+            ok = parse_texture();
+        else if (keyword == "material")
+            ok = parse_material();
+        else if (keyword == "sphere" || keyword == "quad" || keyword == "box")
+            ok = parse_shape(keyword);
+        else
+            return error("unknown directive '" + std::string(keyword) + "'");
+
+        if (ok && pos_ < tokens.size())
+            return error("unexpected '" + std::string(tokens[pos_]) + "'");
+        return ok;
+    }
+
+  private:
+    scene_description &scene_;
+    std::unordered_map<std::string, uint32_t> texture_names_;
+    std::unordered_map<std::string, uint32_t> material_names_;
+
+    int line_number_ = 0;
+    const std::vector<std::string_view> *tokens_ = nullptr;
+    size_t pos_ = 0;
+
+    bool error(const std::string &message) const
+    {
+        std::cerr << "ERROR: scene line " << line_number_ << ": " << message << '\n';
+        return false;
+    }
+
+    [[nodiscard]] bool at_end() const
+    {
+        return pos_ >= tokens_->size();
+    }
+
+    bool word(std::string_view &out)
+    {
+        if (at_end())
+            return error("unexpected end of line");
+        out = (*tokens_)[pos_++];
+        return true;
+    }
+
+    // 数字，也接受 a/b 形式的分数（方便写 16/9 这样的宽高比）
+    bool number(double &out)
+    {
+        std::string_view token;
+        if (!word(token))
+            return false;
+
+        auto parse = [](std::string_view s, double &value) {
+            const auto *end = s.data() + s.size();
+            auto [ptr, ec] = std::from_chars(s.data(), end, value);
+            return ec == std::errc() && ptr == end;
+        };
+        auto slash = token.find('/');
+        if (slash == std::string_view::npos)
+        {
+            if (parse(token, out))
+                return true;
+        }
+        else
+        {
+            double num = 0;
+            double den = 0;
+            if (parse(token.substr(0, slash), num) &&
+                parse(token.substr(slash + 1), den) && den != 0)
+            {
+                out = num / den;
+                return true;
+            }
+        }
+        return error("expected a number, got '" + std::string(token) + "'");
+    }
+
+    // 整数都是数量（宽度、样本数、反弹次数），不能小于 minimum；超出 int32 的值转换是未定义行为
+    bool integer(int32_t &out, int32_t minimum)
+    {
+        double value = 0;
+        if (!number(value))
+            return false;
+        if (!(value >= minimum && value <= std::numeric_limits<int32_t>::max()))
+            return error(std::format("expected an integer >= {}, got '{}'", minimum,
+                                     (*tokens_)[pos_ - 1]));
+        out = static_cast<int32_t>(value);
+        return true;
+    }
+
+    bool vector3(vec3 &out)
+    {
+        double x = 0;
+        double y = 0;
+        double z = 0;
+        if (!number(x) || !number(y) || !number(z))
+            return false;
+        out = vec3(x, y, z);
+        return true;
+    }
+
+    bool new_name(std::string_view &name,
+                  const std::unordered_map<std::string, uint32_t> &names)
+    {
+        if (!word(name))
+            return false;
+        if (names.contains(std::string(name)))
+            return error("'" + std::string(name) + "' is already defined");
+        return true;
+    }
+
+    // <纹理> := 名字 | rgb r g b
+    bool texture_ref(uint32_t &out)
+    {
+        std::string_view name;
+        if (!word(name))
+            return false;
+        if (name == "rgb")
+        {
+            texture_desc t;
+            if (!vector3(t.albedo))
+                return false;
+            out = static_cast<uint32_t>(scene_.textures.size());
+            scene_.textures.push_back(t);
+            return true;
+        }
+        auto it = texture_names_.find(std::string(name));
+        if (it == texture_names_.end())
+            return error("unknown texture '" + std::string(name) + "'");
+        out = it->second;
+        return true;
+    }
+
+    bool material_ref(uint32_t &out)
+    {
+        std::string_view name;
+        if (!word(name))
+            return false;
+        auto it = material_names_.find(std::string(name));
+        if (it == material_names_.end())
+            return error("unknown material '" + std::string(name) + "'");
+        out = it->second;
+        return true;
+    }
+
+    bool parse_camera()
+    {
+        auto &cam = scene_.camera;
+        while (!at_end())
+        {
+            std::string_view key;
+            word(key);
+            bool ok = false;
+            if (key == "width")
+                ok = integer(cam.image_width, 1);
+            else if (key == "spp")
+                ok = integer(cam.samples_per_pixel, 1);
+            else if (key == "depth")
+                ok = integer(cam.max_depth, 0);
+            else if (key == "aspect")
+                ok = number(cam.aspect_ratio);
+            else if (key == "vfov")
+                ok = number(cam.vfov);
+            else if (key == "lookfrom")
+                ok = vector3(cam.lookfrom);
+            else if (key == "lookat")
+                ok = vector3(cam.lookat);
+            else if (key == "vup")
+                ok = vector3(cam.vup);
+            else if (key == "defocus_angle")
+                ok = number(cam.defocus_angle);
+            else if (key == "focus_dist")
+                ok = number(cam.focus_dist);
+            else
+                return error("unknown camera parameter '" + std::string(key) + "'");
+            if (!ok)
+                return false;
+        }
+        return true;
+    }
+
+    bool parse_background()
+    {
+        if (!at_end() && (*tokens_)[pos_] == "sky")
+        {
+            pos_++;
+            scene_.camera.sky = 1;
+            return true;
+        }
+        scene_.camera.sky = 0;
+        return vector3(scene_.camera.background);
+    }
+
+    bool parse_texture()
+    {
+        std::string_view name;
+        std::string_view kind;
+        if (!new_name(name, texture_names_) || !word(kind))
+            return false;
+
+        texture_desc t;
+        bool ok = false;
+        if (kind == "solid")
+        {
+            t.kind = texture_kind::solid;
+            ok = vector3(t.albedo);
+        }
+        else if (kind == "checker")
+        {
+            t.kind = texture_kind::checker;
+            ok = number(t.scale) && texture_ref(t.even) && texture_ref(t.odd);
+        }
+        else if (kind == "image")
+        {
+            std::string_view path;
+            t.kind = texture_kind::image;
+            ok = word(path);
+            t.path_offset = static_cast<uint32_t>(scene_.strings.size());
+            t.path_length = static_cast<uint32_t>(path.size());
+            scene_.strings += path;
+        }
+        else if (kind == "noise" || kind == "turbulence" || kind == "marble")
+        {
+            t.kind = (kind == "noise")        ? texture_kind::noise
+                     : (kind == "turbulence") ? texture_kind::turbulence
+                                              : texture_kind::marble;
+            ok = number(t.scale);
+        }
+        else
+            return error("unknown texture type '" + std::string(kind) + "'");
+
+        if (!ok)
+            return false;
+        texture_names_[std::string(name)] = static_cast<uint32_t>(scene_.textures.size());
+        scene_.textures.push_back(t);
+        return true;
+    }
+
+    bool parse_material()
+    {
+        std::string_view name;
+        std::string_view kind;
+        if (!new_name(name, material_names_) || !word(kind))
+            return false;
+
+        material_desc m;
+        bool ok = false;
+        if (kind == "lambertian" || kind == "light" || kind == "isotropic")
+        {
+            m.kind = (kind == "lambertian") ? material_kind::lambertian
+                     : (kind == "light")    ? material_kind::diffuse_light
+                                            : material_kind::isotropic;
+            ok = texture_ref(m.texture);
+        }
+        else if (kind == "metal")
+        {
+            m.kind = material_kind::metal;
+            ok = vector3(m.albedo) && number(m.param);
+        }
+        else if (kind == "dielectric")
+        {
+            m.kind = material_kind::dielectric;
+            ok = number(m.param);
+        }
+        else
+            return error("unknown material type '" + std::string(kind) + "'");
+
+        if (!ok)
+            return false;
+        material_names_[std::string(name)] =
+            static_cast<uint32_t>(scene_.materials.size());
+        scene_.materials.push_back(m);
+        return true;
+    }
+
+    bool parse_shape(std::string_view keyword)
+    {
+        shape_desc s;
+        bool ok = false;
+        if (keyword == "sphere")
+        {
+            s.kind = shape_kind::sphere;
+            ok = vector3(s.p0) && number(s.radius) && material_ref(s.material);
+            if (ok && !at_end() && (*tokens_)[pos_] == "to")
+            {
+                pos_++;
+                s.kind = shape_kind::moving_sphere;
+                ok = vector3(s.p1);
+            }
+        }
+        else if (keyword == "quad")
+        {
+            s.kind = shape_kind::quad;
+            ok = vector3(s.p0) && vector3(s.p1) && vector3(s.p2) &&
+                 material_ref(s.material);
+        }
+        else
+        {
+            s.kind = shape_kind::box;
+            ok = vector3(s.p0) && vector3(s.p1) && material_ref(s.material);
+        }
+        if (!ok)
+            return false;
+
+        s.first_modifier = static_cast<uint32_t>(scene_.modifiers.size());
+        while (!at_end())
+        {
+            std::string_view key;
+            word(key);
+            modifier_desc m;
+            if (key == "translate")
+            {
+                m.kind = modifier_kind::translate;
+                ok = vector3(m.offset);
+            }
+            else if (key == "rotate_y")
+            {
+                m.kind = modifier_kind::rotate_y;
+                ok = number(m.value);
+            }
+            else if (key == "medium")
+            {
+                m.kind = modifier_kind::constant_medium;
+                ok = number(m.value) && texture_ref(m.texture);
+            }
+            else
+                return error("unknown modifier '" + std::string(key) + "'");
+            if (!ok)
+                return false;
+            scene_.modifiers.push_back(m);
+        }
+        s.modifier_count =
+            static_cast<uint32_t>(scene_.modifiers.size()) - s.first_modifier;
+        scene_.shapes.push_back(s);
+        return true;
+    }
+};
+
+/*
+解析场景文本。camera_only = true 时只解析 camera / background，
+其余行连切分都不做，用于缓存命中时快速拿到相机参数。
+出错时打印行号并返回 false。
+*/
+inline bool parse_scene(std::string_view text, scene_description &scene,
+                        bool camera_only = false)
+{
+    scene_parser p(scene);
+    return scene_parser::for_each_line(text, [&](int line_number, std::string_view line) {
+        if (camera_only && !scene_parser::is_camera_line(scene_parser::first_word(line)))
+            return true;
+        return p.parse_line(line_number, scene_parser::tokenize(line));
+    });
+}
+
+/*
+NOTE: 场景内容的 FNV-1a 哈希，作为缓存是否过期的依据。
+只哈希去掉注释、首尾空白后的非相机行：改相机、改注释都不会让缓存失效。
+直接哈希原始字节，不做切分，大场景上也只是一次线性扫描。
+*/
+inline uint64_t scene_content_hash(std::string_view text)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto feed = [&](std::string_view bytes) {
+        for (auto c : bytes)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+    };
+    scene_parser::for_each_line(text, [&](int /*line_number*/, std::string_view line) {
+        if (!scene_parser::is_camera_line(scene_parser::first_word(line)))
+        {
+            feed(line);
+            feed("\n");
+        }
+        return true;
+    });
+    return hash;
+}
@@ -31,55 +31,72 @@ class sphere : public hittable // NOLINT
 
     bool hit(const ray &r, interval ray_t, hit_record &rec) const override
     {
-        // NOTE: 需要从 射线中，获得中心点 才能兼容原本的代码
-        point3 current_center = center_.at(r.time()); // NOTE: 运动中心的位置，时间确定
-        vec3 oc = current_center - r.origin();
-
-        auto a = r.direction().length_squared();
-        auto h = dot(r.direction(), oc);
-        auto c = oc.length_squared() - (radius_ * radius_);
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
 
-        auto discriminant = (h * h) - (a * c);
-        if (discriminant < 0)
+    // 只求 t；法线、UV（acos + atan2）留给 surface_interaction()
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        count_stat(render_stat::sphere_tests);
+        double root = 0;
+        if (!find_root(r, ray_t, root))
             return false;
+        rec.t = root;
+        rec.deferred = this;
+        return true;
+    }
 
-        auto sqrtd = std::sqrt(discriminant);
+    void surface_interaction(const ray &r, hit_record &rec) const override
+    {
+        set_hit_record(r, rec.t, rec);
+    }
 
-        // Find the nearest root that lies in the acceptable range.
-        auto root = (h - sqrtd) / a;
-        if (!ray_t.surrounds(root))
-        {
-            root = (h + sqrtd) / a;
-            if (!ray_t.surrounds(root))
-                return false;
-        }
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        count_stat(render_stat::sphere_tests);
+        double root = 0;
+        return find_root(r, ray_t, root);
+    }
+
+    // 已知交点参数 root 时填写命中记录；批量求交（flat_bvh_accel 的球叶子）选出最近的球后调用
+    void set_hit_record(const ray &r, double root, hit_record &rec) const
+    {
+        point3 current_center = center_.at(r.time());
         rec.t = root;
         rec.p = r.at(rec.t);
 
         vec3 outward_normal = (rec.p - current_center) / radius_;
         rec.set_face_normal(r, outward_normal);
 
-        rec.mat = mat_;
+        rec.mat = mat_.get();
 
         // NOTE: 填写球体 u,v 的坐标
         get_sphere_uv(outward_normal, rec.u, rec.v);
-
-        return true;
     }
 
-    [[nodiscard]] aabb bounding_box() const override
+    // 静止的球才能把球心预先取出来做批量求交
+    [[nodiscard]] bool is_moving() const
     {
-        return bbox_;
+        return center_.direction().length_squared() > 0;
     }
 
-  private:
-    ray center_; // NOTE: 1. 运动模糊需要让 点 变成射线类
-    double radius_;
+    [[nodiscard]] point3 center() const
+    {
+        return center_.origin();
+    }
 
-    // 带有添加材料信息的Ray球体交集
-    std::shared_ptr<material> mat_;
+    [[nodiscard]] double radius() const
+    {
+        return radius_;
+    }
 
-    aabb bbox_;
+    [[nodiscard]] const material *surface_material() const
+    {
+        return mat_.get();
+    }
 
     static void get_sphere_uv(const point3 &p, double &u, double &v)
     {
@@ -96,4 +113,59 @@ class sphere : public hittable // NOLINT
         u = phi / (2 * pi);
         v = theta / pi;
     }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        out.push_back(mat_.get());
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return bbox_;
+    }
+
+    // NOTE: 球心沿直线运动，任意时刻的包围盒就是 t=0 与 t=1 包围盒的线性插值
+    [[nodiscard]] aabb bounding_box_at(double time) const override
+    {
+        auto rvec = vec3(radius_, radius_, radius_);
+        auto center = center_.at(time);
+        return {center - rvec, center + rvec};
+    }
+
+  private:
+    ray center_; // NOTE: 1. 运动模糊需要让 点 变成射线类
+    double radius_;
+
+    // 带有添加材料信息的Ray球体交集
+    std::shared_ptr<material> mat_;
+
+    aabb bbox_;
+
+    // ray_t 内最近的根
+    bool find_root(const ray &r, const interval &ray_t, double &root) const
+    {
+        // NOTE: 需要从 射线中，获得中心点 才能兼容原本的代码
+        point3 current_center = center_.at(r.time()); // NOTE: 运动中心的位置，时间确定
+        vec3 oc = current_center - r.origin();
+
+        auto a = r.direction().length_squared();
+        auto h = dot(r.direction(), oc);
+        auto c = oc.length_squared() - (radius_ * radius_);
+
+        auto discriminant = (h * h) - (a * c);
+        if (discriminant < 0)
+            return false;
+
+        auto sqrtd = std::sqrt(discriminant);
+
+        // Find the nearest root that lies in the acceptable range.
+        root = (h - sqrtd) / a;
+        if (!ray_t.surrounds(root))
+        {
+            root = (h + sqrtd) / a;
+            if (!ray_t.surrounds(root))
+                return false;
+        }
+        return true;
+    }
 };
@@ -0,0 +1,379 @@
+#include "accumulation_buffer.hpp"
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 多进程分布式渲染
+一幅图拆成若干 render_region，每个 worker 进程渲染一块，写一个部分累加文件（.accum），
+最后把所有部分文件按样本数加权合并。worker 之间不通信，只需要同一个可执行程序和同样的参数，
+所以 worker 可以在本机，也可以在别的机器上跑，把 .accum 文件拷回来再合并。
+
+    worker：渲染一个区域
+        test_distributed_render worker -o part.accum [--region x0 y0 x1 y1 s0 s1]
+                                [--seed-offset K] [场景参数]
+    merge：合并部分文件，输出 PPM（可选再输出合并后的 .accum）
+        test_distributed_render merge -o out.ppm [--accum merged.accum] part1.accum ...
+    local：本机协调器，启动 N 个 worker 进程，等它们结束后合并
+        test_distributed_render local [--workers N] [--split rows|samples] [-o out.ppm]
+                                [--verify] [场景参数]
+场景参数：--scene 名字（bvh / cornell_box / cornell_smoke / perlin / final_scene，默认 cornell_box）
+          --width N --spp N --sampler independent|stratified|halton|sobol --seed N
+--seed 同时用于构建场景和采样器；--seed-offset 只加到渲染用的线程随机引擎上，
+independent 采样器按样本切分时每个 worker 的 offset 要不同，否则各部分的样本完全一样。
+--verify：合并后在本进程里再完整渲染一次，逐像素比较（按行切分应完全相同）。
+*/
+
+double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+struct scene_options
+{
+    std::string scene = "cornell_box";
+    int width = 200;
+    int spp = 64;
+    sampler_type sampling = sampler_type::sobol;
+    uint32_t seed = 20240601;
+};
+
+// 解析场景参数；不是场景参数时返回 false，由调用者继续解析
+bool parse_scene_option(const std::string &key, const std::string &value,
+                        scene_options &options)
+{
+    if (key == "--scene")
+        options.scene = value;
+    else if (key == "--width")
+        options.width = std::stoi(value);
+    else if (key == "--spp")
+        options.spp = std::stoi(value);
+    else if (key == "--seed")
+        options.seed = static_cast<uint32_t>(std::stoul(value));
+    else if (key == "--sampler")
+    {
+        if (!parse_sampler_type(value, options.sampling))
+        {
+            std::cerr << "ERROR: unknown sampler '" << value << "'.\n";
+            std::exit(1);
+        }
+    }
+    else
+        return false;
+    return true;
+}
+
+std::string scene_arguments(const scene_options &options)
+{
+    return std::format("--scene {} --width {} --spp {} --sampler {} --seed {}",
+                       options.scene, options.width, options.spp,
+                       sampler_type_name(options.sampling), options.seed);
+}
+
+struct prepared_scene
+{
+    reference_scene scene;
+    std::shared_ptr<hittable> world;
+};
+
+bool prepare_scene(const scene_options &options, prepared_scene &out)
+{
+    accel_builder build_accel = [](const hittable_list &list) {
+        return std::make_shared<flat_bvh_accel>(list);
+    };
+
+    // 与 bench_ray_tracing 相同：固定种子构建场景，每个 worker 得到完全相同的场景
+    seed_random(options.seed);
+    if (options.scene == "bvh")
+        out.scene = bvh_scene();
+    else if (options.scene == "cornell_box")
+        out.scene = cornell_box_scene();
+    else if (options.scene == "cornell_smoke")
+        out.scene = cornell_smoke_scene();
+    else if (options.scene == "perlin")
+        out.scene = perlin_scene();
+    else if (options.scene == "final_scene")
+        out.scene = final_scene(build_accel);
+    else
+    {
+        std::cerr << "ERROR: unknown scene '" << options.scene << "'.\n";
+        return false;
+    }
+    out.world = build_accel(out.scene.world);
+
+    auto &cam = out.scene.cam;
+    cam.image_width = options.width;
+    cam.samples_per_pixel = options.spp;
+    cam.sampling = options.sampling;
+    cam.sampler_seed = options.seed;
+    cam.show_progress = false;
+    return true;
+}
+
+int run_worker(int argc, char *argv[])
+{
+    scene_options options;
+    std::string output;
+    std::vector<int> region_values;
+    uint32_t seed_offset = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string key = argv[i];
+        if (key == "--region" && i + 6 < argc)
+        {
+            for (int k = 0; k < 6; k++)
+                region_values.push_back(std::stoi(argv[++i]));
+        }
+        else if (i + 1 >= argc)
+        {
+            std::cerr << "ERROR: missing value for " << key << '\n';
+            return 1;
+        }
+        else if (key == "-o")
+            output = argv[++i];
+        else if (key == "--seed-offset")
+            seed_offset = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (!parse_scene_option(key, argv[i + 1], options))
+        {
+            std::cerr << "ERROR: unknown option " << key << '\n';
+            return 1;
+        }
+        else
+            i++;
+    }
+    if (output.empty())
+    {
+        std::cerr << "ERROR: worker needs -o <file.accum>.\n";
+        return 1;
+    }
+
+    prepared_scene prepared;
+    if (!prepare_scene(options, prepared))
+        return 1;
+    auto &cam = prepared.scene.cam;
+    auto height = cam.image_height();
+    auto region = render_region::full(cam.image_width, height, options.spp);
+    if (!region_values.empty())
+        region = {region_values[0], region_values[1], region_values[2],
+                  region_values[3], region_values[4], region_values[5]};
+    if (!region.valid(cam.image_width, height))
+    {
+        std::cerr << "ERROR: region is outside the " << cam.image_width << 'x' << height
+                  << " image.\n";
+        return 1;
+    }
+
+    seed_random(options.seed + seed_offset);
+    auto begin = std::chrono::steady_clock::now();
+    auto buffer = cam.render_partial(*prepared.world, !prepared.scene.sky, region);
+    auto elapsed_s = seconds_since(begin);
+    if (!buffer.save(output))
+        return 1;
+    std::cout << std::format("worker: rows {}-{} samples {}-{} -> {} ({:.2f} s)\n",
+                             region.y0, region.y1, region.sample_begin, region.sample_end,
+                             output, elapsed_s);
+    return 0;
+}
+
+// 把各部分合并到一个整幅图的缓冲区
+bool merge_files(const std::vector<std::string> &paths, accumulation_buffer &merged)
+{
+    for (const auto &path : paths)
+    {
+        accumulation_buffer part;
+        if (!part.load(path))
+            return false;
+        if (merged.empty())
+        {
+            merged = accumulation_buffer(part.image_width(), part.image_height(),
+                                         {0, 0, part.image_width(), part.image_height(),
+                                          part.region().sample_begin,
+                                          part.region().sample_end});
+        }
+        if (!merged.merge(part))
+            return false;
+    }
+    return !merged.empty();
+}
+
+bool write_ppm(const std::string &path, const accumulation_buffer &buffer)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "ERROR: Could not write '" << path << "'.\n";
+        return false;
+    }
+    buffer.write_ppm(out);
+    return true;
+}
+
+int run_merge(int argc, char *argv[])
+{
+    std::string output = "merged.ppm";
+    std::string accum_output;
+    std::vector<std::string> parts;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--accum" && i + 1 < argc)
+            accum_output = argv[++i];
+        else
+            parts.push_back(arg);
+    }
+
+    accumulation_buffer merged;
+    if (parts.empty() || !merge_files(parts, merged))
+    {
+        std::cerr << "ERROR: nothing to merge.\n";
+        return 1;
+    }
+    if (!accum_output.empty() && !merged.save(accum_output))
+        return 1;
+    if (!write_ppm(output, merged))
+        return 1;
+    std::cout << std::format("merged {} parts -> {}\n", parts.size(), output);
+    return 0;
+}
+
+int run_local(int argc, char *argv[])
+{
+    scene_options options;
+    std::string output = "distributed.ppm";
+    std::string split = "rows";
+    int workers = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+    bool verify = false;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string key = argv[i];
+        if (key == "--verify")
+            verify = true;
+        else if (i + 1 >= argc)
+        {
+            std::cerr << "ERROR: missing value for " << key << '\n';
+            return 1;
+        }
+        else if (key == "-o")
+            output = argv[++i];
+        else if (key == "--workers")
+            workers = std::max(1, std::stoi(argv[++i]));
+        else if (key == "--split")
+            split = argv[++i];
+        else if (!parse_scene_option(key, argv[i + 1], options))
+        {
+            std::cerr << "ERROR: unknown option " << key << '\n';
+            return 1;
+        }
+        else
+            i++;
+    }
+
+    prepared_scene prepared;
+    if (!prepare_scene(options, prepared))
+        return 1;
+    auto width = prepared.scene.cam.image_width;
+    auto height = prepared.scene.cam.image_height();
+
+    // 按行或按样本平均切成 workers 份
+    std::vector<render_region> regions;
+    auto total = (split == "samples") ? options.spp : height;
+    workers = std::min(workers, total);
+    for (int w = 0; w < workers; w++)
+    {
+        auto begin = total * w / workers;
+        auto end = total * (w + 1) / workers;
+        if (split == "samples")
+            regions.push_back({0, 0, width, height, begin, end});
+        else
+            regions.push_back({0, begin, width, end, 0, options.spp});
+    }
+
+    std::string self = argv[0];
+    std::vector<std::string> parts;
+    std::vector<int> results(regions.size(), 0);
+    auto begin = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (size_t w = 0; w < regions.size(); w++)
+        {
+            const auto &r = regions[w];
+            parts.push_back(std::format("{}.part{}.accum", output, w));
+            auto command =
+                std::format("\"{}\" worker -o \"{}\" --region {} {} {} {} {} {} "
+                            "--seed-offset {} {}",
+                            self, parts.back(), r.x0, r.y0, r.x1, r.y1, r.sample_begin,
+                            r.sample_end, w, scene_arguments(options));
+            threads.emplace_back([&results, w, command] {
+                results[w] = std::system(command.c_str());
+            });
+        }
+    }
+    auto elapsed_s = seconds_since(begin);
+    for (size_t w = 0; w < results.size(); w++)
+    {
+        if (results[w] != 0)
+        {
+            std::cerr << "ERROR: worker " << w << " failed.\n";
+            return 1;
+        }
+    }
+
+    accumulation_buffer merged;
+    if (!merge_files(parts, merged) || !write_ppm(output, merged))
+        return 1;
+    for (const auto &part : parts)
+        std::filesystem::remove(part);
+    std::cout << std::format("{} workers ({} split): {} in {:.2f} s\n", regions.size(),
+                             split, output, elapsed_s);
+
+    if (verify)
+    {
+        // independent 采样器的随机数取决于每个 worker 的种子，只有哈希采样器能逐像素比较
+        seed_random(options.seed);
+        auto reference = prepared.scene.cam.render_partial(
+            *prepared.world, !prepared.scene.sky,
+            render_region::full(width, height, options.spp));
+        int differing = 0;
+        double max_diff = 0;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                auto d = merged.average(x, y) - reference.average(x, y);
+                auto diff = std::fmax(std::fabs(d.x()), std::fmax(std::fabs(d.y()),
+                                                                  std::fabs(d.z())));
+                differing += diff != 0 ? 1 : 0;
+                max_diff = std::fmax(max_diff, diff);
+            }
+        }
+        std::cout << std::format("verify: {} of {} pixels differ, max difference {:g}\n",
+                                 differing, width * height, max_diff);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "worker")
+        return run_worker(argc, argv);
+    if (mode == "merge")
+        return run_merge(argc, argv);
+    if (mode == "local")
+        return run_local(argc, argv);
+    std::cerr << "usage: test_distributed_render worker|merge|local [options]\n";
+    return 1;
+}
+
+// NOLINTEND
@@ -3,25 +3,95 @@
 #include "constant_medium.hpp"
 #include "hittable_list.hpp"
 #include "camera.hpp"
+#include "checkpoint.hpp"
+#include "render_scheduler.hpp"
+#include "scene_arena.hpp"
 
+#include <chrono>
 #include <fstream>
-#include <thread>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "quad.hpp"
 #include "sphere.hpp"
 
 // NOLINTBEGIN
 
-void final_scene(int image_width, int samples_per_pixel, int max_depth, int i)
+/*
+NOTE: 检查点与续渲
+    test_final_scene [--resume] [--checkpoint-interval 秒] [--threads N]
+两个渲染（800x800 10000 spp 的最终图和 400x400 250 spp 的预览）提交给同一个 render_scheduler，
+共用所有核心：预览优先级高，它的 tile 先做；预览做完后所有线程都去做最终图。
+渲染过程中每隔一段时间（默认 60 秒）把已完成的 tile 存到 final_scene_{i}.ckpt，
+进程被杀掉后加 --resume 重新运行，已完成的 tile 不再渲染，最终图像与不中断时逐位相同
+（每个 tile 的随机数只由 tile 序号决定）。
+场景里的随机物体用固定种子生成，续渲的进程才能得到同一个场景。
+*/
+
+// 每完成一个 tile 合并一次，间隔够了就交给后台线程写检查点；回调由 scheduler 串行调用
+struct checkpoint_sink
 {
+    render_checkpoint state;
+    double interval_seconds = 60;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    checkpoint_writer writer;
+
+    checkpoint_sink(render_checkpoint initial, double interval, std::string path)
+        : state(std::move(initial)), interval_seconds(interval), writer(std::move(path))
+    {
+    }
+
+    void on_event(const render_event &event)
+    {
+        if (event.tile != nullptr)
+            state.buffer.merge(*event.tile);
+        auto now = std::chrono::steady_clock::now();
+        auto finished = event.type == render_event_type::finished;
+        if (finished || (event.tile != nullptr &&
+                         std::chrono::duration<double>(now - last).count() >=
+                             interval_seconds))
+        {
+            writer.submit(state);
+            last = now;
+        }
+    }
+};
+
+// 成员按相反顺序析构：任务和检查点先释放，arena 最后
+struct final_scene_render
+{
+    std::unique_ptr<scene_arena> arena = std::make_unique<scene_arena>();
+    std::shared_ptr<checkpoint_sink> checkpoints;
+    scheduled_render job;
+    int index = 0;
+};
+
+struct final_scene_settings
+{
+    int image_width;
+    int samples_per_pixel;
+    int max_depth;
+    int priority; // 越大越先渲染
+};
+
+std::optional<final_scene_render> start_final_scene(render_scheduler &scheduler,
+                                                    const final_scene_settings &settings,
+                                                    int i, bool resume,
+                                                    double checkpoint_interval)
+{
+    final_scene_render render;
+    render.index = i;
+    seed_random(20240601 + i);
 
     // ==================== 相机设置 ====================
     camera cam;
 
     cam.aspect_ratio = 1.0;
-    cam.image_width = image_width;
-    cam.samples_per_pixel = samples_per_pixel;
-    cam.max_depth = max_depth;
+    cam.image_width = settings.image_width;
+    cam.samples_per_pixel = settings.samples_per_pixel;
+    cam.max_depth = settings.max_depth;
     cam.background = color(0, 0, 0);
 
     cam.vfov = 40;
@@ -32,8 +102,10 @@ void final_scene(int image_width, int samples_per_pixel, int max_depth, int i)
     cam.defocus_angle = 0;
 
     // ==================== 场景构建 ====================
+    // 物体、材质、纹理和 BVH 节点都放在 arena 里，渲染结束后一次释放
+    auto &arena = *render.arena;
     hittable_list boxes1;
-    auto ground = std::make_shared<lambertian>(color(0.48, 0.83, 0.53));
+    auto ground = arena.make<lambertian>(color(0.48, 0.83, 0.53));
 
     int boxes_per_side = 20;
     for (int i = 0; i < boxes_per_side; i++)
@@ -48,59 +120,93 @@ void final_scene(int image_width, int samples_per_pixel, int max_depth, int i)
             auto y1 = random_double(1, 101);
             auto z1 = z0 + w;
 
-            boxes1.add(box(point3(x0, y0, z0), point3(x1, y1, z1), ground));
+            boxes1.add(arena.make<axis_aligned_box>(point3(x0, y0, z0),
+                                                    point3(x1, y1, z1), ground));
         }
     }
 
     hittable_list world;
 
-    world.add(std::make_shared<bvh_node>(boxes1));
+    world.add(arena.make<bvh_node>(boxes1, arena));
 
-    auto light = std::make_shared<diffuse_light>(color(7, 7, 7));
-    world.add(make_shared<quad>(point3(123, 554, 147), vec3(300, 0, 0), vec3(0, 0, 265),
-                                light));
+    auto light = arena.make<diffuse_light>(color(7, 7, 7));
+    world.add(arena.make<quad>(point3(123, 554, 147), vec3(300, 0, 0), vec3(0, 0, 265),
+                               light));
 
     auto center1 = point3(400, 400, 200);
     auto center2 = center1 + vec3(30, 0, 0);
-    auto sphere_material = std::make_shared<lambertian>(color(0.7, 0.3, 0.1));
-    world.add(make_shared<sphere>(center1, center2, 50, sphere_material));
+    auto sphere_material = arena.make<lambertian>(color(0.7, 0.3, 0.1));
+    world.add(arena.make<sphere>(center1, center2, 50, sphere_material));
 
-    world.add(
-        make_shared<sphere>(point3(260, 150, 45), 50, std::make_shared<dielectric>(1.5)));
-    world.add(make_shared<sphere>(point3(0, 150, 145), 50,
-                                  std::make_shared<metal>(color(0.8, 0.8, 0.9), 1.0)));
+    world.add(arena.make<sphere>(point3(260, 150, 45), 50, arena.make<dielectric>(1.5)));
+    world.add(arena.make<sphere>(point3(0, 150, 145), 50,
+                                 arena.make<metal>(color(0.8, 0.8, 0.9), 1.0)));
 
     auto boundary =
-        make_shared<sphere>(point3(360, 150, 145), 70, std::make_shared<dielectric>(1.5));
+        arena.make<sphere>(point3(360, 150, 145), 70, arena.make<dielectric>(1.5));
     world.add(boundary);
-    world.add(make_shared<constant_medium>(boundary, 0.2, color(0.2, 0.4, 0.9)));
-    boundary =
-        make_shared<sphere>(point3(0, 0, 0), 5000, std::make_shared<dielectric>(1.5));
-    world.add(make_shared<constant_medium>(boundary, .0001, color(1, 1, 1)));
-
-    auto emat = make_shared<lambertian>(std::make_shared<image_texture>("earthmap.jpg"));
-    world.add(make_shared<sphere>(point3(400, 200, 400), 100, emat));
-    auto pertext = std::make_shared<noise_texture_with_vec_and_turb_phase>(0.2);
+    world.add(arena.make<constant_medium>(boundary, 0.2, color(0.2, 0.4, 0.9)));
+    boundary = arena.make<sphere>(point3(0, 0, 0), 5000, arena.make<dielectric>(1.5));
+    world.add(arena.make<constant_medium>(boundary, .0001, color(1, 1, 1)));
+
+    auto emat = arena.make<lambertian>(arena.make<image_texture>("earthmap.jpg"));
+    world.add(arena.make<sphere>(point3(400, 200, 400), 100, emat));
+    auto pertext = arena.make<noise_texture_with_vec_and_turb_phase>(0.2);
     world.add(
-        make_shared<sphere>(point3(220, 280, 300), 80, make_shared<lambertian>(pertext)));
+        arena.make<sphere>(point3(220, 280, 300), 80, arena.make<lambertian>(pertext)));
 
     hittable_list boxes2;
-    auto white = std::make_shared<lambertian>(color(.73, .73, .73));
+    auto white = arena.make<lambertian>(color(.73, .73, .73));
     int ns = 1000;
     for (int j = 0; j < ns; j++)
     {
-        boxes2.add(make_shared<sphere>(point3::random(0, 165), 10, white));
+        boxes2.add(arena.make<sphere>(point3::random(0, 165), 10, white));
     }
 
-    world.add(make_shared<translate>(
-        make_shared<rotate_y>(std::make_shared<bvh_node>(boxes2), 15),
-        vec3(-100, 270, 395)));
+    auto rotated = arena.make<rotate_y>(arena.make<bvh_node>(boxes2, arena), 15);
+    world.add(arena.make<translate>(rotated, vec3(-100, 270, 395)));
 
-    std::ofstream file(std::format("final_scene_{}.ppm", i));
-    cam.render_with_background(hittable_list(std::make_shared<bvh_node>(world)), file);
+    // ==================== 检查点 ====================
+    auto path = std::format("final_scene_{}.ckpt", i);
+    render_checkpoint initial;
+    initial.fingerprint = checkpoint_fingerprint(cam, true, "final_scene");
+    initial.buffer = accumulation_buffer(
+        cam.image_width, cam.image_height(),
+        render_region::full(cam.image_width, cam.image_height(), cam.samples_per_pixel));
+    if (resume && std::filesystem::exists(path))
+    {
+        render_checkpoint saved;
+        if (!saved.load(path))
+            return std::nullopt;
+        if (saved.fingerprint != initial.fingerprint ||
+            saved.buffer.image_width() != cam.image_width ||
+            saved.buffer.image_height() != cam.image_height())
+        {
+            std::cerr << "ERROR: Checkpoint '" << path
+                      << "' was written by a different render.\n";
+            return std::nullopt;
+        }
+        initial = std::move(saved);
+    }
+    render.checkpoints =
+        std::make_shared<checkpoint_sink>(initial, checkpoint_interval, path);
+
+    // ==================== 提交渲染 ====================
+    render_request request;
+    request.cam = cam;
+    request.world = arena.make<bvh_node>(world, arena);
+    request.use_background = true;
+    request.priority = settings.priority;
+    request.seed = 20240601 + i;
+    request.resume = std::move(initial.buffer);
+    request.on_event = [sink = render.checkpoints](const render_event &event) {
+        sink->on_event(event);
+    };
+    render.job = scheduler.submit(std::move(request));
+    return render;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     /*
 让我们把它们放在一起，用一个大薄雾覆盖一切，和一个蓝色的地下反射球
@@ -108,12 +214,58 @@ int main()
 渲染器中留下的最大限制是没有阴影光线，但这就是为什么我们免费获得焦散线和地下。这是一个双刃剑的设计决定.
 另请注意，我们将参数化这个最终场景以支持较低质量的渲染以进行快速测试。
 */
-    std::jthread t0([] { final_scene(800, 10000, 40, 0); });
-    std::jthread t1([] { final_scene(400, 250, 4, 1); });
+    bool resume = false;
+    double checkpoint_interval = 60;
+    int threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--resume")
+            resume = true;
+        else if (arg == "--checkpoint-interval" && i + 1 < argc)
+            checkpoint_interval = std::stod(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::stoi(argv[++i]);
+        else
+        {
+            std::cerr << "usage: test_final_scene [--resume] [--checkpoint-interval s] "
+                         "[--threads N]\n";
+            return 1;
+        }
+    }
+
+    // 预览（i = 1）优先级高：先出图，做完后它的线程转去做最终图
+    const final_scene_settings settings[] = {
+        {800, 10000, 40, 0},
+        {400, 250, 4, 1},
+    };
+    // renders 先声明：scheduler 先析构（停线程、丢掉没做的 tile），arena 里的场景才释放
+    std::vector<final_scene_render> renders;
+    render_scheduler scheduler(threads);
+    for (int i = 0; i < 2; i++)
+    {
+        auto render =
+            start_final_scene(scheduler, settings[i], i, resume, checkpoint_interval);
+        if (!render)
+            return 1;
+        renders.push_back(std::move(*render));
+    }
 
-    t0.join();
-    t1.join();
-    return 0;
+    int failed = 0;
+    for (auto &render : renders)
+    {
+        if (render.job.wait() != render_status::finished)
+        {
+            failed++;
+            continue;
+        }
+        render.checkpoints->writer.flush();
+        std::ofstream file(std::format("final_scene_{}.ppm", render.index));
+        render.job.result().write_ppm(file);
+        std::clog << std::format("final_scene_{}: {:.1f} s\n", render.index,
+                                 render.job.progress().elapsed_seconds);
+    }
+    return failed == 0 ? 0 : 1;
 }
 
 // NOLINTEND
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "bvh_node.hpp"
+#include "heterogeneous_medium.hpp"
+#include "hittable_list.hpp"
+#include "camera.hpp"
+
+#include <fstream>
+
+#include "quad.hpp"
+
+// NOLINTBEGIN
+
+void heterogeneous_smoke()
+{
+    // ==================== 相机设置 ====================
+    camera cam;
+
+    cam.aspect_ratio = 1.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 100;
+    cam.max_depth = 50;
+    cam.background = color(0, 0, 0);
+
+    cam.vfov = 40;
+    cam.lookfrom = point3(278, 278, -800);
+    cam.lookat = point3(278, 278, 0);
+    cam.vup = vec3(0, 1, 0);
+
+    cam.defocus_angle = 0;
+
+    // ==================== 场景构建 ====================
+    auto red = std::make_shared<lambertian>(color(.65, .05, .05));
+    auto white = std::make_shared<lambertian>(color(.73, .73, .73));
+    auto green = std::make_shared<lambertian>(color(.12, .45, .15));
+    auto light = std::make_shared<diffuse_light>(color(7, 7, 7));
+
+    hittable_list world;
+    world.add(
+        make_shared<quad>(point3(555, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), green));
+    world.add(make_shared<quad>(point3(0, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), red));
+    world.add(make_shared<quad>(point3(113, 554, 127), vec3(330, 0, 0), vec3(0, 0, 305),
+                                light));
+    world.add(
+        make_shared<quad>(point3(0, 555, 0), vec3(555, 0, 0), vec3(0, 0, 555), white));
+    world.add(
+        make_shared<quad>(point3(0, 0, 0), vec3(555, 0, 0), vec3(0, 0, 555), white));
+    world.add(
+        make_shared<quad>(point3(0, 0, 555), vec3(555, 0, 0), vec3(0, 555, 0), white));
+
+    // NOTE: 1. 程序化密度：湍流噪声云。阈值以下的区域密度为 0，majorant 网格会直接跳过
+    auto cloud = std::make_shared<perlin_density>(0.1, 0.02, 0.15);
+    world.add(std::make_shared<heterogeneous_medium>(
+        cloud, aabb(point3(60, 0, 80), point3(300, 330, 320)), color(1, 1, 1)));
+
+    // NOTE: 2. 体素网格密度：一个中心浓、边缘淡的球形烟团
+    auto blob_bounds = aabb(point3(310, 0, 260), point3(500, 190, 450));
+    auto blob_center = point3(405, 95, 355);
+    auto blob = std::make_shared<grid_density>(
+        grid_density::from_function(blob_bounds, 32, 32, 32, [&](const point3 &p) {
+            auto r = (p - blob_center).length() / 95.0;
+            return r < 1 ? 0.08 * (1 - r * r) : 0.0;
+        }));
+    world.add(std::make_shared<heterogeneous_medium>(blob, blob_bounds,
+                                                     color(0.9, 0.6, 0.3)));
+
+    std::ofstream file(std::format("heterogeneous_smoke.ppm"));
+    cam.render_with_background(hittable_list(std::make_shared<bvh_node>(world)), file);
+}
+
+int main()
+{
+    /*
+constant_medium 只能表达均匀的烟；这里用 delta tracking 渲染密度随位置变化的烟和云
+*/
+    heterogeneous_smoke();
+}
+
+// NOLINTEND
@@ -0,0 +1,132 @@
+#include "camera.hpp"
+#include "hittable_list.hpp"
+#include "mesh_loader.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 三角形网格渲染
+    test_mesh [模型.obj|.gltf|.glb] [--texture 贴图] [-o 输出.ppm] [--width N] [--spp N]
+              [--zup|--yup]
+
+默认渲染 Vulkan 示例里的 viking_room.obj，贴图 viking_room.png（OBJ 没有 .mtl，贴图由命令行给出）。
+glTF 规定 Y 轴向上；OBJ 没有约定，viking_room 是 Z 轴向上，所以 .obj 默认 --zup。
+相机根据网格包围盒自动取景，背景用天空渐变照明。
+*/
+
+// 与 rtw_image 找图片的方式相同：当前目录，然后逐级向上找 <dir>/ 目录
+std::string find_asset(const std::string &name, const std::string &dir)
+{
+    if (std::filesystem::exists(name))
+        return name;
+    std::string prefix = dir + "/";
+    for (int level = 0; level < 7; level++)
+    {
+        if (std::filesystem::exists(prefix + name))
+            return prefix + name;
+        prefix = "../" + prefix;
+    }
+    return {};
+}
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mesh_name = "viking_room.obj";
+    std::string texture_name;
+    std::string output = "mesh.ppm";
+    int width = 400;
+    int spp = 50;
+    int up = -1; // -1：按扩展名决定
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--texture" && i + 1 < argc)
+            texture_name = argv[++i];
+        else if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--width" && i + 1 < argc)
+            width = std::stoi(argv[++i]);
+        else if (arg == "--spp" && i + 1 < argc)
+            spp = std::stoi(argv[++i]);
+        else if (arg == "--zup")
+            up = 2;
+        else if (arg == "--yup")
+            up = 1;
+        else
+            mesh_name = arg;
+    }
+    if (mesh_name == "viking_room.obj" && texture_name.empty())
+        texture_name = "viking_room.png";
+
+    auto path = find_asset(mesh_name, "vulkan/models");
+    if (path.empty())
+    {
+        std::cerr << "ERROR: Could not find mesh file '" << mesh_name << "'.\n";
+        return 1;
+    }
+    if (up < 0)
+        up = std::filesystem::path(path).extension() == ".obj" ? 2 : 1;
+
+    // 命令行给了贴图：作为没有材质的面的材质（OBJ 没有 .mtl 时就是整个网格）
+    std::shared_ptr<material> fallback;
+    if (!texture_name.empty())
+    {
+        auto texture_path = find_asset(texture_name, "vulkan/textures");
+        if (texture_path.empty())
+            texture_path = texture_name; // 交给 rtw_image 按它的规则再找一遍
+        fallback = std::make_shared<lambertian>(
+            std::make_shared<image_texture>(texture_path.c_str()));
+    }
+
+    auto load_begin = std::chrono::steady_clock::now();
+    auto mesh = load_mesh(path, fallback);
+    if (!mesh)
+        return 1;
+    std::cout << std::format("loaded {}: {} triangles, {} vertices, {} BVH nodes in "
+                             "{:.2f} ms\n",
+                             path, mesh->data().triangle_count(),
+                             mesh->data().positions.size(), mesh->bvh().nodes().size(),
+                             ms_since(load_begin));
+
+    hittable_list world;
+    world.add(mesh);
+
+    // 取景：从包围盒中心沿 (1, 1, 1) 方向（上方轴取较小的抬高）看向中心
+    auto box = mesh->bounding_box();
+    point3 center(0.5 * (box.x.min + box.x.max), 0.5 * (box.y.min + box.y.max),
+                  0.5 * (box.z.min + box.z.max));
+    auto radius = 0.5 * vec3(box.x.size(), box.y.size(), box.z.size()).length();
+
+    camera cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = width;
+    cam.samples_per_pixel = spp;
+    cam.max_depth = 20;
+
+    vec3 view_dir(1, 1, 1);
+    view_dir[up] = 0.8;
+    cam.vfov = 40;
+    cam.lookat = center;
+    cam.lookfrom = center + (2.4 * radius) * unit_vector(view_dir);
+    cam.vup = (up == 2) ? vec3(0, 0, 1) : vec3(0, 1, 0);
+    cam.defocus_angle = 0;
+
+    std::ofstream file(output);
+    auto render_begin = std::chrono::steady_clock::now();
+    cam.render(world, file);
+    std::cout << std::format("rendered {} in {:.2f} s\n", output,
+                             ms_since(render_begin) / 1000.0);
+    return 0;
+}
+
+// NOLINTEND
@@ -0,0 +1,86 @@
+#include "bvh_node.hpp"
+#include "motion_bvh.hpp"
+#include "hittable_list.hpp"
+#include "sphere.hpp"
+#include "camera.hpp"
+
+#include <chrono>
+#include <fstream>
+
+// NOLINTBEGIN
+
+// NOTE: 与 test_moving_blur.cpp 相同的弹跳球场景，但位移放大：球在快门时间内跳得很高
+hittable_list bouncing_spheres(double max_bounce)
+{
+    hittable_list world;
+
+    auto ground_material = std::make_shared<lambertian>(color(0.5, 0.5, 0.5));
+    world.add(std::make_shared<sphere>(point3(0, -1000, 0), 1000, ground_material));
+
+    for (int a = -11; a < 11; a++)
+    {
+        for (int b = -11; b < 11; b++)
+        {
+            point3 center(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
+            if ((center - point3(4, 0.2, 0)).length() <= 0.9)
+                continue;
+
+            auto albedo = color::random() * color::random();
+            auto sphere_material = std::make_shared<lambertian>(albedo);
+            auto center2 = center + vec3(0, random_double(0, max_bounce), 0);
+            world.add(make_shared<sphere>(center, center2, 0.2, sphere_material));
+        }
+    }
+
+    world.add(std::make_shared<sphere>(point3(0, 1, 0), 1.0,
+                                       std::make_shared<dielectric>(1.5)));
+    world.add(std::make_shared<sphere>(
+        point3(-4, 1, 0), 1.0, std::make_shared<lambertian>(color(0.4, 0.2, 0.1))));
+    world.add(std::make_shared<sphere>(
+        point3(4, 1, 0), 1.0, std::make_shared<metal>(color(0.7, 0.6, 0.5), 0.0)));
+    return world;
+}
+
+template <typename Accel>
+void render_with(const char *name, const hittable_list &objects, const camera &setup)
+{
+    auto build_begin = std::chrono::steady_clock::now();
+    hittable_list world(std::make_shared<Accel>(objects));
+    auto build_end = std::chrono::steady_clock::now();
+
+    camera cam = setup;
+    std::ofstream file(std::format("motion_bvh_{}.ppm", name));
+    cam.render(world, file);
+    auto render_end = std::chrono::steady_clock::now();
+
+    std::cout << std::format(
+        "{:<12} build {:8.2f} ms  render {:8.2f} s\n", name,
+        std::chrono::duration<double, std::milli>(build_end - build_begin).count(),
+        std::chrono::duration<double>(render_end - build_end).count());
+}
+
+int main()
+{
+    camera cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 50;
+    cam.max_depth = 20;
+
+    cam.vfov = 20;
+    cam.lookfrom = point3(13, 2, 3);
+    cam.lookat = point3(0, 0, 0);
+    cam.vup = vec3(0, 1, 0);
+
+    cam.defocus_angle = 0.6;
+    cam.focus_dist = 10.0;
+
+    // NOTE: 位移越大，bvh_node 的并集包围盒越松，motion_bvh_node 的优势越明显
+    auto objects = bouncing_spheres(4.0);
+
+    render_with<bvh_node>("bvh_node", objects, cam);
+    render_with<motion_bvh_node>("motion_bvh", objects, cam);
+    return 0;
+}
+
+// NOLINTEND
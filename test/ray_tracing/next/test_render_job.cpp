@@ -0,0 +1,126 @@
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "render_job.hpp"
+
+#include <fstream>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 异步渲染任务演示（render_job.hpp）
+    test_render_job [--scene cornell_box|bvh] [--width N] [--spp N] [--tile N]
+                    [--threads N] [--cancel-at 比例] [-o 输出.ppm] [--verify]
+1. 启动任务，主线程从有界队列里取完成的 tile，同时回调输出 JSON 格式的进度事件
+2. --cancel-at 0.3：完成 30% 的 tile 后取消，输出的图像里只有已完成的 tile
+3. --verify：再用 camera::render_linear 渲染一次，逐像素比较（没有取消时应完全相同）
+*/
+
+int main(int argc, char *argv[])
+{
+    std::string scene_name = "cornell_box";
+    std::string output = "render_job.ppm";
+    int width = 200;
+    int spp = 64;
+    render_job_options options;
+    options.tile_queue_capacity = 8;
+    double cancel_at = 0;
+    bool verify = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--verify")
+            verify = true;
+        else if (i + 1 >= argc)
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+        else if (arg == "--scene")
+            scene_name = argv[++i];
+        else if (arg == "-o")
+            output = argv[++i];
+        else if (arg == "--width")
+            width = std::stoi(argv[++i]);
+        else if (arg == "--spp")
+            spp = std::stoi(argv[++i]);
+        else if (arg == "--tile")
+            options.tile_size = std::stoi(argv[++i]);
+        else if (arg == "--threads")
+            options.threads = std::stoi(argv[++i]);
+        else if (arg == "--cancel-at")
+            cancel_at = std::stod(argv[++i]);
+        else
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(20240601);
+    reference_scene scene;
+    if (scene_name == "cornell_box")
+        scene = cornell_box_scene();
+    else if (scene_name == "bvh")
+        scene = bvh_scene();
+    else
+    {
+        std::cerr << "ERROR: unknown scene '" << scene_name << "'.\n";
+        return 1;
+    }
+    auto world = std::make_shared<flat_bvh_accel>(scene.world);
+    auto cam = scene.cam;
+    cam.image_width = width;
+    cam.samples_per_pixel = spp;
+    cam.sampling = sampler_type::sobol;
+
+    options.on_event = [](const render_event &event) {
+        static constexpr const char *names[] = {"started", "tile", "finished",
+                                                "cancelled"};
+        const auto &p = event.progress;
+        std::cout << std::format("{{\"event\":\"{}\",\"tiles_done\":{},"
+                                 "\"tiles_total\":{},\"samples_done\":{},"
+                                 "\"elapsed_s\":{:.3f}",
+                                 names[static_cast<int>(event.type)], p.tiles_done,
+                                 p.tiles_total, p.samples_done, p.elapsed_seconds);
+        if (event.tile != nullptr)
+        {
+            const auto &r = event.tile->region();
+            std::cout << std::format(",\"tile\":[{},{},{},{}]", r.x0, r.y0, r.x1, r.y1);
+        }
+        std::cout << "}\n";
+    };
+
+    render_job job(cam, world, !scene.sky, options);
+    int received = 0;
+    while (auto tile = job.next_tile())
+    {
+        received++;
+        if (cancel_at > 0 && job.progress().fraction() >= cancel_at)
+            job.cancel();
+    }
+    auto status = job.wait();
+    auto image = job.result();
+    std::clog << std::format("{}: {} tiles received from the queue\n",
+                             status == render_status::finished ? "finished" : "cancelled",
+                             received);
+
+    std::ofstream file(output);
+    image.write_ppm(file);
+
+    if (verify && status == render_status::finished)
+    {
+        auto reference = cam.render_linear(*world, !scene.sky);
+        auto height = cam.image_height();
+        int mismatches = 0;
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                for (int c = 0; c < 3; c++)
+                    if (image.average(x, y)[c] != reference[(y * width) + x][c])
+                        mismatches++;
+        std::clog << std::format("verify: {} mismatching channels\n", mismatches);
+        return mismatches == 0 ? 0 : 1;
+    }
+    return 0;
+}
+
+// NOLINTEND
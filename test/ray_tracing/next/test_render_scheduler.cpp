@@ -0,0 +1,151 @@
+#include "flat_bvh.hpp"
+#include "reference_scenes.hpp"
+#include "render_scheduler.hpp"
+
+#include <fstream>
+#include <vector>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 多任务渲染调度演示（render_scheduler.hpp）
+    test_render_scheduler [--threads N] [--width N] [--spp N] [--preview-after 比例]
+                          [--cancel-final] [--verify]
+1. 先提交一个低优先级的"最终渲染"（cornell_box，width x width，spp），
+   最终渲染完成 preview-after（默认 0.2）后再提交一个高优先级的"预览"（bvh 场景，1/2 宽度，1/8 spp）
+2. 每个 tile 事件输出一行 JSON：哪个任务、完成多少 tile。预览提交后，线程先做完手上的 tile，
+   然后只做预览的 tile，预览结束后再回到最终渲染
+3. 输出 scheduler_final.ppm / scheduler_preview.ppm
+4. --verify：两个任务分别在只有 1 个线程的调度器里单独再渲染一次，逐像素比较，
+   结果应该完全相同（每个 tile 的随机数只取决于任务的 seed 和 tile 序号）
+5. --cancel-final：预览结束后取消最终渲染
+*/
+
+struct job_setup
+{
+    std::string name;
+    reference_scene scene;
+    std::shared_ptr<hittable> world;
+    int width = 0;
+    int spp = 0;
+    int priority = 0;
+    uint32_t seed = 0;
+};
+
+render_request make_request(const job_setup &job)
+{
+    render_request request;
+    request.cam = job.scene.cam;
+    request.cam.image_width = job.width;
+    request.cam.samples_per_pixel = job.spp;
+    request.cam.sampling = sampler_type::sobol;
+    request.world = job.world;
+    request.use_background = !job.scene.sky;
+    request.priority = job.priority;
+    request.tile_size = 16;
+    request.seed = job.seed;
+    return request;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    int width = 200;
+    int spp = 64;
+    double preview_after = 0.2;
+    bool cancel_final = false;
+    bool verify = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--verify")
+            verify = true;
+        else if (arg == "--cancel-final")
+            cancel_final = true;
+        else if (i + 1 >= argc)
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+        else if (arg == "--threads")
+            threads = std::stoi(argv[++i]);
+        else if (arg == "--width")
+            width = std::stoi(argv[++i]);
+        else if (arg == "--spp")
+            spp = std::stoi(argv[++i]);
+        else if (arg == "--preview-after")
+            preview_after = std::stod(argv[++i]);
+        else
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(20240601);
+    std::vector<job_setup> jobs(2);
+    jobs[0] = {"final", cornell_box_scene(), nullptr, width, spp, 0, 1};
+    jobs[1] = {"preview", bvh_scene(), nullptr, std::max(1, width / 2),
+               std::max(1, spp / 8), 1, 2};
+    for (auto &job : jobs)
+        job.world = std::make_shared<flat_bvh_accel>(job.scene.world);
+
+    render_scheduler scheduler(threads);
+    std::clog << std::format("{} worker threads\n", scheduler.threads());
+
+    auto print_event = [](const std::string &name) {
+        return [name](const render_event &event) {
+            static constexpr const char *names[] = {"started", "tile", "finished",
+                                                    "cancelled"};
+            const auto &p = event.progress;
+            std::cout << std::format("{{\"job\":\"{}\",\"event\":\"{}\","
+                                     "\"tiles_done\":{},\"tiles_total\":{},"
+                                     "\"elapsed_s\":{:.3f}}}\n",
+                                     name, names[static_cast<int>(event.type)],
+                                     p.tiles_done, p.tiles_total, p.elapsed_seconds);
+        };
+    };
+
+    auto final_request = make_request(jobs[0]);
+    final_request.on_event = print_event(jobs[0].name);
+    auto final_job = scheduler.submit(std::move(final_request));
+    while (!final_job.done() && final_job.progress().fraction() < preview_after)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    auto preview_request = make_request(jobs[1]);
+    preview_request.on_event = print_event(jobs[1].name);
+    auto preview_job = scheduler.submit(std::move(preview_request));
+
+    preview_job.wait();
+    if (cancel_final)
+        final_job.cancel();
+    final_job.wait();
+
+    std::vector<accumulation_buffer> results = {final_job.result(), preview_job.result()};
+    for (size_t k = 0; k < jobs.size(); k++)
+    {
+        std::ofstream file(std::format("scheduler_{}.ppm", jobs[k].name));
+        results[k].write_ppm(file);
+    }
+
+    if (!verify)
+        return 0;
+    render_scheduler single(1);
+    int mismatches = 0;
+    for (size_t k = 0; k < jobs.size(); k++)
+    {
+        if (k == 0 && cancel_final)
+            continue;
+        auto alone = single.submit(make_request(jobs[k])).result();
+        const auto &shared = results[k];
+        for (int y = 0; y < shared.image_height(); y++)
+            for (int x = 0; x < shared.image_width(); x++)
+                for (int c = 0; c < 3; c++)
+                    if (shared.average(x, y)[c] != alone.average(x, y)[c])
+                        mismatches++;
+    }
+    std::clog << std::format("verify: {} mismatching channels\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// NOLINTEND
@@ -0,0 +1,59 @@
+#include "render_server.hpp"
+
+// NOLINTBEGIN
+
+/*
+NOTE: 常驻渲染服务（render_server.hpp）
+    test_render_server [--threads N] [--socket 路径] [--preload 场景 ...]
+不给 --socket 时从 stdin 读请求，回复写到 stdout；给了就在本地 socket 上等连接。
+--preload 在接受请求之前先加载场景，第一个请求也不用等。例如：
+
+    printf '%s\n' 'render final_scene width=200 spp=4 out=a.ppm' \
+        'render final_scene width=200 spp=4 vfov=30 out=b.ppm' | test_render_server
+
+第一个回复的 setup_ms 是构建 final_scene（物体、贴图、Perlin 表、BVH）的时间，
+第二个请求换了视角，setup_ms 为 0，只剩渲染时间。
+*/
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    std::string socket_path;
+    std::vector<std::string> preload;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+        if (arg == "--threads")
+            threads = std::stoi(argv[++i]);
+        else if (arg == "--socket")
+            socket_path = argv[++i];
+        else if (arg == "--preload")
+            preload.push_back(argv[++i]);
+        else
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    render_server server(threads);
+    std::clog << std::format("{} worker threads\n", server.threads());
+    for (const auto &scene : preload)
+    {
+        bool stop = false;
+        bool quit = false;
+        std::clog << server.handle("load " + scene, stop, quit) << '\n';
+    }
+
+    if (!socket_path.empty())
+        return server.serve_socket(socket_path) ? 0 : 1;
+    server.serve(std::cin, std::cout);
+    return 0;
+}
+
+// NOLINTEND
@@ -0,0 +1,108 @@
+#include "constant_medium.hpp"
+#include "flat_bvh.hpp"
+#include "hittable_list.hpp"
+#include "material.hpp"
+#include "sbvh.hpp"
+#include "sphere.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+
+// NOLINTBEGIN
+
+/*
+NOTE: 体积介质在 SBVH 里的命中概率（sbvh.hpp）
+    test_sbvh_medium [--rays N] [--spheres N] [--seed N]
+
+半径 10、密度 0.05 的雾球里塞满小球（都不在 x 轴上），沿 x 轴穿过球心发 rays 条光线。
+小球挡不到光线，所以命中的只有雾，命中概率应该是 1 - exp(-0.05 * 20) ≈ 0.632。
+小球让 SBVH 在雾球内部做空间分割；如果雾球也被分割，它会出现在好几个叶子里，
+每个叶子各取一次散射距离，命中概率接近 1。分别用 flat_bvh 和 SBVH 统计命中概率：
+    每种输出一行 JSON：引用总数、雾球出现在几个叶子里、命中概率、与期望值差几个标准误差
+雾球出现不止一次，或者命中概率与期望差超过 4 个标准误差时在 stderr 报错，退出码为 1。
+*/
+
+int main(int argc, char *argv[])
+{
+    int rays = 20000;
+    int spheres = 4000;
+    uint32_t seed = 20240601;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--rays")
+            rays = std::stoi(value);
+        else if (key == "--spheres")
+            spheres = std::stoi(value);
+        else if (key == "--seed")
+            seed = static_cast<uint32_t>(std::stoul(value));
+        else
+        {
+            std::cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+
+    seed_random(seed);
+    const double radius = 10;
+    const double density = 0.05;
+    hittable_list scene;
+    auto fog = std::make_shared<constant_medium>(
+        std::make_shared<sphere>(point3(0, 0, 0), radius,
+                                 std::make_shared<lambertian>(color(1, 1, 1))),
+        density, color(1, 1, 1));
+    scene.add(fog);
+    auto white = std::make_shared<lambertian>(color(0.8, 0.8, 0.8));
+    while (static_cast<int>(scene.objects.size()) < spheres + 1)
+    {
+        point3 center(random_double(-9, 9), random_double(-9, 9), random_double(-9, 9));
+        if (center.length() < 9 && std::hypot(center.y(), center.z()) > 1)
+            scene.add(std::make_shared<sphere>(center, 0.2, white));
+    }
+
+    auto expected = 1 - std::exp(-density * 2 * radius);
+    auto sigma = std::sqrt(expected * (1 - expected) / rays);
+    int status = 0;
+    for (const auto *name : {"flat_bvh", "sbvh"})
+    {
+        auto sbvh = std::string(name) == "sbvh";
+        std::vector<aabb> boxes;
+        for (const auto &object : scene.objects)
+            boxes.push_back(object->bounding_box());
+        auto bvh = sbvh ? build_sbvh(scene.objects) : flat_bvh::build(boxes);
+        auto refs = bvh.prim_indices().size();
+        size_t fog_refs = 0;
+        for (auto prim : bvh.prim_indices())
+            fog_refs += prim == 0 ? 1 : 0;
+        flat_bvh_accel world(scene.objects, std::move(bvh));
+
+        int hits = 0;
+        for (int i = 0; i < rays; i++)
+        {
+            ray r(point3(-2 * radius, 0, 0), vec3(1, 0, 0), 0);
+            hit_record rec;
+            if (world.hit(r, interval(0.001, infinity), rec))
+                hits++;
+        }
+        auto p = static_cast<double>(hits) / rays;
+        auto sigmas = std::fabs(p - expected) / sigma;
+        std::cout << std::format(
+            "{{\"accel\":\"{}\",\"primitives\":{},\"refs\":{},\"fog_refs\":{},"
+            "\"p_hit\":{:.4f},\"expected\":{:.4f},\"sigmas\":{:.2f}}}\n",
+            name, scene.objects.size(), refs, fog_refs, p, expected, sigmas);
+        if (fog_refs != 1 || sigmas > 4)
+        {
+            std::cerr << std::format(
+                "ERROR: {}: fog appears in {} leaves, P(hit) = {:.4f}, "
+                "expected {:.4f}.\n",
+                name, fog_refs, p, expected);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// NOLINTEND
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "color.hpp"
 
@@ -20,14 +23,107 @@ NOTE: 在实践中，我们反过来实现这个过程：给定对象上的某
 按照惯例，纹理坐标命名为u和v。
 
 */
+class texture_table;
+
 class texture // NOLINT
 {
   public:
     virtual ~texture() = default;
 
     [[nodiscard]] virtual color value(double u, double v, const point3 &p) const = 0;
+
+    // 编译成 texture_table 里的扁平节点，返回节点下标；默认是调用 value() 的回退节点
+    virtual uint32_t compile(texture_table &table) const;
 };
 
+/*
+NOTE: 扁平化的纹理
+纹理对象之间用 shared_ptr 连接（例如 checker_texture -> 两个 solid_color），
+每次求值都要沿指针走、做虚函数调用。texture_table 把一棵纹理树编译成连续数组里的节点，
+节点之间用下标引用，求值是一个 switch 循环：棋盘格只是选一个子节点继续，不递归。
+纯色节点直接存颜色；噪声、图片节点存指向原对象里 perlin / rtw_image 的指针，只是读数据。
+没有对应节点类型的纹理（自定义的子类）编译成回退节点，仍然调用 value()。
+原来的纹理类保持不变，作为构建器使用；求值结果与 value() 逐位相同。
+*/
+enum class texture_node_type : uint8_t // NOLINT
+{
+    solid,
+    checker,
+    image,
+    noise_nosmooth,
+    noise,
+    noise_vec,
+    turbulence,
+    marble,
+    fallback,
+};
+
+struct texture_node // NOLINT
+{
+    texture_node_type type = texture_node_type::fallback;
+    uint32_t even = 0;  // checker 的两个子节点
+    uint32_t odd = 0;
+    double scale = 0;   // checker：1 / 格子大小；噪声：频率
+    color value;        // solid
+    const perlin *noise = nullptr;
+    const perlin_with_random_vec *noise_vec = nullptr;
+    const rtw_image *image = nullptr;
+    const texture *fallback = nullptr;
+};
+
+class texture_table // NOLINT
+{
+  public:
+    // 同一个纹理对象（例如几个材质共用的纹理）只编译一次
+    uint32_t compile(const texture &tex)
+    {
+        if (auto it = compiled_.find(&tex); it != compiled_.end())
+            return it->second;
+        auto index = tex.compile(*this);
+        compiled_.emplace(&tex, index);
+        return index;
+    }
+
+    uint32_t add(const texture_node &node)
+    {
+        nodes_.push_back(node);
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    [[nodiscard]] color value(uint32_t index, double u, double v, const point3 &p) const;
+
+    // 节点是纯色时返回 true 并给出颜色
+    bool constant(uint32_t index, color &value) const
+    {
+        if (nodes_[index].type != texture_node_type::solid)
+            return false;
+        value = nodes_[index].value;
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return nodes_.size();
+    }
+
+    void clear()
+    {
+        nodes_.clear();
+        compiled_.clear();
+    }
+
+  private:
+    std::vector<texture_node> nodes_;
+    std::unordered_map<const texture *, uint32_t> compiled_;
+};
+
+inline uint32_t texture::compile(texture_table &table) const
+{
+    texture_node node;
+    node.fallback = this;
+    return table.add(node);
+}
+
 class solid_color : public texture
 {
   public:
@@ -43,6 +139,14 @@ class solid_color : public texture
         return albedo_;
     }
 
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::solid;
+        node.value = albedo_;
+        return table.add(node);
+    }
+
   private:
     color albedo_;
 };
@@ -82,14 +186,27 @@ class checker_texture : public texture // NOLINT
     */
     [[nodiscard]] color value(double u, double v, const point3 &p) const override
     {
-        // 核心算法：判断当前位置是偶数格还是奇数格
-        auto xInteger = static_cast<int>(std::floor(invScale_ * p.x()));
-        auto yInteger = static_cast<int>(std::floor(invScale_ * p.y()));
-        auto zInteger = static_cast<int>(std::floor(invScale_ * p.z()));
+        return is_even(invScale_, p) ? even_->value(u, v, p) : odd_->value(u, v, p);
+    }
 
-        bool isEven = (xInteger + yInteger + zInteger) % 2 == 0;
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::checker;
+        node.even = table.compile(*even_);
+        node.odd = table.compile(*odd_);
+        node.scale = invScale_;
+        return table.add(node);
+    }
+
+    // 核心算法：判断当前位置是偶数格还是奇数格
+    static bool is_even(double inv_scale, const point3 &p)
+    {
+        auto xInteger = static_cast<int>(std::floor(inv_scale * p.x()));
+        auto yInteger = static_cast<int>(std::floor(inv_scale * p.y()));
+        auto zInteger = static_cast<int>(std::floor(inv_scale * p.z()));
 
-        return isEven ? even_->value(u, v, p) : odd_->value(u, v, p);
+        return (xInteger + yInteger + zInteger) % 2 == 0;
     }
 
   private:
@@ -110,11 +227,27 @@ class image_texture : public texture // NOLINT
     // 构造函数：从图像文件加载纹理
     constexpr explicit image_texture(const char *filename) : image_(filename) {}
 
+    // 从内存中的已编码图片加载（glTF 内嵌贴图）
+    image_texture(const unsigned char *encoded, size_t size) : image_(encoded, size) {}
+
     [[nodiscard]] color value(double u, double v, const point3 & /*p*/) const override
+    {
+        return lookup(image_, u, v);
+    }
+
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::image;
+        node.image = &image_;
+        return table.add(node);
+    }
+
+    static color lookup(const rtw_image &image, double u, double v)
     {
         // 如果没有纹理数据，返回青色作为调试辅助
         // If we have no texture data, then return solid cyan as a debugging aid.
-        if (image_.height() <= 0)
+        if (image.height() <= 0)
             return {0, 1, 1};
 
         // 步骤1：将纹理坐标限制在[0,1]范围内
@@ -127,11 +260,11 @@ class image_texture : public texture // NOLINT
         v = 1.0 - interval(0, 1).clamp(v); // Flip V to image coordinates
 
         // 步骤3：将归一化的UV坐标转换为像素坐标
-        auto i = static_cast<int>(u * image_.width());
-        auto j = static_cast<int>(v * image_.height());
+        auto i = static_cast<int>(u * image.width());
+        auto j = static_cast<int>(v * image.height());
 
         // 步骤4：获取对应像素的RGB数据
-        const auto *pixel = image_.pixel_data(i, j);
+        const auto *pixel = image.pixel_data(i, j);
 
         // 步骤5：将8位RGB值(0-255)转换为浮点数颜色值(0.0-1.0)
         constexpr auto k_max_value = 255.0;
@@ -149,9 +282,22 @@ class noise_texture_nosmooth : public texture // NOLINT
     noise_texture_nosmooth() = default;
 
     [[nodiscard]] color value(double u, double v, const point3 &p) const override
+    {
+        return evaluate(noise_, p);
+    }
+
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::noise_nosmooth;
+        node.noise = &noise_;
+        return table.add(node);
+    }
+
+    static color evaluate(const perlin &noise, const point3 &p)
     {
         // NOTE: 生成随颜色： 散列随机纹理
-        return color(1, 1, 1) * noise_.noise_nosmooth(p);
+        return color(1, 1, 1) * noise.noise_nosmooth(p);
     }
 
   private:
@@ -164,9 +310,23 @@ class noise_texture : public texture // NOLINT
     explicit noise_texture(double scale) : scale(scale) {}
 
     [[nodiscard]] color value(double u, double v, const point3 &p) const override
+    {
+        return evaluate(noise_, scale, p);
+    }
+
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::noise;
+        node.noise = &noise_;
+        node.scale = scale;
+        return table.add(node);
+    }
+
+    static color evaluate(const perlin &noise, double scale, const point3 &p)
     {
         // NOTE: 生成随颜色： 散列随机纹理
-        return color(1, 1, 1) * noise_.noise(scale * p);
+        return color(1, 1, 1) * noise.noise(scale * p);
     }
 
   private:
@@ -180,6 +340,21 @@ class noise_texture_with_vec : public texture // NOLINT
     explicit noise_texture_with_vec(double scale) : scale(scale) {}
 
     [[nodiscard]] color value(double u, double v, const point3 &p) const override
+    {
+        return evaluate(noise, scale, p);
+    }
+
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::noise_vec;
+        node.noise_vec = &noise;
+        node.scale = scale;
+        return table.add(node);
+    }
+
+    static color evaluate(const perlin_with_random_vec &noise, double scale,
+                          const point3 &p)
     {
         /*
         scale * p：控制噪声的频率（缩放采样点）
@@ -202,6 +377,19 @@ class noise_texture_with_vec_and_turb : public texture // NOLINT
     explicit noise_texture_with_vec_and_turb(double scale) : scale(scale) {}
 
     [[nodiscard]] color value(double u, double v, const point3 &p) const override
+    {
+        return evaluate(noise, p);
+    }
+
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::turbulence;
+        node.noise_vec = &noise;
+        return table.add(node);
+    }
+
+    static color evaluate(const perlin_with_random_vec &noise, const point3 &p)
     {
         return color(1, 1, 1) * noise.turb(p, 7);
     }
@@ -239,6 +427,21 @@ class noise_texture_with_vec_and_turb_phase : public texture // NOLINT
   石材的纹理 + 地质变形
 */
     [[nodiscard]] color value(double u, double v, const point3 &p) const override
+    {
+        return evaluate(noise, scale, p);
+    }
+
+    uint32_t compile(texture_table &table) const override
+    {
+        texture_node node;
+        node.type = texture_node_type::marble;
+        node.noise_vec = &noise;
+        node.scale = scale;
+        return table.add(node);
+    }
+
+    static color evaluate(const perlin_with_random_vec &noise, double scale,
+                          const point3 &p)
     {
         // NOTE: std::sin(相位). phase 意思是相位
         // NOTE: 核心思想：用湍流扰动正弦波
@@ -254,3 +457,37 @@ class noise_texture_with_vec_and_turb_phase : public texture // NOLINT
     perlin_with_random_vec noise;
     double scale;
 };
+
+// 节点求值：棋盘格只选子节点继续循环，其他节点直接返回
+inline color texture_table::value(uint32_t index, double u, double v,
+                                  const point3 &p) const
+{
+    for (;;)
+    {
+        const auto &node = nodes_[index];
+        switch (node.type)
+        {
+        case texture_node_type::solid:
+            return node.value;
+        case texture_node_type::checker:
+            index = checker_texture::is_even(node.scale, p) ? node.even : node.odd;
+            continue;
+        case texture_node_type::image:
+            return image_texture::lookup(*node.image, u, v);
+        case texture_node_type::noise_nosmooth:
+            return noise_texture_nosmooth::evaluate(*node.noise, p);
+        case texture_node_type::noise:
+            return noise_texture::evaluate(*node.noise, node.scale, p);
+        case texture_node_type::noise_vec:
+            return noise_texture_with_vec::evaluate(*node.noise_vec, node.scale, p);
+        case texture_node_type::turbulence:
+            return noise_texture_with_vec_and_turb::evaluate(*node.noise_vec, p);
+        case texture_node_type::marble:
+            return noise_texture_with_vec_and_turb_phase::evaluate(*node.noise_vec,
+                                                                   node.scale, p);
+        case texture_node_type::fallback:
+            break;
+        }
+        return node.fallback->value(u, v, p);
+    }
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "flat_bvh.hpp"
+#include "hittable.hpp"
+#include "material.hpp"
+
+/*
+NOTE: 索引三角形网格
+box_quads() 用 6 个 quad 拼一个 hittable_list；这种"一个图元一个对象"的做法用在
+百万三角形的模型上不现实：每个三角形一次堆分配、一个 shared_ptr 材质、一个虚函数。
+
+这里一个网格就是一个 hittable：
+    mesh_data：位置 / 法线 / UV 共用一套顶点下标，三角形只存 3 个 uint32 下标
+    flat_bvh：网格自己的 BVH，叶子里是三角形编号，遍历时直接做三角形求交，没有虚函数
+    materials：按三角形的 material_ids 查，同一网格可以有多个材质
+mesh_data 用 shared_ptr<const> 保存，同一份顶点数据可以被多个实例（translate / rotate_y）共享。
+*/
+struct mesh_data // NOLINT
+{
+    std::vector<point3> positions;
+    std::vector<vec3> normals;           // 可选：与 positions 一一对应，用于平滑着色
+    std::vector<double> uvs;             // 可选：每个顶点 2 个（u, v），v 向上，与 quad 相同
+    std::vector<uint32_t> indices;       // 每个三角形 3 个顶点下标
+    std::vector<uint32_t> material_ids;  // 可选：每个三角形的材质下标，空表示都用 0 号
+
+    [[nodiscard]] size_t triangle_count() const
+    {
+        return indices.size() / 3;
+    }
+
+    // 检查下标都在范围内；加载器读的是外部文件，构建网格前先检查
+    [[nodiscard]] bool validate(size_t material_count) const
+    {
+        if (indices.size() % 3 != 0)
+            return false;
+        if (!normals.empty() && normals.size() != positions.size())
+            return false;
+        if (!uvs.empty() && uvs.size() != 2 * positions.size())
+            return false;
+        if (!material_ids.empty() && material_ids.size() != triangle_count())
+            return false;
+        for (auto index : indices)
+            if (index >= positions.size())
+                return false;
+        for (auto id : material_ids)
+            if (id >= material_count)
+                return false;
+        return true;
+    }
+};
+
+class triangle_mesh : public hittable // NOLINT
+{
+  public:
+    triangle_mesh(std::shared_ptr<const mesh_data> data,
+                  std::vector<std::shared_ptr<material>> materials, int max_leaf_size = 4)
+        : data_(std::move(data)), materials_(std::move(materials))
+    {
+        std::vector<aabb> boxes;
+        boxes.reserve(data_->triangle_count());
+        for (size_t tri = 0; tri < data_->triangle_count(); tri++)
+        {
+            const auto &p0 = vertex(tri, 0);
+            const auto &p1 = vertex(tri, 1);
+            const auto &p2 = vertex(tri, 2);
+            boxes.emplace_back(aabb(p0, p1), aabb(p2, p2));
+        }
+        bvh_ = flat_bvh::build(boxes, max_leaf_size);
+        bbox_ = bvh_.bounds();
+    }
+
+    // 只有一个材质的便捷构造
+    triangle_mesh(std::shared_ptr<const mesh_data> data, std::shared_ptr<material> mat)
+        : triangle_mesh(std::move(data),
+                        std::vector<std::shared_ptr<material>>{std::move(mat)})
+    {
+    }
+
+    bool hit(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        if (!intersect(r, ray_t, rec))
+            return false;
+        finish_hit(r, rec);
+        return true;
+    }
+
+    // 记下最近的三角形和重心坐标，交点信息等最终确定是这个网格时再算
+    bool intersect(const ray &r, interval ray_t, hit_record &rec) const override
+    {
+        const watertight_ray wr(r);
+        uint32_t hit_tri = 0;
+        double hit_t = 0;
+        double hit_b1 = 0;
+        double hit_b2 = 0;
+        bool hit_anything = bvh_.closest_hit(r, ray_t, [&](uint32_t tri, interval &t) {
+            count_stat(render_stat::triangle_tests);
+            double b1 = 0;
+            double b2 = 0;
+            double t_hit = 0;
+            if (!intersect_triangle(wr, tri, t, t_hit, b1, b2))
+                return false;
+            t.max = t_hit;
+            hit_t = t_hit;
+            hit_tri = tri;
+            hit_b1 = b1;
+            hit_b2 = b2;
+            return true;
+        });
+        if (!hit_anything)
+            return false;
+
+        rec.t = hit_t;
+        rec.prim = hit_tri;
+        rec.b1 = hit_b1;
+        rec.b2 = hit_b2;
+        rec.deferred = this;
+        return true;
+    }
+
+    void surface_interaction(const ray &r, hit_record &rec) const override
+    {
+        fill_record(r, rec.prim, rec.b1, rec.b2, rec);
+    }
+
+    [[nodiscard]] bool occluded(const ray &r, interval ray_t) const override
+    {
+        const watertight_ray wr(r);
+        return bvh_.any_hit(r, ray_t, [&](uint32_t tri, const interval &t) {
+            count_stat(render_stat::triangle_tests);
+            double b1 = 0;
+            double b2 = 0;
+            double t_hit = 0;
+            return intersect_triangle(wr, tri, t, t_hit, b1, b2);
+        });
+    }
+
+    void collect_materials(std::vector<const material *> &out) const override
+    {
+        for (const auto &mat : materials_)
+            out.push_back(mat.get());
+    }
+
+    [[nodiscard]] aabb bounding_box() const override
+    {
+        return bbox_;
+    }
+
+    [[nodiscard]] const mesh_data &data() const
+    {
+        return *data_;
+    }
+
+    [[nodiscard]] const flat_bvh &bvh() const
+    {
+        return bvh_;
+    }
+
+  private:
+    std::shared_ptr<const mesh_data> data_;
+    std::vector<std::shared_ptr<material>> materials_;
+    flat_bvh bvh_;
+    aabb bbox_;
+
+    /*
+    NOTE: 水密（watertight）光线-三角形求交，Woop / Benthin / Wald 2013
+    Möller-Trumbore 在两个三角形共享的边上，因为两边的舍入不同，可能两边都判为"没打中"，
+    渲染出一条条漏光的裂缝。水密算法先把光线变换到以光线原点为原点、方向为 +z 的坐标系：
+        1. 选 |d| 最大的轴为 kz，另外两个轴为 kx, ky（kz 方向为负时交换 kx, ky 保持手性）
+        2. 剪切：x' = x - Sx*z, y' = y - Sy*z，光线变成沿 z 轴的直线
+        3. 在 xy 平面上算三条边函数 U, V, W，三者同号即命中
+    共享边的边函数由同样的两个顶点、同样的运算算出，在两个三角形里只差一个符号，
+    所以一条光线不会同时漏掉相邻的两个三角形。
+    每条光线的 kx/ky/kz 和剪切系数只算一次。
+    */
+    struct watertight_ray
+    {
+        int kx, ky, kz;
+        double sx, sy, sz;
+        point3 origin;
+
+        explicit watertight_ray(const ray &r) : origin(r.origin())
+        {
+            const auto &d = r.direction();
+            kz = 0;
+            if (std::fabs(d.y()) > std::fabs(d[kz]))
+                kz = 1;
+            if (std::fabs(d.z()) > std::fabs(d[kz]))
+                kz = 2;
+            kx = (kz + 1) % 3;
+            ky = (kx + 1) % 3;
+            if (d[kz] < 0)
+                std::swap(kx, ky);
+
+            sx = d[kx] / d[kz];
+            sy = d[ky] / d[kz];
+            sz = 1.0 / d[kz];
+        }
+    };
+
+    [[nodiscard]] const point3 &vertex(size_t tri, int corner) const
+    {
+        return data_->positions[data_->indices[(3 * tri) + corner]];
+    }
+
+    bool intersect_triangle(const watertight_ray &wr, uint32_t tri, const interval &ray_t,
+                            double &t_hit, double &b1, double &b2) const
+    {
+        // 第1步：顶点平移到光线原点，并剪切到光线坐标系
+        const auto a = vertex(tri, 0) - wr.origin;
+        const auto b = vertex(tri, 1) - wr.origin;
+        const auto c = vertex(tri, 2) - wr.origin;
+
+        const double ax = a[wr.kx] - (wr.sx * a[wr.kz]);
+        const double ay = a[wr.ky] - (wr.sy * a[wr.kz]);
+        const double bx = b[wr.kx] - (wr.sx * b[wr.kz]);
+        const double by = b[wr.ky] - (wr.sy * b[wr.kz]);
+        const double cx = c[wr.kx] - (wr.sx * c[wr.kz]);
+        const double cy = c[wr.ky] - (wr.sy * c[wr.kz]);
+
+        // 第2步：边函数，同号（允许为 0，边上算命中）才在三角形内
+        const double u = (cx * by) - (cy * bx);
+        const double v = (ax * cy) - (ay * cx);
+        const double w = (bx * ay) - (by * ax);
+        if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+            return false;
+
+        const double det = u + v + w;
+        if (det == 0)
+            return false; // 光线与三角形平面平行，或三角形退化
+
+        // 第3步：z 坐标按边函数加权，再除以 det 得到 t
+        const double az = wr.sz * a[wr.kz];
+        const double bz = wr.sz * b[wr.kz];
+        const double cz = wr.sz * c[wr.kz];
+        const double t_scaled = (u * az) + (v * bz) + (w * cz);
+
+        const double inv_det = 1.0 / det;
+        const double t = t_scaled * inv_det;
+        if (!ray_t.surrounds(t))
+            return false;
+
+        t_hit = t;
+        b1 = v * inv_det; // 顶点 1 的权重
+        b2 = w * inv_det; // 顶点 2 的权重
+        return true;
+    }
+
+    void fill_record(const ray &r, uint32_t tri, double b1, double b2,
+                     hit_record &rec) const
+    {
+        const auto &mesh = *data_;
+        const auto i0 = mesh.indices[(3 * tri) + 0];
+        const auto i1 = mesh.indices[(3 * tri) + 1];
+        const auto i2 = mesh.indices[(3 * tri) + 2];
+        const double b0 = 1.0 - b1 - b2;
+
+        rec.p = r.at(rec.t);
+
+        // 几何法线决定正反面；有顶点法线时用插值法线着色，并翻到与几何法线同一侧
+        const auto &p0 = mesh.positions[i0];
+        auto geometric =
+            unit_vector(cross(mesh.positions[i1] - p0, mesh.positions[i2] - p0));
+        rec.set_face_normal(r, geometric);
+        if (!mesh.normals.empty())
+        {
+            auto shading = (b0 * mesh.normals[i0]) + (b1 * mesh.normals[i1]) +
+                           (b2 * mesh.normals[i2]);
+            if (shading.length_squared() > 0)
+            {
+                shading = unit_vector(shading);
+                rec.normal = dot(shading, rec.normal) < 0 ? -shading : shading;
+            }
+        }
+
+        if (mesh.uvs.empty())
+        {
+            rec.u = b1;
+            rec.v = b2;
+        }
+        else
+        {
+            rec.u = (b0 * mesh.uvs[(2 * i0)]) + (b1 * mesh.uvs[(2 * i1)]) +
+                    (b2 * mesh.uvs[(2 * i2)]);
+            rec.v = (b0 * mesh.uvs[(2 * i0) + 1]) + (b1 * mesh.uvs[(2 * i1) + 1]) +
+                    (b2 * mesh.uvs[(2 * i2) + 1]);
+        }
+
+        auto id = mesh.material_ids.empty() ? 0 : mesh.material_ids[tri];
+        rec.mat = materials_[id].get();
+    }
+};
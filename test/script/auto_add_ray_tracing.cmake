@@ -1,10 +1,16 @@
+# NOTE: 打开后定义 RT_STATS，渲染时统计热路径计数器（render_stats.hpp），默认关闭不影响性能
+option(RAY_TRACING_STATS "Enable ray tracing hot-path counters" OFF)
+
 function(auto_add_ray_tracing dir_name libraries)
     if(NOT DEFINED TEST_ROOT_DIR)
         message(FATAL_ERROR "TEST_ROOT_DIR is not defined. Please define TEST_ROOT_DIR.")
     endif()
 
-    # 获取指定目录下的所有 .cpp 文件
-    file(GLOB test_files "${TEST_ROOT_DIR}/${dir_name}/test_*.cpp")
+    # 获取指定目录下的所有 .cpp 文件：test_*.cpp 是演示程序，bench_*.cpp 是 benchmark
+    file(GLOB test_files
+        "${TEST_ROOT_DIR}/${dir_name}/test_*.cpp"
+        "${TEST_ROOT_DIR}/${dir_name}/bench_*.cpp"
+    )
 
     # 遍历每个 .cpp 文件
     foreach(test_file ${test_files})
@@ -23,6 +29,9 @@ function(auto_add_ray_tracing dir_name libraries)
 
         # NOTE: 加引号，才能方便 list 以 空格的传输
         target_link_libraries(${target_name} PRIVATE "${libraries}")
+        if(RAY_TRACING_STATS)
+            target_compile_definitions(${target_name} PRIVATE RT_STATS)
+        endif()
 
         message(STATUS "[Added exec]: ${target_name} from ${test_file}")
     endforeach()